@@ -0,0 +1,132 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisCurveOptionBenchmark.h"
+
+#include <QTest>
+#include <QDir>
+
+#include <kis_distance_information.h>
+#include <kis_spacing_information.h>
+#include <kis_timing_information.h>
+#include <brushengine/kis_paint_information.h>
+#include <brushengine/kis_paintop_preset.h>
+#include <brushengine/kis_paintop_settings.h>
+
+#include "kis_pressure_size_option.h"
+#include "kis_pressure_opacity_option.h"
+#include "kis_pressure_flow_option.h"
+#include "kis_pressure_rotation_option.h"
+#include "kis_pressure_softness_option.h"
+#include "kis_pressure_ratio_option.h"
+#include "kis_pressure_spacing_option.h"
+#include "kis_pressure_scatter_option.h"
+#include "kis_pressure_darken_option.h"
+#include "kis_pressure_mix_option.h"
+
+#define NUM_DABS 1000
+
+
+void KisCurveOptionBenchmark::benchmarkPresetDynamics_data()
+{
+    QTest::addColumn<QString>("presetFileName");
+
+    QTest::newRow("autobrush_300px") << "autobrush_300px.kpp";
+    QTest::newRow("AutoBrush_70px_rotated") << "AutoBrush_70px_rotated.kpp";
+    QTest::newRow("softbrush_30px_full") << "softbrush_30px_full.kpp";
+    QTest::newRow("softbrush_opacity1") << "softbrush_opacity1.kpp";
+    QTest::newRow("softbrush_softness1") << "softbrush_softness1.kpp";
+    QTest::newRow("roundmarker40px") << "roundmarker40px.kpp";
+    QTest::newRow("colorsmudge") << "colorsmudge.kpp";
+}
+
+/**
+ * Measures the time a paintop spends on evaluating the sensors of
+ * its curve options for every dab. The set of options is the one
+ * of the pixel brush engine, the options disabled in the preset are
+ * skipped like the paintop does.
+ */
+void KisCurveOptionBenchmark::benchmarkPresetDynamics()
+{
+    QFETCH(QString, presetFileName);
+
+    KisPaintOpPresetSP preset = new KisPaintOpPreset(QString(FILES_DATA_DIR) + QDir::separator() + presetFileName);
+    if (!preset->load()) {
+        QSKIP("The preset cannot be loaded, probably the paintop is not available");
+    }
+
+    KisPressureSizeOption sizeOption;
+    KisPressureOpacityOption opacityOption;
+    KisPressureFlowOption flowOption;
+    KisPressureRotationOption rotationOption;
+    KisPressureSoftnessOption softnessOption;
+    KisPressureRatioOption ratioOption;
+    KisPressureSpacingOption spacingOption;
+    KisPressureScatterOption scatterOption;
+    KisPressureDarkenOption darkenOption;
+    KisPressureMixOption mixOption;
+
+    QList<KisCurveOption*> allOptions;
+    allOptions << &sizeOption << &opacityOption << &flowOption
+               << &rotationOption << &softnessOption << &ratioOption
+               << &spacingOption << &scatterOption << &darkenOption
+               << &mixOption;
+
+    QList<KisCurveOption*> options;
+
+    Q_FOREACH (KisCurveOption *option, allOptions) {
+        option->readOptionSetting(preset->settings());
+        if (option->isChecked()) {
+            option->resetAllSensors();
+            options << option;
+        }
+    }
+
+    QVector<KisPaintInformation> infos;
+    for (int i = 0; i < NUM_DABS; i++) {
+        const qreal t = qreal(i) / NUM_DABS;
+
+        infos << KisPaintInformation(QPointF(1000.0 * t, 300.0 * sin(10 * t)),
+                                     0.5 + 0.5 * sin(20 * t),
+                                     60 * cos(7 * t), 60 * sin(5 * t),
+                                     0.0, 0.0, 1.0,
+                                     5 * i, 0.5 + 0.5 * cos(3 * t));
+    }
+
+    qreal sum = 0;
+
+    QBENCHMARK {
+        KisDistanceInformation distance(infos.first().pos(), 0.0);
+
+        for (auto it = infos.begin(); it != infos.end(); ++it) {
+            KisPaintInformation::DistanceInformationRegistrar registrar =
+                it->registerDistanceInformation(&distance);
+
+            Q_FOREACH (KisCurveOption *option, options) {
+                sum += option->computeSizeLikeValue(*it);
+            }
+
+            distance.registerPaintedDab(*it, KisSpacingInformation(1.0), KisTimingInformation());
+        }
+    }
+
+    // make sure the compiler doesn't throw the calculations away
+    QVERIFY(sum >= 0);
+}
+
+QTEST_MAIN(KisCurveOptionBenchmark)
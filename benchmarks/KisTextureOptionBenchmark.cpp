@@ -0,0 +1,116 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisTextureOptionBenchmark.h"
+
+#include <QTest>
+#include <QPainter>
+
+#include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoResourceServerProvider.h>
+#include <resources/KoPattern.h>
+
+#include <kis_fixed_paint_device.h>
+#include <kis_properties_configuration.h>
+#include <brushengine/kis_paint_information.h>
+
+#include "kis_embedded_pattern_manager.h"
+#include "kis_texture_option.h"
+
+
+namespace {
+
+KoPattern* createNoisePattern()
+{
+    QImage image(256, 256, QImage::Format_ARGB32);
+
+    qsrand(1);
+    for (int y = 0; y < image.height(); y++) {
+        QRgb *pixel = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < image.width(); x++) {
+            const int value = qrand() % 256;
+            pixel[x] = qRgba(value, value, value, 255);
+        }
+    }
+
+    return new KoPattern(image,
+                         "__benchmark_texture_pattern",
+                         KoResourceServerProvider::instance()->patternServer()->saveLocation());
+}
+
+}
+
+void KisTextureOptionBenchmark::benchmarkApply_data()
+{
+    QTest::addColumn<int>("dabSize");
+    QTest::addColumn<int>("texturingMode");
+
+    const QVector<int> sizes = {10, 30, 100, 300};
+
+    Q_FOREACH (int size, sizes) {
+        QTest::newRow(QString("multiply-%1px").arg(size).toLatin1())
+            << size << int(KisTextureProperties::MULTIPLY);
+        QTest::newRow(QString("subtract-%1px").arg(size).toLatin1())
+            << size << int(KisTextureProperties::SUBTRACT);
+    }
+}
+
+void KisTextureOptionBenchmark::benchmarkApply()
+{
+    QFETCH(int, dabSize);
+    QFETCH(int, texturingMode);
+
+    QScopedPointer<KoPattern> pattern(createNoisePattern());
+
+    // the options of a typical textured preset with pressure-dependent strength
+    KisPropertiesConfigurationSP setting(new KisPropertiesConfiguration());
+    KisEmbeddedPatternManager::saveEmbeddedPattern(setting, pattern.data());
+    setting->setProperty("Texture/Pattern/Enabled", true);
+    setting->setProperty("Texture/Pattern/Scale", 1.0);
+    setting->setProperty("Texture/Pattern/OffsetX", 13);
+    setting->setProperty("Texture/Pattern/OffsetY", 7);
+    setting->setProperty("Texture/Pattern/TexturingMode", texturingMode);
+    setting->setProperty("Texture/Pattern/Strength", 0.8);
+
+    KisTextureProperties properties(0);
+    properties.fillProperties(setting);
+    QVERIFY(properties.m_enabled);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisFixedPaintDeviceSP dab = new KisFixedPaintDevice(cs);
+    dab->setRect(QRect(0, 0, dabSize, dabSize));
+    dab->initialize();
+
+    const KoColor color(Qt::black, cs);
+    const KisPaintInformation info(QPointF(100.0, 100.0), 0.7);
+
+    int i = 0;
+
+    QBENCHMARK {
+        // the dab is filled every time, otherwise all the iterations
+        // except the first one would work on a transparent dab
+        dab->fill(0, 0, dabSize, dabSize, color.data());
+
+        // move the dab along a line, so that the texture offset changes
+        properties.apply(dab, QPoint(37 * i, 11 * i), info);
+        i++;
+    }
+}
+
+QTEST_MAIN(KisTextureOptionBenchmark)
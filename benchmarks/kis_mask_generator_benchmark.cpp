@@ -108,4 +108,130 @@ void KisMaskGeneratorBenchmark::benchmarkSquare()
     }
 }
 
+#include <QPainter>
+#include <QtMath>
+#include "kis_qimage_pyramid.h"
+
+/**
+ * Compares the old way of transforming the tips of predefined brushes
+ * (QPainter on ARGB images) with the vectorized resampling of the mask
+ * planes. The set of dab shapes is the same for both methods.
+ */
+void benchmarkPredefinedTip(bool useRotation, bool useResampler)
+{
+    QImage image(512, 512, QImage::Format_ARGB32);
+    image.fill(0);
+
+    QPainter gc(&image);
+    gc.setRenderHints(QPainter::Antialiasing);
+    QRadialGradient gradient(QPointF(256, 256), 256);
+    gradient.setColorAt(0.0, Qt::black);
+    gradient.setColorAt(1.0, Qt::transparent);
+    gc.setBrush(gradient);
+    gc.setPen(Qt::NoPen);
+    gc.drawEllipse(QRect(0, 0, 512, 512));
+    gc.end();
+
+    KisQImagePyramid pyramid(image);
+
+    QVector<KisDabShape> shapes;
+    qsrand(1);
+    for (int i = 0; i < 100; i++) {
+        const qreal scale = 0.1 + qreal(qrand()) / RAND_MAX * 0.9;
+        const qreal rotation = useRotation ? qreal(qrand()) / RAND_MAX * 2 * M_PI : 0.0;
+        shapes << KisDabShape(scale, 1.0, rotation);
+    }
+
+    QBENCHMARK {
+        Q_FOREACH (const KisDabShape &shape, shapes) {
+            const QImage result = useResampler ?
+                pyramid.createMaskImage(shape, 0.3, 0.6) :
+                pyramid.createImage(shape, 0.3, 0.6);
+            Q_UNUSED(result);
+        }
+    }
+}
+
+void KisMaskGeneratorBenchmark::benchmarkPredefinedTipScaling_QPainter()
+{
+    benchmarkPredefinedTip(false, false);
+}
+
+void KisMaskGeneratorBenchmark::benchmarkPredefinedTipScaling_Resampler()
+{
+    benchmarkPredefinedTip(false, true);
+}
+
+void KisMaskGeneratorBenchmark::benchmarkPredefinedTipRotation_QPainter()
+{
+    benchmarkPredefinedTip(true, false);
+}
+
+void KisMaskGeneratorBenchmark::benchmarkPredefinedTipRotation_Resampler()
+{
+    benchmarkPredefinedTip(true, true);
+}
+
+#include <KoColor.h>
+#include "kis_auto_brush.h"
+#include <brushengine/kis_paint_information.h>
+
+/**
+ * A 2000px soft brush, the size where a single dab takes milliseconds.
+ * The single threaded case generates the whole dab in one call, the way
+ * it was done for the brushes that disallow threading; the auto brush
+ * ones go through the band splitting and, for axis-aligned dabs, through
+ * the quadrant mirroring.
+ */
+const int largeDabDiameter = 2000;
+
+void KisMaskGeneratorBenchmark::benchmarkLargeDab_SingleThread()
+{
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisFixedPaintDeviceSP dev = new KisFixedPaintDevice(cs);
+    dev->setRect(QRect(0, 0, largeDabDiameter, largeDabDiameter));
+    dev->initialize();
+
+    MaskProcessingData data(dev, cs,
+                            0.0, 1.0,
+                            0.5 * largeDabDiameter - 0.5, 0.5 * largeDabDiameter - 0.5, 0);
+
+    KisCircleMaskGenerator gen(largeDabDiameter, 1.0, 0.5, 0.5, 2, true);
+
+    KisBrushMaskApplicatorBase *applicator = gen.applicator();
+    applicator->initializeData(&data);
+
+    QBENCHMARK {
+        applicator->process(dev->bounds());
+    }
+}
+
+void benchmarkLargeAutoBrush(qreal rotation)
+{
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+    const KoColor color(Qt::black, cs);
+
+    KisBrushSP brush = new KisAutoBrush(new KisCircleMaskGenerator(largeDabDiameter, 1.0, 0.5, 0.5, 2, true), 0.0, 0.0);
+
+    // the same as the brush op does
+    brush->setThreadingAllowed(false);
+
+    KisFixedPaintDeviceSP dev = new KisFixedPaintDevice(cs);
+    KisPaintInformation info(QPointF(100.0, 100.0), 1.0);
+
+    QBENCHMARK {
+        brush->mask(dev, color, KisDabShape(1.0, 1.0, rotation), info);
+    }
+}
+
+void KisMaskGeneratorBenchmark::benchmarkLargeDab_AutoBrush()
+{
+    benchmarkLargeAutoBrush(0.0);
+}
+
+void KisMaskGeneratorBenchmark::benchmarkLargeDab_AutoBrushRotated()
+{
+    benchmarkLargeAutoBrush(0.3);
+}
+
 QTEST_MAIN(KisMaskGeneratorBenchmark)
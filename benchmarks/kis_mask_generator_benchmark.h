@@ -30,6 +30,15 @@ private Q_SLOTS:
     void benchmarkSIMD_FadedBrush();
     void benchmarkSquare();
 
+    void benchmarkPredefinedTipScaling_QPainter();
+    void benchmarkPredefinedTipScaling_Resampler();
+    void benchmarkPredefinedTipRotation_QPainter();
+    void benchmarkPredefinedTipRotation_Resampler();
+
+    void benchmarkLargeDab_SingleThread();
+    void benchmarkLargeDab_AutoBrush();
+    void benchmarkLargeDab_AutoBrushRotated();
+
 };
 
 #endif
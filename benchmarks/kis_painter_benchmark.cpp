@@ -461,5 +461,23 @@ void KisPainterBenchmark::benchmarkMassiveBltFixed()
 }
 
 
+void KisPainterBenchmark::benchmarkMassiveBltFixedSmallDabs()
+{
+    /**
+     * Small brushes with high spacing: every dab touches only a few
+     * pixels of a tile, so the per-dab overhead of walking the tiles
+     * dominates the composition time
+     */
+    const int idealThreadCount = 8;
+
+    for (int d = 3; d < 25; d += 5) {
+        for (qreal sp = 0.5; sp < 3.1; sp += 1.25) {
+            for (int n = 16; n < 1100; n *= 4) {
+                benchmarkMassiveBltFixedImpl(n, d, sp, idealThreadCount, Qt::Horizontal);
+                benchmarkMassiveBltFixedImpl(n, d, sp, idealThreadCount, Qt::Vertical | Qt::Horizontal);
+            }
+        }
+    }
+}
 
 QTEST_MAIN(KisPainterBenchmark)
@@ -52,6 +52,7 @@ private Q_SLOTS:
     void benchmarkBitBlt2();
     void benchmarkBitBltOldData();
     void benchmarkMassiveBltFixed();
+    void benchmarkMassiveBltFixedSmallDabs();
 
     
 };
@@ -48,6 +48,15 @@ inline double drand48()
 #define GMP_IMAGE_HEIGHT 2067
 #include <kis_painter.h>
 #include <brushengine/kis_paintop_registry.h>
+#include <brushengine/kis_paintop.h>
+#include <kis_distance_information.h>
+
+#include <KisRunnableStrokeJobData.h>
+#include <KisRunnableStrokeJobsInterface.h>
+
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <tuple>
 
 //#define SAVE_OUTPUT
 
@@ -55,6 +64,43 @@ static const int LINES = 20;
 static const int RECTANGLES = 20;
 const QString OUTPUT_FORMAT = ".png";
 
+/**
+ * Executes the jobs generated by the paintops in a thread pool in a
+ * way similar to the strokes framework: concurrent jobs are run in
+ * parallel, sequential jobs wait until all the previous jobs are
+ * completed.
+ */
+class ThreadedRunnableJobsExecutor : public KisRunnableStrokeJobsInterface
+{
+    struct Runnable : public QRunnable {
+        Runnable(KisRunnableStrokeJobDataBase *data) : m_data(data) {}
+        ~Runnable() override { delete m_data; }
+        void run() override { m_data->run(); }
+
+        KisRunnableStrokeJobDataBase *m_data;
+    };
+
+public:
+    void addRunnableJobs(const QVector<KisRunnableStrokeJobDataBase*> &list) override {
+        Q_FOREACH (KisRunnableStrokeJobDataBase *data, list) {
+            if (data->sequentiality() == KisStrokeJobData::CONCURRENT) {
+                m_pool.start(new Runnable(data));
+            } else {
+                m_pool.waitForDone();
+                data->run();
+                delete data;
+            }
+        }
+    }
+
+    void waitForDone() {
+        m_pool.waitForDone();
+    }
+
+private:
+    QThreadPool m_pool;
+};
+
 void KisStrokeBenchmark::initTestCase()
 {
     m_dataPath = QString(FILES_DATA_DIR) + QDir::separator();
@@ -356,6 +402,12 @@ void KisStrokeBenchmark::colorsmudgeRL()
     benchmarkStroke(presetFileName);
 }
 
+void KisStrokeBenchmark::colorsmudgeDabsPerSecond()
+{
+    QString presetFileName = "colorsmudge.kpp";
+    benchmarkDabsPerSecond(presetFileName);
+}
+
 
 void KisStrokeBenchmark::roundMarker()
 {
@@ -530,6 +582,7 @@ void KisStrokeBenchmark::benchmarkRandomLines(QString presetFileName)
             KisPaintInformation pi2(m_endPoints[i], 1.0);
             m_painter->paintLine(pi1, pi2, &currentDistance);
         }
+        finishAsyncronousUpdates();
     }
 
 #ifdef SAVE_OUTPUT
@@ -585,6 +638,7 @@ void KisStrokeBenchmark::benchmarkStroke(QString presetFileName)
         KisDistanceInformation currentDistance;
         m_painter->paintBezierCurve(m_pi1, m_c1, m_c1, m_pi2, &currentDistance);
         m_painter->paintBezierCurve(m_pi2, m_c2, m_c2, m_pi3, &currentDistance);
+        finishAsyncronousUpdates();
     }
 
 #ifdef SAVE_OUTPUT
@@ -593,6 +647,74 @@ void KisStrokeBenchmark::benchmarkStroke(QString presetFileName)
 #endif
 }
 
+void KisStrokeBenchmark::benchmarkDabsPerSecond(QString presetFileName)
+{
+    KisPaintOpPresetSP preset = new KisPaintOpPreset(m_dataPath + presetFileName);
+    bool loadedOk = preset->load();
+    if (!loadedOk){
+        dbgKrita << "The preset was not loaded correctly. Done.";
+        return;
+    } else {
+        dbgKrita << "preset : " << presetFileName;
+    }
+
+    ThreadedRunnableJobsExecutor executor;
+    m_painter->setRunnableStrokeJobsInterface(&executor);
+    m_painter->setPaintOpPreset(preset, m_layer, m_image);
+
+    int numDabs = 0;
+    qint64 elapsedNSecs = 0;
+    QElapsedTimer timer;
+
+    QBENCHMARK{
+        timer.start();
+
+        KisDistanceInformation currentDistance;
+        m_painter->paintBezierCurve(m_pi1, m_c1, m_c1, m_pi2, &currentDistance);
+        m_painter->paintBezierCurve(m_pi2, m_c2, m_c2, m_pi3, &currentDistance);
+
+        // wait for the dab rendering jobs and blit the rendered dabs
+        executor.waitForDone();
+        finishAsyncronousUpdates();
+
+        elapsedNSecs += timer.nsecsElapsed();
+        numDabs += currentDistance.currentDabSeqNo();
+    }
+
+    // the paintop keeps a pointer to the executor, so recreate it
+    m_painter->setRunnableStrokeJobsInterface(0);
+    m_painter->setPaintOpPreset(preset, m_layer, m_image);
+
+    if (elapsedNSecs > 0) {
+        qDebug() << qPrintable(QString("%1: %2 dabs, %3 dabs/sec")
+                               .arg(presetFileName)
+                               .arg(numDabs)
+                               .arg(numDabs / (elapsedNSecs * 1e-9), 0, 'f', 1));
+    }
+
+#ifdef SAVE_OUTPUT
+    m_layer->paintDevice()->convertToQImage(0).save(m_outputPath + presetFileName + "_dabs" + OUTPUT_FORMAT);
+#endif
+}
+
+/**
+ * The paintops with asynchronous updates only queue the dabs in
+ * paintAt(), so we should ask them to blit the queued dabs.
+ */
+void KisStrokeBenchmark::finishAsyncronousUpdates()
+{
+    KisPaintOp *paintOp = m_painter->paintOp();
+    if (!paintOp) return;
+
+    bool needsMoreUpdates = true;
+
+    while (needsMoreUpdates) {
+        QVector<KisRunnableStrokeJobData*> jobs;
+        std::tie(std::ignore, needsMoreUpdates) = paintOp->doAsyncronousUpdate(jobs);
+        m_painter->runnableStrokeJobsInterface()->addRunnableJobs(jobs);
+    }
+}
+
 static const int COUNT = 1000000;
 void KisStrokeBenchmark::benchmarkRand48()
 {
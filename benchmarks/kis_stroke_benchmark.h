@@ -68,6 +68,9 @@ private:
         inline void benchmarkLine(QString presetFileName);
         inline void benchmarkCircle(QString presetFileName);
         inline void benchmarkRectangle(QString presetFileName);
+        inline void benchmarkDabsPerSecond(QString presetFileName);
+
+        void finishAsyncronousUpdates();
 
 private Q_SLOTS:
     void initTestCase();
@@ -126,6 +129,7 @@ private Q_SLOTS:
 
     void colorsmudge();
     void colorsmudgeRL();
+    void colorsmudgeDabsPerSecond();
 
     void roundMarker();
     void roundMarkerRandomLines();
@@ -0,0 +1,309 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisQImagePyramidCache.h"
+
+#include <QGlobalStatic>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QHash>
+#include <QWeakPointer>
+#include <QImage>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <QRunnable>
+
+#include <kis_debug.h>
+#include <kis_image_config.h>
+
+#include "kis_qimage_pyramid.h"
+
+Q_GLOBAL_STATIC(KisQImagePyramidCache, s_instance)
+
+namespace {
+
+const QString pyramidFileSuffix = ".pyramid";
+
+/**
+ * Removes the least recently used files from \p dirPath until the total
+ * size of the cache fits into \p sizeLimit bytes
+ */
+void enforceSizeLimit(const QString &dirPath, qint64 sizeLimit)
+{
+    QDir dir(dirPath);
+    const QFileInfoList files =
+        dir.entryInfoList(QStringList() << "*" + pyramidFileSuffix,
+                          QDir::Files, QDir::Time | QDir::Reversed);
+
+    qint64 totalSize = 0;
+    Q_FOREACH (const QFileInfo &info, files) {
+        totalSize += info.size();
+    }
+
+    Q_FOREACH (const QFileInfo &info, files) {
+        if (totalSize <= sizeLimit) break;
+
+        if (QFile::remove(info.absoluteFilePath())) {
+            totalSize -= info.size();
+        }
+    }
+}
+
+class PyramidWriter : public QRunnable
+{
+public:
+    PyramidWriter(const QString &dirPath, const QString &filePath,
+                  QSharedPointer<const KisQImagePyramid> pyramid,
+                  qint64 sizeLimit)
+        : m_dirPath(dirPath),
+          m_filePath(filePath),
+          m_pyramid(pyramid),
+          m_sizeLimit(sizeLimit)
+    {
+    }
+
+    void run() override {
+        QDir().mkpath(m_dirPath);
+
+        QSaveFile file(m_filePath);
+        if (!file.open(QIODevice::WriteOnly)) {
+            warnKrita << "Failed to open brush pyramid cache file" << m_filePath;
+            return;
+        }
+
+        if (!m_pyramid->save(&file)) {
+            file.cancelWriting();
+            warnKrita << "Failed to write brush pyramid cache file" << m_filePath;
+            return;
+        }
+
+        file.commit();
+        enforceSizeLimit(m_dirPath, m_sizeLimit);
+    }
+
+private:
+    QString m_dirPath;
+    QString m_filePath;
+    QSharedPointer<const KisQImagePyramid> m_pyramid;
+    qint64 m_sizeLimit;
+};
+
+}
+
+struct KisQImagePyramidCache::Private
+{
+    QMutex mutex;
+    QHash<QByteArray, QWeakPointer<const KisQImagePyramid>> pyramids;
+    QHash<qint64, QByteArray> imageKeys;
+
+    QString cacheDir;
+
+    // the files are written one-by-one to keep eviction simple
+    QThreadPool writerPool;
+
+    QByteArray keyForImage(const QImage &image);
+    QString filePath(const QByteArray &key) const;
+    QSharedPointer<const KisQImagePyramid> loadFromDisk(const QByteArray &key);
+};
+
+KisQImagePyramidCache::KisQImagePyramidCache()
+    : m_d(new Private)
+{
+    const QString cacheLocation = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (!cacheLocation.isEmpty()) {
+        m_d->cacheDir = cacheLocation + QDir::separator() + "brush_pyramids";
+    }
+
+    m_d->writerPool.setMaxThreadCount(1);
+}
+
+KisQImagePyramidCache::~KisQImagePyramidCache()
+{
+    m_d->writerPool.waitForDone();
+}
+
+KisQImagePyramidCache *KisQImagePyramidCache::instance()
+{
+    return s_instance;
+}
+
+int KisQImagePyramidCache::minCachedImagePixels()
+{
+    return 1024 * 1024;
+}
+
+void KisQImagePyramidCache::setCacheDir(const QString &path)
+{
+    QMutexLocker l(&m_d->mutex);
+    m_d->cacheDir = path;
+}
+
+QString KisQImagePyramidCache::cacheDir() const
+{
+    QMutexLocker l(&m_d->mutex);
+    return m_d->cacheDir;
+}
+
+void KisQImagePyramidCache::waitForDone()
+{
+    m_d->writerPool.waitForDone();
+}
+
+QByteArray KisQImagePyramidCache::imageKey(const QImage &image)
+{
+    QCryptographicHash hash(QCryptographicHash::Md5);
+
+    const qint32 header[] = {image.width(), image.height(), qint32(image.format())};
+    hash.addData(reinterpret_cast<const char*>(header), sizeof(header));
+
+    // hash the rows separately to skip the padding at the end of scanlines
+    const int rowSize = image.width() * image.depth() / 8;
+    for (int y = 0; y < image.height(); y++) {
+        hash.addData(reinterpret_cast<const char*>(image.constScanLine(y)), rowSize);
+    }
+
+    return hash.result().toHex();
+}
+
+QByteArray KisQImagePyramidCache::Private::keyForImage(const QImage &image)
+{
+    /**
+     * All the copies of the brush share the same image data, so we can
+     * avoid rehashing of the image by looking up its cacheKey(). Qt never
+     * reuses the keys of the destroyed images.
+     */
+    {
+        QMutexLocker l(&mutex);
+        auto it = imageKeys.constFind(image.cacheKey());
+        if (it != imageKeys.constEnd()) {
+            return *it;
+        }
+    }
+
+    const QByteArray key = KisQImagePyramidCache::imageKey(image);
+
+    QMutexLocker l(&mutex);
+
+    // the keys of the images are tiny, just don't let them pile up forever
+    if (imageKeys.size() > 1024) {
+        imageKeys.clear();
+    }
+
+    imageKeys.insert(image.cacheKey(), key);
+    return key;
+}
+
+QString KisQImagePyramidCache::Private::filePath(const QByteArray &key) const
+{
+    return cacheDir + QDir::separator() + QString::fromLatin1(key) + pyramidFileSuffix;
+}
+
+QSharedPointer<const KisQImagePyramid> KisQImagePyramidCache::Private::loadFromDisk(const QByteArray &key)
+{
+    QString path;
+    {
+        QMutexLocker l(&mutex);
+        if (cacheDir.isEmpty()) return QSharedPointer<const KisQImagePyramid>();
+        path = filePath(key);
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return QSharedPointer<const KisQImagePyramid>();
+
+    QSharedPointer<KisQImagePyramid> pyramid(new KisQImagePyramid());
+
+    if (!pyramid->load(&file)) {
+        warnKrita << "Removing corrupted brush pyramid cache file" << path;
+        file.close();
+        QFile::remove(path);
+        return QSharedPointer<const KisQImagePyramid>();
+    }
+
+    file.close();
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+    /**
+     * Mark the file as recently used for the eviction. The file time
+     * can be changed only through a handle opened for writing, ReadWrite
+     * doesn't truncate the file.
+     */
+    QFile touchedFile(path);
+    if (touchedFile.open(QIODevice::ReadWrite)) {
+        touchedFile.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    }
+#endif
+
+    return pyramid;
+}
+
+QSharedPointer<const KisQImagePyramid> KisQImagePyramidCache::pyramid(const QImage &baseImage)
+{
+    if (qint64(baseImage.width()) * baseImage.height() < minCachedImagePixels()) {
+        return QSharedPointer<const KisQImagePyramid>(new KisQImagePyramid(baseImage));
+    }
+
+    const QByteArray key = m_d->keyForImage(baseImage);
+
+    {
+        QMutexLocker l(&m_d->mutex);
+        QSharedPointer<const KisQImagePyramid> pyramid = m_d->pyramids.value(key).toStrongRef();
+        if (pyramid) return pyramid;
+    }
+
+    KisImageConfig cfg(true);
+    const bool useDiskCache = cfg.useBrushPyramidDiskCache();
+
+    QSharedPointer<const KisQImagePyramid> pyramid;
+
+    if (useDiskCache) {
+        pyramid = m_d->loadFromDisk(key);
+    }
+
+    if (!pyramid) {
+        pyramid.reset(new KisQImagePyramid(baseImage));
+
+        QMutexLocker l(&m_d->mutex);
+        if (useDiskCache && !m_d->cacheDir.isEmpty()) {
+            const qint64 sizeLimit = qint64(cfg.brushPyramidDiskCacheSizeLimit()) * 1024 * 1024;
+            m_d->writerPool.start(new PyramidWriter(m_d->cacheDir, m_d->filePath(key), pyramid, sizeLimit));
+        }
+    }
+
+    QMutexLocker l(&m_d->mutex);
+
+    // another thread might have prepared the same pyramid in the meantime
+    QSharedPointer<const KisQImagePyramid> existingPyramid = m_d->pyramids.value(key).toStrongRef();
+    if (existingPyramid) return existingPyramid;
+
+    for (auto it = m_d->pyramids.begin(); it != m_d->pyramids.end();) {
+        if (it.value().isNull()) {
+            it = m_d->pyramids.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    m_d->pyramids.insert(key, pyramid);
+    return pyramid;
+}
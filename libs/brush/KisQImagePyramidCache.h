@@ -0,0 +1,95 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISQIMAGEPYRAMIDCACHE_H
+#define KISQIMAGEPYRAMIDCACHE_H
+
+#include "kritabrush_export.h"
+
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QByteArray>
+#include <QString>
+
+class QImage;
+class KisQImagePyramid;
+
+/**
+ * A process-wide content-addressed cache of the brush pyramids.
+ *
+ * Building a pyramid for a large predefined brush means several smooth
+ * rescalings of a multi-megapixel image, which makes the first dab of
+ * every session laggy. The cache keys the pyramids by the hash of the
+ * brush tip image, so that:
+ *
+ * 1) all the brush objects with the same tip (e.g. the copies of the
+ *    brush loaded by different presets or views) share one pyramid
+ *    while it is alive;
+ *
+ * 2) the pyramids of the large brushes are stored in the cache directory
+ *    of the application and are loaded from there in the next sessions
+ *    instead of being rebuilt.
+ *
+ * The files are written in a background thread. The total size of the
+ * directory is limited by KisImageConfig::brushPyramidDiskCacheSizeLimit(),
+ * the least recently used files are removed first.
+ *
+ * The small brushes are not hashed, their pyramids are cheap to build.
+ */
+class BRUSH_EXPORT KisQImagePyramidCache
+{
+public:
+    KisQImagePyramidCache();
+    ~KisQImagePyramidCache();
+
+    static KisQImagePyramidCache* instance();
+
+    /**
+     * Returns a pyramid for \p baseImage, either a shared, a loaded from
+     * disk or a newly built one
+     */
+    QSharedPointer<const KisQImagePyramid> pyramid(const QImage &baseImage);
+
+    /**
+     * The content hash of the image used as a key in the cache
+     */
+    static QByteArray imageKey(const QImage &image);
+
+    /**
+     * The minimal number of pixels in the base image for the pyramid
+     * to be shared and stored on disk
+     */
+    static int minCachedImagePixels();
+
+    /**
+     * Overrides the location of the on-disk cache. Used in the unittests.
+     */
+    void setCacheDir(const QString &path);
+    QString cacheDir() const;
+
+    /**
+     * Waits until all the pending files are written to disk
+     */
+    void waitForDone();
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif // KISQIMAGEPYRAMIDCACHE_H
@@ -55,6 +55,57 @@ inline double drand48()
 }
 #endif
 
+namespace {
+
+/**
+ * Dabs with more pixels than this are split into more row bands than
+ * the number of threads for better balancing, because a single dab of
+ * a huge brush takes milliseconds to generate.
+ */
+const int LARGE_DAB_THRESHOLD = 512 * 512;
+
+QVector<QRect> splitIntoRowBands(const QRect &rc, int numBands)
+{
+    QVector<QRect> rects;
+
+    numBands = qBound(1, numBands, qMax(1, rc.height()));
+    const int bandHeight = rc.height() / numBands;
+
+    for (int i = 0; i < numBands; i++) {
+        const int top = rc.top() + i * bandHeight;
+        // the last band absorbs the remainder of the division
+        const int height = i < numBands - 1 ? bandHeight : rc.bottom() - top + 1;
+        rects << QRect(rc.x(), top, rc.width(), height);
+    }
+
+    return rects;
+}
+
+/**
+ * Copies the top-left quadrant of the dab into the other three ones,
+ * mirroring it relative to the center of the dab
+ */
+void mirrorDabQuadrant(quint8 *data, int width, int height, int pixelSize)
+{
+    const int rowStride = width * pixelSize;
+    const int halfWidth = (width + 1) / 2;
+    const int halfHeight = (height + 1) / 2;
+
+    for (int y = 0; y < halfHeight; y++) {
+        quint8 *row = data + y * rowStride;
+
+        for (int x = halfWidth; x < width; x++) {
+            memcpy(row + x * pixelSize, row + (width - 1 - x) * pixelSize, pixelSize);
+        }
+    }
+
+    for (int y = halfHeight; y < height; y++) {
+        memcpy(data + y * rowStride, data + (height - 1 - y) * rowStride, rowStride);
+    }
+}
+
+}
+
 struct KisAutoBrush::Private {
     Private()
         : randomness(0), density(1.0), idealThreadCountCached(1) {}
@@ -71,8 +122,47 @@ struct KisAutoBrush::Private {
     qreal randomness;
     qreal density;
     int idealThreadCountCached;
+
+    bool isMaskSymmetric(int width, int height, double centerX, double centerY, qreal angle) const;
 };
 
+/**
+ * All the mask generators produce shapes symmetric relative to their axes
+ * as long as they have two spikes (KisAutoBrushTest::testMirroredMask
+ * checks each of them). When the dab is axis-aligned and its
+ * center lies exactly in the middle of the dab, the mirrored pixels have
+ * exactly the same coordinates relative to the center (up to the sign),
+ * so mirroring gives exactly the same result as generating the whole dab.
+ *
+ * Both conditions are checked without any tolerance, otherwise the result
+ * would not be bitwise equal. The applicators rotate the pixels with sin()
+ * and cos() of the angle, so the dab is axis-aligned only when these are
+ * exactly 0 and 1. That is not the case for M_PI_2 and M_PI, because
+ * cos(M_PI_2) and sin(M_PI) are not zero in floating point, so rotated
+ * dabs are generated as a whole.
+ *
+ * Supersampling takes the samples asymmetrically inside the pixel, and the
+ * randomness is obviously not symmetric, so such masks are not mirrored.
+ */
+bool KisAutoBrush::Private::isMaskSymmetric(int width, int height, double centerX, double centerY, qreal angle) const
+{
+    // the same values as MaskProcessingData uses
+    const double cosa = cos(angle);
+    const double sina = sin(angle);
+
+    const bool isAxisAligned =
+        (sina == 0.0 && qAbs(cosa) == 1.0) ||
+        (cosa == 0.0 && qAbs(sina) == 1.0);
+
+    const bool isCentered =
+        2.0 * centerX == width - 1 &&
+        2.0 * centerY == height - 1;
+
+    return isAxisAligned && isCentered &&
+        randomness == 0.0 && density == 1.0 &&
+        shape->spikes() == 2 && !shape->shouldSupersample();
+}
+
 KisAutoBrush::KisAutoBrush(KisMaskGenerator* as, qreal angle, qreal randomness, qreal density)
     : KisBrush(),
       d(new Private)
@@ -301,20 +391,47 @@ void KisAutoBrush::generateMaskAndApplyMaskOrCreateDab(KisFixedPaintDeviceSP dst
     KisBrushMaskApplicatorBase *applicator = d->shape->applicator();
     applicator->initializeData(&data);
 
+    /**
+     * When the dab is filled with a plain color, the pixels of a symmetric
+     * mask are symmetric as well, so we can generate only one quadrant
+     * of the dab and mirror it
+     */
+    const bool useMirroring =
+        color && d->isMaskSymmetric(dstWidth, dstHeight, centerX, centerY, angle);
+
+    const QRect processRect = useMirroring ?
+        QRect(0, 0, (dstWidth + 1) / 2, (dstHeight + 1) / 2) :
+        QRect(0, 0, dstWidth, dstHeight);
+
+    /**
+     * The paintops that render several dabs concurrently disallow
+     * threading in the brush, nesting blockingMap() into their jobs
+     * would only oversubscribe the global thread pool. The random
+     * source of the applicator is shared, so random masks are not
+     * split into the small bands either.
+     */
+    const bool isLargeDab =
+        processRect.width() * processRect.height() >= LARGE_DAB_THRESHOLD &&
+        d->randomness == 0.0 && d->density == 1.0;
+
     int jobs = d->idealThreadCountCached;
-    if (threadingAllowed() && dstHeight > 100 && jobs >= 4) {
-        int splitter = dstHeight / jobs;
-        QVector<QRect> rects;
-        for (int i = 0; i < jobs - 1; i++) {
-            rects << QRect(0, i * splitter, dstWidth, splitter);
-        }
-        rects << QRect(0, (jobs - 1)*splitter, dstWidth, dstHeight - (jobs - 1)*splitter);
+    if (threadingAllowed() && isLargeDab && jobs > 1) {
+        // the cost of the rows differs a lot, so use smaller bands for better balancing
+        QVector<QRect> rects = splitIntoRowBands(processRect, 4 * jobs);
+        OperatorWrapper wrapper(applicator);
+        QtConcurrent::blockingMap(rects, wrapper);
+    }
+    else if (threadingAllowed() && processRect.height() > 100 && jobs >= 4) {
+        QVector<QRect> rects = splitIntoRowBands(processRect, jobs);
         OperatorWrapper wrapper(applicator);
         QtConcurrent::blockingMap(rects, wrapper);
     }
     else {
-        QRect rect(0, 0, dstWidth, dstHeight);
-        applicator->process(rect);
+        applicator->process(processRect);
+    }
+
+    if (useMirroring) {
+        mirrorDabQuadrant(dst->data(), dstWidth, dstHeight, pixelSize);
     }
 }
 
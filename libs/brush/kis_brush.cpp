@@ -482,10 +482,24 @@ void KisBrush::generateMaskAndApplyMaskOrCreateDab(KisFixedPaintDeviceSP dst,
     Q_UNUSED(info_);
     Q_UNUSED(softnessFactor);
 
-    QImage outputImage = d->brushPyramid->pyramid(this)->createImage(KisDabShape(
-            shape.scale() * d->scale, shape.ratio(),
-            -normalizeAngle(shape.rotation() + d->angle)),
-        subPixelX, subPixelY);
+    const KisQImagePyramid *pyramid = d->brushPyramid->pyramid(this);
+    const KisDabShape transformedShape(shape.scale() * d->scale, shape.ratio(),
+                                       -normalizeAngle(shape.rotation() + d->angle));
+
+    bool hasColor = this->hasColor();
+
+    /**
+     * For color tips and for grayscale tips used as masks the pyramid
+     * can resample the precomputed mask plane directly, which is much
+     * faster than transforming the whole ARGB image. Colored tips used
+     * as masks take the mask from the blue channel, so they still go
+     * through the generic path.
+     */
+    const bool useMaskPlane = hasColor || pyramid->isGrayscale();
+
+    QImage outputImage = useMaskPlane ?
+        pyramid->createMaskImage(transformedShape, subPixelX, subPixelY) :
+        pyramid->createImage(transformedShape, subPixelX, subPixelY);
 
     qint32 maskWidth = outputImage.width();
     qint32 maskHeight = outputImage.height();
@@ -506,7 +520,6 @@ void KisBrush::generateMaskAndApplyMaskOrCreateDab(KisFixedPaintDeviceSP dst,
     quint8 *dabPointer = dst->data();
     quint8 *rowPointer = dabPointer;
     quint8 *alphaArray = new quint8[maskWidth];
-    bool hasColor = this->hasColor();
 
     for (int y = 0; y < maskHeight; y++) {
         const quint8* maskPointer = outputImage.constScanLine(y);
@@ -523,16 +536,8 @@ void KisBrush::generateMaskAndApplyMaskOrCreateDab(KisFixedPaintDeviceSP dst,
             }
         }
 
-        if (hasColor) {
-            const quint8 *src = maskPointer;
-            quint8 *dst = alphaArray;
-            for (int x = 0; x < maskWidth; x++) {
-                const QRgb *c = reinterpret_cast<const QRgb*>(src);
-
-                *dst = KoColorSpaceMaths<quint8>::multiply(255 - qGray(*c), qAlpha(*c));
-                src += 4;
-                dst++;
-            }
+        if (useMaskPlane) {
+            cs->applyAlphaU8Mask(rowPointer, maskPointer, maskWidth);
         }
         else {
             const quint8 *src = maskPointer;
@@ -544,9 +549,10 @@ void KisBrush::generateMaskAndApplyMaskOrCreateDab(KisFixedPaintDeviceSP dst,
                 src += 4;
                 dst++;
             }
+
+            cs->applyAlphaU8Mask(rowPointer, alphaArray, maskWidth);
         }
 
-        cs->applyAlphaU8Mask(rowPointer, alphaArray, maskWidth);
         rowPointer += maskWidth * pixelSize;
         dabPointer = rowPointer;
 
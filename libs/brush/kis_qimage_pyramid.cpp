@@ -20,13 +20,20 @@
 
 #include <limits>
 #include <QPainter>
+#include <QDataStream>
+#include <QIODevice>
 #include <kis_debug.h>
+#include <KoColorSpaceMaths.h>
+#include <KisAlphaResampler.h>
 
 #define MIPMAP_SIZE_THRESHOLD 512
 #define MAX_MIPMAP_SCALE 8.0
 
 #define QPAINTER_WORKAROUND_BORDER 1
 
+#define PYRAMID_FILE_MAGIC 0x4B514950 // "KQIP"
+#define PYRAMID_FILE_VERSION 1
+
 
 KisQImagePyramid::KisQImagePyramid(const QImage &baseImage)
 {
@@ -260,7 +267,32 @@ QSize levelSize = image.size();
                    -QPAINTER_WORKAROUND_BORDER,
                    image.width() + 2 * QPAINTER_WORKAROUND_BORDER,
                    image.height() + 2 * QPAINTER_WORKAROUND_BORDER);
-    m_levels.append(PyramidLevel(tmp, levelSize));
+    appendPreparedLevel(tmp, levelSize);
+}
+
+void KisQImagePyramid::appendPreparedLevel(const QImage &imageWithBorder, const QSize &levelSize)
+{
+    /**
+     * The mask value (255 - gray) * alpha is linear in premultiplied
+     * color components, so resampling of the mask plane gives the same
+     * result as resampling of the image (which QPainter does in
+     * premultiplied form) and calculating the mask afterwards.
+     */
+    QImage mask(imageWithBorder.size(), QImage::Format_Alpha8);
+
+    for (int y = 0; y < imageWithBorder.height(); y++) {
+        const QRgb *srcPtr = reinterpret_cast<const QRgb*>(imageWithBorder.constScanLine(y));
+        quint8 *dstPtr = mask.scanLine(y);
+
+        for (int x = 0; x < imageWithBorder.width(); x++) {
+            const QRgb c = srcPtr[x];
+
+            m_isGrayscale &= qRed(c) == qGreen(c) && qGreen(c) == qBlue(c);
+            dstPtr[x] = KoColorSpaceMaths<quint8>::multiply(255 - qGray(c), qAlpha(c));
+        }
+    }
+
+    m_levels.append(PyramidLevel(imageWithBorder, mask, levelSize));
 }
 
 QImage KisQImagePyramid::createImage(KisDabShape const& shape,
@@ -318,6 +350,58 @@ QImage KisQImagePyramid::createImage(KisDabShape const& shape,
     return dstImage;
 }
 
+QImage KisQImagePyramid::createMaskImage(KisDabShape const& shape,
+                                         qreal subPixelX, qreal subPixelY) const
+{
+    if (m_levels.isEmpty()) return QImage();
+
+    qreal baseScale = -1.0;
+    int level = findNearestLevel(shape.scale(), &baseScale);
+
+    const QImage &srcMask = m_levels[level].mask;
+
+    QTransform transform;
+    QSize dstSize;
+
+    calculateParams(shape, subPixelX, subPixelY,
+                    m_originalSize, baseScale, m_levels[level].size,
+                    &transform, &dstSize);
+
+    if (transform.isIdentity()) {
+        return srcMask.copy(QPAINTER_WORKAROUND_BORDER,
+                            QPAINTER_WORKAROUND_BORDER,
+                            srcMask.width() - 2 * QPAINTER_WORKAROUND_BORDER,
+                            srcMask.height() - 2 * QPAINTER_WORKAROUND_BORDER);
+    }
+
+    QImage dstImage(dstSize, QImage::Format_Alpha8);
+
+    bool isInvertible = false;
+    const QTransform dstToSrc =
+        (QTransform::fromTranslate(-QPAINTER_WORKAROUND_BORDER,
+                                   -QPAINTER_WORKAROUND_BORDER) * transform).inverted(&isInvertible);
+
+    if (!isInvertible) {
+        dstImage.fill(0);
+        return dstImage;
+    }
+
+    KisAlphaResampler::instance()->resample(srcMask.constBits(),
+                                            srcMask.width(), srcMask.height(),
+                                            srcMask.bytesPerLine(),
+                                            dstImage.bits(),
+                                            dstSize.width(), dstSize.height(),
+                                            dstImage.bytesPerLine(),
+                                            dstToSrc);
+
+    return dstImage;
+}
+
+bool KisQImagePyramid::isGrayscale() const
+{
+    return m_isGrayscale;
+}
+
 QImage KisQImagePyramid::getClosest(QTransform transform, qreal *scale) const
 {
     if (m_levels.isEmpty()) return QImage();
@@ -331,3 +415,70 @@ QImage KisQImagePyramid::getClosest(QTransform transform, qreal *scale) const
     int level = findNearestLevel(estimatedScale, scale);
     return m_levels[level].image;
 }
+
+bool KisQImagePyramid::save(QIODevice *device) const
+{
+    QDataStream stream(device);
+    stream.setVersion(QDataStream::Qt_5_9);
+
+    stream << quint32(PYRAMID_FILE_MAGIC) << quint32(PYRAMID_FILE_VERSION);
+    stream << m_originalSize << m_baseScale << qint32(m_levels.size());
+
+    Q_FOREACH (const PyramidLevel &level, m_levels) {
+        KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(level.image.format() == QImage::Format_ARGB32, false);
+
+        const QImage &image = level.image;
+        stream << level.size << image.size();
+
+        // the images are mostly masks, so even the fastest level of zlib shrinks them well
+        stream << qCompress(image.constBits(), image.bytesPerLine() * image.height(), 1);
+    }
+
+    return stream.status() == QDataStream::Ok;
+}
+
+bool KisQImagePyramid::load(QIODevice *device)
+{
+    QDataStream stream(device);
+    stream.setVersion(QDataStream::Qt_5_9);
+
+    m_levels.clear();
+    m_isGrayscale = true;
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    stream >> magic >> version;
+
+    if (magic != PYRAMID_FILE_MAGIC || version != PYRAMID_FILE_VERSION) {
+        return false;
+    }
+
+    qint32 numLevels = 0;
+    stream >> m_originalSize >> m_baseScale >> numLevels;
+
+    for (int i = 0; i < numLevels && stream.status() == QDataStream::Ok; i++) {
+        QSize levelSize;
+        QSize imageSize;
+        QByteArray compressedData;
+
+        stream >> levelSize >> imageSize >> compressedData;
+
+        QImage image(imageSize, QImage::Format_ARGB32);
+        const QByteArray data = qUncompress(compressedData);
+
+        if (image.isNull() || data.size() != image.bytesPerLine() * image.height()) {
+            m_levels.clear();
+            return false;
+        }
+
+        memcpy(image.bits(), data.constData(), data.size());
+        appendPreparedLevel(image, levelSize);
+    }
+
+    if (stream.status() != QDataStream::Ok || m_levels.size() != numLevels) {
+        m_levels.clear();
+        return false;
+    }
+
+    return true;
+}
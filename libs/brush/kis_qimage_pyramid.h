@@ -24,6 +24,7 @@
 #include <kis_dab_shape.h>
 #include <kritabrush_export.h>
 
+class QIODevice;
 
 class BRUSH_EXPORT KisQImagePyramid
 {
@@ -41,12 +42,46 @@ public:
     QImage createImage(KisDabShape const&,
                        qreal subPixelX, qreal subPixelY) const;
 
+    /**
+     * Creates an 8-bit mask of the transformed brush tip. The value of
+     * every pixel is equal to (255 - gray) * alpha / 255, that is what
+     * KisBrush uses as a mask of the dab. The mask is resampled directly
+     * from the precomputed mask planes of the levels, which is much faster
+     * than transforming the ARGB images with QPainter in createImage().
+     *
+     * The result is of QImage::Format_Alpha8 format and has the same
+     * size as the image returned by createImage().
+     */
+    QImage createMaskImage(KisDabShape const&,
+                           qreal subPixelX, qreal subPixelY) const;
+
+    /**
+     * Returns true if all the pixels of the tip are gray (r == g == b),
+     * that is, the mask can be calculated from any of the color channels
+     */
+    bool isGrayscale() const;
+
     QImage getClosest(QTransform transform, qreal *scale) const;
 
+    /**
+     * Writes all the levels of the pyramid into \p device, so that
+     * they could be restored with load() without rescaling the base
+     * image. Used by KisQImagePyramidCache.
+     */
+    bool save(QIODevice *device) const;
+
+    /**
+     * Restores the levels written by save(). Returns false if the data
+     * is corrupted or has been written by an incompatible version. In
+     * such case the pyramid is left empty.
+     */
+    bool load(QIODevice *device);
+
 private:
     friend class KisGbrBrushTest;
     int findNearestLevel(qreal scale, qreal *baseScale) const;
     void appendPyramidLevel(const QImage &image);
+    void appendPreparedLevel(const QImage &imageWithBorder, const QSize &levelSize);
 
     static void calculateParams(KisDabShape const& shape,
                                 qreal subPixelX, qreal subPixelY,
@@ -62,12 +97,14 @@ private:
 private:
     QSize m_originalSize;
     qreal m_baseScale;
+    bool m_isGrayscale = true;
 
     struct PyramidLevel {
         PyramidLevel() {}
-        PyramidLevel(QImage _image, QSize _size) : image(_image), size(_size) {}
+        PyramidLevel(QImage _image, QImage _mask, QSize _size) : image(_image), mask(_mask), size(_size) {}
 
         QImage image;
+        QImage mask;
         QSize size;
     };
 
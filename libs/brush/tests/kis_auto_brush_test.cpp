@@ -24,6 +24,7 @@
 #include <testutil.h>
 #include "../kis_auto_brush.h"
 #include "kis_mask_generator.h"
+#include "kis_cubic_curve.h"
 #include "kis_paint_device.h"
 #include "kis_fill_painter.h"
 #include <KoColor.h>
@@ -31,6 +32,7 @@
 #include <KoColorSpaceRegistry.h>
 #include <KoCompositeOpRegistry.h>
 #include <kis_fixed_paint_device.h>
+#include <kis_brush_mask_applicator_base.h>
 #include <brushengine/kis_paint_information.h>
 
 void KisAutoBrushTest::testCreation()
@@ -193,4 +195,102 @@ void KisAutoBrushTest::testClone()
     QCOMPARE(res1, res2);
 }
 
+void KisAutoBrushTest::testMirroredMask_data()
+{
+    QTest::addColumn<QString>("generatorType");
+    QTest::addColumn<int>("diameter");
+    QTest::addColumn<qreal>("fade");
+    QTest::addColumn<qreal>("angle");
+
+    QTest::newRow("circle-even") << "circle" << 100 << 0.5 << 0.0;
+    QTest::newRow("circle-odd") << "circle" << 101 << 0.5 << 0.0;
+    QTest::newRow("circle-sharp") << "circle" << 64 << 1.0 << 0.0;
+    QTest::newRow("rect-even") << "rect" << 100 << 0.3 << 0.0;
+    QTest::newRow("rect-odd") << "rect" << 77 << 0.3 << 0.0;
+
+    QTest::newRow("gauss-circle-even") << "gauss-circle" << 100 << 0.5 << 0.0;
+    QTest::newRow("gauss-circle-odd") << "gauss-circle" << 101 << 0.5 << 0.0;
+    QTest::newRow("gauss-rect-even") << "gauss-rect" << 100 << 0.3 << 0.0;
+    QTest::newRow("gauss-rect-odd") << "gauss-rect" << 77 << 0.3 << 0.0;
+    QTest::newRow("curve-circle-even") << "curve-circle" << 100 << 0.5 << 0.0;
+    QTest::newRow("curve-circle-odd") << "curve-circle" << 101 << 0.5 << 0.0;
+    QTest::newRow("curve-rect-even") << "curve-rect" << 100 << 0.3 << 0.0;
+    QTest::newRow("curve-rect-odd") << "curve-rect" << 77 << 0.3 << 0.0;
+
+    // large enough to be split into the bands
+    QTest::newRow("circle-large") << "circle" << 1200 << 0.5 << 0.0;
+    QTest::newRow("rect-large") << "rect" << 1200 << 0.5 << 0.0;
+    QTest::newRow("gauss-circle-large") << "gauss-circle" << 1200 << 0.5 << 0.0;
+    QTest::newRow("curve-rect-large") << "curve-rect" << 1200 << 0.5 << 0.0;
+
+    // sin() and cos() of these are not exact, so they must not be mirrored
+    QTest::newRow("rect-90") << "rect" << 100 << 0.3 << M_PI_2;
+    QTest::newRow("rect-180") << "rect" << 100 << 0.3 << M_PI;
+    QTest::newRow("rect-large-270") << "rect" << 1200 << 0.5 << 3 * M_PI_2;
+}
+
+/**
+ * The auto brush generates only one quadrant of axis-aligned dabs and
+ * mirrors it, the result must be exactly the same as when generating
+ * the whole dab. Rotated dabs must be exactly the same as well.
+ */
+void KisAutoBrushTest::testMirroredMask()
+{
+    QFETCH(QString, generatorType);
+    QFETCH(int, diameter);
+    QFETCH(qreal, fade);
+    QFETCH(qreal, angle);
+
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+    const KoColor color(Qt::black, cs);
+
+    KisCubicCurve curve;
+    curve.fromString("0,1;0.3,0.8;1,0");
+
+    auto createGenerator = [generatorType, diameter, fade, curve] () -> KisMaskGenerator* {
+        if (generatorType == "circle") {
+            return new KisCircleMaskGenerator(diameter, 0.8, fade, fade, 2, true);
+        } else if (generatorType == "rect") {
+            return new KisRectangleMaskGenerator(diameter, 0.8, fade, fade, 2, true);
+        } else if (generatorType == "gauss-circle") {
+            return new KisGaussCircleMaskGenerator(diameter, 0.8, fade, fade, 2, true);
+        } else if (generatorType == "gauss-rect") {
+            return new KisGaussRectangleMaskGenerator(diameter, 0.8, fade, fade, 2, true);
+        } else if (generatorType == "curve-circle") {
+            return new KisCurveCircleMaskGenerator(diameter, 0.8, fade, fade, 2, curve, true);
+        } else {
+            return new KisCurveRectangleMaskGenerator(diameter, 0.8, fade, fade, 2, curve, true);
+        }
+    };
+
+    KisBrushSP brush = new KisAutoBrush(createGenerator(), 0.0, 0.0);
+    KisPaintInformation info(QPointF(100.0, 100.0), 1.0);
+
+    const KisDabShape shape(1.0, 1.0, angle);
+
+    KisFixedPaintDeviceSP mirroredDab = new KisFixedPaintDevice(cs);
+    brush->mask(mirroredDab, color, shape, info);
+
+    const QRect dabRect = mirroredDab->bounds();
+    const QPointF hotSpot = brush->hotSpot(shape, info);
+
+    KisFixedPaintDeviceSP referenceDab = new KisFixedPaintDevice(cs);
+    referenceDab->setRect(dabRect);
+    referenceDab->initialize();
+    referenceDab->fill(dabRect, color);
+
+    QScopedPointer<KisMaskGenerator> generator(createGenerator());
+    generator->setSoftness(1.0);
+    generator->setScale(1.0, 1.0);
+
+    MaskProcessingData data(referenceDab, cs, 0.0, 1.0,
+                            hotSpot.x() - 0.5, hotSpot.y() - 0.5, angle);
+
+    KisBrushMaskApplicatorBase *applicator = generator->applicator();
+    applicator->initializeData(&data);
+    applicator->process(dabRect);
+
+    QCOMPARE(mirroredDab->convertToQImage(0), referenceDab->convertToQImage(0));
+}
+
 QTEST_MAIN(KisAutoBrushTest)
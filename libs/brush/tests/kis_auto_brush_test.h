@@ -32,6 +32,9 @@ private Q_SLOTS:
     void testCopyMasking();
     void testClone();
 
+    void testMirroredMask_data();
+    void testMirroredMask();
+
 };
 
 #endif
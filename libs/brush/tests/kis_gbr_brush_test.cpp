@@ -21,12 +21,15 @@
 #include <QTest>
 #include <QString>
 #include <QDir>
+#include <QPainter>
 #include <KoColor.h>
 #include <KoColorSpace.h>
 #include <KoColorSpaceRegistry.h>
+#include <KoColorSpaceMaths.h>
 #include "testutil.h"
 #include "../kis_gbr_brush.h"
 #include "kis_types.h"
+#include "kis_debug.h"
 #include "kis_paint_device.h"
 #include "brushengine/kis_paint_information.h"
 #include <kis_fixed_paint_device.h>
@@ -251,6 +254,210 @@ void KisGbrBrushTest::testPyramidDabTransform()
     QCOMPARE(dabTransformHelper(KisDabShape(1.0, 0.5, M_PI / 4)), QSize(160, 160));
 }
 
+void KisGbrBrushTest::testPyramidMaskResampling()
+{
+    // a smooth colored tip, so that the rounding of the weights in
+    // QPainter doesn't affect the result much
+    QImage image(64, 48, QImage::Format_ARGB32);
+    for (int y = 0; y < image.height(); y++) {
+        for (int x = 0; x < image.width(); x++) {
+            const qreal dx = (x - 32.0) / 32.0;
+            const qreal dy = (y - 24.0) / 24.0;
+            const int alpha = qBound(0, qRound(255 * (1.0 - dx * dx - dy * dy)), 255);
+            image.setPixel(x, y, qRgba(x * 4, y * 5, 128, alpha));
+        }
+    }
+
+    KisQImagePyramid pyramid(image);
+    QVERIFY(!pyramid.isGrayscale());
+
+    const QVector<KisDabShape> shapes = {
+        KisDabShape(1.0, 1.0, 0.0),
+        KisDabShape(0.7, 1.0, 0.0),
+        KisDabShape(1.6, 0.5, 0.0),
+        KisDabShape(0.3, 1.0, 0.0),
+        KisDabShape(1.0, 1.0, 0.3),
+        KisDabShape(0.8, 0.7, 2.0),
+        KisDabShape(2.5, 1.0, M_PI / 4)
+    };
+
+    Q_FOREACH (const KisDabShape &shape, shapes) {
+        for (int i = 0; i < 3; i++) {
+            const qreal subPixel = 0.25 * i;
+
+            const QImage referenceImage = pyramid.createImage(shape, subPixel, subPixel);
+            const QImage mask = pyramid.createMaskImage(shape, subPixel, subPixel);
+
+            QCOMPARE(mask.format(), QImage::Format_Alpha8);
+            QCOMPARE(mask.size(), referenceImage.size());
+
+            qint64 totalDifference = 0;
+            int maxDifference = 0;
+
+            for (int y = 0; y < mask.height(); y++) {
+                const QRgb *refPtr = reinterpret_cast<const QRgb*>(referenceImage.constScanLine(y));
+                const quint8 *maskPtr = mask.constScanLine(y);
+
+                for (int x = 0; x < mask.width(); x++) {
+                    const int refValue = KoColorSpaceMaths<quint8>::multiply(255 - qGray(refPtr[x]), qAlpha(refPtr[x]));
+                    const int difference = qAbs(refValue - maskPtr[x]);
+
+                    totalDifference += difference;
+                    maxDifference = qMax(maxDifference, difference);
+                }
+            }
+
+            const qreal averageDifference = qreal(totalDifference) / (mask.width() * mask.height());
+
+            if (averageDifference > 1.0 || maxDifference > 16) {
+                qDebug() << ppVar(shape.scale()) << ppVar(shape.ratio()) << ppVar(shape.rotation()) << ppVar(subPixel);
+                qDebug() << ppVar(averageDifference) << ppVar(maxDifference);
+                QFAIL("The resampled mask differs from the one generated by QPainter");
+            }
+        }
+    }
+}
+
+static QImage createLargeTestTip()
+{
+    const int size = 2048;
+    QImage image(size, size, QImage::Format_ARGB32);
+    image.fill(0);
+
+    QPainter gc(&image);
+    gc.setRenderHints(QPainter::Antialiasing);
+    gc.setBrush(Qt::black);
+    gc.drawEllipse(QRect(100, 100, size - 200, size - 400));
+    gc.end();
+
+    return image;
+}
+
+#include <QBuffer>
+
+void KisGbrBrushTest::testPyramidSaveLoad()
+{
+    QImage image(300, 200, QImage::Format_ARGB32);
+    image.fill(0);
+    QPainter gc(&image);
+    gc.fillRect(QRect(50, 50, 100, 30), Qt::black);
+    gc.end();
+
+    KisQImagePyramid pyramid(image);
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    QVERIFY(pyramid.save(&buffer));
+    buffer.close();
+
+    KisQImagePyramid loadedPyramid;
+    buffer.open(QIODevice::ReadOnly);
+    QVERIFY(loadedPyramid.load(&buffer));
+
+    const QVector<KisDabShape> shapes = {
+        KisDabShape(1.0, 1.0, 0.0),
+        KisDabShape(0.3, 1.0, 0.0),
+        KisDabShape(2.5, 0.5, M_PI / 3)
+    };
+
+    Q_FOREACH (const KisDabShape &shape, shapes) {
+        QCOMPARE(loadedPyramid.createImage(shape, 0.3, 0.7),
+                 pyramid.createImage(shape, 0.3, 0.7));
+    }
+
+    // truncated data must be rejected
+    QBuffer truncatedBuffer;
+    truncatedBuffer.setData(buffer.data().left(buffer.data().size() / 2));
+    truncatedBuffer.open(QIODevice::ReadOnly);
+    KisQImagePyramid brokenPyramid;
+    QVERIFY(!brokenPyramid.load(&truncatedBuffer));
+}
+
+#include <QTemporaryDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include "KisQImagePyramidCache.h"
+
+void KisGbrBrushTest::testPyramidDiskCache()
+{
+    QTemporaryDir cacheDir;
+    QVERIFY(cacheDir.isValid());
+
+    KisQImagePyramidCache cache;
+    cache.setCacheDir(cacheDir.path());
+
+    const QImage image = createLargeTestTip();
+    const KisDabShape shape(0.7, 1.0, M_PI / 5);
+    QImage referenceDab;
+
+    {
+        QSharedPointer<const KisQImagePyramid> pyramid = cache.pyramid(image);
+        QVERIFY(pyramid);
+        referenceDab = pyramid->createImage(shape, 0.5, 0.5);
+
+        // the same image is shared while the pyramid is alive
+        QCOMPARE(cache.pyramid(image.copy()), pyramid);
+    }
+
+    cache.waitForDone();
+
+    const QString filePath =
+        cacheDir.path() + QDir::separator() +
+        QString::fromLatin1(KisQImagePyramidCache::imageKey(image)) + ".pyramid";
+    QVERIFY(QFile::exists(filePath));
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+    const QDateTime oldTime = QDateTime::currentDateTime().addDays(-10);
+    {
+        QFile file(filePath);
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        QVERIFY(file.setFileTime(oldTime, QFileDevice::FileModificationTime));
+    }
+#endif
+
+    // a new cache object has nothing in memory and should load the file
+    KisQImagePyramidCache anotherCache;
+    anotherCache.setCacheDir(cacheDir.path());
+
+    QSharedPointer<const KisQImagePyramid> loadedPyramid = anotherCache.pyramid(image);
+    QVERIFY(loadedPyramid);
+    QCOMPARE(loadedPyramid->createImage(shape, 0.5, 0.5), referenceDab);
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+    // the cache hit should mark the file as recently used for the eviction
+    QVERIFY(QFileInfo(filePath).lastModified() > oldTime.addDays(1));
+#endif
+
+    // small images are not stored
+    QImage smallImage(64, 64, QImage::Format_ARGB32);
+    smallImage.fill(0);
+    QVERIFY(anotherCache.pyramid(smallImage));
+    anotherCache.waitForDone();
+    QCOMPARE(QDir(cacheDir.path()).entryList(QDir::Files).size(), 1);
+}
+
+void KisGbrBrushTest::benchmarkPyramidLoadingFromCache()
+{
+    QTemporaryDir cacheDir;
+    QVERIFY(cacheDir.isValid());
+
+    const QImage image = createLargeTestTip();
+
+    {
+        KisQImagePyramidCache cache;
+        cache.setCacheDir(cacheDir.path());
+        QVERIFY(cache.pyramid(image));
+        cache.waitForDone();
+    }
+
+    QBENCHMARK {
+        // a fresh cache emulates the first stroke of a new session
+        KisQImagePyramidCache cache;
+        cache.setCacheDir(cacheDir.path());
+        QVERIFY(cache.pyramid(image));
+    }
+}
+
 // see comment in KisQImagePyramid::appendPyramidLevel
 void KisGbrBrushTest::testQPainterTransformationBorder()
 {
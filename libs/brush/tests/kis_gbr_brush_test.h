@@ -40,6 +40,10 @@ private Q_SLOTS:
 
     void testPyramidLevelRounding();
     void testPyramidDabTransform();
+    void testPyramidMaskResampling();
+    void testPyramidSaveLoad();
+    void testPyramidDiskCache();
+    void benchmarkPyramidLoadingFromCache();
 
     void testQPainterTransformationBorder();
 };
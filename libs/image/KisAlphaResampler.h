@@ -0,0 +1,67 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISALPHARESAMPLER_H
+#define KISALPHARESAMPLER_H
+
+#include "kritaimage_export.h"
+
+#include <QtGlobal>
+
+class QTransform;
+
+/**
+ * Bilinear resampling of 8-bit single-channel planes (masks, alpha or
+ * gray channels) with an arbitrary affine transform. It is used for
+ * transforming the tips of predefined brushes, which used to be done
+ * by QPainter on ARGB images for every dab.
+ *
+ * The sampling follows the conventions of QPainter's smooth pixmap
+ * transform, so the results of the two approaches differ by rounding
+ * errors only. The pixels outside the source plane are clamped to the
+ * border ones, therefore the source is expected to have a one pixel
+ * wide transparent border (like the levels of KisQImagePyramid do).
+ *
+ * Use instance() to get the implementation optimized for the current CPU.
+ */
+class KRITAIMAGE_EXPORT KisAlphaResampler
+{
+public:
+    virtual ~KisAlphaResampler();
+
+    /**
+     * The implementation with the best set of vector instructions
+     * supported by the CPU. The object is shared and thread-safe.
+     */
+    static const KisAlphaResampler* instance();
+
+    /**
+     * Fills \p dst plane of size \p dstWidth x \p dstHeight with the
+     * values sampled from \p src. \p dstToSrc maps the coordinates of
+     * the destination plane into the source one.
+     *
+     * When \p dstToSrc contains no rotation or shear, the filter weights
+     * are precomputed separately for rows and columns, otherwise the
+     * sampling position is calculated for every pixel.
+     */
+    virtual void resample(const quint8 *src, int srcWidth, int srcHeight, int srcRowStride,
+                          quint8 *dst, int dstWidth, int dstHeight, int dstRowStride,
+                          const QTransform &dstToSrc) const = 0;
+};
+
+#endif // KISALPHARESAMPLER_H
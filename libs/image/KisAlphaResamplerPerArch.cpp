@@ -0,0 +1,219 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisAlphaResamplerPerArch.h"
+
+#include <QTransform>
+#include <QVector>
+
+#include "kis_assert.h"
+#include "KisAlphaResampler.h"
+
+
+template<Vc::Implementation _impl>
+class KisAlphaResamplerImpl : public KisAlphaResampler
+{
+public:
+    void resample(const quint8 *src, int srcWidth, int srcHeight, int srcRowStride,
+                  quint8 *dst, int dstWidth, int dstHeight, int dstRowStride,
+                  const QTransform &dstToSrc) const override
+    {
+        KIS_SAFE_ASSERT_RECOVER_RETURN(srcWidth >= 2 && srcHeight >= 2);
+
+        if (dstToSrc.type() <= QTransform::TxScale) {
+            resampleScaled(src, srcWidth, srcHeight, srcRowStride,
+                           dst, dstWidth, dstHeight, dstRowStride,
+                           dstToSrc);
+        } else {
+            resampleAffine(src, srcWidth, srcHeight, srcRowStride,
+                           dst, dstWidth, dstHeight, dstRowStride,
+                           dstToSrc);
+        }
+    }
+
+private:
+    /**
+     * Converts the position of the sample in one dimension into the index
+     * of the top-left pixel of the bilinear kernel and the weight of the
+     * bottom-right one. The position is clamped into the source plane.
+     */
+    static inline void samplePosition(float pos, int size, int *index, float *weight) {
+        pos = qBound(0.0f, pos, float(size - 1));
+        const int i = qMin(int(pos), size - 2);
+        *index = i;
+        *weight = pos - i;
+    }
+
+    static inline float sample(const quint8 *src, int rowStride, int offset, float fx, float fy) {
+        const quint8 *top = src + offset;
+        const quint8 *bottom = top + rowStride;
+
+        const float topValue = top[0] + fx * (top[1] - top[0]);
+        const float bottomValue = bottom[0] + fx * (bottom[1] - bottom[0]);
+        return topValue + fy * (bottomValue - topValue);
+    }
+
+#if defined HAVE_VC
+    static inline Vc::float_v sample(const quint8 *src, int rowStride,
+                                     const Vc::float_v::IndexType &offsets,
+                                     const Vc::float_v &fx, const Vc::float_v &fy) {
+
+        const Vc::float_v topLeft(src, offsets);
+        const Vc::float_v topRight(src + 1, offsets);
+        const Vc::float_v bottomLeft(src + rowStride, offsets);
+        const Vc::float_v bottomRight(src + rowStride + 1, offsets);
+
+        const Vc::float_v topValue = topLeft + fx * (topRight - topLeft);
+        const Vc::float_v bottomValue = bottomLeft + fx * (bottomRight - bottomLeft);
+        return topValue + fy * (bottomValue - topValue);
+    }
+#endif
+
+    static inline void storeRow(const float *values, quint8 *dst, int size) {
+        // the values are convex combinations of 8-bit values, no need to clamp
+        for (int i = 0; i < size; i++) {
+            dst[i] = quint8(values[i] + 0.5f);
+        }
+    }
+
+    /**
+     * The transform is separable, so the sampling positions and the
+     * filter weights are calculated once per column and once per row
+     */
+    void resampleScaled(const quint8 *src, int srcWidth, int srcHeight, int srcRowStride,
+                        quint8 *dst, int dstWidth, int dstHeight, int dstRowStride,
+                        const QTransform &dstToSrc) const {
+
+        QVector<int> xOffsets(dstWidth);
+        QVector<float> xWeights(dstWidth);
+        QVector<float> values(dstWidth);
+
+        int *xOffsetsPtr = xOffsets.data();
+        float *xWeightsPtr = xWeights.data();
+        float *valuesPtr = values.data();
+
+        for (int x = 0; x < dstWidth; x++) {
+            samplePosition(dstToSrc.m11() * (x + 0.5) + dstToSrc.dx() - 0.5,
+                           srcWidth, xOffsetsPtr + x, xWeightsPtr + x);
+        }
+
+        for (int y = 0; y < dstHeight; y++) {
+            int yIndex = 0;
+            float fy = 0.0f;
+            samplePosition(dstToSrc.m22() * (y + 0.5) + dstToSrc.dy() - 0.5,
+                           srcHeight, &yIndex, &fy);
+
+            const quint8 *srcRow = src + yIndex * srcRowStride;
+            int x = 0;
+
+#if defined HAVE_VC
+            const int vectorSize = Vc::float_v::size();
+            const Vc::float_v vFy(fy);
+
+            for (; x + vectorSize <= dstWidth; x += vectorSize) {
+                const Vc::float_v::IndexType offsets(xOffsetsPtr + x, Vc::Unaligned);
+                const Vc::float_v fx(xWeightsPtr + x, Vc::Unaligned);
+
+                sample(srcRow, srcRowStride, offsets, fx, vFy).store(valuesPtr + x, Vc::Unaligned);
+            }
+#endif
+
+            for (; x < dstWidth; x++) {
+                valuesPtr[x] = sample(srcRow, srcRowStride, xOffsetsPtr[x], xWeightsPtr[x], fy);
+            }
+
+            storeRow(valuesPtr, dst + y * dstRowStride, dstWidth);
+        }
+    }
+
+    /**
+     * Rotated or sheared transform: the sampling position changes linearly
+     * along the row, so it is calculated for a vector of pixels at once
+     */
+    void resampleAffine(const quint8 *src, int srcWidth, int srcHeight, int srcRowStride,
+                        quint8 *dst, int dstWidth, int dstHeight, int dstRowStride,
+                        const QTransform &dstToSrc) const {
+
+        QVector<float> values(dstWidth);
+        float *valuesPtr = values.data();
+
+        const float stepX = dstToSrc.m11();
+        const float stepY = dstToSrc.m12();
+
+        for (int y = 0; y < dstHeight; y++) {
+            // the sampling position of the first pixel of the row
+            const float startX = dstToSrc.m11() * 0.5 + dstToSrc.m21() * (y + 0.5) + dstToSrc.dx() - 0.5;
+            const float startY = dstToSrc.m12() * 0.5 + dstToSrc.m22() * (y + 0.5) + dstToSrc.dy() - 0.5;
+
+            int x = 0;
+
+#if defined HAVE_VC
+            const int vectorSize = Vc::float_v::size();
+
+            const Vc::float_v vZero(Vc::Zero);
+            const Vc::float_v vMaxX(srcWidth - 1);
+            const Vc::float_v vMaxY(srcHeight - 1);
+            const Vc::float_v::IndexType vMaxIndexX(srcWidth - 2);
+            const Vc::float_v::IndexType vMaxIndexY(srcHeight - 2);
+            const Vc::float_v::IndexType vRowStride(srcRowStride);
+
+            Vc::float_v currentIndices = Vc::float_v::IndexesFromZero();
+
+            for (; x + vectorSize <= dstWidth; x += vectorSize) {
+                Vc::float_v px = startX + stepX * currentIndices;
+                Vc::float_v py = startY + stepY * currentIndices;
+
+                px = Vc::min(Vc::max(px, vZero), vMaxX);
+                py = Vc::min(Vc::max(py, vZero), vMaxY);
+
+                // the positions are non-negative, so truncation is the same as floor
+                const Vc::float_v::IndexType ix = Vc::min(Vc::simd_cast<Vc::float_v::IndexType>(px), vMaxIndexX);
+                const Vc::float_v::IndexType iy = Vc::min(Vc::simd_cast<Vc::float_v::IndexType>(py), vMaxIndexY);
+
+                const Vc::float_v fx = px - Vc::simd_cast<Vc::float_v>(ix);
+                const Vc::float_v fy = py - Vc::simd_cast<Vc::float_v>(iy);
+
+                sample(src, srcRowStride, iy * vRowStride + ix, fx, fy).store(valuesPtr + x, Vc::Unaligned);
+
+                currentIndices += Vc::float_v(vectorSize);
+            }
+#endif
+
+            for (; x < dstWidth; x++) {
+                int ix = 0;
+                int iy = 0;
+                float fx = 0.0f;
+                float fy = 0.0f;
+
+                samplePosition(startX + stepX * x, srcWidth, &ix, &fx);
+                samplePosition(startY + stepY * x, srcHeight, &iy, &fy);
+
+                valuesPtr[x] = sample(src, srcRowStride, iy * srcRowStride + ix, fx, fy);
+            }
+
+            storeRow(valuesPtr, dst + y * dstRowStride, dstWidth);
+        }
+    }
+};
+
+template<>
+KisAlphaResamplerFactory::ReturnType
+KisAlphaResamplerFactory::create<Vc::CurrentImplementation::current()>(ParamType)
+{
+    return new KisAlphaResamplerImpl<Vc::CurrentImplementation::current()>();
+}
@@ -36,6 +36,9 @@ struct KisRenderedDab
     KisFixedPaintDeviceSP device;
     QPoint offset;
 
+    /// the sequence number of the dab in the rendering queue (if any)
+    int seqNo = -1;
+
     qreal opacity = OPACITY_OPAQUE_F;
     qreal flow = OPACITY_OPAQUE_F;
     qreal averageOpacity = OPACITY_TRANSPARENT_F;
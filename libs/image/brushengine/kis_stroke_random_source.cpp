@@ -29,6 +29,15 @@ struct KisStrokeRandomSource::Private
     {
     }
 
+    Private(int seed)
+        : levelOfDetail(0),
+          lod0RandomSource(new KisRandomSource(seed)),
+          lodNRandomSource(new KisRandomSource(*lod0RandomSource)),
+          lod0PerStrokeRandomSource(new KisPerStrokeRandomSource(seed)),
+          lodNPerStrokeRandomSource(new KisPerStrokeRandomSource(*lod0PerStrokeRandomSource))
+    {
+    }
+
     int levelOfDetail;
     KisRandomSourceSP lod0RandomSource;
     KisRandomSourceSP lodNRandomSource;
@@ -43,6 +52,11 @@ KisStrokeRandomSource::KisStrokeRandomSource()
 {
 }
 
+KisStrokeRandomSource::KisStrokeRandomSource(int seed)
+    : m_d(new Private(seed))
+{
+}
+
 KisStrokeRandomSource::KisStrokeRandomSource(const KisStrokeRandomSource &rhs)
     : m_d(new Private(*rhs.m_d))
 {
@@ -37,6 +37,14 @@ class KRITAIMAGE_EXPORT  KisStrokeRandomSource
 {
 public:
     KisStrokeRandomSource();
+
+    /**
+     * Creates the sources with a fixed \p seed, so that the stroke
+     * generates exactly the same sequence of numbers every time it is
+     * painted (used for replaying recorded strokes)
+     */
+    KisStrokeRandomSource(int seed);
+
     KisStrokeRandomSource(const KisStrokeRandomSource &rhs);
     KisStrokeRandomSource& operator=(const KisStrokeRandomSource &rhs);
 
@@ -93,13 +93,17 @@ void KisBrushMaskVectorApplicator<MaskGenerator, _impl>::processVector(const QRe
     MaskGenerator *m_maskGenerator = KisBrushMaskScalarApplicator<MaskGenerator, _impl>::m_maskGenerator;
 
     qreal random = 1.0;
-    quint8* dabPointer = m_d->device->data() + rect.y() * rect.width() * m_d->pixelSize;
+    const int deviceWidth = m_d->device->bounds().width();
+    quint8* dabPointer = m_d->device->data() + (rect.y() * deviceWidth + rect.x()) * m_d->pixelSize;
     quint8 alphaValue = OPACITY_TRANSPARENT_U8;
     // this offset is needed when brush size is smaller then fixed device size
-    int offset = (m_d->device->bounds().width() - rect.width()) * m_d->pixelSize;
+    int offset = (deviceWidth - rect.width()) * m_d->pixelSize;
 
     int width = rect.width();
 
+    // the row processor always starts from the column 0 of the buffer
+    const float rowCenterX = m_d->centerX - rect.x();
+
     // We need to calculate with a multiple of the width of the simd register
     int alignOffset = 0;
     if (width % Vc::float_v::size() != 0) {
@@ -113,7 +117,7 @@ void KisBrushMaskVectorApplicator<MaskGenerator, _impl>::processVector(const QRe
 
     for (int y = rect.y(); y < rect.y() + rect.height(); y++) {
 
-        processor.template process<_impl>(buffer, simdWidth, y, m_d->cosa, m_d->sina, m_d->centerX, m_d->centerY);
+        processor.template process<_impl>(buffer, simdWidth, y, m_d->cosa, m_d->sina, rowCenterX, m_d->centerY);
 
         if (m_d->randomness != 0.0 || m_d->density != 1.0) {
             for (int x = 0; x < width; x++) {
@@ -155,10 +159,11 @@ void KisBrushMaskScalarApplicator<MaskGenerator, _impl>::processScalar(const QRe
     MaskGenerator *m_maskGenerator = KisBrushMaskScalarApplicator<MaskGenerator, _impl>::m_maskGenerator;
 
     qreal random = 1.0;
-    quint8* dabPointer = m_d->device->data() + rect.y() * rect.width() * m_d->pixelSize;
+    const int deviceWidth = m_d->device->bounds().width();
+    quint8* dabPointer = m_d->device->data() + (rect.y() * deviceWidth + rect.x()) * m_d->pixelSize;
     quint8 alphaValue = OPACITY_TRANSPARENT_U8;
     // this offset is needed when brush size is smaller then fixed device size
-    int offset = (m_d->device->bounds().width() - rect.width()) * m_d->pixelSize;
+    int offset = (deviceWidth - rect.width()) * m_d->pixelSize;
     int supersample = (m_maskGenerator->shouldSupersample() ? SUPERSAMPLING : 1);
     double invss = 1.0 / supersample;
     int samplearea = pow2(supersample);
@@ -0,0 +1,89 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_CONVOLUTION_ROW_OPS_H
+#define __KIS_CONVOLUTION_ROW_OPS_H
+
+#include <compositeops/KoVcMultiArchBuildSupport.h>
+
+/**
+ * Inner loops of the spatial convolution worker. The worker keeps
+ * the data in contiguous planar buffers (float for 8-bit channels,
+ * double for the deeper ones), so the whole convolution is reduced
+ * to the operations on the rows of these buffers, which are
+ * vectorized here.
+ */
+class KisConvolutionRowOpsBase
+{
+public:
+    virtual ~KisConvolutionRowOpsBase() {}
+
+    /**
+     * dst[i] += coeff * src[i] for i in [0, size)
+     */
+    virtual void accumulate(float *dst, const float *src, float coeff, int size) const = 0;
+    virtual void accumulate(double *dst, const double *src, double coeff, int size) const = 0;
+};
+
+template<Vc::Implementation _impl>
+struct KisConvolutionRowOps : public KisConvolutionRowOpsBase
+{
+    void accumulate(float *dst, const float *src, float coeff, int size) const override {
+        accumulateImpl(dst, src, coeff, size);
+    }
+
+    void accumulate(double *dst, const double *src, double coeff, int size) const override {
+        accumulateImpl(dst, src, coeff, size);
+    }
+
+private:
+    template<typename T>
+    static inline void accumulateImpl(T *dst, const T *src, T coeff, int size) {
+        int i = 0;
+
+#if defined HAVE_VC
+        typedef Vc::Vector<T> vector_type;
+
+        const int vectorSize = vector_type::size();
+        const vector_type coeffVec(coeff);
+
+        for (; i + vectorSize <= size; i += vectorSize) {
+            vector_type d(dst + i, Vc::Unaligned);
+            const vector_type s(src + i, Vc::Unaligned);
+            d += coeffVec * s;
+            d.store(dst + i, Vc::Unaligned);
+        }
+#endif
+
+        for (; i < size; i++) {
+            dst[i] += coeff * src[i];
+        }
+    }
+};
+
+struct KisConvolutionRowOpsFactory
+{
+    // the row ops don't need any construction parameters
+    typedef int ParamType;
+    typedef KisConvolutionRowOpsBase* ReturnType;
+
+    template<Vc::Implementation _impl>
+    static ReturnType create(ParamType);
+};
+
+#endif /* __KIS_CONVOLUTION_ROW_OPS_H */
@@ -20,9 +20,30 @@
 #ifndef KIS_CONVOLUTION_WORKER_SPATIAL_H
 #define KIS_CONVOLUTION_WORKER_SPATIAL_H
 
+#include <algorithm>
+#include <QScopedPointer>
+
 #include "kis_convolution_worker.h"
+#include "kis_convolution_row_ops.h"
 #include "kis_math_toolbox.h"
 
+/**
+ * The spatial convolution worker loads the source area into planar
+ * buffers (one contiguous plane per channel, colors are premultiplied
+ * by alpha), convolves the planes with vectorized row operations and
+ * writes the result back.
+ *
+ * The planes are float for 8-bit color spaces. When any of the
+ * convolved channels is deeper, the planes are double, otherwise the
+ * premultiplied sums would lose the precision of the channels.
+ *
+ * If the kernel is separable (its rank is 1), the convolution is
+ * done in two 1D passes, which costs (kw + kh) operations per pixel
+ * instead of (kw * kh).
+ *
+ * The area is processed in horizontal stripes to keep the memory
+ * footprint bounded.
+ */
 template <class _IteratorFactory_>
 class KisConvolutionWorkerSpatial : public KisConvolutionWorker<_IteratorFactory_>
 {
@@ -31,53 +52,21 @@ public:
         : KisConvolutionWorker<_IteratorFactory_>(painter, progress)
         ,  m_alphaCachePos(-1)
         ,  m_alphaRealPos(-1)
-        ,  m_pixelPtrCache(0)
-        ,  m_pixelPtrCacheCopy(0)
-        ,  m_minClamp(0)
-        ,  m_maxClamp(0)
-        ,  m_absoluteOffset(0)
+        ,  m_isSeparable(false)
+        ,  m_useDoublePrecision(false)
     {
     }
 
     ~KisConvolutionWorkerSpatial() override {
     }
 
-    inline void loadPixelToCache(qreal **cache, const quint8 *data, int index) {
-        // no alpha is rare case, so just multiply by 1.0 in that case
-        qreal alphaValue = m_alphaRealPos >= 0 ?
-            m_toDoubleFuncPtr[m_alphaCachePos](data, m_alphaRealPos) : 1.0;
-
-        for (quint32 k = 0; k < m_convolveChannelsNo; ++k) {
-            if (k != (quint32)m_alphaCachePos) {
-                const quint32 channelPos = m_convChannelList[k]->pos();
-                cache[index][k] = m_toDoubleFuncPtr[k](data, channelPos) * alphaValue;
-            } else {
-                cache[index][k] = alphaValue;
-            }
-        }
-
-    }
-
     void execute(const KisConvolutionKernelSP kernel, const KisPaintDeviceSP src, QPoint srcPos, QPoint dstPos, QSize areaSize, const QRect& dataRect) override {
         // store some kernel characteristics
         m_kw = kernel->width();
         m_kh = kernel->height();
         m_khalfWidth = (m_kw - 1) / 2;
         m_khalfHeight = (m_kh - 1) / 2;
-        m_cacheSize = m_kw * m_kh;
         m_pixelSize = src->colorSpace()->pixelSize();
-        quint32 channelCount = src->colorSpace()->channelCount();
-
-        m_kernelData = new qreal[m_cacheSize];
-        qreal *kernelDataPtr = m_kernelData;
-
-        // fill in data
-        for (quint32 r = 0; r < kernel->height(); r++) {
-            for (quint32 c = 0; c < kernel->width(); c++) {
-                *kernelDataPtr = (*(kernel->data()))(r, c);
-                kernelDataPtr++;
-            }
-        }
 
         // Make the area we cover as small as possible
         if (this->m_painter->selection()) {
@@ -96,33 +85,23 @@ public:
         // find out which channels need be convolved
         m_convChannelList = this->convolvableChannelList(src);
         m_convolveChannelsNo = m_convChannelList.count();
+        m_useDoublePrecision = false;
 
         for (int i = 0; i < m_convChannelList.size(); i++) {
             if (m_convChannelList[i]->channelType() == KoChannelInfo::ALPHA) {
                 m_alphaCachePos = i;
                 m_alphaRealPos = m_convChannelList[i]->pos();
             }
+
+            if (m_convChannelList[i]->size() > 1) {
+                m_useDoublePrecision = true;
+            }
         }
 
         bool hasProgressUpdater = this->m_progress;
         if (hasProgressUpdater)
             this->m_progress->setProgress(0);
 
-        // Iterate over all pixels in our rect, create a cache of pixels around the current pixel and convolve them.
-        m_pixelPtrCache = new qreal*[m_cacheSize];
-        m_pixelPtrCacheCopy = new qreal*[m_cacheSize];
-        for (quint32 c = 0; c < m_cacheSize; ++c) {
-            m_pixelPtrCache[c] = new qreal[channelCount];
-            m_pixelPtrCacheCopy[c] = new qreal[channelCount];
-        }
-
-        // decide caching strategy
-        enum TraversingDirection { Horizontal, Vertical };
-        TraversingDirection traversingDirection = Vertical;
-        if (m_kw > m_kh) {
-            traversingDirection = Horizontal;
-        }
-
         KisMathToolbox mathToolbox;
         m_toDoubleFuncPtr = QVector<PtrToDouble>(m_convolveChannelsNo);
         if (!mathToolbox.getToDoubleChannelPtr(m_convChannelList, m_toDoubleFuncPtr))
@@ -133,121 +112,260 @@ public:
             return;
 
         m_kernelFactor = kernel->factor() ? 1.0 / kernel->factor() : 1;
-        m_maxClamp = new qreal[m_convChannelList.count()];
-        m_minClamp = new qreal[m_convChannelList.count()];
-        m_absoluteOffset = new qreal[m_convChannelList.count()];
+        m_maxClamp.resize(m_convolveChannelsNo);
+        m_minClamp.resize(m_convolveChannelsNo);
+        m_absoluteOffset.resize(m_convolveChannelsNo);
         for (quint16 i = 0; i < m_convChannelList.count(); ++i) {
             m_minClamp[i] = mathToolbox.minChannelValue(m_convChannelList[i]);
             m_maxClamp[i] = mathToolbox.maxChannelValue(m_convChannelList[i]);
             m_absoluteOffset[i] = (m_maxClamp[i] - m_minClamp[i]) * kernel->offset();
         }
 
-        qint32 row = srcPos.y();
-        qint32 col = srcPos.x();
+        prepareKernel(kernel);
 
-        // populate pixelPtrCacheCopy for starting position (0, 0)
-        qint32 i = 0;
-        typename _IteratorFactory_::HLineConstIterator hitInitSrc = _IteratorFactory_::createHLineConstIterator(src, col - m_khalfWidth, row - m_khalfHeight, m_kw, dataRect);
+        m_rowOps.reset(createOptimizedClass<KisConvolutionRowOpsFactory>(0));
 
-        for (quint32 krow = 0; krow < m_kh; ++krow) {
-            do {
-                const quint8* data = hitInitSrc->oldRawData();
-                loadPixelToCache(m_pixelPtrCacheCopy, data, i);
-                ++i;
-            } while (hitInitSrc->nextPixel());
-            hitInitSrc->nextRow();
+        if (hasProgressUpdater) {
+            this->m_progress->setRange(0, areaSize.height());
         }
 
+        if (m_useDoublePrecision) {
+            convolveArea(m_doublePlanes, src, srcPos, dstPos, areaSize, dataRect);
+        } else {
+            convolveArea(m_floatPlanes, src, srcPos, dstPos, areaSize, dataRect);
+        }
 
-        if (traversingDirection == Horizontal) {
-            if(hasProgressUpdater) {
-                this->m_progress->setRange(0, areaSize.height());
-            }
-            typename _IteratorFactory_::HLineIterator hitDst = _IteratorFactory_::createHLineIterator(this->m_painter->device(), dstPos.x(), dstPos.y(), areaSize.width(), dataRect);
-            typename _IteratorFactory_::HLineConstIterator hitSrc = _IteratorFactory_::createHLineConstIterator(src, srcPos.x(), srcPos.y(), areaSize.width(), dataRect);
-
-            typename _IteratorFactory_::HLineConstIterator khitSrc = _IteratorFactory_::createHLineConstIterator(src, col - m_khalfWidth, row + m_khalfHeight, m_kw, dataRect);
-            for (int prow = 0; prow < areaSize.height(); ++prow) {
-                // reload cache from copy
-                for (quint32 i = 0; i < m_cacheSize; ++i)
-                    memcpy(m_pixelPtrCache[i], m_pixelPtrCacheCopy[i], channelCount * sizeof(qreal));
-
-                typename _IteratorFactory_::VLineConstIterator kitSrc = _IteratorFactory_::createVLineConstIterator(src, col + m_khalfWidth, row - m_khalfHeight, m_kh, dataRect);
-                for (int pcol = 0; pcol < areaSize.width(); ++pcol) {
-                    // write original channel values
-                    memcpy(hitDst->rawData(), hitSrc->oldRawData(), m_pixelSize);
-                    convolveCache(hitDst->rawData());
-
-                    ++col;
-                    kitSrc->nextColumn();
-                    hitDst->nextPixel();
-                    hitSrc->nextPixel();
-                    moveKernelRight(kitSrc, m_pixelPtrCache);
-                }
+        cleanUp();
+    }
 
-                row++;
-                khitSrc->nextRow();
-                hitDst->nextRow();
-                hitSrc->nextRow();
-                col = srcPos.x();
+private:
+    template <typename T>
+    struct Planes {
+        QVector<T> input;
+        QVector<T> intermediate;
+        QVector<T> output;
+
+        inline T* inputPlane(int channel, int planeSize) {
+            return input.data() + channel * planeSize;
+        }
 
-                moveKernelDown(khitSrc, m_pixelPtrCacheCopy);
+        inline T* outputPlane(int channel, int planeSize) {
+            return output.data() + channel * planeSize;
+        }
 
-                if (hasProgressUpdater) {
-                    this->m_progress->setValue(prow);
+        void clear() {
+            input.clear();
+            intermediate.clear();
+            output.clear();
+        }
+    };
+
+    template <typename T>
+    void convolveArea(Planes<T> &planes, const KisPaintDeviceSP src, const QPoint &srcPos, const QPoint &dstPos, const QSize &areaSize, const QRect& dataRect) {
+        const int areaWidth = areaSize.width();
+        const int inputWidth = areaWidth + m_kw - 1;
+
+        /**
+         * The stripe should be high enough to make the overhead of
+         * reloading the kernel margins negligible
+         */
+        const int stripeHeight = qMin(areaSize.height(), qMax(64, 2 * int(m_kh)));
+
+        planes.input.resize(m_convolveChannelsNo * inputWidth * (stripeHeight + m_kh - 1));
+        planes.output.resize(m_convolveChannelsNo * areaWidth * stripeHeight);
+        if (m_isSeparable) {
+            planes.intermediate.resize(areaWidth * (stripeHeight + m_kh - 1));
+        }
 
-                    if (this->m_progress->interrupted()) {
-                        cleanUp();
-                        return;
-                    }
+        for (int stripeTop = 0; stripeTop < areaSize.height(); stripeTop += stripeHeight) {
+            const int rows = qMin(stripeHeight, areaSize.height() - stripeTop);
+            const int inputRows = rows + m_kh - 1;
+
+            loadStripe(planes, src,
+                       srcPos.x() - m_khalfWidth, srcPos.y() + stripeTop - m_khalfHeight,
+                       inputWidth, inputRows, dataRect);
+
+            convolveStripe(planes, inputWidth, inputRows, areaWidth, rows);
+
+            writeStripe(planes, src,
+                        QPoint(srcPos.x(), srcPos.y() + stripeTop),
+                        QPoint(dstPos.x(), dstPos.y() + stripeTop),
+                        areaWidth, rows, dataRect);
+
+            if (this->m_progress) {
+                this->m_progress->setValue(stripeTop + rows);
+
+                if (this->m_progress->interrupted()) {
+                    return;
                 }
+            }
+        }
+    }
 
+    /**
+     * Stores the kernel in the flipped form (that is, in the order the
+     * source pixels are traversed) and checks whether it is separable.
+     */
+    void prepareKernel(const KisConvolutionKernelSP kernel) {
+        const quint32 cacheSize = m_kw * m_kh;
+        m_kernelData.resize(cacheSize);
+
+        qreal maxAbsValue = 0.0;
+        int pivotRow = 0;
+        int pivotColumn = 0;
+
+        for (quint32 r = 0; r < m_kh; r++) {
+            for (quint32 c = 0; c < m_kw; c++) {
+                const qreal value = (*(kernel->data()))(m_kh - r - 1, m_kw - c - 1);
+                m_kernelData[r * m_kw + c] = value;
+
+                if (qAbs(value) > maxAbsValue) {
+                    maxAbsValue = qAbs(value);
+                    pivotRow = r;
+                    pivotColumn = c;
+                }
             }
-        } else /* if (traversingDirection == Vertical) */ {
-            if(hasProgressUpdater) {
-                this->m_progress->setRange(0, areaSize.width());
+        }
+
+        // 1D kernels gain nothing from the separation
+        m_isSeparable = m_kw > 1 && m_kh > 1 && maxAbsValue > 0.0;
+        if (!m_isSeparable) return;
+
+        const qreal pivotValue = m_kernelData[pivotRow * m_kw + pivotColumn];
+
+        m_horizontalKernel.resize(m_kw);
+        m_verticalKernel.resize(m_kh);
+
+        for (quint32 c = 0; c < m_kw; c++) {
+            m_horizontalKernel[c] = m_kernelData[pivotRow * m_kw + c] / pivotValue;
+        }
+
+        for (quint32 r = 0; r < m_kh; r++) {
+            m_verticalKernel[r] = m_kernelData[r * m_kw + pivotColumn];
+        }
+
+        const qreal eps = 1e-6 * maxAbsValue;
+
+        for (quint32 r = 0; r < m_kh && m_isSeparable; r++) {
+            for (quint32 c = 0; c < m_kw; c++) {
+                const qreal diff =
+                    m_kernelData[r * m_kw + c] -
+                    m_verticalKernel[r] * m_horizontalKernel[c];
+
+                if (qAbs(diff) > eps) {
+                    m_isSeparable = false;
+                    break;
+                }
             }
-            typename _IteratorFactory_::VLineIterator vitDst = _IteratorFactory_::createVLineIterator(this->m_painter->device(), dstPos.x(), dstPos.y(), areaSize.height(), dataRect);
-            typename _IteratorFactory_::VLineConstIterator vitSrc = _IteratorFactory_::createVLineConstIterator(src, srcPos.x(), srcPos.y(), areaSize.height(), dataRect);
-
-            typename _IteratorFactory_::VLineConstIterator kitSrc = _IteratorFactory_::createVLineConstIterator(src, col + m_khalfWidth, row - m_khalfHeight, m_kh, dataRect);
-            for (int pcol = 0; pcol < areaSize.width(); pcol++) {
-                // reload cache from copy
-                for (quint32 i = 0; i < m_cacheSize; ++i)
-                    memcpy(m_pixelPtrCache[i], m_pixelPtrCacheCopy[i], channelCount * sizeof(qreal));
-
-                typename _IteratorFactory_::HLineConstIterator khitSrc = _IteratorFactory_::createHLineConstIterator(src, col - m_khalfWidth, row + m_khalfHeight, m_kw, dataRect);
-                for (int prow = 0; prow < areaSize.height(); prow++) {
-                    // write original channel values
-                    memcpy(vitDst->rawData(), vitSrc->oldRawData(), m_pixelSize);
-                    convolveCache(vitDst->rawData());
-
-                    ++row;
-                    khitSrc->nextRow();
-                    vitDst->nextPixel();
-                    vitSrc->nextPixel();
-                    moveKernelDown(khitSrc, m_pixelPtrCache);
+        }
+    }
+
+    template <typename T>
+    void loadStripe(Planes<T> &planes, const KisPaintDeviceSP src, int x, int y, int width, int height, const QRect &dataRect) {
+        const int planeSize = width * height;
+
+        typename _IteratorFactory_::HLineConstIterator hitSrc = _IteratorFactory_::createHLineConstIterator(src, x, y, width, dataRect);
+
+        int index = 0;
+        for (int row = 0; row < height; ++row) {
+            do {
+                const quint8* data = hitSrc->oldRawData();
+
+                // no alpha is rare case, so just multiply by 1.0 in that case
+                const qreal alphaValue = m_alphaRealPos >= 0 ?
+                    m_toDoubleFuncPtr[m_alphaCachePos](data, m_alphaRealPos) : 1.0;
+
+                for (quint32 k = 0; k < m_convolveChannelsNo; ++k) {
+                    T *plane = planes.inputPlane(k, planeSize);
+
+                    if (k != (quint32)m_alphaCachePos) {
+                        const quint32 channelPos = m_convChannelList[k]->pos();
+                        plane[index] = m_toDoubleFuncPtr[k](data, channelPos) * alphaValue;
+                    } else {
+                        plane[index] = alphaValue;
+                    }
                 }
 
-                ++col;
-                kitSrc->nextColumn();
-                vitDst->nextColumn();
-                vitSrc->nextColumn();
-                row = srcPos.y();
+                ++index;
+            } while (hitSrc->nextPixel());
+            hitSrc->nextRow();
+        }
+    }
+
+    template <typename T>
+    void convolveStripe(Planes<T> &planes, int inputWidth, int inputRows, int areaWidth, int rows) {
+        const int inputPlaneSize = inputWidth * inputRows;
+        const int outputPlaneSize = areaWidth * rows;
+
+        for (quint32 k = 0; k < m_convolveChannelsNo; ++k) {
+            const T *input = planes.inputPlane(k, inputPlaneSize);
+            T *output = planes.outputPlane(k, outputPlaneSize);
 
-                moveKernelRight(kitSrc, m_pixelPtrCacheCopy);
+            std::fill(output, output + outputPlaneSize, T(0));
 
-                if (hasProgressUpdater) {
-                    this->m_progress->setValue(pcol);
+            if (m_isSeparable) {
+                T *intermediate = planes.intermediate.data();
+                std::fill(intermediate, intermediate + areaWidth * inputRows, T(0));
 
-                    if (this->m_progress->interrupted()) {
-                        cleanUp();
-                        return;
+                for (int row = 0; row < inputRows; ++row) {
+                    for (quint32 c = 0; c < m_kw; ++c) {
+                        const T coeff = m_horizontalKernel[c];
+                        if (coeff == T(0)) continue;
+
+                        m_rowOps->accumulate(intermediate + row * areaWidth,
+                                             input + row * inputWidth + c,
+                                             coeff, areaWidth);
+                    }
+                }
+
+                for (int row = 0; row < rows; ++row) {
+                    for (quint32 r = 0; r < m_kh; ++r) {
+                        const T coeff = m_verticalKernel[r];
+                        if (coeff == T(0)) continue;
+
+                        m_rowOps->accumulate(output + row * areaWidth,
+                                             intermediate + (row + r) * areaWidth,
+                                             coeff, areaWidth);
+                    }
+                }
+            } else {
+                for (int row = 0; row < rows; ++row) {
+                    for (quint32 r = 0; r < m_kh; ++r) {
+                        for (quint32 c = 0; c < m_kw; ++c) {
+                            const T coeff = m_kernelData[r * m_kw + c];
+                            if (coeff == T(0)) continue;
+
+                            m_rowOps->accumulate(output + row * areaWidth,
+                                                 input + (row + r) * inputWidth + c,
+                                                 coeff, areaWidth);
+                        }
                     }
                 }
             }
         }
-        cleanUp();
+    }
+
+    template <typename T>
+    void writeStripe(Planes<T> &planes, const KisPaintDeviceSP src, const QPoint &srcPos, const QPoint &dstPos, int width, int height, const QRect &dataRect) {
+        const int planeSize = width * height;
+
+        typename _IteratorFactory_::HLineIterator hitDst = _IteratorFactory_::createHLineIterator(this->m_painter->device(), dstPos.x(), dstPos.y(), width, dataRect);
+        typename _IteratorFactory_::HLineConstIterator hitSrc = _IteratorFactory_::createHLineConstIterator(src, srcPos.x(), srcPos.y(), width, dataRect);
+
+        int index = 0;
+        for (int row = 0; row < height; ++row) {
+            do {
+                // write original channel values
+                memcpy(hitDst->rawData(), hitSrc->oldRawData(), m_pixelSize);
+                convolvePixel(planes, hitDst->rawData(), index, planeSize);
+
+                ++index;
+                hitSrc->nextPixel();
+            } while (hitDst->nextPixel());
+
+            hitDst->nextRow();
+            hitSrc->nextRow();
+        }
     }
 
     inline void limitValue(qreal *value, qreal lowBound, qreal highBound) {
@@ -259,14 +377,9 @@ public:
         }
     }
 
-    template <bool additionalMultiplierActive>
-    inline qreal convolveOneChannelFromCache(quint8* dstPtr, quint32 channel, qreal additionalMultiplier = 0.0) {
-        qreal interimConvoResult = 0;
-
-        for (quint32 pIndex = 0; pIndex < m_cacheSize; ++pIndex) {
-            qreal cacheValue = m_pixelPtrCache[pIndex][channel];
-            interimConvoResult += m_kernelData[m_cacheSize - pIndex - 1] * cacheValue;
-        }
+    template <bool additionalMultiplierActive, typename T>
+    inline qreal convolveOneChannel(Planes<T> &planes, quint8* dstPtr, quint32 channel, int index, int planeSize, qreal additionalMultiplier = 0.0) {
+        const qreal interimConvoResult = planes.outputPlane(channel, planeSize)[index];
 
         qreal channelPixelValue;
         if (additionalMultiplierActive) {
@@ -283,9 +396,10 @@ public:
         return channelPixelValue;
     }
 
-    inline void convolveCache(quint8* dstPtr) {
+    template <typename T>
+    inline void convolvePixel(Planes<T> &planes, quint8* dstPtr, int index, int planeSize) {
         if (m_alphaCachePos >= 0) {
-            qreal alphaValue = convolveOneChannelFromCache<false>(dstPtr, m_alphaCachePos);
+            qreal alphaValue = convolveOneChannel<false>(planes, dstPtr, m_alphaCachePos, index, planeSize);
 
             // TODO: we need a special case for applying LoG filter,
             // when the alpha i suniform and therefore should not be
@@ -297,7 +411,7 @@ public:
 
                 for (quint32 k = 0; k < m_convolveChannelsNo; ++k) {
                     if (k == (quint32)m_alphaCachePos) continue;
-                    convolveOneChannelFromCache<true>(dstPtr, k, alphaValueInv);
+                    convolveOneChannel<true>(planes, dstPtr, k, index, planeSize, alphaValueInv);
                 }
             } else {
                 for (quint32 k = 0; k < m_convolveChannelsNo; ++k) {
@@ -310,76 +424,45 @@ public:
             }
         } else {
             for (quint32 k = 0; k < m_convolveChannelsNo; ++k) {
-                convolveOneChannelFromCache<false>(dstPtr, k);
+                convolveOneChannel<false>(planes, dstPtr, k, index, planeSize);
             }
         }
     }
 
-    inline void moveKernelRight(typename _IteratorFactory_::VLineConstIterator& kitSrc, qreal **pixelPtrCache) {
-        qreal** d = pixelPtrCache;
-
-        for (quint32 krow = 0; krow < m_kh; ++krow) {
-            qreal* first = *d;
-            memmove(d, d + 1, (m_kw - 1) * sizeof(qreal *));
-            *(d + m_kw - 1) = first;
-            d += m_kw;
-        }
-
-        qint32 i = m_kw - 1;
-        do {
-            const quint8* data = kitSrc->oldRawData();
-            loadPixelToCache(pixelPtrCache, data, i);
-            i += m_kw;
-        } while (kitSrc->nextPixel());
-    }
-
-    inline void moveKernelDown(typename _IteratorFactory_::HLineConstIterator& kitSrc, qreal **pixelPtrCache) {
-        quint8 **tmp = new quint8*[m_kw];
-        memcpy(tmp, pixelPtrCache, m_kw * sizeof(qreal *));
-        memmove(pixelPtrCache, pixelPtrCache + m_kw, (m_kw * m_kh - m_kw) * sizeof(quint8 *));
-        memcpy(pixelPtrCache + m_kw *(m_kh - 1), tmp, m_kw * sizeof(quint8 *));
-        delete[] tmp;
-
-        qint32 i = m_kw * (m_kh - 1);
-        do {
-            const quint8* data = kitSrc->oldRawData();
-            loadPixelToCache(pixelPtrCache, data, i);
-            i++;
-        } while (kitSrc->nextPixel());
-    }
-
     void cleanUp() {
-        for (quint32 c = 0; c < m_cacheSize; ++c) {
-            delete[] m_pixelPtrCache[c];
-            delete[] m_pixelPtrCacheCopy[c];
-        }
-
-        delete[] m_kernelData;
-        delete[] m_pixelPtrCache;
-        delete[] m_pixelPtrCacheCopy;
-
-        delete[] m_minClamp;
-        delete[] m_maxClamp;
-        delete[] m_absoluteOffset;
+        m_floatPlanes.clear();
+        m_doublePlanes.clear();
+        m_rowOps.reset();
     }
 
 private:
     quint32 m_kw, m_kh;
     quint32 m_khalfWidth, m_khalfHeight;
     quint32 m_convolveChannelsNo;
-    quint32 m_cacheSize, m_pixelSize;
+    quint32 m_pixelSize;
 
     int m_alphaCachePos;
     int m_alphaRealPos;
 
-    qreal *m_kernelData;
-    qreal** m_pixelPtrCache, ** m_pixelPtrCacheCopy;
-    qreal* m_minClamp, *m_maxClamp, *m_absoluteOffset;
+    QVector<qreal> m_kernelData;
+    QVector<qreal> m_horizontalKernel;
+    QVector<qreal> m_verticalKernel;
+    bool m_isSeparable;
+
+    bool m_useDoublePrecision;
+    Planes<float> m_floatPlanes;
+    Planes<qreal> m_doublePlanes;
+
+    QVector<qreal> m_minClamp;
+    QVector<qreal> m_maxClamp;
+    QVector<qreal> m_absoluteOffset;
 
     qreal m_kernelFactor;
     QList<KoChannelInfo *> m_convChannelList;
     QVector<PtrToDouble> m_toDoubleFuncPtr;
     QVector<PtrFromDouble> m_fromDoubleFuncPtr;
+
+    QScopedPointer<KisConvolutionRowOpsBase> m_rowOps;
 };
 
 
@@ -0,0 +1,201 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_fftw_plan_cache.h"
+
+#include <QGlobalStatic>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QHash>
+#include <QPair>
+#include <QList>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+#include <climits>
+
+#include <kis_debug.h>
+
+Q_GLOBAL_STATIC(KisFFTWPlanCache, s_instance)
+
+namespace {
+
+/**
+ * The mutex protecting all the calls to the FFTW planner. It
+ * is recursive, because the last reference to a plan pair may
+ * be dropped while the cache itself holds the lock.
+ */
+QMutex s_plannerMutex(QMutex::Recursive);
+
+const int maxCachedPlans = 16;
+
+QString wisdomFilePath()
+{
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    return cacheDir.isEmpty() ? QString() : cacheDir + QDir::separator() + "fftw3.wisdom";
+}
+
+}
+
+KisFFTWPlanCache::PlanPair::PlanPair()
+    : forward(0),
+      backward(0),
+      measured(false)
+{
+}
+
+KisFFTWPlanCache::PlanPair::~PlanPair()
+{
+    QMutexLocker l(&s_plannerMutex);
+
+    if (forward) {
+        fftw_destroy_plan(forward);
+    }
+
+    if (backward) {
+        fftw_destroy_plan(backward);
+    }
+}
+
+struct KisFFTWPlanCache::Private
+{
+    typedef QPair<int, int> PlanKey;
+
+    QHash<PlanKey, PlanPairSP> plans;
+    QList<PlanKey> lruQueue;
+
+    bool wisdomLoaded = false;
+
+    void loadWisdom();
+    void saveWisdom();
+    PlanPairSP createPlans(int width, int height, bool measure);
+};
+
+void KisFFTWPlanCache::Private::loadWisdom()
+{
+    wisdomLoaded = true;
+
+    const QString filePath = wisdomFilePath();
+    if (filePath.isEmpty() || !QFile::exists(filePath)) return;
+
+    if (!fftw_import_wisdom_from_filename(QFile::encodeName(filePath).constData())) {
+        warnKrita << "Failed to import FFTW wisdom from" << filePath;
+    }
+}
+
+void KisFFTWPlanCache::Private::saveWisdom()
+{
+    const QString filePath = wisdomFilePath();
+    if (filePath.isEmpty()) return;
+
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+
+    if (!fftw_export_wisdom_to_filename(QFile::encodeName(filePath).constData())) {
+        warnKrita << "Failed to export FFTW wisdom to" << filePath;
+    }
+}
+
+KisFFTWPlanCache::PlanPairSP
+KisFFTWPlanCache::Private::createPlans(int width, int height, bool measure)
+{
+    /**
+     * FFTW_MEASURE overwrites the arrays while planning, so the
+     * plans are created on a scratch buffer with the same layout
+     * and alignment as the buffers used by the workers.
+     */
+    const int complexLength = height * (width / 2 + 1);
+    fftw_complex *scratch = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * complexLength);
+
+    const unsigned flags = measure ? FFTW_MEASURE : FFTW_ESTIMATE;
+
+    PlanPairSP pair(new PlanPair());
+    pair->forward = fftw_plan_dft_r2c_2d(height, width, (double*)scratch, scratch, flags);
+    pair->backward = fftw_plan_dft_c2r_2d(height, width, scratch, (double*)scratch, flags);
+    pair->measured = measure;
+
+    fftw_free(scratch);
+
+    if (measure) {
+        saveWisdom();
+    }
+
+    return pair;
+}
+
+KisFFTWPlanCache::KisFFTWPlanCache()
+    : m_d(new Private)
+{
+}
+
+KisFFTWPlanCache::~KisFFTWPlanCache()
+{
+}
+
+KisFFTWPlanCache* KisFFTWPlanCache::instance()
+{
+    return s_instance;
+}
+
+KisFFTWPlanCache::PlanPairSP KisFFTWPlanCache::plans(int width, int height, bool measure)
+{
+    QMutexLocker l(&s_plannerMutex);
+
+    if (!m_d->wisdomLoaded) {
+        m_d->loadWisdom();
+    }
+
+    const Private::PlanKey key(width, height);
+
+    PlanPairSP pair = m_d->plans.value(key);
+
+    if (!pair || (measure && !pair->measured)) {
+        pair = m_d->createPlans(width, height, measure);
+        m_d->plans.insert(key, pair);
+    }
+
+    m_d->lruQueue.removeOne(key);
+    m_d->lruQueue.append(key);
+
+    while (m_d->lruQueue.size() > maxCachedPlans) {
+        m_d->plans.remove(m_d->lruQueue.takeFirst());
+    }
+
+    return pair;
+}
+
+int KisFFTWPlanCache::optimalSize(int size)
+{
+    int bestSize = INT_MAX;
+
+    for (int p7 = 1; p7 < bestSize; p7 *= 7) {
+        for (int p5 = p7; p5 < bestSize; p5 *= 5) {
+            for (int p3 = p5; p3 < bestSize; p3 *= 3) {
+                int candidate = p3;
+                while (candidate < size) {
+                    candidate *= 2;
+                }
+
+                bestSize = qMin(bestSize, candidate);
+            }
+        }
+    }
+
+    return bestSize;
+}
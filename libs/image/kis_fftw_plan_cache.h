@@ -0,0 +1,84 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_FFTW_PLAN_CACHE_H
+#define __KIS_FFTW_PLAN_CACHE_H
+
+#include <QScopedPointer>
+#include <QSharedPointer>
+
+#include <fftw3.h>
+
+/**
+ * A process-wide cache of in-place 2D real-to-complex and
+ * complex-to-real FFTW plans.
+ *
+ * FFTW's planner is not reentrant, but executing an existing plan
+ * with fftw_execute_dft_r2c()/fftw_execute_dft_c2r() on new arrays is.
+ * Therefore the cache serializes only creation and destruction of the
+ * plans, and the convolution workers may run the returned plans from
+ * as many threads as they like. The arrays passed to the plans must be
+ * allocated with fftw_malloc() and have the padded in-place layout,
+ * that is, rows of 2 * (width / 2 + 1) doubles.
+ *
+ * The plans requested with \p measure flag are created with
+ * FFTW_MEASURE. The accumulated wisdom is stored in the cache
+ * directory of the application, so the (expensive) measurement
+ * happens only once per transform size.
+ */
+class KisFFTWPlanCache
+{
+public:
+    struct PlanPair {
+        PlanPair();
+        ~PlanPair();
+
+        fftw_plan forward;
+        fftw_plan backward;
+        bool measured;
+    };
+
+    typedef QSharedPointer<PlanPair> PlanPairSP;
+
+public:
+    KisFFTWPlanCache();
+    ~KisFFTWPlanCache();
+
+    static KisFFTWPlanCache* instance();
+
+    /**
+     * Returns a pair of plans for the transform of size \p width x \p height.
+     *
+     * If \p measure is true and the cached plans were created in the
+     * estimate mode only, the plans are recreated with FFTW_MEASURE.
+     */
+    PlanPairSP plans(int width, int height, bool measure);
+
+    /**
+     * Rounds \p size up to the closest size FFTW transforms efficiently,
+     * that is, to the closest number of form 2^a * 3^b * 5^c * 7^d.
+     */
+    static int optimalSize(int size);
+
+private:
+    friend struct PlanPair;
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif /* __KIS_FFTW_PLAN_CACHE_H */
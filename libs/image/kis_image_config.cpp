@@ -633,3 +633,23 @@ void KisImageConfig::setSelectionOverlayMaskColor(const QColor &color)
 {
     m_config.writeEntry("selectionOverlayMaskColor", color);
 }
+
+bool KisImageConfig::useBrushPyramidDiskCache(bool defaultValue) const
+{
+    return defaultValue ? true : m_config.readEntry("useBrushPyramidDiskCache", true);
+}
+
+void KisImageConfig::setUseBrushPyramidDiskCache(bool value)
+{
+    m_config.writeEntry("useBrushPyramidDiskCache", value);
+}
+
+int KisImageConfig::brushPyramidDiskCacheSizeLimit(bool defaultValue) const
+{
+    return defaultValue ? 1024 : m_config.readEntry("brushPyramidDiskCacheSizeLimit", 1024);
+}
+
+void KisImageConfig::setBrushPyramidDiskCacheSizeLimit(int value)
+{
+    m_config.writeEntry("brushPyramidDiskCacheSizeLimit", value);
+}
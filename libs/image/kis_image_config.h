@@ -141,6 +141,12 @@ public:
     QColor selectionOverlayMaskColor(bool defaultValue = false) const;
     void setSelectionOverlayMaskColor(const QColor &color);
 
+    bool useBrushPyramidDiskCache(bool defaultValue = false) const;
+    void setUseBrushPyramidDiskCache(bool value);
+
+    int brushPyramidDiskCacheSizeLimit(bool defaultValue = false) const; // MiB
+    void setBrushPyramidDiskCacheSizeLimit(int value);
+
 private:
     Q_DISABLE_COPY(KisImageConfig)
 
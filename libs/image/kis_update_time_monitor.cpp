@@ -42,6 +42,13 @@
 
 Q_GLOBAL_STATIC(KisUpdateTimeMonitor, s_instance)
 
+/**
+ * The input events whose position has not been covered by any canvas
+ * update are dropped when their number exceeds the limit. It happens
+ * when the stylus leaves the image bounds.
+ */
+#define MAX_PENDING_INPUT_EVENTS 1024
+
 
 struct StrokeTicket
 {
@@ -85,6 +92,8 @@ struct Q_DECL_HIDDEN KisUpdateTimeMonitor::Private
           numTickets(0),
           numUpdates(0),
           mousePath(0.0),
+          inputLatency(0),
+          numInputEvents(0),
           loggingEnabled(false)
     {
         loggingEnabled = KisImageConfig(true).enablePerfLog();
@@ -104,6 +113,20 @@ struct Q_DECL_HIDDEN KisUpdateTimeMonitor::Private
     QElapsedTimer strokeTime;
     KisPaintOpPresetSP preset;
 
+    struct PendingInputEvent {
+        QPointF pos;
+        qint64 time;
+    };
+
+    /**
+     * Input events that have not reached the screen yet. The
+     * input-to-pixel latency of an event is the time passed until
+     * the first canvas update covering its position.
+     */
+    QVector<PendingInputEvent> pendingInputEvents;
+    qint64 inputLatency;
+    qint32 numInputEvents;
+
     bool loggingEnabled;
 };
 
@@ -143,6 +166,11 @@ void KisUpdateTimeMonitor::startStrokeMeasure()
 
     m_d->lastMousePos = QPointF();
     m_d->preset = 0;
+
+    m_d->pendingInputEvents.clear();
+    m_d->inputLatency = 0;
+    m_d->numInputEvents = 0;
+
     m_d->strokeTime.start();
 }
 
@@ -176,6 +204,11 @@ void KisUpdateTimeMonitor::reportMouseMove(const QPointF &pos)
     }
 
     m_d->lastMousePos = pos;
+
+    if (m_d->pendingInputEvents.size() >= MAX_PENDING_INPUT_EVENTS) {
+        m_d->pendingInputEvents.removeFirst();
+    }
+    m_d->pendingInputEvents.append({pos, m_d->strokeTime.elapsed()});
 }
 
 void KisUpdateTimeMonitor::printValues()
@@ -185,6 +218,7 @@ void KisUpdateTimeMonitor::printValues()
     qreal nonUpdateTime = qreal(m_d->jobsTime) / m_d->numTickets;
     qreal jobsPerUpdate = qreal(m_d->numTickets) / m_d->numUpdates;
     qreal mouseSpeed = qreal(m_d->mousePath) / strokeTime;
+    qreal inputLatency = averageInputLatency();
 
     QString prefix;
 
@@ -203,10 +237,16 @@ void KisUpdateTimeMonitor::printValues()
            << i18n("Mouse Speed:") << QString::number( mouseSpeed, 'f', 3 ) << "\t"
            << i18n("Jobs/Update:") << QString::number( jobsPerUpdate, 'f', 3 ) << "\t"
            << i18n("Non Update Time:") << QString::number( nonUpdateTime, 'f', 3 ) << "\t"
-           << i18n("Response Time:") << responseTime << endl; // 'endl' will use the correct OS line ending
+           << i18n("Response Time:") << responseTime << "\t"
+           << i18n("Input Latency:") << QString::number( inputLatency, 'f', 3 ) << endl; // 'endl' will use the correct OS line ending
     logFile.close();
 }
 
+qreal KisUpdateTimeMonitor::averageInputLatency() const
+{
+    return m_d->numInputEvents ? qreal(m_d->inputLatency) / m_d->numInputEvents : 0.0;
+}
+
 void KisUpdateTimeMonitor::reportJobStarted(void *key)
 {
     if (!m_d->loggingEnabled) return;
@@ -254,5 +294,20 @@ void KisUpdateTimeMonitor::reportUpdateFinished(const QRect &rect)
             delete ticket;
         }
     }
+
+    const qint64 currentTime = m_d->strokeTime.elapsed();
+    const QRectF updateRect(rect);
+
+    auto it = m_d->pendingInputEvents.begin();
+    while (it != m_d->pendingInputEvents.end()) {
+        if (updateRect.contains(it->pos)) {
+            m_d->inputLatency += currentTime - it->time;
+            m_d->numInputEvents++;
+            it = m_d->pendingInputEvents.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
     m_d->numUpdates++;
 }
@@ -42,6 +42,13 @@ public:
     void reportMouseMove(const QPointF &pos);
     void printValues();
 
+    /**
+     * \return the average time (in milliseconds) between an input event
+     * and the first canvas update covering its position, measured since
+     * the start of the current stroke
+     */
+    qreal averageInputLatency() const;
+
     void reportJobStarted(void *key);
     void reportJobFinished(void *key, const QVector<QRect> &rects);
     void reportUpdateFinished(const QRect &rect);
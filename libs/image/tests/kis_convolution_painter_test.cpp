@@ -27,6 +27,10 @@
 #include <KoColorSpace.h>
 #include <KoColorSpaceRegistry.h>
 #include <KoColorSpaceTraits.h>
+#include <KoColorModelStandardIds.h>
+
+#include <functional>
+#include <limits>
 
 #include "kis_paint_device.h"
 #include "kis_convolution_painter.h"
@@ -437,6 +441,252 @@ void KisConvolutionPainterTest::testGaussianDetailsFFTW()
     testGaussianDetails(true);
 }
 
+void KisConvolutionPainterTest::testSeparableKernel()
+{
+    QImage referenceImage(QString(FILES_DATA_DIR) + QDir::separator() + "hakonepa.png");
+    const QRect imageRect(QPoint(), referenceImage.size());
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+
+    KisPaintDeviceSP dev2D = new KisPaintDevice(cs);
+    dev2D->convertFromQImage(referenceImage, 0, 0, 0);
+
+    KisPaintDeviceSP dev1D = new KisPaintDevice(cs);
+    dev1D->convertFromQImage(referenceImage, 0, 0, 0);
+
+    const qreal radius = 7;
+
+    // the 2D kernel has rank 1, so the spatial worker takes the separable path
+    KisConvolutionKernelSP kernel2D = KisGaussianKernel::createUniform2DKernel(radius, radius);
+
+    KisConvolutionPainter painter2D(dev2D, KisConvolutionPainter::SPATIAL);
+    painter2D.beginTransaction();
+    painter2D.applyMatrix(kernel2D, dev2D, imageRect.topLeft(), imageRect.topLeft(), imageRect.size(), BORDER_REPEAT);
+    painter2D.deleteTransaction();
+
+    KisConvolutionKernelSP kernelHoriz = KisGaussianKernel::createHorizontalKernel(radius);
+    KisConvolutionKernelSP kernelVertical = KisGaussianKernel::createVerticalKernel(radius);
+
+    KisConvolutionPainter horizPainter(dev1D, KisConvolutionPainter::SPATIAL);
+    horizPainter.beginTransaction();
+    horizPainter.applyMatrix(kernelHoriz, dev1D, imageRect.topLeft(), imageRect.topLeft(), imageRect.size(), BORDER_REPEAT);
+    horizPainter.deleteTransaction();
+
+    KisConvolutionPainter verticalPainter(dev1D, KisConvolutionPainter::SPATIAL);
+    verticalPainter.beginTransaction();
+    verticalPainter.applyMatrix(kernelVertical, dev1D, imageRect.topLeft(), imageRect.topLeft(), imageRect.size(), BORDER_REPEAT);
+    verticalPainter.deleteTransaction();
+
+    QImage result2D = dev2D->convertToQImage(0, imageRect);
+    QImage result1D = dev1D->convertToQImage(0, imageRect);
+
+    QPoint errpoint;
+    if (!TestUtil::compareQImages(errpoint, result1D, result2D, 1, 1)) {
+        result2D.save("separable_convolution_2d.png");
+        result1D.save("separable_convolution_1d.png");
+        QFAIL(QString("Separable kernel gives different result, first different pixel: %1,%2 ").arg(errpoint.x()).arg(errpoint.y()).toLatin1());
+    }
+}
+
+void KisConvolutionPainterTest::testTiledFFTW()
+{
+    if (!KisConvolutionPainter::supportsFFTW()) {
+        QSKIP("Krita is built without FFTW support");
+    }
+
+    QImage referenceImage(QString(FILES_DATA_DIR) + QDir::separator() + "hakonepa.png");
+    const QRect imageRect(QPoint(), referenceImage.size());
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    KisPaintDeviceSP devFFT = new KisPaintDevice(cs);
+    devFFT->convertFromQImage(referenceImage, 0, 0, 0);
+
+    KisPaintDeviceSP devSpatial = new KisPaintDevice(cs);
+    devSpatial->convertFromQImage(referenceImage, 0, 0, 0);
+
+    // the image is wider than a single FFT tile, so the area is split
+    KisConvolutionKernelSP kernel = KisGaussianKernel::createUniform2DKernel(15, 15);
+
+    // the FFT worker needs no transaction even when convolving in-place
+    KisConvolutionPainter painterFFT(devFFT, KisConvolutionPainter::FFTW);
+    QVERIFY(!painterFFT.needsTransaction(kernel));
+    painterFFT.applyMatrix(kernel, devFFT, imageRect.topLeft(), imageRect.topLeft(), imageRect.size(), BORDER_REPEAT);
+
+    KisConvolutionPainter painterSpatial(devSpatial, KisConvolutionPainter::SPATIAL);
+    painterSpatial.beginTransaction();
+    painterSpatial.applyMatrix(kernel, devSpatial, imageRect.topLeft(), imageRect.topLeft(), imageRect.size(), BORDER_REPEAT);
+    painterSpatial.deleteTransaction();
+
+    QImage resultFFT = devFFT->convertToQImage(0, imageRect);
+    QImage resultSpatial = devSpatial->convertToQImage(0, imageRect);
+
+    QPoint errpoint;
+    if (!TestUtil::compareQImages(errpoint, resultSpatial, resultFFT, 2, 2)) {
+        resultFFT.save("tiled_convolution_fftw.png");
+        resultSpatial.save("tiled_convolution_spatial.png");
+        QFAIL(QString("Tiled FFTW convolution differs from the spatial one, first different pixel: %1,%2 ").arg(errpoint.x()).arg(errpoint.y()).toLatin1());
+    }
+}
+
+/**
+ * Convolves the device with a non-separable kernel and compares the
+ * result with a straightforward double precision convolution of the
+ * premultiplied channels, that is, with the output of the original
+ * per-pixel implementation of the spatial worker.
+ */
+Eigen::Matrix<qreal, 5, 5> initNonSeparableFilter(qreal centerValue)
+{
+    Eigen::Matrix<qreal, 5, 5> filter;
+    filter << 1, 2, -3, 4, 1,
+             -2, 5, 7, -1, 3,
+              4, -6, centerValue, 2, -5,
+              1, 3, -2, 6, 2,
+             -1, 2, 4, -3, 1;
+    return filter;
+}
+
+template <typename T>
+void testPrecisionImpl(const KoColorSpace *cs,
+                       const Eigen::Matrix<qreal, 5, 5> &filter,
+                       std::function<T(int, int, int)> channelValue,
+                       qreal tolerance)
+{
+    const int channels = 4;
+    const int alphaPos = 3;
+    const int kernelSize = 5;
+    const int kernelHalf = kernelSize / 2;
+    const qreal factor = filter.sum();
+
+    const QRect imageRect(0, 0, 64, 64);
+    const QRect filterRect = imageRect.adjusted(kernelHalf, kernelHalf, -kernelHalf, -kernelHalf);
+
+    QVector<T> initialData(imageRect.width() * imageRect.height() * channels);
+    for (int y = 0; y < imageRect.height(); y++) {
+        for (int x = 0; x < imageRect.width(); x++) {
+            for (int ch = 0; ch < channels; ch++) {
+                initialData[(y * imageRect.width() + x) * channels + ch] = channelValue(x, y, ch);
+            }
+        }
+    }
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->writeBytes(reinterpret_cast<const quint8*>(initialData.constData()), imageRect);
+
+    KisConvolutionKernelSP kernel = KisConvolutionKernel::fromMatrix(filter, 0.0, factor);
+    KisConvolutionPainter gc(dev, KisConvolutionPainter::SPATIAL);
+    gc.beginTransaction();
+    gc.applyMatrix(kernel, dev, filterRect.topLeft(), filterRect.topLeft(), filterRect.size());
+    gc.deleteTransaction();
+
+    QVector<T> resultData(initialData.size());
+    dev->readBytes(reinterpret_cast<quint8*>(resultData.data()), imageRect);
+
+    auto clamp = [] (qreal value) {
+        return qBound(qreal(KoColorSpaceMathsTraits<T>::min), value, qreal(KoColorSpaceMathsTraits<T>::max));
+    };
+
+    for (int y = filterRect.top(); y <= filterRect.bottom(); y++) {
+        for (int x = filterRect.left(); x <= filterRect.right(); x++) {
+            qreal sums[channels] = {0.0, 0.0, 0.0, 0.0};
+
+            for (int r = 0; r < kernelSize; r++) {
+                for (int c = 0; c < kernelSize; c++) {
+                    const qreal coeff = filter(kernelSize - r - 1, kernelSize - c - 1);
+                    const T *pixel = initialData.constData() +
+                        ((y - kernelHalf + r) * imageRect.width() + (x - kernelHalf + c)) * channels;
+
+                    const qreal alpha = pixel[alphaPos];
+
+                    for (int ch = 0; ch < channels; ch++) {
+                        sums[ch] += coeff * (ch == alphaPos ? alpha : pixel[ch] * alpha);
+                    }
+                }
+            }
+
+            const qreal alpha = clamp(sums[alphaPos] * (1.0 / factor));
+            const T *result = resultData.constData() + (y * imageRect.width() + x) * channels;
+
+            for (int ch = 0; ch < channels; ch++) {
+                const qreal expected =
+                    ch == alphaPos ? alpha :
+                    alpha != 0.0 ? clamp(sums[ch] * (1.0 / factor) * (1.0 / alpha)) : 0.0;
+
+                const T expectedValue = std::numeric_limits<T>::is_integer ? T(qRound(expected)) : T(expected);
+
+                if (qAbs(qreal(result[ch]) - qreal(expectedValue)) > tolerance * qAbs(qreal(expectedValue))) {
+                    QFAIL(QString("Different value at %1,%2, channel %3: %4 (expected %5)")
+                          .arg(x).arg(y).arg(ch)
+                          .arg(qreal(result[ch]), 0, 'g', 10)
+                          .arg(qreal(expectedValue), 0, 'g', 10).toLatin1());
+                }
+            }
+        }
+    }
+}
+
+void KisConvolutionPainterTest::testPrecision16()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+
+    testPrecisionImpl<quint16>(cs, initNonSeparableFilter(9),
+        [] (int x, int y, int ch) {
+            return ch == 3 ?
+                quint16(40000 + (x * 2503 + y * 3001) % 25536) :
+                quint16((x * 7919 + y * 104729 + ch * 15331) % 65536);
+        },
+        0.0);
+}
+
+void KisConvolutionPainterTest::testPrecisionF32()
+{
+    const KoColorSpace *cs =
+        KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), Float32BitsColorDepthID.id(), 0);
+    QVERIFY(cs);
+
+    /**
+     * Big values with small details and a kernel with the sum much
+     * smaller than its norm, so that the sums would lose precision
+     * in floats
+     */
+    testPrecisionImpl<float>(cs, initNonSeparableFilter(-23),
+        [] (int x, int y, int ch) {
+            return ch == 3 ? 1.0f : 100000.0f + 0.01f * ((x * 7 + y * 13 + ch * 5) % 17);
+        },
+        std::numeric_limits<float>::epsilon());
+}
+
+void KisConvolutionPainterTest::benchmarkConvolution16()
+{
+    QImage referenceImage(QString(FILES_DATA_DIR) + QDir::separator() + "hakonepa.png");
+    QRect imageRect(QPoint(), referenceImage.size());
+
+    KisPaintDeviceSP dev = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb16());
+    dev->convertFromQImage(referenceImage, 0, 0, 0);
+
+    for (int radius = 1; radius <= 9; radius += 4) {
+        KisConvolutionKernelSP separableKernel = KisGaussianKernel::createUniform2DKernel(radius, radius);
+
+        KisCircleMaskGenerator* kas = new KisCircleMaskGenerator(2 * radius + 1, 1.0, 5, 5, 2, false);
+        KisConvolutionKernelSP roundKernel = KisConvolutionKernel::fromMaskGenerator(kas);
+
+        Q_FOREACH (KisConvolutionKernelSP kernel, QList<KisConvolutionKernelSP>() << separableKernel << roundKernel) {
+            KisConvolutionPainter gc(dev, KisConvolutionPainter::SPATIAL);
+
+            QTime timer; timer.start();
+
+            gc.beginTransaction();
+            gc.applyMatrix(kernel, dev, imageRect.topLeft(), imageRect.topLeft(),
+                           imageRect.size());
+            gc.revertTransaction();
+
+            dbgKrita << "Kernel:" << kernel->width() << "x" << kernel->height()
+                     << (kernel == separableKernel ? "(separable)" : "(round)")
+                     << "time:" << timer.elapsed();
+        }
+    }
+}
+
 #include "kis_transaction.h"
 
 void KisConvolutionPainterTest::testDilate()
@@ -48,6 +48,7 @@ private Q_SLOTS:
     void testAsymmSkipAlpha();
 
     void benchmarkConvolution();
+    void benchmarkConvolution16();
     void testGaussianSpatial();
     void testGaussianFFTW();
 
@@ -57,6 +58,12 @@ private Q_SLOTS:
     void testGaussianDetailsSpatial();
     void testGaussianDetailsFFTW();
 
+    void testSeparableKernel();
+    void testTiledFFTW();
+
+    void testPrecision16();
+    void testPrecisionF32();
+
     void testDilate();
     void testErode();
 };
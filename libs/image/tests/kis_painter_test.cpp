@@ -621,6 +621,80 @@ void KisPainterTest::testMassiveBltFixedCornerCases()
     QVERIFY(dst->extent().isEmpty());
 }
 
+void KisPainterTest::testMassiveBltFixedManySmallDabs()
+{
+    /**
+     * Small overlapping dabs scattered across several tiles must give
+     * exactly the same result as blitting them one-by-one, no matter
+     * in which order the tiles are processed.
+     */
+
+    const KoColorSpace* cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    QList<QColor> colors;
+    colors << QColor(255, 0, 0, 200);
+    colors << QColor(0, 255, 0, 128);
+    colors << QColor(0, 0, 255, 255);
+
+    QRect devicesRect;
+    QList<KisRenderedDab> devices;
+
+    for (int i = 0; i < 200; i++) {
+        const QRect rc(50 + (i * 37) % 150, 40 + (i * 13) % 170, 7 + i % 9, 7 + i % 5);
+
+        KisFixedPaintDeviceSP dev = new KisFixedPaintDevice(cs);
+        dev->setRect(rc);
+        dev->initialize();
+        dev->fill(rc, KoColor(colors[i % 3], cs));
+
+        KisRenderedDab dab;
+        dab.device = dev;
+        dab.offset = dev->bounds().topLeft();
+        dab.opacity = qreal(85 * (1 + i % 3)) / 255;
+        dab.flow = 1.0;
+
+        devices << dab;
+        devicesRect |= rc;
+    }
+
+    for (int useSelection = 0; useSelection < 2; useSelection++) {
+        KisSelectionSP selection;
+
+        if (useSelection) {
+            selection = new KisSelection();
+            selection->pixelSelection()->select(kisGrowRect(devicesRect, -20));
+        }
+
+        KisPaintDeviceSP dst = new KisPaintDevice(cs);
+        KisPaintDeviceSP ref = new KisPaintDevice(cs);
+
+        {
+            KisPainter painter(dst);
+            painter.setSelection(selection);
+            painter.bltFixed(devicesRect, devices);
+            painter.end();
+        }
+
+        {
+            KisPainter painter(ref);
+            painter.setSelection(selection);
+            Q_FOREACH (const KisRenderedDab &dab, devices) {
+                painter.setOpacity(qRound(255 * dab.opacity));
+                painter.bltFixed(dab.offset, dab.device, dab.device->bounds());
+            }
+            painter.end();
+        }
+
+        QPoint pt;
+        if (!TestUtil::compareQImages(pt,
+                                      dst->convertToQImage(0, devicesRect),
+                                      ref->convertToQImage(0, devicesRect), 1, 1)) {
+            QFAIL(QString("Batched composition differs from the sequential one at %1,%2 (selection: %3)")
+                  .arg(pt.x()).arg(pt.y()).arg(useSelection).toLatin1());
+        }
+    }
+}
+
 
 #include "kis_lod_transform.h"
 
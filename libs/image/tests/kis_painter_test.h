@@ -60,6 +60,7 @@ private Q_SLOTS:
     void testMassiveBltFixedMultiTileWithSelection();
 
     void testMassiveBltFixedCornerCases();
+    void testMassiveBltFixedManySmallDabs();
 
 
     void testOptimizedCopying();
@@ -382,6 +382,7 @@ void KisUpdateSchedulerTest::testBlockUpdates()
 }
 
 #include "kis_update_time_monitor.h"
+#include "kis_image_config.h"
 
 void KisUpdateSchedulerTest::testTimeMonitor()
 {
@@ -410,6 +411,40 @@ void KisUpdateSchedulerTest::testTimeMonitor()
     KisUpdateTimeMonitor::instance()->endStrokeMeasure();
 }
 
+void KisUpdateSchedulerTest::testTimeMonitorInputLatency()
+{
+    /**
+     * The monitor does nothing unless the performance log is
+     * enabled, and it reads the option only on construction
+     */
+    KisImageConfig cfg(false);
+    const bool perfLogEnabled = cfg.enablePerfLog();
+    cfg.setEnablePerfLog(true);
+    KisUpdateTimeMonitor monitor;
+    cfg.setEnablePerfLog(perfLogEnabled);
+
+    monitor.startStrokeMeasure();
+    QCOMPARE(monitor.averageInputLatency(), 0.0);
+
+    monitor.reportMouseMove(QPointF(15, 15));
+    monitor.reportMouseMove(QPointF(100, 0));
+    QTest::qSleep(200);
+
+    // the update doesn't cover any of the events
+    monitor.reportUpdateFinished(QRect(30, 30, 10, 10));
+    QCOMPARE(monitor.averageInputLatency(), 0.0);
+
+    QTest::qSleep(200);
+    monitor.reportUpdateFinished(QRect(10, 10, 10, 10));
+
+    const qreal latency = monitor.averageInputLatency();
+    QVERIFY(latency >= 400);
+
+    // the event at (15, 15) has already reached the screen
+    monitor.reportUpdateFinished(QRect(10, 10, 10, 10));
+    QCOMPARE(monitor.averageInputLatency(), latency);
+}
+
 void KisUpdateSchedulerTest::testLodSync()
 {
     KisImageSP image = buildTestingImage();
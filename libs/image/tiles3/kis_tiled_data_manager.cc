@@ -18,6 +18,9 @@
  *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include <algorithm>
+
+#include <QCryptographicHash>
 #include <QRect>
 #include <QVector>
 
@@ -138,6 +141,47 @@ bool KisTiledDataManager::write(KisPaintDeviceWriter &store)
 
     return retval;
 }
+QByteArray KisTiledDataManager::contentHash()
+{
+    QReadLocker locker(&m_lock);
+
+    QVector<KisTileSP> tiles;
+    tiles.reserve(m_hashTable->numTiles());
+
+    KisTileHashTableConstIterator iter(m_hashTable);
+    KisTileSP tile;
+
+    while ((tile = iter.tile())) {
+        tiles.append(tile);
+        iter.next();
+    }
+
+    // the order of the tiles in the hash table depends on its history
+    std::sort(tiles.begin(), tiles.end(),
+              [] (KisTileSP lhs, KisTileSP rhs) {
+                  return lhs->row() < rhs->row() ||
+                      (lhs->row() == rhs->row() && lhs->col() < rhs->col());
+              });
+
+    QCryptographicHash hash(QCryptographicHash::Md5);
+
+    const qint32 header[] = {qint32(pixelSize()), qint32(tiles.size())};
+    hash.addData(reinterpret_cast<const char*>(header), sizeof(header));
+
+    const int tileDataSize = KisTileData::WIDTH * KisTileData::HEIGHT * pixelSize();
+
+    Q_FOREACH (tile, tiles) {
+        const qint32 position[] = {tile->col(), tile->row()};
+        hash.addData(reinterpret_cast<const char*>(position), sizeof(position));
+
+        tile->lockForRead();
+        hash.addData(reinterpret_cast<const char*>(tile->data()), tileDataSize);
+        tile->unlockForRead();
+    }
+
+    return hash.result();
+}
+
 bool KisTiledDataManager::read(QIODevice *stream)
 {
     clear();
@@ -204,6 +204,18 @@ public:
 
     static void releaseInternalPools();
 
+    /**
+     * Calculates a hash of the tiles of the data manager: their
+     * positions and pixel data. The hash doesn't depend on the order of
+     * the tiles in the hash table, so two data managers that would be
+     * read back into the same content have the same hash. The default
+     * pixel is not included.
+     *
+     * The hash is much cheaper to calculate than write() is, so it can
+     * be used for checking whether the data needs to be saved again.
+     */
+    QByteArray contentHash();
+
 protected:
     /**
      * Reads and writes the tiles 
@@ -541,6 +541,40 @@ void KisTiledDataManagerTest::testUndoSetDefaultPixel()
 
 //#include <valgrind/callgrind.h>
 
+void KisTiledDataManagerTest::testContentHash()
+{
+    quint8 defaultPixel = 0;
+    quint8 oddPixel1 = 128;
+    quint8 oddPixel2 = 129;
+
+    QRect rect1(0,0,100,100);
+    QRect rect2(200,200,100,100);
+
+    KisTiledDataManager dm1(1, &defaultPixel);
+    dm1.clear(rect1, &oddPixel1);
+    dm1.clear(rect2, &oddPixel2);
+
+    // the same content created in a different order
+    KisTiledDataManager dm2(1, &defaultPixel);
+    dm2.clear(rect2, &oddPixel2);
+    dm2.clear(rect1, &oddPixel1);
+
+    QCOMPARE(dm1.contentHash(), dm2.contentHash());
+
+    // the shared tiles have the same content
+    KisTiledDataManager dm3(dm1);
+    QCOMPARE(dm3.contentHash(), dm1.contentHash());
+
+    dm3.clear(QRect(10,10,1,1), &oddPixel2);
+    QVERIFY(dm3.contentHash() != dm1.contentHash());
+
+    // the same pixels in a different place
+    KisTiledDataManager dm4(1, &defaultPixel);
+    dm4.clear(rect1.translated(64, 0), &oddPixel1);
+    dm4.clear(rect2.translated(64, 0), &oddPixel2);
+    QVERIFY(dm4.contentHash() != dm1.contentHash());
+}
+
 void KisTiledDataManagerTest::benchmarkReadOnlyTileLazy()
 {
     quint8 defaultPixel = 0;
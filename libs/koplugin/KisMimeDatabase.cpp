@@ -197,6 +197,11 @@ void KisMimeDatabase::fillMimeData()
         mimeType.suffixes = QStringList() << "r8";
         s_mimeDatabase << mimeType;
 
+        mimeType.mimeType = "application/x-krita-raw-canvas";
+        mimeType.description = i18nc("description of a file type", "Krita Raw Canvas");
+        mimeType.suffixes = QStringList() << "krc";
+        s_mimeDatabase << mimeType;
+
         mimeType.mimeType = "application/x-spriter";
         mimeType.description = i18nc("description of a file type", "Spriter SCML");
         mimeType.suffixes = QStringList() << "scml";
@@ -422,6 +422,26 @@ public:
     virtual void setOpacity(quint8 * pixels, quint8 alpha, qint32 nPixels) const = 0;
     virtual void setOpacity(quint8 * pixels, qreal alpha, qint32 nPixels) const = 0;
 
+    /**
+     * Copy the alpha channels of the given run of pixels into an array
+     * of 8-bit values.
+     *
+     * pixels -- a pointer to the pixels to read the alpha from
+     * alpha -- the array of nPixels downscaled 8-bit values
+     * nPixels -- the number of pixels
+     */
+    virtual void copyOpacityU8(const quint8 * pixels, quint8 * alpha, qint32 nPixels) const = 0;
+
+    /**
+     * Set the alpha channel of every pixel in the run to the corresponding
+     * 8-bit value of the array.
+     *
+     * pixels -- a pointer to the pixels that will have their alpha set
+     * alpha -- the array of nPixels downscaled 8-bit values
+     * nPixels -- the number of pixels
+     */
+    virtual void setOpacityU8(quint8 * pixels, const quint8 * alpha, qint32 nPixels) const = 0;
+
     /**
      * Multiply the alpha channel of the given run of pixels by the given value.
      *
@@ -31,6 +31,7 @@
 #include "KoFallBackColorTransformation.h"
 #include "KoLabDarkenColorTransformation.h"
 #include "KoMixColorsOpImpl.h"
+#include "KoOptimizedMixColorsOpFactory.h"
 
 #include "KoConvolutionOpImpl.h"
 #include "KoInvertColorTransformation.h"
@@ -53,7 +54,7 @@ public:
 
 public:
     KoColorSpaceAbstract(const QString &id, const QString &name) :
-        KoColorSpace(id, name, new KoMixColorsOpImpl< _CSTrait>(), new KoConvolutionOpImpl< _CSTrait>()) {
+        KoColorSpace(id, name, KoOptimizedMixColorsOpFactory::create<_CSTrait>(), new KoConvolutionOpImpl< _CSTrait>()) {
     }
 
     quint32 colorChannelCount() const override {
@@ -117,6 +118,14 @@ public:
         _CSTrait::setOpacity(pixels, alpha, nPixels);
     }
 
+    void copyOpacityU8(const quint8 * pixels, quint8 * alpha, qint32 nPixels) const override {
+        _CSTrait::copyOpacityU8(pixels, alpha, nPixels);
+    }
+
+    void setOpacityU8(quint8 * pixels, const quint8 * alpha, qint32 nPixels) const override {
+        _CSTrait::setOpacityU8(pixels, alpha, nPixels);
+    }
+
     void multiplyAlpha(quint8 * pixels, quint8 alpha, qint32 nPixels) const override {
         _CSTrait::multiplyAlpha(pixels, alpha, nPixels);
     }
@@ -21,6 +21,7 @@
 #define _KO_COLORSPACE_TRAITS_H_
 
 #include <QVector>
+#include <string.h>
 
 #include "KoColorSpaceConstants.h"
 #include "KoColorSpaceMaths.h"
@@ -106,6 +107,33 @@ struct KoColorSpaceTrait {
         }
     }
 
+    /**
+     * Copy the alpha channels of the run of pixels into \p alpha,
+     * downscaled to the 0..255 range
+     */
+    inline static void copyOpacityU8(const quint8 * pixels, quint8 * alpha, qint32 nPixels) {
+        if (alpha_pos < 0) {
+            memset(alpha, OPACITY_OPAQUE_U8, nPixels);
+            return;
+        }
+
+        for (; nPixels > 0; --nPixels, pixels += pixelSize, ++alpha) {
+            *alpha = KoColorSpaceMaths<channels_type, quint8>::scaleToA(nativeArray(pixels)[alpha_pos]);
+        }
+    }
+
+    /**
+     * Set the alpha channel of every pixel from the corresponding
+     * value of \p alpha in the 0..255 range
+     */
+    inline static void setOpacityU8(quint8 * pixels, const quint8 * alpha, qint32 nPixels) {
+        if (alpha_pos < 0) return;
+
+        for (; nPixels > 0; --nPixels, pixels += pixelSize, ++alpha) {
+            nativeArray(pixels)[alpha_pos] = KoColorSpaceMaths<quint8, channels_type>::scaleToA(*alpha);
+        }
+    }
+
     /**
      * Convenient function for transforming a quint8* array in a pointer of the native channels type
      */
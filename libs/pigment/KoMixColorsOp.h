@@ -76,6 +76,37 @@ public:
      */
     virtual void mixColors(const quint8 * const*colors, quint32 nColors, quint8 *dst) const = 0;
     virtual void mixColors(const quint8 *colors, quint32 nColors, quint8 *dst) const = 0;
+
+    /**
+     * Mix the colors of a rectangular area of a contiguous buffer uniformly.
+     * Unlike mixColors() it doesn't require the caller to build an array of
+     * pointers to the pixels, so it can be used to average a whole dab area
+     * in one call.
+     *
+     * @param colors a pointer to the top-left pixel of the area
+     * @param rowStride the distance between the rows of the area in bytes
+     * @param width the width of the area in pixels
+     * @param height the height of the area in pixels
+     * @param dst the destination pixel
+     */
+    virtual void mixColorsRect(const quint8 *colors, int rowStride, int width, int height, quint8 *dst) const = 0;
+
+    /**
+     * Mix the colors of a rectangular area of a contiguous buffer using
+     * an 8-bit mask as weights. The weights are normalized by their sum,
+     * so the mask can have an arbitrary shape (e.g. a dab).
+     *
+     * @param colors a pointer to the top-left pixel of the area
+     * @param rowStride the distance between the rows of the area in bytes
+     * @param mask a pointer to the top-left value of the mask
+     * @param maskRowStride the distance between the rows of the mask in bytes
+     * @param width the width of the area in pixels
+     * @param height the height of the area in pixels
+     * @param dst the destination pixel
+     */
+    virtual void mixColorsRect(const quint8 *colors, int rowStride,
+                               const quint8 *mask, int maskRowStride,
+                               int width, int height, quint8 *dst) const = 0;
 };
 
 #endif
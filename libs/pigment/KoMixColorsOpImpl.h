@@ -23,6 +23,9 @@
 
 #include "KoMixColorsOp.h"
 
+#include <type_traits>
+#include <limits>
+
 template<class _CSTrait>
 class KoMixColorsOpImpl : public KoMixColorsOp
 {
@@ -46,7 +49,29 @@ public:
         mixColorsImpl(PointerToArray(colors, _CSTrait::pixelSize), NoWeightsSurrogate(nColors), nColors, dst);
     }
 
+    void mixColorsRect(const quint8 *colors, int rowStride, int width, int height, quint8 *dst) const override {
+        mixColorsImpl(RectSource(colors, rowStride, width), NoWeightsRectSurrogate(width * height), width * height, dst);
+    }
+
+    void mixColorsRect(const quint8 *colors, int rowStride,
+                       const quint8 *mask, int maskRowStride,
+                       int width, int height, quint8 *dst) const override {
+        mixColorsImpl(RectSource(colors, rowStride, width), MaskWeightsWrapper(mask, maskRowStride, width), width * height, dst);
+    }
+
 private:
+    typedef typename KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::compositetype compositetype;
+
+    /**
+     * The rect-based mixing may sum up millions of pixels, which overflows
+     * the standard compositetype of the integer colorspaces, so we use a
+     * wider accumulator for it.
+     */
+    typedef typename std::conditional<std::numeric_limits<compositetype>::is_integer,
+                                      qint64,
+                                      compositetype>::type widecompositetype;
+
+
     struct ArrayOfPointers {
         ArrayOfPointers(const quint8 * const* colors)
             : m_colors(colors)
@@ -85,6 +110,38 @@ private:
         const int m_pixelSize;
     };
 
+    struct RectSource {
+        RectSource(const quint8 *colors, int rowStride, int width)
+            : m_rowStart(colors),
+              m_colors(colors),
+              m_rowStride(rowStride),
+              m_width(width),
+              m_column(0)
+        {
+        }
+
+        const quint8* getPixel() const {
+            return m_colors;
+        }
+
+        void nextPixel() {
+            if (++m_column >= m_width) {
+                m_column = 0;
+                m_rowStart += m_rowStride;
+                m_colors = m_rowStart;
+            } else {
+                m_colors += _CSTrait::pixelSize;
+            }
+        }
+
+    private:
+        const quint8 *m_rowStart;
+        const quint8 *m_colors;
+        const int m_rowStride;
+        const int m_width;
+        int m_column;
+    };
+
     struct WeightsWrapper
     {
         typedef typename KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::compositetype compositetype;
@@ -133,11 +190,79 @@ private:
         const int m_numPixles;
     };
 
+    struct NoWeightsRectSurrogate
+    {
+        typedef widecompositetype compositetype;
+
+        NoWeightsRectSurrogate(int numPixels)
+            : m_numPixles(numPixels)
+        {
+        }
+
+        inline void nextPixel() {
+        }
+
+        inline void premultiplyAlphaWithWeight(compositetype &) const {
+        }
+
+        inline compositetype normalizeFactor() const {
+            return m_numPixles;
+        }
+
+    private:
+        const int m_numPixles;
+    };
+
+    struct MaskWeightsWrapper
+    {
+        typedef widecompositetype compositetype;
+
+        MaskWeightsWrapper(const quint8 *mask, int maskRowStride, int width)
+            : m_rowStart(mask),
+              m_mask(mask),
+              m_maskRowStride(maskRowStride),
+              m_width(width),
+              m_column(0),
+              m_sumOfWeights(0)
+        {
+        }
+
+        inline void nextPixel() {
+            m_sumOfWeights += *m_mask;
+
+            if (++m_column >= m_width) {
+                m_column = 0;
+                m_rowStart += m_maskRowStride;
+                m_mask = m_rowStart;
+            } else {
+                m_mask++;
+            }
+        }
+
+        inline void premultiplyAlphaWithWeight(compositetype &alpha) const {
+            alpha *= *m_mask;
+        }
+
+        inline compositetype normalizeFactor() const {
+            return m_sumOfWeights;
+        }
+
+    private:
+        const quint8 *m_rowStart;
+        const quint8 *m_mask;
+        const int m_maskRowStride;
+        const int m_width;
+        int m_column;
+        compositetype m_sumOfWeights;
+    };
+
     template<class AbstractSource, class WeightsWrapper>
     void mixColorsImpl(AbstractSource source, WeightsWrapper weightsWrapper, quint32 nColors, quint8 *dst) const {
+        typedef typename WeightsWrapper::compositetype compositetype;
+
         // Create and initialize to 0 the array of totals
-        typename KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::compositetype totals[_CSTrait::channels_nb];
-        typename KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::compositetype totalAlpha = 0;
+        compositetype totals[_CSTrait::channels_nb];
+        compositetype totalAlpha = 0;
 
         memset(totals, 0, sizeof(totals));
 
@@ -145,7 +270,7 @@ private:
 
         while (nColors--) {
             const typename _CSTrait::channels_type* color = _CSTrait::nativeArray(source.getPixel());
-            typename KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::compositetype alphaTimesWeight;
+            compositetype alphaTimesWeight;
 
             if (_CSTrait::alpha_pos != -1) {
                 alphaTimesWeight = color[_CSTrait::alpha_pos];
@@ -167,7 +292,7 @@ private:
         }
 
         // set totalAlpha to the minimum between its value and the unit value of the channels
-        const int sumOfWeights = weightsWrapper.normalizeFactor();
+        const compositetype sumOfWeights = weightsWrapper.normalizeFactor();
 
         if (totalAlpha > KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::unitValue * sumOfWeights) {
             totalAlpha = KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::unitValue * sumOfWeights;
@@ -180,7 +305,7 @@ private:
             for (int i = 0; i < (int)_CSTrait::channels_nb; i++) {
                 if (i != _CSTrait::alpha_pos) {
 
-                    typename KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::compositetype v = totals[i] / totalAlpha;
+                    compositetype v = totals[i] / totalAlpha;
 
                     if (v > KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::max) {
                         v = KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::max;
@@ -20,12 +20,19 @@
 
 #include "../compositeops/KoCompositeOpAlphaDarken.h"
 #include "../compositeops/KoCompositeOpOver.h"
+#include "../compositeops/KoAlphaDarkenParamsWrapper.h"
 #include <KoOptimizedCompositeOpFactory.h>
 
 #include <KoColorSpaceTraits.h>
 #include <KoColorSpaceRegistry.h>
+#include <KoColorModelStandardIds.h>
+#include <KoCompositeOpRegistry.h>
 
 #include <QTest>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <QDir>
 
 const int TILE_WIDTH = 64;
 const int TILE_HEIGHT = 64;
@@ -39,11 +46,15 @@ const int TILES_IN_WIDTH = IMG_WIDTH / TILE_WIDTH;
 const int TILES_IN_HEIGHT = IMG_HEIGHT / TILE_HEIGHT;
 
 
-#define COMPOSITE_BENCHMARK \
+// the buffers are big enough for the pixels of RGBA F32 colorspace
+const int MAX_PIXEL_SIZE = KoRgbF32Traits::pixelSize;
+
+
+#define COMPOSITE_BENCHMARK_PIXEL(pixelSize) \
         for (int y = 0; y < TILES_IN_HEIGHT; y++){                                              \
             for (int x = 0; x < TILES_IN_WIDTH; x++) {                                           \
-                const int rowStride = IMG_WIDTH * KoBgrU8Traits::pixelSize;  \
-                const int bufOffset = y * rowStride + x * TILE_WIDTH * KoBgrU8Traits::pixelSize;  \
+                const int rowStride = IMG_WIDTH * pixelSize;  \
+                const int bufOffset = y * rowStride + x * TILE_WIDTH * pixelSize;  \
                 compositeOp->composite(m_dstBuffer + bufOffset, rowStride,      \
                                       m_srcBuffer + bufOffset, rowStride,      \
                                       m_mskBuffer + bufOffset, rowStride,                                                            \
@@ -52,9 +63,112 @@ const int TILES_IN_HEIGHT = IMG_HEIGHT / TILE_HEIGHT;
             }                                                                                   \
         }
 
+#define COMPOSITE_BENCHMARK COMPOSITE_BENCHMARK_PIXEL(KoBgrU8Traits::pixelSize)
+
+/**
+ * Random bytes are not valid floating point pixels, so the buffers
+ * are refilled with the channels in 0...1 range
+ */
+template<class Traits>
+void initFloatingPointBuffers(quint8 *srcBuffer, quint8 *dstBuffer)
+{
+    typedef typename Traits::channels_type channels_type;
+
+    channels_type *src = reinterpret_cast<channels_type*>(srcBuffer);
+    channels_type *dst = reinterpret_cast<channels_type*>(dstBuffer);
+
+    qsrand(42);
+
+    for (int i = 0; i < int(IMG_WIDTH * IMG_HEIGHT * Traits::channels_nb); i++) {
+        src[i] = channels_type(float(qrand() & 0xFFFF) / 0xFFFF);
+        dst[i] = channels_type(float(qrand() & 0xFFFF) / 0xFFFF);
+    }
+}
+
+/**
+ * The size of the image used by the composite ops matrix. It is smaller
+ * than the one used by the other benchmarks, because the matrix has a
+ * few thousands of entries.
+ */
+const int MATRIX_IMG_WIDTH = 512;
+const int MATRIX_IMG_HEIGHT = 512;
+const int MATRIX_MIN_TIME_MS = 50;
+const int MATRIX_PATTERN_SIZE = 4096;
+
+namespace {
+
+QList<QPair<KoID, KoID>> matrixColorSpaceIds()
+{
+    QList<QPair<KoID, KoID>> ids;
+
+    ids << qMakePair(RGBAColorModelID, Integer8BitsColorDepthID);
+    ids << qMakePair(RGBAColorModelID, Integer16BitsColorDepthID);
+    ids << qMakePair(RGBAColorModelID, Float16BitsColorDepthID);
+    ids << qMakePair(RGBAColorModelID, Float32BitsColorDepthID);
+    ids << qMakePair(CMYKAColorModelID, Integer8BitsColorDepthID);
+    ids << qMakePair(CMYKAColorModelID, Integer16BitsColorDepthID);
+    ids << qMakePair(LABAColorModelID, Integer16BitsColorDepthID);
+    ids << qMakePair(GrayAColorModelID, Integer8BitsColorDepthID);
+
+    return ids;
+}
+
+/**
+ * Fills \p buffer with random pixels. Random bytes are not valid
+ * pixels for floating point colorspaces, so the pixels are generated
+ * from normalized channel values and then repeated all over the buffer.
+ */
+void fillRandomPixels(const KoColorSpace *cs, quint8 *buffer, int numPixels)
+{
+    const int pixelSize = cs->pixelSize();
+    const int patternSize = qMin(numPixels, MATRIX_PATTERN_SIZE);
+
+    QVector<float> channels(cs->channelCount());
+
+    for (int i = 0; i < patternSize; i++) {
+        for (auto it = channels.begin(); it != channels.end(); ++it) {
+            *it = float(qrand() & 0xFFFF) / 0xFFFF;
+        }
+        cs->fromNormalisedChannelsValue(buffer + i * pixelSize, channels);
+    }
+
+    for (int i = patternSize; i < numPixels; i += patternSize) {
+        const int numCopied = qMin(patternSize, numPixels - i);
+        memcpy(buffer + i * pixelSize, buffer, numCopied * pixelSize);
+    }
+}
+
+}
+
+void KoCompositeOpsBenchmark::saveMatrixResults(const QVector<MatrixResult> &results)
+{
+    const QString fileName = QDir::currentPath() + QDir::separator() + "KoCompositeOpsBenchmark_matrix.csv";
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        qWarning() << "Failed to save the composite ops matrix to" << fileName;
+        return;
+    }
+
+    QTextStream out(&file);
+    out << "colorModel,colorDepth,compositeOp,mask,opacity,flow,mpixPerSecond\n";
+
+    Q_FOREACH (const MatrixResult &r, results) {
+        out << r.colorModelId << ","
+            << r.colorDepthId << ","
+            << r.compositeOpId << ","
+            << (r.haveMask ? 1 : 0) << ","
+            << r.opacity << ","
+            << r.flow << ","
+            << QString::number(r.mpixPerSecond, 'f', 2) << "\n";
+    }
+
+    qDebug() << "Composite ops matrix is saved to" << fileName;
+}
+
 void KoCompositeOpsBenchmark::initTestCase()
 {
-    const int bufLen = IMG_HEIGHT * IMG_WIDTH * KoBgrU8Traits::pixelSize;
+    const int bufLen = IMG_HEIGHT * IMG_WIDTH * MAX_PIXEL_SIZE;
 
     m_dstBuffer = new quint8[bufLen];
     m_srcBuffer = new quint8[bufLen];
@@ -78,6 +192,10 @@ void KoCompositeOpsBenchmark::init()
 
 void KoCompositeOpsBenchmark::cleanupTestCase()
 {
+    if (!m_matrixResults.isEmpty()) {
+        saveMatrixResults(m_matrixResults);
+    }
+
     delete [] m_dstBuffer;
     delete [] m_srcBuffer;
     delete [] m_mskBuffer;
@@ -109,4 +227,235 @@ void KoCompositeOpsBenchmark::benchmarkCompositeAlphaDarkenCreamy()
 }
 
 
+void KoCompositeOpsBenchmark::benchmarkCompositeOverF32()
+{
+    initFloatingPointBuffers<KoRgbF32Traits>(m_srcBuffer, m_dstBuffer);
+
+    const KoColorSpace *cs =
+        KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), Float32BitsColorDepthID.id(), 0);
+
+    KoCompositeOp *compositeOp = KoOptimizedCompositeOpFactory::createOverOp128(cs);
+    QBENCHMARK{
+        COMPOSITE_BENCHMARK_PIXEL(KoRgbF32Traits::pixelSize)
+    }
+}
+
+void KoCompositeOpsBenchmark::benchmarkCompositeAlphaDarkenF32()
+{
+    initFloatingPointBuffers<KoRgbF32Traits>(m_srcBuffer, m_dstBuffer);
+
+    const KoColorSpace *cs =
+        KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), Float32BitsColorDepthID.id(), 0);
+
+    KoCompositeOp *compositeOp = new KoCompositeOpAlphaDarken<KoRgbF32Traits, KoAlphaDarkenParamsWrapperHard>(cs);
+    QBENCHMARK{
+        COMPOSITE_BENCHMARK_PIXEL(KoRgbF32Traits::pixelSize)
+    }
+}
+
+void KoCompositeOpsBenchmark::benchmarkCompositeOverF16()
+{
+#ifdef HAVE_OPENEXR
+    initFloatingPointBuffers<KoRgbF16Traits>(m_srcBuffer, m_dstBuffer);
+
+    const KoColorSpace *cs =
+        KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), Float16BitsColorDepthID.id(), 0);
+
+    KoCompositeOp *compositeOp = KoOptimizedCompositeOpFactory::createOverOpF16(cs);
+    QBENCHMARK{
+        COMPOSITE_BENCHMARK_PIXEL(KoRgbF16Traits::pixelSize)
+    }
+#else
+    QSKIP("Krita is built without OpenEXR support");
+#endif
+}
+
+void KoCompositeOpsBenchmark::benchmarkCompositeOverF16Generic()
+{
+#ifdef HAVE_OPENEXR
+    initFloatingPointBuffers<KoRgbF16Traits>(m_srcBuffer, m_dstBuffer);
+
+    const KoColorSpace *cs =
+        KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), Float16BitsColorDepthID.id(), 0);
+
+    KoCompositeOp *compositeOp = new KoCompositeOpOver<KoRgbF16Traits>(cs);
+    QBENCHMARK{
+        COMPOSITE_BENCHMARK_PIXEL(KoRgbF16Traits::pixelSize)
+    }
+#else
+    QSKIP("Krita is built without OpenEXR support");
+#endif
+}
+
+void KoCompositeOpsBenchmark::benchmarkCompositeAlphaDarkenF16()
+{
+#ifdef HAVE_OPENEXR
+    initFloatingPointBuffers<KoRgbF16Traits>(m_srcBuffer, m_dstBuffer);
+
+    const KoColorSpace *cs =
+        KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), Float16BitsColorDepthID.id(), 0);
+
+    KoCompositeOp *compositeOp = KoOptimizedCompositeOpFactory::createAlphaDarkenOpHardF16(cs);
+    QBENCHMARK{
+        COMPOSITE_BENCHMARK_PIXEL(KoRgbF16Traits::pixelSize)
+    }
+#else
+    QSKIP("Krita is built without OpenEXR support");
+#endif
+}
+
+void KoCompositeOpsBenchmark::benchmarkCompositeAlphaDarkenF16Generic()
+{
+#ifdef HAVE_OPENEXR
+    initFloatingPointBuffers<KoRgbF16Traits>(m_srcBuffer, m_dstBuffer);
+
+    const KoColorSpace *cs =
+        KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), Float16BitsColorDepthID.id(), 0);
+
+    KoCompositeOp *compositeOp = new KoCompositeOpAlphaDarken<KoRgbF16Traits, KoAlphaDarkenParamsWrapperHard>(cs);
+    QBENCHMARK{
+        COMPOSITE_BENCHMARK_PIXEL(KoRgbF16Traits::pixelSize)
+    }
+#else
+    QSKIP("Krita is built without OpenEXR support");
+#endif
+}
+
+
+void KoCompositeOpsBenchmark::benchmarkCompositeOpsMatrix_data()
+{
+    QTest::addColumn<QString>("colorModelId");
+    QTest::addColumn<QString>("colorDepthId");
+    QTest::addColumn<QString>("compositeOpId");
+    QTest::addColumn<bool>("haveMask");
+    QTest::addColumn<qreal>("opacity");
+    QTest::addColumn<qreal>("flow");
+
+    typedef QPair<KoID, KoID> ColorSpaceId;
+
+    Q_FOREACH (const ColorSpaceId &id, matrixColorSpaceIds()) {
+        const KoColorSpace *cs =
+            KoColorSpaceRegistry::instance()->colorSpace(id.first.id(), id.second.id(), 0);
+
+        if (!cs) continue;
+
+        Q_FOREACH (const KoCompositeOp *op, cs->compositeOps()) {
+            QList<qreal> flowValues;
+            flowValues << 1.0;
+
+            // only alpha darken takes flow into account
+            if (op->id() == COMPOSITE_ALPHA_DARKEN) {
+                flowValues << 0.5;
+            }
+
+            for (int haveMask = 0; haveMask <= 1; haveMask++) {
+                Q_FOREACH (qreal opacity, QList<qreal>() << 1.0 << 0.5) {
+                    Q_FOREACH (qreal flow, flowValues) {
+                        const QString name =
+                            QString("%1-%2-%3-%4-o%5-f%6")
+                                .arg(id.first.id())
+                                .arg(id.second.id())
+                                .arg(op->id())
+                                .arg(haveMask ? "mask" : "nomask")
+                                .arg(opacity)
+                                .arg(flow);
+
+                        QTest::newRow(name.toLatin1())
+                            << id.first.id() << id.second.id() << op->id()
+                            << bool(haveMask) << opacity << flow;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void KoCompositeOpsBenchmark::benchmarkCompositeOpsMatrix()
+{
+    QFETCH(QString, colorModelId);
+    QFETCH(QString, colorDepthId);
+    QFETCH(QString, compositeOpId);
+    QFETCH(bool, haveMask);
+    QFETCH(qreal, opacity);
+    QFETCH(qreal, flow);
+
+    const KoColorSpace *cs =
+        KoColorSpaceRegistry::instance()->colorSpace(colorModelId, colorDepthId, 0);
+    QVERIFY(cs);
+
+    const KoCompositeOp *op = cs->compositeOp(compositeOpId);
+    QVERIFY(op);
+
+    const int numPixels = MATRIX_IMG_WIDTH * MATRIX_IMG_HEIGHT;
+    const int pixelSize = cs->pixelSize();
+    const int rowStride = MATRIX_IMG_WIDTH * pixelSize;
+
+    QVector<quint8> srcBuffer(numPixels * pixelSize);
+    QVector<quint8> dstBuffer(numPixels * pixelSize);
+    QVector<quint8> dstInitialBuffer(numPixels * pixelSize);
+    QVector<quint8> mskBuffer(numPixels);
+
+    qsrand(42);
+
+    fillRandomPixels(cs, srcBuffer.data(), numPixels);
+    fillRandomPixels(cs, dstInitialBuffer.data(), numPixels);
+
+    for (int i = 0; i < numPixels; i++) {
+        mskBuffer[i] = qrand() & 0xFF;
+    }
+
+    KoCompositeOp::ParameterInfo params;
+    params.srcRowStride = rowStride;
+    params.dstRowStride = rowStride;
+    params.maskRowStride = haveMask ? MATRIX_IMG_WIDTH : 0;
+    params.rows = TILE_HEIGHT;
+    params.cols = TILE_WIDTH;
+    params.setOpacityAndAverage(opacity, opacity);
+    params.flow = flow;
+
+    qint64 totalNanoseconds = 0;
+    qint64 totalPixels = 0;
+
+    QElapsedTimer timer;
+
+    /**
+     * The destination is restored before every pass, so that the
+     * repeated blending doesn't make it converge to a flat color
+     */
+    while (totalNanoseconds < MATRIX_MIN_TIME_MS * 1000000LL) {
+        // dstBuffer is never shared, so data() doesn't copy inside the timed loop
+        memcpy(dstBuffer.data(), dstInitialBuffer.constData(), dstBuffer.size());
+
+        timer.start();
+
+        for (int y = 0; y < MATRIX_IMG_HEIGHT; y += TILE_HEIGHT) {
+            for (int x = 0; x < MATRIX_IMG_WIDTH; x += TILE_WIDTH) {
+                const int bufOffset = y * rowStride + x * pixelSize;
+
+                params.dstRowStart = dstBuffer.data() + bufOffset;
+                params.srcRowStart = srcBuffer.constData() + bufOffset;
+                params.maskRowStart = haveMask ? mskBuffer.constData() + y * MATRIX_IMG_WIDTH + x : 0;
+
+                op->composite(params);
+            }
+        }
+
+        totalNanoseconds += timer.nsecsElapsed();
+        totalPixels += numPixels;
+    }
+
+    MatrixResult result;
+    result.colorModelId = colorModelId;
+    result.colorDepthId = colorDepthId;
+    result.compositeOpId = compositeOpId;
+    result.haveMask = haveMask;
+    result.opacity = opacity;
+    result.flow = flow;
+    result.mpixPerSecond = qreal(totalPixels) * 1000.0 / totalNanoseconds;
+
+    m_matrixResults.append(result);
+
+    qDebug() << "Mpix/s:" << QString::number(result.mpixPerSecond, 'f', 2);
+}
+
 QTEST_GUILESS_MAIN(KoCompositeOpsBenchmark)
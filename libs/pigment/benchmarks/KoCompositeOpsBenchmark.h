@@ -20,6 +20,8 @@
 #define KO_COMPOSITEOPS_BENCHMARK_H_
 
 #include <QObject>
+#include <QVector>
+#include <QString>
 
 class KoCompositeOpsBenchmark : public QObject
 {
@@ -34,10 +36,37 @@ private Q_SLOTS:
     void benchmarkCompositeAlphaDarkenHard();
     void benchmarkCompositeAlphaDarkenCreamy();
 
+    void benchmarkCompositeOverF32();
+    void benchmarkCompositeAlphaDarkenF32();
+
+    void benchmarkCompositeOverF16();
+    void benchmarkCompositeOverF16Generic();
+    void benchmarkCompositeAlphaDarkenF16();
+    void benchmarkCompositeAlphaDarkenF16Generic();
+
+    void benchmarkCompositeOpsMatrix_data();
+    void benchmarkCompositeOpsMatrix();
+
+private:
+    struct MatrixResult
+    {
+        QString colorModelId;
+        QString colorDepthId;
+        QString compositeOpId;
+        bool haveMask;
+        qreal opacity;
+        qreal flow;
+        qreal mpixPerSecond;
+    };
+
+    static void saveMatrixResults(const QVector<MatrixResult> &results);
+
 private:
     quint8 * m_dstBuffer;
     quint8 * m_srcBuffer;
     quint8 * m_mskBuffer;
+
+    QVector<MatrixResult> m_matrixResults;
         
 
 };
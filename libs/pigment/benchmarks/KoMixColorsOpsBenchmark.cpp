@@ -0,0 +1,153 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This library is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation; either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KoMixColorsOpsBenchmark.h"
+
+#include <KoColorSpaceMaths.h>
+#include <KoColorSpaceTraits.h>
+#include <KoMixColorsOpImpl.h>
+#include <KoOptimizedMixColorsOpFactory.h>
+
+#include <QTest>
+#include <QScopedPointer>
+
+/**
+ * The size of the area is chosen to be close to an area sampled
+ * by the color smudge brush of a medium size
+ */
+const int AREA_WIDTH = 128;
+const int AREA_HEIGHT = 128;
+const int NUM_REPEATS = 64;
+
+const int MAX_PIXEL_SIZE = 16;
+
+
+template <class Traits>
+void benchmarkPointersImpl(const quint8 *srcBuffer)
+{
+    QScopedPointer<KoMixColorsOp> op(new KoMixColorsOpImpl<Traits>());
+
+    QVector<const quint8*> pixels;
+    for (int i = 0; i < AREA_WIDTH * AREA_HEIGHT; i++) {
+        pixels << srcBuffer + i * Traits::pixelSize;
+    }
+
+    quint8 dst[MAX_PIXEL_SIZE];
+
+    QBENCHMARK {
+        for (int i = 0; i < NUM_REPEATS; i++) {
+            op->mixColors(pixels.constData(), pixels.size(), dst);
+        }
+    }
+}
+
+template <class Traits>
+void benchmarkRectImpl(KoMixColorsOp *op, const quint8 *srcBuffer, const quint8 *mskBuffer)
+{
+    QScopedPointer<KoMixColorsOp> opHolder(op);
+    quint8 dst[MAX_PIXEL_SIZE];
+
+    const int rowStride = AREA_WIDTH * Traits::pixelSize;
+
+    QBENCHMARK {
+        for (int i = 0; i < NUM_REPEATS; i++) {
+            if (mskBuffer) {
+                op->mixColorsRect(srcBuffer, rowStride, mskBuffer, AREA_WIDTH, AREA_WIDTH, AREA_HEIGHT, dst);
+            } else {
+                op->mixColorsRect(srcBuffer, rowStride, AREA_WIDTH, AREA_HEIGHT, dst);
+            }
+        }
+    }
+}
+
+void KoMixColorsOpsBenchmark::initTestCase()
+{
+    const int bufLen = AREA_WIDTH * AREA_HEIGHT * MAX_PIXEL_SIZE;
+
+    m_srcBuffer = new quint8[bufLen];
+    m_mskBuffer = new quint8[AREA_WIDTH * AREA_HEIGHT];
+
+    qsrand(42);
+
+    // the values are chosen to be valid for all the colorspaces, including float ones
+    for (int i = 0; i < AREA_WIDTH * AREA_HEIGHT * 4; i++) {
+        reinterpret_cast<float*>(m_srcBuffer)[i] = qreal(qrand() % 256) / 255.0;
+    }
+
+    for (int i = 0; i < AREA_WIDTH * AREA_HEIGHT; i++) {
+        m_mskBuffer[i] = qrand() & 0xFF;
+    }
+}
+
+void KoMixColorsOpsBenchmark::cleanupTestCase()
+{
+    delete[] m_srcBuffer;
+    delete[] m_mskBuffer;
+}
+
+void KoMixColorsOpsBenchmark::benchmarkPointersU8()
+{
+    benchmarkPointersImpl<KoBgrU8Traits>(m_srcBuffer);
+}
+
+void KoMixColorsOpsBenchmark::benchmarkRectGenericU8()
+{
+    benchmarkRectImpl<KoBgrU8Traits>(new KoMixColorsOpImpl<KoBgrU8Traits>(), m_srcBuffer, 0);
+}
+
+void KoMixColorsOpsBenchmark::benchmarkRectOptimizedU8()
+{
+    benchmarkRectImpl<KoBgrU8Traits>(KoOptimizedMixColorsOpFactory::createMixColorsOpU8(), m_srcBuffer, 0);
+}
+
+void KoMixColorsOpsBenchmark::benchmarkRectMaskedOptimizedU8()
+{
+    benchmarkRectImpl<KoBgrU8Traits>(KoOptimizedMixColorsOpFactory::createMixColorsOpU8(), m_srcBuffer, m_mskBuffer);
+}
+
+void KoMixColorsOpsBenchmark::benchmarkPointersU16()
+{
+    benchmarkPointersImpl<KoBgrU16Traits>(m_srcBuffer);
+}
+
+void KoMixColorsOpsBenchmark::benchmarkRectGenericU16()
+{
+    benchmarkRectImpl<KoBgrU16Traits>(new KoMixColorsOpImpl<KoBgrU16Traits>(), m_srcBuffer, 0);
+}
+
+void KoMixColorsOpsBenchmark::benchmarkRectOptimizedU16()
+{
+    benchmarkRectImpl<KoBgrU16Traits>(KoOptimizedMixColorsOpFactory::createMixColorsOpU16(), m_srcBuffer, 0);
+}
+
+void KoMixColorsOpsBenchmark::benchmarkPointersF32()
+{
+    benchmarkPointersImpl<KoRgbF32Traits>(m_srcBuffer);
+}
+
+void KoMixColorsOpsBenchmark::benchmarkRectGenericF32()
+{
+    benchmarkRectImpl<KoRgbF32Traits>(new KoMixColorsOpImpl<KoRgbF32Traits>(), m_srcBuffer, 0);
+}
+
+void KoMixColorsOpsBenchmark::benchmarkRectOptimizedF32()
+{
+    benchmarkRectImpl<KoRgbF32Traits>(KoOptimizedMixColorsOpFactory::createMixColorsOpF32(), m_srcBuffer, 0);
+}
+
+QTEST_GUILESS_MAIN(KoMixColorsOpsBenchmark)
@@ -0,0 +1,49 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This library is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation; either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KO_MIXCOLORSOPS_BENCHMARK_H_
+#define KO_MIXCOLORSOPS_BENCHMARK_H_
+
+#include <QObject>
+
+class KoMixColorsOpsBenchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void benchmarkPointersU8();
+    void benchmarkRectGenericU8();
+    void benchmarkRectOptimizedU8();
+    void benchmarkRectMaskedOptimizedU8();
+
+    void benchmarkPointersU16();
+    void benchmarkRectGenericU16();
+    void benchmarkRectOptimizedU16();
+
+    void benchmarkPointersF32();
+    void benchmarkRectGenericF32();
+    void benchmarkRectOptimizedF32();
+
+private:
+    quint8 *m_srcBuffer;
+    quint8 *m_mskBuffer;
+};
+
+#endif
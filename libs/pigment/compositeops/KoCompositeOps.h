@@ -114,6 +114,21 @@ struct OptimizedOpsSelector<KoRgbF32Traits>
     }
 };
 
+#ifdef HAVE_OPENEXR
+template<>
+struct OptimizedOpsSelector<KoRgbF16Traits>
+{
+    static KoCompositeOp* createAlphaDarkenOp(const KoColorSpace *cs) {
+        return useCreamyAlphaDarken() ?
+            KoOptimizedCompositeOpFactory::createAlphaDarkenOpCreamyF16(cs) :
+            KoOptimizedCompositeOpFactory::createAlphaDarkenOpHardF16(cs);
+    }
+    static KoCompositeOp* createOverOp(const KoColorSpace *cs) {
+        return KoOptimizedCompositeOpFactory::createOverOpF16(cs);
+    }
+};
+#endif
+
 template<class Traits>
 struct AddGeneralOps<Traits, true>
 {
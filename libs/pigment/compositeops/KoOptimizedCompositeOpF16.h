@@ -0,0 +1,157 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDCOMPOSITEOPF16_H
+#define KOOPTIMIZEDCOMPOSITEOPF16_H
+
+#include <KoConfig.h>
+
+#ifdef HAVE_OPENEXR
+
+#include <QScopedPointer>
+
+#include "KoColorSpaceTraits.h"
+#include "KoCompositeOpAlphaDarken.h"
+#include "KoAlphaDarkenParamsWrapper.h"
+#include "KoOptimizedCompositeOpOver128.h"
+#include "KoOptimizedHalfConversion.h"
+
+/**
+ * A composite op for 4-channel half-float colorspaces with alpha
+ * channel placed at the last position of the pixel: C1_C2_C3_A.
+ *
+ * The pixels are converted into 32-bit floats in chunks of chunkSize
+ * pixels, blended with the float version of the op and converted back.
+ * The chunks are small enough to stay in L1 cache, so the document
+ * keeps the memory footprint of half-floats while the blending itself
+ * goes through the vectorized code of RGBA F32 colorspace. It also
+ * avoids per-channel half <-> float conversions of the generic
+ * templates.
+ */
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpF16Base : public KoCompositeOp
+{
+    static const int channelsNb = 4;
+    static const int chunkSize = 256;
+
+public:
+    /**
+     * \p floatOp is an op for RGBA F32 pixels, the object takes ownership of it
+     */
+    KoOptimizedCompositeOpF16Base(const KoColorSpace* cs, KoCompositeOp *floatOp)
+        : KoCompositeOp(cs, floatOp->id(), floatOp->description(), floatOp->category()),
+          m_floatOp(floatOp)
+    {
+    }
+
+    using KoCompositeOp::composite;
+
+    void composite(const KoCompositeOp::ParameterInfo& params) const override
+    {
+        typedef KoOptimizedHalfConversion<_impl> Conversion;
+
+        alignas(64) float srcBuffer[chunkSize * channelsNb];
+        alignas(64) float dstBuffer[chunkSize * channelsNb];
+
+        KoCompositeOp::ParameterInfo floatParams(params);
+        floatParams.rows = 1;
+        floatParams.dstRowStart = reinterpret_cast<quint8*>(dstBuffer);
+        floatParams.dstRowStride = chunkSize * channelsNb * sizeof(float);
+        floatParams.srcRowStart = reinterpret_cast<const quint8*>(srcBuffer);
+
+        // zero source stride means the source is a single pixel
+        const bool srcIsConstant = !params.srcRowStride;
+
+        if (srcIsConstant) {
+            Conversion::halfToFloat(reinterpret_cast<const half*>(params.srcRowStart), srcBuffer, channelsNb);
+            floatParams.srcRowStride = 0;
+        } else {
+            floatParams.srcRowStride = chunkSize * channelsNb * sizeof(float);
+        }
+
+        const quint8 *srcRowStart = params.srcRowStart;
+        quint8 *dstRowStart = params.dstRowStart;
+        const quint8 *maskRowStart = params.maskRowStart;
+
+        for (int row = 0; row < params.rows; row++) {
+            const half *src = reinterpret_cast<const half*>(srcRowStart);
+            half *dst = reinterpret_cast<half*>(dstRowStart);
+
+            for (int x = 0; x < params.cols; x += chunkSize) {
+                const int cols = qMin(chunkSize, params.cols - x);
+                const int numValues = cols * channelsNb;
+
+                if (!srcIsConstant) {
+                    Conversion::halfToFloat(src + x * channelsNb, srcBuffer, numValues);
+                }
+                Conversion::halfToFloat(dst + x * channelsNb, dstBuffer, numValues);
+
+                floatParams.cols = cols;
+                floatParams.maskRowStart = maskRowStart ? maskRowStart + x : 0;
+                m_floatOp->composite(floatParams);
+
+                Conversion::floatToHalf(dstBuffer, dst + x * channelsNb, numValues);
+            }
+
+            srcRowStart += params.srcRowStride;
+            dstRowStart += params.dstRowStride;
+
+            if (maskRowStart) {
+                maskRowStart += params.maskRowStride;
+            }
+        }
+    }
+
+private:
+    QScopedPointer<KoCompositeOp> m_floatOp;
+};
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpOverF16 : public KoOptimizedCompositeOpF16Base<_impl>
+{
+public:
+    KoOptimizedCompositeOpOverF16(const KoColorSpace* cs)
+        : KoOptimizedCompositeOpF16Base<_impl>(cs, new KoOptimizedCompositeOpOver128<_impl>(cs)) {}
+};
+
+/**
+ * The alpha darken ops use the generic float implementation, the same
+ * one RGBA F32 colorspace uses, so that F16 and F32 strokes look
+ * identical. See the comment in KoCompositeOps.h about the optimized
+ * 128-bit alpha darken op.
+ */
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpAlphaDarkenHardF16 : public KoOptimizedCompositeOpF16Base<_impl>
+{
+public:
+    KoOptimizedCompositeOpAlphaDarkenHardF16(const KoColorSpace* cs)
+        : KoOptimizedCompositeOpF16Base<_impl>(cs, new KoCompositeOpAlphaDarken<KoRgbF32Traits, KoAlphaDarkenParamsWrapperHard>(cs)) {}
+};
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpAlphaDarkenCreamyF16 : public KoOptimizedCompositeOpF16Base<_impl>
+{
+public:
+    KoOptimizedCompositeOpAlphaDarkenCreamyF16(const KoColorSpace* cs)
+        : KoOptimizedCompositeOpF16Base<_impl>(cs, new KoCompositeOpAlphaDarken<KoRgbF32Traits, KoAlphaDarkenParamsWrapperCreamy>(cs)) {}
+};
+
+#endif /* HAVE_OPENEXR */
+
+#endif // KOOPTIMIZEDCOMPOSITEOPF16_H
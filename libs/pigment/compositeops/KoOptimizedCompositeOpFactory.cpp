@@ -63,3 +63,26 @@ KoCompositeOp* KoOptimizedCompositeOpFactory::createOverOp128(const KoColorSpace
 {
     return createOptimizedClass<KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOver128> >(cs);
 }
+
+#ifdef HAVE_OPENEXR
+
+KoCompositeOp* KoOptimizedCompositeOpFactory::createAlphaDarkenOpHardF16(const KoColorSpace *cs)
+{
+    return createOptimizedClass<
+        KoOptimizedCompositeOpFactoryPerArch<
+            KoOptimizedCompositeOpAlphaDarkenHardF16>>(cs);
+}
+
+KoCompositeOp* KoOptimizedCompositeOpFactory::createAlphaDarkenOpCreamyF16(const KoColorSpace *cs)
+{
+    return createOptimizedClass<
+        KoOptimizedCompositeOpFactoryPerArch<
+            KoOptimizedCompositeOpAlphaDarkenCreamyF16>>(cs);
+}
+
+KoCompositeOp* KoOptimizedCompositeOpFactory::createOverOpF16(const KoColorSpace *cs)
+{
+    return createOptimizedClass<KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOverF16> >(cs);
+}
+
+#endif
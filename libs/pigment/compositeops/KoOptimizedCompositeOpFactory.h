@@ -21,6 +21,7 @@
 #define KOOPTIMIZEDCOMPOSITEOPFACTORY_H
 
 #include "kritapigment_export.h"
+#include <KoConfig.h>
 
 class KoCompositeOp;
 class KoColorSpace;
@@ -46,6 +47,11 @@ public:
     static KoCompositeOp* createAlphaDarkenOpHard128(const KoColorSpace *cs);
     static KoCompositeOp* createAlphaDarkenOpCreamy128(const KoColorSpace *cs);
     static KoCompositeOp* createOverOp128(const KoColorSpace *cs);
+#ifdef HAVE_OPENEXR
+    static KoCompositeOp* createAlphaDarkenOpHardF16(const KoColorSpace *cs);
+    static KoCompositeOp* createAlphaDarkenOpCreamyF16(const KoColorSpace *cs);
+    static KoCompositeOp* createOverOpF16(const KoColorSpace *cs);
+#endif
 };
 
 #endif /* KOOPTIMIZEDCOMPOSITEOPFACTORY_H */
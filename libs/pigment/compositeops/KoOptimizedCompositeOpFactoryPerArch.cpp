@@ -26,6 +26,7 @@
 #include "KoOptimizedCompositeOpAlphaDarken128.h"
 #include "KoOptimizedCompositeOpOver32.h"
 #include "KoOptimizedCompositeOpOver128.h"
+#include "KoOptimizedCompositeOpF16.h"
 
 #include <QString>
 #include "DebugPigment.h"
@@ -85,3 +86,31 @@ KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOver128>::create<Vc::
 {
     return new KoOptimizedCompositeOpOver128<Vc::CurrentImplementation::current()>(param);
 }
+
+#ifdef HAVE_OPENEXR
+
+template<>
+template<>
+KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpAlphaDarkenHardF16>::ReturnType
+KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpAlphaDarkenHardF16>::create<Vc::CurrentImplementation::current()>(ParamType param)
+{
+    return new KoOptimizedCompositeOpAlphaDarkenHardF16<Vc::CurrentImplementation::current()>(param);
+}
+
+template<>
+template<>
+KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpAlphaDarkenCreamyF16>::ReturnType
+KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpAlphaDarkenCreamyF16>::create<Vc::CurrentImplementation::current()>(ParamType param)
+{
+    return new KoOptimizedCompositeOpAlphaDarkenCreamyF16<Vc::CurrentImplementation::current()>(param);
+}
+
+template<>
+template<>
+KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOverF16>::ReturnType
+KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOverF16>::create<Vc::CurrentImplementation::current()>(ParamType param)
+{
+    return new KoOptimizedCompositeOpOverF16<Vc::CurrentImplementation::current()>(param);
+}
+
+#endif
@@ -46,6 +46,15 @@ class KoOptimizedCompositeOpAlphaDarkenCreamy128;
 template<Vc::Implementation _impl>
 class KoOptimizedCompositeOpOver128;
 
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpAlphaDarkenHardF16;
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpAlphaDarkenCreamyF16;
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpOverF16;
+
 template<template<Vc::Implementation I> class CompositeOp>
 struct KoOptimizedCompositeOpFactoryPerArch
 {
@@ -0,0 +1,131 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDHALFCONVERSION_H
+#define KOOPTIMIZEDHALFCONVERSION_H
+
+#include <KoConfig.h>
+
+#ifdef HAVE_OPENEXR
+
+#include <half.h>
+#include "KoStreamedMath.h"
+
+/**
+ * Every CPU supporting AVX2 also supports F16C conversion instructions,
+ * but the AVX2 version of the per-arch modules is not compiled with
+ * -mf16c flag. So we enable the instructions for the conversion
+ * routines only.
+ */
+#if defined __F16C__
+#  define KO_HAVE_F16C 1
+#  define KO_F16C_TARGET
+#elif defined __AVX2__ && (defined __GNUC__ || defined __clang__)
+#  define KO_HAVE_F16C 1
+#  define KO_F16C_TARGET __attribute__((target("f16c")))
+#elif defined __AVX2__ && defined _MSC_VER
+#  define KO_HAVE_F16C 1
+#  define KO_F16C_TARGET
+#endif
+
+#ifdef KO_HAVE_F16C
+#include <immintrin.h>
+#endif
+
+/**
+ * Bulk conversion of half-float channels into 32-bit floats and back.
+ *
+ * When the module is compiled for a CPU with F16C instructions, eight
+ * values are converted in one instruction, otherwise the conversion
+ * falls back to the lookup tables of OpenEXR's half class. Both the
+ * versions round to the nearest even value, so the result doesn't
+ * depend on the implementation chosen.
+ */
+template<Vc::Implementation _impl>
+struct KoOptimizedHalfConversion
+{
+    static void halfToFloat(const half *src, float *dst, int numValues)
+    {
+        int i = 0;
+
+#ifdef KO_HAVE_F16C
+        i = halfToFloatF16C(src, dst, numValues);
+#endif
+
+        for (; i < numValues; i++) {
+            dst[i] = src[i];
+        }
+    }
+
+    static void floatToHalf(const float *src, half *dst, int numValues)
+    {
+        int i = 0;
+
+#ifdef KO_HAVE_F16C
+        i = floatToHalfF16C(src, dst, numValues);
+#endif
+
+        for (; i < numValues; i++) {
+            dst[i] = src[i];
+        }
+    }
+
+private:
+#ifdef KO_HAVE_F16C
+    /**
+     * \return the number of values converted
+     */
+    KO_F16C_TARGET
+    static int halfToFloatF16C(const half *src, float *dst, int numValues)
+    {
+        const int numBlocks = numValues / 8;
+
+        for (int i = 0; i < numBlocks; i++) {
+            const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+            _mm256_storeu_ps(dst, _mm256_cvtph_ps(h));
+
+            src += 8;
+            dst += 8;
+        }
+
+        return numBlocks * 8;
+    }
+
+    KO_F16C_TARGET
+    static int floatToHalfF16C(const float *src, half *dst, int numValues)
+    {
+        const int numBlocks = numValues / 8;
+
+        for (int i = 0; i < numBlocks; i++) {
+            const __m256 f = _mm256_loadu_ps(src);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst),
+                             _mm256_cvtps_ph(f, _MM_FROUND_TO_NEAREST_INT));
+
+            src += 8;
+            dst += 8;
+        }
+
+        return numBlocks * 8;
+    }
+#endif
+};
+
+#endif /* HAVE_OPENEXR */
+
+#endif // KOOPTIMIZEDHALFCONVERSION_H
@@ -0,0 +1,269 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDMIXCOLORSOP_H
+#define KOOPTIMIZEDMIXCOLORSOP_H
+
+#include <KoColorSpaceMaths.h>
+#include <KoMixColorsOpImpl.h>
+#include "KoStreamedMath.h"
+
+
+/**
+ * Fetches Vc::float_v::size() pixels of a 4-channel colorspace with
+ * the alpha channel placed at the last position. The color channels
+ * are returned in the order they are stored in memory.
+ */
+template<Vc::Implementation _impl, typename channels_type>
+struct KoMixColorsPixelFetcher
+{
+    static ALWAYS_INLINE void fetch(const quint8 *data,
+                                    Vc::float_v &c0,
+                                    Vc::float_v &c1,
+                                    Vc::float_v &c2,
+                                    Vc::float_v &alpha)
+    {
+        const channels_type *ptr = reinterpret_cast<const channels_type*>(data);
+        const Vc::float_v::IndexType indexes = Vc::float_v::IndexType(Vc::IndexesFromZero) * 4;
+
+        c0.gather(ptr, indexes);
+        c1.gather(ptr + 1, indexes);
+        c2.gather(ptr + 2, indexes);
+        alpha.gather(ptr + 3, indexes);
+    }
+};
+
+template<Vc::Implementation _impl>
+struct KoMixColorsPixelFetcher<_impl, quint8>
+{
+    static ALWAYS_INLINE void fetch(const quint8 *data,
+                                    Vc::float_v &c0,
+                                    Vc::float_v &c1,
+                                    Vc::float_v &c2,
+                                    Vc::float_v &alpha)
+    {
+        // fetch_colors_32() returns the channels in the order of significance
+        KoStreamedMath<_impl>::template fetch_colors_32<false>(data, c2, c1, c0);
+        alpha = KoStreamedMath<_impl>::template fetch_alpha_32<false>(data);
+    }
+};
+
+template<Vc::Implementation _impl>
+struct KoMixColorsPixelFetcher<_impl, float>
+{
+    struct Pixel {
+        float c0;
+        float c1;
+        float c2;
+        float alpha;
+    };
+
+    static ALWAYS_INLINE void fetch(const quint8 *data,
+                                    Vc::float_v &c0,
+                                    Vc::float_v &c1,
+                                    Vc::float_v &c2,
+                                    Vc::float_v &alpha)
+    {
+        const Vc::float_v::IndexType indexes(Vc::IndexesFromZero);
+        Vc::InterleavedMemoryWrapper<Pixel, Vc::float_v> pixels(reinterpret_cast<Pixel*>(const_cast<quint8*>(data)));
+        tie(c0, c1, c2, alpha) = pixels[indexes];
+    }
+};
+
+/**
+ * An optimized version of the mix colors op for the colorspaces
+ * with 4 channels and the alpha channel placed at the last position
+ * of the pixel: C1_C2_C3_A. It supports 8-bit, 16-bit and 32-bit
+ * floating point channels.
+ *
+ * The weighted sums are accumulated in the lanes of Vc::float_v
+ * vectors and are flushed into double-precision totals every
+ * maxVectorsInBlock iterations, so that the sums of 8-bit colors
+ * stay exact and summing of huge areas doesn't lose precision.
+ *
+ * Only the contiguous-buffer methods are vectorized. Mixing via an
+ * array of pointers goes through the generic implementation.
+ */
+template<Vc::Implementation _impl, class _CSTrait>
+class KoOptimizedMixColorsOp : public KoMixColorsOpImpl<_CSTrait>
+{
+    typedef typename _CSTrait::channels_type channels_type;
+    typedef KoMixColorsPixelFetcher<_impl, channels_type> PixelFetcher;
+
+    static const int maxVectorsInBlock = 256;
+
+public:
+    using KoMixColorsOpImpl<_CSTrait>::mixColors;
+
+    void mixColors(const quint8 *colors, quint32 nColors, quint8 *dst) const override {
+        mixColorsRectImpl<false>(colors, 0, 0, 0, nColors, 1, dst);
+    }
+
+    void mixColorsRect(const quint8 *colors, int rowStride, int width, int height, quint8 *dst) const override {
+        mixColorsRectImpl<false>(colors, rowStride, 0, 0, width, height, dst);
+    }
+
+    void mixColorsRect(const quint8 *colors, int rowStride,
+                       const quint8 *mask, int maskRowStride,
+                       int width, int height, quint8 *dst) const override {
+        mixColorsRectImpl<true>(colors, rowStride, mask, maskRowStride, width, height, dst);
+    }
+
+private:
+    struct Totals {
+        Totals()
+            : c0(Vc::Zero), c1(Vc::Zero), c2(Vc::Zero),
+              alpha(Vc::Zero), weight(Vc::Zero),
+              numVectors(0)
+        {
+        }
+
+        inline void flush() {
+            sumC0 += c0.sum();
+            sumC1 += c1.sum();
+            sumC2 += c2.sum();
+            sumAlpha += alpha.sum();
+            sumWeight += weight.sum();
+
+            c0.setZero();
+            c1.setZero();
+            c2.setZero();
+            alpha.setZero();
+            weight.setZero();
+
+            numVectors = 0;
+        }
+
+        Vc::float_v c0;
+        Vc::float_v c1;
+        Vc::float_v c2;
+        Vc::float_v alpha;
+        Vc::float_v weight;
+        int numVectors;
+
+        double sumC0 = 0.0;
+        double sumC1 = 0.0;
+        double sumC2 = 0.0;
+        double sumAlpha = 0.0;
+        double sumWeight = 0.0;
+    };
+
+    template<bool useMask>
+    void mixColorsRectImpl(const quint8 *colors, int rowStride,
+                           const quint8 *mask, int maskRowStride,
+                           int width, int height, quint8 *dst) const
+    {
+        const int vectorSize = Vc::float_v::size();
+        const int pixelSize = _CSTrait::pixelSize;
+        const Vc::float_v uint8MaxRec1(1.0f / 255.0f);
+
+        Totals totals;
+
+        for (int row = 0; row < height; row++) {
+            const quint8 *src = colors;
+            const quint8 *msk = mask;
+
+            const int numVectors = width / vectorSize;
+            const int numRest = width % vectorSize;
+
+            for (int i = 0; i < numVectors; i++) {
+                Vc::float_v c0;
+                Vc::float_v c1;
+                Vc::float_v c2;
+                Vc::float_v alpha;
+
+                PixelFetcher::fetch(src, c0, c1, c2, alpha);
+
+                if (useMask) {
+                    const Vc::float_v weight = KoStreamedMath<_impl>::fetch_mask_8(msk) * uint8MaxRec1;
+                    alpha *= weight;
+                    totals.weight += weight;
+                    msk += vectorSize;
+                }
+
+                totals.c0 += c0 * alpha;
+                totals.c1 += c1 * alpha;
+                totals.c2 += c2 * alpha;
+                totals.alpha += alpha;
+
+                src += vectorSize * pixelSize;
+
+                if (++totals.numVectors >= maxVectorsInBlock) {
+                    totals.flush();
+                }
+            }
+
+            for (int i = 0; i < numRest; i++) {
+                const channels_type *color = reinterpret_cast<const channels_type*>(src);
+                double alpha = color[3];
+
+                if (useMask) {
+                    const double weight = *msk * (1.0 / 255.0);
+                    alpha *= weight;
+                    totals.sumWeight += weight;
+                    msk++;
+                }
+
+                totals.sumC0 += color[0] * alpha;
+                totals.sumC1 += color[1] * alpha;
+                totals.sumC2 += color[2] * alpha;
+                totals.sumAlpha += alpha;
+
+                src += pixelSize;
+            }
+
+            colors += rowStride;
+            mask += maskRowStride;
+        }
+
+        totals.flush();
+
+        const double sumOfWeights = useMask ? totals.sumWeight : double(width) * height;
+        const double unitValue = KoColorSpaceMathsTraits<channels_type>::unitValue;
+
+        double totalAlpha = totals.sumAlpha;
+        if (totalAlpha > unitValue * sumOfWeights) {
+            totalAlpha = unitValue * sumOfWeights;
+        }
+
+        channels_type *dstColor = reinterpret_cast<channels_type*>(dst);
+
+        if (totalAlpha > 0) {
+            dstColor[0] = convertChannel(totals.sumC0 / totalAlpha);
+            dstColor[1] = convertChannel(totals.sumC1 / totalAlpha);
+            dstColor[2] = convertChannel(totals.sumC2 / totalAlpha);
+            dstColor[3] = convertChannel(totalAlpha / sumOfWeights);
+        } else {
+            memset(dst, 0, pixelSize);
+        }
+    }
+
+    static inline channels_type convertChannel(double value) {
+        const double maxValue = KoColorSpaceMathsTraits<channels_type>::max;
+        const double minValue = KoColorSpaceMathsTraits<channels_type>::min;
+
+        if (std::numeric_limits<channels_type>::is_integer) {
+            value = qRound64(value);
+        }
+
+        return channels_type(qBound(minValue, value, maxValue));
+    }
+};
+
+#endif // KOOPTIMIZEDMIXCOLORSOP_H
@@ -0,0 +1,67 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDMIXCOLORSOPFACTORY_H
+#define KOOPTIMIZEDMIXCOLORSOPFACTORY_H
+
+#include <type_traits>
+
+#include "kritapigment_export.h"
+#include <KoColorSpaceMaths.h>
+#include <KoMixColorsOpImpl.h>
+
+/**
+ * Creates vectorized versions of KoMixColorsOp for the colorspaces
+ * with 4 channels and alpha channel placed at the last position. The
+ * order of color channels is not important for mixing, so the same
+ * op is shared by RGBA, BGRA, Lab and other alike colorspaces.
+ *
+ * The creation is moved into a separate object module for the same
+ * reasons as KoOptimizedCompositeOpFactory.
+ */
+class KRITAPIGMENT_EXPORT KoOptimizedMixColorsOpFactory
+{
+public:
+    static KoMixColorsOp* createMixColorsOpU8();
+    static KoMixColorsOp* createMixColorsOpU16();
+    static KoMixColorsOp* createMixColorsOpF32();
+
+    /**
+     * Returns an optimized mix colors op if there is one for
+     * \p _CSTrait, otherwise returns a generic KoMixColorsOpImpl
+     */
+    template<class _CSTrait>
+    static KoMixColorsOp* create() {
+        typedef typename _CSTrait::channels_type channels_type;
+
+        if (_CSTrait::channels_nb == 4 && _CSTrait::alpha_pos == 3) {
+            if (std::is_same<channels_type, quint8>::value) {
+                return createMixColorsOpU8();
+            } else if (std::is_same<channels_type, quint16>::value) {
+                return createMixColorsOpU16();
+            } else if (std::is_same<channels_type, float>::value) {
+                return createMixColorsOpF32();
+            }
+        }
+
+        return new KoMixColorsOpImpl<_CSTrait>();
+    }
+};
+
+#endif /* KOOPTIMIZEDMIXCOLORSOPFACTORY_H */
@@ -0,0 +1,47 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "KoOptimizedMixColorsOpFactoryPerArch.h"
+
+#include "KoColorSpaceTraits.h"
+#include "KoMixColorsOpImpl.h"
+
+template<>
+template<>
+KoOptimizedMixColorsOpFactoryPerArch<KoBgrU8Traits>::ReturnType
+KoOptimizedMixColorsOpFactoryPerArch<KoBgrU8Traits>::create<Vc::ScalarImpl>(ParamType)
+{
+    return new KoMixColorsOpImpl<KoBgrU8Traits>();
+}
+
+template<>
+template<>
+KoOptimizedMixColorsOpFactoryPerArch<KoBgrU16Traits>::ReturnType
+KoOptimizedMixColorsOpFactoryPerArch<KoBgrU16Traits>::create<Vc::ScalarImpl>(ParamType)
+{
+    return new KoMixColorsOpImpl<KoBgrU16Traits>();
+}
+
+template<>
+template<>
+KoOptimizedMixColorsOpFactoryPerArch<KoRgbF32Traits>::ReturnType
+KoOptimizedMixColorsOpFactoryPerArch<KoRgbF32Traits>::create<Vc::ScalarImpl>(ParamType)
+{
+    return new KoMixColorsOpImpl<KoRgbF32Traits>();
+}
@@ -2,10 +2,12 @@
 
 #include "KoColorSpaceAbstract.h"
 #include "KoColorSpaceTraits.h"
+#include "KoOptimizedMixColorsOpFactory.h"
 
 #include <cfloat>
 
 #include <QTest>
+#include <QScopedPointer>
 
 template <class T>
 T mixOpExpectedAlpha(T alpha1, T alpha2, const qint16 *weights)
@@ -385,5 +387,87 @@ void TestKoColorSpaceAbstract::testMixColorsOpU8NoAlphaLinear()
     QCOMPARE(outputPixel[COLOR_CHANNEL_2], mixOpNoAlphaExpectedColor(pixel1[COLOR_CHANNEL_2], pixel2[COLOR_CHANNEL_2], weights));
 }
 
+template <class Traits>
+void testMixColorsRectImpl(typename Traits::channels_type unitValue, qreal tolerance)
+{
+    typedef typename Traits::channels_type channels_type;
+
+    const int width = 67;
+    const int height = 13;
+    const int pixelSize = Traits::pixelSize;
+    const int rowStride = width * pixelSize;
+
+    QVector<quint8> buffer(width * height * pixelSize);
+    QVector<quint8> mask(width * height);
+    QVector<const quint8*> allPixels;
+    QVector<const quint8*> maskedPixels;
+
+    qsrand(1);
+
+    for (int i = 0; i < width * height; i++) {
+        channels_type *pixel = reinterpret_cast<channels_type*>(buffer.data() + i * pixelSize);
+        for (int ch = 0; ch < 4; ch++) {
+            pixel[ch] = channels_type(qreal(qrand() % 1000) / 999.0 * unitValue);
+        }
+
+        mask[i] = qrand() % 3 ? 255 : 0;
+
+        allPixels << buffer.data() + i * pixelSize;
+        if (mask[i]) {
+            maskedPixels << buffer.data() + i * pixelSize;
+        }
+    }
+
+    QScopedPointer<KoMixColorsOp> genericOp(new KoMixColorsOpImpl<Traits>());
+    QScopedPointer<KoMixColorsOp> optimizedOp(KoOptimizedMixColorsOpFactory::create<Traits>());
+
+    channels_type expected[4];
+    channels_type result[4];
+
+    auto compareResult = [&] () {
+        for (int ch = 0; ch < 4; ch++) {
+            if (qAbs(qreal(expected[ch]) - qreal(result[ch])) > tolerance) {
+                qDebug() << "ch" << ch << "expected" << expected[ch] << "result" << result[ch];
+                QFAIL("Mixed colors differ");
+            }
+        }
+    };
+
+    genericOp->mixColors(allPixels.constData(), allPixels.size(), reinterpret_cast<quint8*>(expected));
+
+    genericOp->mixColorsRect(buffer.constData(), rowStride, width, height, reinterpret_cast<quint8*>(result));
+    compareResult();
+
+    optimizedOp->mixColorsRect(buffer.constData(), rowStride, width, height, reinterpret_cast<quint8*>(result));
+    compareResult();
+
+    genericOp->mixColors(maskedPixels.constData(), maskedPixels.size(), reinterpret_cast<quint8*>(expected));
+
+    genericOp->mixColorsRect(buffer.constData(), rowStride, mask.constData(), width, width, height, reinterpret_cast<quint8*>(result));
+    compareResult();
+
+    optimizedOp->mixColorsRect(buffer.constData(), rowStride, mask.constData(), width, width, height, reinterpret_cast<quint8*>(result));
+    compareResult();
+
+    // a single row of a contiguous buffer
+    genericOp->mixColors(allPixels.constData(), width, reinterpret_cast<quint8*>(expected));
+    optimizedOp->mixColors(buffer.constData(), width, reinterpret_cast<quint8*>(result));
+    compareResult();
+}
+
+void TestKoColorSpaceAbstract::testMixColorsRectU8()
+{
+    testMixColorsRectImpl<KoBgrU8Traits>(255, 1.0);
+}
+
+void TestKoColorSpaceAbstract::testMixColorsRectU16()
+{
+    testMixColorsRectImpl<KoBgrU16Traits>(65535, 1.0);
+}
+
+void TestKoColorSpaceAbstract::testMixColorsRectF32()
+{
+    testMixColorsRectImpl<KoRgbF32Traits>(1.0, 1e-5);
+}
 
 QTEST_GUILESS_MAIN(TestKoColorSpaceAbstract)
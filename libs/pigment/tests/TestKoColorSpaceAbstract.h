@@ -11,6 +11,9 @@ private Q_SLOTS:
     void testMixColorsOpF32();
     void testMixColorsOpU8NoAlpha();
     void testMixColorsOpU8NoAlphaLinear();
+    void testMixColorsRectU8();
+    void testMixColorsRectU16();
+    void testMixColorsRectF32();
 };
 
 #endif
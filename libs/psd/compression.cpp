@@ -22,180 +22,161 @@
 #include "psd_utils.h"
 #include "kis_debug.h"
 #include <QtEndian>
+#include <QtAlgorithms>
 
-// from gimp's psd-save.c
-static quint32 pack_pb_line (const QByteArray &src,
-                             QByteArray &dst)
+#include <cstring>
+
+namespace {
+
+const quint64 lowBits = Q_UINT64_C(0x0101010101010101);
+const quint64 highBits = Q_UINT64_C(0x8080808080808080);
+
+inline quint64 loadWord(const quint8 *ptr)
 {
-    quint32 length = src.size();
-    quint32 remaining = length;
-    quint8  i, j;
-    quint32 dest_ptr = 0;
-    const char *start = src.constData();
-
-    length = 0;
-    while (remaining > 0)
-    {
-        /* Look for characters matching the first */
-        i = 0;
-        while ((i < 128) &&
-               (remaining - i > 0) &&
-               (start[0] == start[i]) )
-            i++;
-
-        if (i > 1)              /* Match found */
-        {
-
-            dst[dest_ptr++] = -(i - 1);
-            dst[dest_ptr++] = *start;
-
-            start += i;
-            remaining -= i;
-            length += 2;
-        }
-        else       /* Look for characters different from the previous */
-        {
-            i = 0;
-            while ((i < 128)             &&
-                   (remaining - (i + 1) > 0) &&
-                   (start[i] != start[(i + 1)] ||
-                    remaining - (i + 2) <= 0  || start[i] != start[(i+2)]))
-                i++;
-
-            /* If there's only 1 remaining, the previous WHILE stmt doesn't
-             catch it */
-
-            if (remaining == 1)
-            {
-                i = 1;
-            }
+    quint64 value;
+    memcpy(&value, ptr, sizeof(value));
+    return qFromLittleEndian(value);
+}
 
-            if (i > 0)               /* Some distinct ones found */
-            {
-                dst[dest_ptr++] = i - 1;
-                for (j = 0; j < i; j++)
-                {
-                    dst[dest_ptr++] = start[j];
-                }
-                start += i;
-                remaining -= i;
-                length += i + 1;
-            }
+/**
+ * Returns the number of bytes equal to src[0] at the beginning of \p src,
+ * but not more than \p maxLength. The bytes are compared eight at a time.
+ */
+inline int runLength(const quint8 *src, int maxLength)
+{
+    const quint64 pattern = lowBits * src[0];
+    int length = 0;
 
+    for (; length + 8 <= maxLength; length += 8) {
+        const quint64 diff = loadWord(src + length) ^ pattern;
+        if (diff) {
+            return length + qCountTrailingZeroBits(diff) / 8;
         }
     }
+
+    while (length < maxLength && src[length] == src[0]) {
+        length++;
+    }
+
     return length;
 }
 
-
-// from gimp's psd-util.c
-quint32 decode_packbits(const char *src, char* dst, quint16 packed_len, quint32 unpacked_len)
+/**
+ * Returns the offset of the first run of three equal bytes in \p src
+ * (which is \p size bytes long), but not more than \p maxLength. Such
+ * a run is cheaper to encode as a replicate packet than as a part of
+ * a literal one.
+ */
+inline int literalLength(const quint8 *src, int size, int maxLength)
 {
-    /*
-     *  Decode a PackBits chunk.
-     */
-    qint32    n;
-    char      dat;
-    qint32    unpack_left = unpacked_len;
-    qint32    pack_left = packed_len;
-    qint32    error_code = 0;
-    qint32    return_val = 0;
-
-    while (unpack_left > 0 && pack_left > 0)
-    {
-        n = *src;
-        src++;
-        pack_left--;
-
-        if (n == 128)     /* nop */
-            continue;
-        else if (n > 128)
-            n -= 256;
-
-        if (n < 0)        /* replicate next gchar |n|+ 1 times */
-        {
-            n  = 1 - n;
-            if (! pack_left)
-            {
-                dbgFile << "Input buffer exhausted in replicate";
-                error_code = 1;
-                break;
-            }
-            if (n > unpack_left)
-            {
-                dbgFile << "Overrun in packbits replicate of" << n - unpack_left << "chars";
-                error_code = 2;
-            }
-            dat = *src;
-            for (; n > 0; --n)
-            {
-                if (! unpack_left)
-                    break;
-                *dst = dat;
-                dst++;
-                unpack_left--;
-            }
-            if (unpack_left)
-            {
-                src++;
-                pack_left--;
-            }
-        }
-        else              /* copy next n+1 gchars literally */
-        {
-            n++;
-            for (; n > 0; --n)
-            {
-                if (! pack_left)
-                {
-                    dbgFile << "Input buffer exhausted in copy";
-                    error_code = 3;
-                    break;
-                }
-                if (! unpack_left)
-                {
-                    dbgFile << "Output buffer exhausted in copy";
-                    error_code = 4;
-                    break;
-                }
-                *dst = *src;
-                dst++;
-                unpack_left--;
-                src++;
-                pack_left--;
-            }
+    int length = 0;
+
+    for (; length < maxLength && length + 10 <= size; length += 8) {
+        const quint64 first = loadWord(src + length);
+        const quint64 diff = (first ^ loadWord(src + length + 1)) |
+                             (first ^ loadWord(src + length + 2));
+
+        // the lowest zero byte of diff is detected exactly
+        const quint64 zeroBytes = (diff - lowBits) & ~diff & highBits;
+        if (zeroBytes) {
+            return qMin(maxLength, length + int(qCountTrailingZeroBits(zeroBytes) / 8));
         }
     }
 
-    if (unpack_left > 0)
-    {
-        /* Pad with zeros to end of output buffer */
-        for (n = 0; n < pack_left; ++n)
-        {
-            *dst = 0;
-            dst++;
+    for (; length < maxLength && length + 2 < size; length++) {
+        if (src[length] == src[length + 1] && src[length] == src[length + 2]) {
+            return length;
         }
     }
 
-    if (unpack_left)
-    {
-        dbgFile << "Packbits decode - unpack left" << unpack_left;
-        return_val -= unpack_left;
+    return qMin(maxLength, size);
+}
+
+}
+
+int Compression::packBitsBound(int size)
+{
+    // the worst case is a sequence of literal packets of 128 bytes each
+    return size + (size + 127) / 128;
+}
+
+int Compression::packBits(const quint8 *src, int size, quint8 *dst)
+{
+    quint8 *dstPtr = dst;
+    int pos = 0;
+
+    while (pos < size) {
+        const int maxLength = qMin(size - pos, 128);
+        const int run = runLength(src + pos, maxLength);
+
+        if (run > 1) {
+            *dstPtr++ = quint8(1 - run);
+            *dstPtr++ = src[pos];
+            pos += run;
+        } else {
+            const int length = qMax(1, literalLength(src + pos, size - pos, maxLength));
+
+            *dstPtr++ = quint8(length - 1);
+            memcpy(dstPtr, src + pos, length);
+            dstPtr += length;
+            pos += length;
+        }
     }
-    if (pack_left)
-    {
-        /* Some images seem to have a pad byte at the end of the packed data */
-        if (error_code || pack_left != 1)
-        {
-            dbgFile << "Packbits decode - pack left" << pack_left;
-            return_val = pack_left;
+
+    return dstPtr - dst;
+}
+
+bool Compression::unpackBits(const quint8 *src, int packedSize, quint8 *dst, int unpackedSize)
+{
+    const quint8 *srcEnd = src + packedSize;
+    quint8 *dstEnd = dst + unpackedSize;
+    bool result = true;
+
+    while (dst < dstEnd && src < srcEnd) {
+        const int n = qint8(*src++);
+
+        if (n >= 0) {
+            // copy next n + 1 bytes literally
+            int length = n + 1;
+
+            if (length > srcEnd - src || length > dstEnd - dst) {
+                dbgFile << "Packbits decode - overrun in a literal packet";
+                length = qMin(int(srcEnd - src), int(dstEnd - dst));
+                result = false;
+            }
+
+            memcpy(dst, src, length);
+            src += length;
+            dst += length;
+
+        } else if (n != -128) {
+            // replicate next byte 1 - n times
+            int length = 1 - n;
+
+            if (src >= srcEnd) {
+                dbgFile << "Packbits decode - input buffer exhausted in a replicate packet";
+                result = false;
+                break;
+            }
+
+            if (length > dstEnd - dst) {
+                dbgFile << "Packbits decode - overrun in a replicate packet";
+                length = dstEnd - dst;
+                result = false;
+            }
+
+            memset(dst, *src++, length);
+            dst += length;
         }
     }
 
-    if (error_code)
-        dbgFile << "Error code" <<  error_code;
+    if (dst < dstEnd) {
+        dbgFile << "Packbits decode - unpack left" << dstEnd - dst;
+        memset(dst, 0, dstEnd - dst);
+        result = false;
+    }
 
-    return return_val;
+    return result;
 }
 
 QByteArray Compression::uncompress(quint32 unpacked_len, QByteArray bytes, Compression::CompressionType compressionType)
@@ -209,10 +190,9 @@ QByteArray Compression::uncompress(quint32 unpacked_len, QByteArray bytes, Compr
         return bytes;
     case RLE:
     {
-        char *dst = new char[unpacked_len];
-        decode_packbits(bytes.constData(), dst, bytes.length(), unpacked_len);
-        QByteArray ba(dst, unpacked_len);
-        delete[] dst;
+        QByteArray ba(unpacked_len, Qt::Uninitialized);
+        unpackBits(reinterpret_cast<const quint8*>(bytes.constData()), bytes.size(),
+                   reinterpret_cast<quint8*>(ba.data()), ba.size());
         return ba;
      }
     case ZIP:
@@ -247,10 +227,10 @@ QByteArray Compression::compress(QByteArray bytes, Compression::CompressionType
         return bytes;
     case RLE:
     {
-        QByteArray dst;
-        int packed_len = pack_pb_line(bytes, dst);
-        Q_ASSERT(packed_len == dst.size());
-        Q_UNUSED(packed_len);
+        QByteArray dst(packBitsBound(bytes.size()), Qt::Uninitialized);
+        const int packedSize = packBits(reinterpret_cast<const quint8*>(bytes.constData()), bytes.size(),
+                                        reinterpret_cast<quint8*>(dst.data()));
+        dst.resize(packedSize);
         return dst;
     }
     case ZIP:
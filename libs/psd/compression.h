@@ -35,6 +35,28 @@ public:
 
     static QByteArray uncompress(quint32 unpacked_len, QByteArray bytes, CompressionType compressionType);
     static QByteArray compress(QByteArray bytes, CompressionType compressionType);
+
+    /**
+     * The maximum size of \p size bytes encoded with PackBits
+     */
+    static int packBitsBound(int size);
+
+    /**
+     * Encodes \p size bytes of \p src with PackBits (the RLE flavour used
+     * by PSD files). \p dst must have room for packBitsBound(size) bytes.
+     *
+     * \return the size of the encoded data
+     */
+    static int packBits(const quint8 *src, int size, quint8 *dst);
+
+    /**
+     * Decodes PackBits data from \p src into \p unpackedSize bytes of
+     * \p dst. If the data is malformed, the rest of \p dst is filled with
+     * zeroes.
+     *
+     * \return false if the data is malformed
+     */
+    static bool unpackBits(const quint8 *src, int packedSize, quint8 *dst, int unpackedSize);
 };
 
 #endif // PSD_COMPRESSION_H
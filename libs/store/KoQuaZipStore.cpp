@@ -32,11 +32,223 @@
 #include <QTextCodec>
 #include <QByteArray>
 #include <QBuffer>
+#include <QFile>
+#include <QtEndian>
 
 #include <KConfig>
 #include <KSharedConfig>
 #include <KConfigGroup>
 
+namespace {
+
+/**
+ * The index of the independently compressed chunks of a file is saved
+ * in the extra field of the central directory:
+ *
+ *   quint16 header id, quint16 size of the data,
+ *   quint64 uncompressed size of a chunk,
+ *   quint32 compressed size of every chunk
+ *
+ * All the values are little-endian, as everything else in zip.
+ */
+const quint16 chunkIndexHeaderId = 0x4b43;
+
+/// zip limits the size of all the extra fields of a file to 64 KiB
+const int maxChunkIndexSize = 32768;
+
+QByteArray chunkIndexExtraField(const KoStore::CompressedData &data)
+{
+    const int dataSize = 8 + 4 * data.compressedChunkSizes.size();
+
+    if (!data.isCompressed || data.chunkSize <= 0 ||
+        data.compressedChunkSizes.isEmpty() ||
+        4 + dataSize > maxChunkIndexSize) {
+
+        return QByteArray();
+    }
+
+    QByteArray field(4 + dataSize, Qt::Uninitialized);
+    uchar *ptr = reinterpret_cast<uchar*>(field.data());
+
+    qToLittleEndian<quint16>(chunkIndexHeaderId, ptr);
+    qToLittleEndian<quint16>(quint16(dataSize), ptr + 2);
+    qToLittleEndian<quint64>(quint64(data.chunkSize), ptr + 4);
+    ptr += 12;
+
+    Q_FOREACH (quint32 size, data.compressedChunkSizes) {
+        qToLittleEndian<quint32>(size, ptr);
+        ptr += 4;
+    }
+
+    return field;
+}
+
+/**
+ * Looks for the chunk index in \p extra and checks that it matches
+ * the sizes of the file
+ */
+bool readChunkIndex(const QByteArray &extra,
+                    qint64 compressedSize, qint64 uncompressedSize,
+                    qint64 *chunkSize, QVector<quint32> *compressedChunkSizes)
+{
+    const uchar *ptr = reinterpret_cast<const uchar*>(extra.constData());
+    const uchar *end = ptr + extra.size();
+
+    while (end - ptr >= 4) {
+        const quint16 id = qFromLittleEndian<quint16>(ptr);
+        const quint16 size = qFromLittleEndian<quint16>(ptr + 2);
+        ptr += 4;
+
+        if (end - ptr < size) break;
+
+        if (id == chunkIndexHeaderId && size >= 12 && (size - 8) % 4 == 0) {
+            const qint64 fileChunkSize = qint64(qFromLittleEndian<quint64>(ptr));
+            const int numChunks = (size - 8) / 4;
+
+            if (fileChunkSize <= 0 ||
+                (uncompressedSize + fileChunkSize - 1) / fileChunkSize != numChunks) {
+
+                return false;
+            }
+
+            QVector<quint32> sizes(numChunks);
+            qint64 totalSize = 0;
+
+            for (int i = 0; i < numChunks; i++) {
+                sizes[i] = qFromLittleEndian<quint32>(ptr + 8 + 4 * i);
+                totalSize += sizes[i];
+            }
+
+            if (totalSize != compressedSize) return false;
+
+            *chunkSize = fileChunkSize;
+            *compressedChunkSizes = sizes;
+            return true;
+        }
+
+        ptr += size;
+    }
+
+    return false;
+}
+
+/**
+ * A read-only device over a file with an index of chunks. It supports
+ * seeking and inflates only the chunks which are actually read, reading
+ * their compressed data directly from the device of the archive.
+ */
+class ChunkedDeflateDevice : public QIODevice
+{
+public:
+    ChunkedDeflateDevice(QIODevice *archive, qint64 dataOffset, qint64 size,
+                         qint64 chunkSize, const QVector<quint32> &compressedChunkSizes)
+        : m_archive(archive),
+          m_dataOffset(dataOffset),
+          m_size(size),
+          m_chunkSize(chunkSize)
+    {
+        qint64 offset = 0;
+        Q_FOREACH (quint32 compressedSize, compressedChunkSizes) {
+            m_chunkOffsets.append(offset);
+            offset += compressedSize;
+        }
+        m_chunkOffsets.append(offset);
+    }
+
+    bool isSequential() const override {
+        return false;
+    }
+
+    qint64 size() const override {
+        return m_size;
+    }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override {
+        qint64 pos = this->pos();
+        qint64 bytesRead = 0;
+
+        while (bytesRead < maxSize && pos < m_size) {
+            const int chunk = int(pos / m_chunkSize);
+
+            if (!loadChunk(chunk)) {
+                return bytesRead > 0 ? bytesRead : -1;
+            }
+
+            const qint64 offsetInChunk = pos - chunk * m_chunkSize;
+            const qint64 length = qMin(maxSize - bytesRead, qint64(m_chunk.size()) - offsetInChunk);
+
+            memcpy(data + bytesRead, m_chunk.constData() + offsetInChunk, size_t(length));
+            bytesRead += length;
+            pos += length;
+        }
+
+        return bytesRead;
+    }
+
+    qint64 writeData(const char *, qint64) override {
+        return -1;
+    }
+
+private:
+    bool loadChunk(int index) {
+        if (index == m_currentChunk) return true;
+        m_currentChunk = -1;
+
+        const qint64 compressedOffset = m_chunkOffsets[index];
+        const qint64 compressedSize = m_chunkOffsets[index + 1] - compressedOffset;
+
+        if (!m_archive->seek(m_dataOffset + compressedOffset)) {
+            return false;
+        }
+
+        const QByteArray compressed = m_archive->read(compressedSize);
+        if (compressed.size() != compressedSize) {
+            return false;
+        }
+
+        m_chunk.resize(int(qMin(m_chunkSize, m_size - index * m_chunkSize)));
+
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+
+        if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+            warnStore << "Could not initialize zlib stream";
+            return false;
+        }
+
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed.constData()));
+        stream.avail_in = uInt(compressed.size());
+        stream.next_out = reinterpret_cast<Bytef*>(m_chunk.data());
+        stream.avail_out = uInt(m_chunk.size());
+
+        // the chunks except the last one end with a full flush, not with the end of the stream
+        const int r = inflate(&stream, Z_SYNC_FLUSH);
+        const qint64 decompressedSize = qint64(stream.total_out);
+        inflateEnd(&stream);
+
+        if ((r != Z_OK && r != Z_STREAM_END) || decompressedSize != m_chunk.size()) {
+            warnStore << "Could not decompress chunk" << index << "zlib error" << r;
+            return false;
+        }
+
+        m_currentChunk = index;
+        return true;
+    }
+
+private:
+    QIODevice *m_archive;
+    qint64 m_dataOffset;
+    qint64 m_size;
+    qint64 m_chunkSize;
+    QVector<qint64> m_chunkOffsets;
+
+    QByteArray m_chunk;
+    int m_currentChunk = -1;
+};
+
+}
+
 struct KoQuaZipStore::Private {
 
     Private() {}
@@ -48,8 +260,33 @@ struct KoQuaZipStore::Private {
     bool usingSaveFile {false};
     QByteArray cache;
     QBuffer buffer;
+
+    /// the device for the files with an index of chunks
+    QScopedPointer<QIODevice> chunkedDevice;
+
+    /// used for random access when QuaZip opens the file itself
+    QScopedPointer<QFile> archiveFile;
+
+    QIODevice* randomAccessArchiveDevice(const QString &localFileName);
 };
 
+QIODevice* KoQuaZipStore::Private::randomAccessArchiveDevice(const QString &localFileName)
+{
+    QIODevice *device = archive->getIoDevice();
+
+    if (!device && !localFileName.isEmpty()) {
+        if (!archiveFile) {
+            archiveFile.reset(new QFile(localFileName));
+            if (!archiveFile->open(QIODevice::ReadOnly)) {
+                warnStore << "Could not open" << localFileName << "for random access";
+            }
+        }
+        device = archiveFile->isOpen() ? archiveFile.data() : 0;
+    }
+
+    return device && !device->isSequential() ? device : 0;
+}
+
 
 KoQuaZipStore::KoQuaZipStore(const QString &_filename, KoStore::Mode _mode, const QByteArray &appIdentification, bool writeMimetype)
     : KoStore(_mode, writeMimetype)
@@ -78,6 +315,11 @@ KoQuaZipStore::~KoQuaZipStore()
         dd->currentFile->close();
     }
 
+    // the device is owned by the private part, KoStore should not delete it
+    if (d->stream == dd->chunkedDevice.data()) {
+        d->stream = 0;
+    }
+
     if (!d->finalized) {
         finalize();
     }
@@ -97,6 +339,11 @@ void KoQuaZipStore::setCompressionEnabled(bool enabled)
     }
 }
 
+bool KoQuaZipStore::compressionEnabled() const
+{
+    return dd->compressionLevel != Z_NO_COMPRESSION;
+}
+
 qint64 KoQuaZipStore::write(const char *_data, qint64 _len)
 {
     Q_D(KoStore);
@@ -119,6 +366,96 @@ qint64 KoQuaZipStore::write(const char *_data, qint64 _len)
     return 0;
 }
 
+KoStore::CompressedData KoQuaZipStore::compressData(const QByteArray &data, bool compressionEnabled, qint64 chunkSize) const
+{
+    CompressedData result;
+    result.uncompressedSize = data.size();
+
+    /**
+     * Without compression QuaZip just stores the data, there is
+     * nothing to be prepared in advance. The checksum is still
+     * calculated, so that the caller could recognize the entry later.
+     */
+    if (!compressionEnabled || data.isEmpty()) {
+        result.data = data;
+        result.crc = quint32(crc32(0, reinterpret_cast<const Bytef*>(data.constData()), uInt(data.size())));
+        return result;
+    }
+
+    /**
+     * The parameters should be the same as the ones QuaZipFile passes
+     * to zlib, so that the resulting stream could be written into the
+     * archive as a raw deflated entry
+     */
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        warnStore << "Could not initialize zlib stream";
+        result.data = data;
+        return result;
+    }
+
+    if (chunkSize <= 0 || chunkSize >= data.size()) {
+        chunkSize = data.size();
+    }
+
+    const int numChunks = int((data.size() + chunkSize - 1) / chunkSize);
+
+    // every full flush adds an empty stored block to the stream
+    result.data.resize(int(deflateBound(&stream, uLong(data.size()))) + 16 * numChunks);
+
+    stream.next_out = reinterpret_cast<Bytef*>(result.data.data());
+    stream.avail_out = uInt(result.data.size());
+
+    int r = Z_OK;
+
+    /**
+     * A full flush resets the state of the compressor, so every chunk
+     * can be inflated without the data preceding it
+     */
+    for (qint64 offset = 0; offset < data.size(); offset += chunkSize) {
+        const qint64 length = qMin(chunkSize, data.size() - offset);
+        const bool isLastChunk = offset + length >= data.size();
+        const uLong chunkStart = stream.total_out;
+
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData() + offset));
+        stream.avail_in = uInt(length);
+
+        r = deflate(&stream, isLastChunk ? Z_FINISH : Z_FULL_FLUSH);
+
+        if (isLastChunk ? r != Z_STREAM_END : (r != Z_OK || stream.avail_in > 0)) {
+            break;
+        }
+
+        result.compressedChunkSizes.append(quint32(stream.total_out - chunkStart));
+    }
+
+    const qint64 compressedSize = qint64(stream.total_out);
+    deflateEnd(&stream);
+
+    if (r != Z_STREAM_END) {
+        warnStore << "Could not compress data, zlib error" << r;
+        result.data = data;
+        result.compressedChunkSizes.clear();
+        return result;
+    }
+
+    result.data.resize(int(compressedSize));
+    result.crc = quint32(crc32(crc32(0, Z_NULL, 0),
+                               reinterpret_cast<const Bytef*>(data.constData()),
+                               uInt(data.size())));
+    result.isCompressed = true;
+
+    if (numChunks > 1) {
+        result.chunkSize = chunkSize;
+    } else {
+        result.compressedChunkSizes.clear();
+    }
+
+    return result;
+}
+
 QStringList KoQuaZipStore::directoryList() const
 {
     return dd->archive->getFileNameList();
@@ -211,6 +548,7 @@ bool KoQuaZipStore::openRead(const QString &name)
     d->stream = 0;
     delete dd->currentFile;
     dd->currentFile = 0;
+    dd->chunkedDevice.reset();
 
     if (!currentPath().isEmpty() && !fixedPath.startsWith(currentPath())) {
         fixedPath = currentPath() + '/' + fixedPath;
@@ -232,6 +570,34 @@ bool KoQuaZipStore::openRead(const QString &name)
     }
     d->stream = dd->currentFile;
     d->size = dd->currentFile->size();
+
+    /**
+     * The files with an index of chunks are read through a device that
+     * supports seeking, QuaZipFile can only inflate the file from the
+     * very beginning
+     */
+    QuaZipFileInfo64 info;
+    qint64 chunkSize = 0;
+    QVector<quint32> compressedChunkSizes;
+
+    if (dd->currentFile->getFileInfo(&info) &&
+        info.method == Z_DEFLATED &&
+        readChunkIndex(info.extra, qint64(info.compressedSize), qint64(info.uncompressedSize),
+                       &chunkSize, &compressedChunkSizes)) {
+
+        QIODevice *archiveDevice = dd->randomAccessArchiveDevice(d->localFileName);
+
+        if (archiveDevice) {
+            const qint64 dataOffset = qint64(unzGetCurrentFileZStreamPos64(dd->archive->getUnzFile()));
+
+            dd->chunkedDevice.reset(new ChunkedDeflateDevice(archiveDevice, dataOffset,
+                                                             qint64(info.uncompressedSize),
+                                                             chunkSize, compressedChunkSizes));
+            dd->chunkedDevice->open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+            d->stream = dd->chunkedDevice.data();
+        }
+    }
+
     return true;
 }
 
@@ -254,9 +620,80 @@ bool KoQuaZipStore::closeRead()
 {
     Q_D(KoStore);
     d->stream = 0;
+    dd->chunkedDevice.reset();
     return true;
 }
 
+bool KoQuaZipStore::writeCompressedFile(const QString &name, const CompressedData &data)
+{
+    QString fixedPath = name;
+    fixedPath.replace("//", "/");
+
+    QuaZipFile file(dd->archive);
+    QuaZipNewInfo newInfo(fixedPath);
+    newInfo.setPermissions(QFileDevice::ReadOwner | QFileDevice::ReadGroup | QFileDevice::ReadOther);
+    newInfo.uncompressedSize = quint64(data.uncompressedSize);
+    newInfo.extraGlobal = chunkIndexExtraField(data);
+
+    if (!file.open(QIODevice::WriteOnly, newInfo, 0, data.crc, Z_DEFLATED, Z_BEST_COMPRESSION, true)) {
+        qWarning() << "Could not open" << name << file.getZipError();
+        return false;
+    }
+
+    bool r = true;
+    if (file.write(data.data) != data.data.size()) {
+        qWarning() << "Could not write precompressed data to the file";
+        r = false;
+    }
+
+    // in raw mode QuaZipFile takes the crc and the size from the open() call
+    file.close();
+    return (r && file.getZipError() == ZIP_OK);
+}
+
+bool KoQuaZipStore::readCompressedFile(CompressedData *data)
+{
+    Q_D(KoStore);
+
+    QuaZipFileInfo64 info;
+    if (!dd->currentFile || !dd->currentFile->getFileInfo(&info)) {
+        return false;
+    }
+
+    if (info.method != Z_DEFLATED) {
+        return KoStore::readCompressedFile(data);
+    }
+
+    if (!fitsIntoByteArray(qint64(info.compressedSize))) {
+        warnStore << "KoQuaZipStore: compressed file is too big to be read at once, size:" << info.compressedSize;
+        return false;
+    }
+
+    // reopen the current file in raw mode, QuaZip will not inflate it then
+    dd->currentFile->close();
+
+    int method = 0;
+    int level = 0;
+    if (!dd->currentFile->open(QIODevice::ReadOnly, &method, &level, true)) {
+        qWarning() << "Could not open the file in raw mode" << dd->currentFile->getZipError();
+        return false;
+    }
+
+    *data = CompressedData();
+    data->data = dd->currentFile->readAll();
+    data->crc = info.crc;
+    data->uncompressedSize = qint64(info.uncompressedSize);
+    data->isCompressed = true;
+
+    // keep the index, so that the data could be copied into another store as it is
+    readChunkIndex(info.extra, qint64(info.compressedSize), qint64(info.uncompressedSize),
+                   &data->chunkSize, &data->compressedChunkSizes);
+
+    d->size = data->uncompressedSize;
+
+    return data->data.size() == qint64(info.compressedSize);
+}
+
 bool KoQuaZipStore::enterRelativeDirectory(const QString & /*path*/)
 {
     return true;
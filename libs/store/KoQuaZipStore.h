@@ -37,8 +37,11 @@ public:
     ~KoQuaZipStore() override;
 
     void setCompressionEnabled(bool enabled) override;
+    bool compressionEnabled() const override;
     qint64 write(const char* _data, qint64 _len) override;
 
+    CompressedData compressData(const QByteArray &data, bool compressionEnabled, qint64 chunkSize = 0) const override;
+
     QStringList directoryList() const override;
 
 protected:
@@ -48,6 +51,8 @@ protected:
     bool openRead(const QString& name) override;
     bool closeWrite() override;
     bool closeRead() override;
+    bool writeCompressedFile(const QString &name, const CompressedData &data) override;
+    bool readCompressedFile(CompressedData *data) override;
     bool enterRelativeDirectory(const QString& dirName) override;
     bool enterAbsoluteDirectory(const QString& path) override;
     bool fileExists(const QString& absPath) const override;
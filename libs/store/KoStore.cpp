@@ -37,6 +37,10 @@
 #include <KSharedConfig>
 #include <KConfigGroup>
 
+#include <zlib.h>
+
+#include <limits>
+
 
 #define DefaultFormat KoStore::Zip
 
@@ -437,6 +441,150 @@ void KoStore::setCompressionEnabled(bool /*e*/)
 {
 }
 
+bool KoStore::compressionEnabled() const
+{
+    return false;
+}
+
+KoStore::CompressedData KoStore::compressData(const QByteArray &data, bool /*compressionEnabled*/, qint64 /*chunkSize*/) const
+{
+    CompressedData result;
+    result.data = data;
+    result.uncompressedSize = data.size();
+    return result;
+}
+
+bool KoStore::writeCompressedData(const QString &name, const CompressedData &data)
+{
+    Q_D(KoStore);
+
+    if (!data.isCompressed) {
+        if (!open(name)) return false;
+        const bool writeResult = write(data.data) == data.data.size();
+        return close() && writeResult;
+    }
+
+    const QString fileName = d->toExternalNaming(name);
+
+    if (d->isOpen) {
+        warnStore << "Store is already opened, missing close";
+        return false;
+    }
+
+    if (fileName.length() > 512) {
+        errorStore << "KoStore: Filename " << fileName << " is too long" << endl;
+        return false;
+    }
+
+    if (d->mode != Write) {
+        errorStore << "KoStore: Can not write to store that is opened for reading" << endl;
+        return false;
+    }
+
+    if (d->filesList.contains(fileName)) {
+        warnStore << "KoStore: Duplicate filename" << fileName;
+        return false;
+    }
+
+    d->filesList.append(fileName);
+
+    return writeCompressedFile(fileName, data);
+}
+
+bool KoStore::readCompressedData(const QString &name, CompressedData *data)
+{
+    Q_D(KoStore);
+
+    if (d->mode != Read) {
+        errorStore << "KoStore: Can not read from store that is opened for writing" << endl;
+        return false;
+    }
+
+    if (!open(name)) return false;
+
+    if (!fitsIntoByteArray(size())) {
+        warnStore << "KoStore: File" << name << "is too big to be read at once, size:" << size();
+        close();
+        return false;
+    }
+
+    const bool result = readCompressedFile(data);
+    return close() && result;
+}
+
+bool KoStore::decompressData(const CompressedData &data, QByteArray *result)
+{
+    if (!data.isCompressed) {
+        *result = data.data;
+        return true;
+    }
+
+    if (!fitsIntoByteArray(data.uncompressedSize)) {
+        warnStore << "Could not decompress data, invalid size" << data.uncompressedSize;
+        return false;
+    }
+
+    QByteArray buffer(int(data.uncompressedSize), Qt::Uninitialized);
+
+    if (!buffer.isEmpty()) {
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+
+        if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+            warnStore << "Could not initialize zlib stream";
+            return false;
+        }
+
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data.constData()));
+        stream.avail_in = uInt(data.data.size());
+        stream.next_out = reinterpret_cast<Bytef*>(buffer.data());
+        stream.avail_out = uInt(buffer.size());
+
+        const int r = inflate(&stream, Z_FINISH);
+        const qint64 decompressedSize = qint64(stream.total_out);
+        inflateEnd(&stream);
+
+        if (r != Z_STREAM_END || decompressedSize != data.uncompressedSize) {
+            warnStore << "Could not decompress data, zlib error" << r;
+            return false;
+        }
+    }
+
+    const quint32 crc = quint32(crc32(crc32(0, Z_NULL, 0),
+                                      reinterpret_cast<const Bytef*>(buffer.constData()),
+                                      uInt(buffer.size())));
+
+    if (crc != data.crc) {
+        warnStore << "CRC mismatch in the decompressed data";
+        return false;
+    }
+
+    *result = buffer;
+    return true;
+}
+
+bool KoStore::readCompressedFile(CompressedData *data)
+{
+    *data = CompressedData();
+    data->uncompressedSize = size();
+    data->data = read(data->uncompressedSize);
+    return data->data.size() == data->uncompressedSize;
+}
+
+bool KoStore::fitsIntoByteArray(qint64 size)
+{
+    // QByteArray keeps its size in an int and allocates a header and
+    // a null terminator in the same block as the data
+    const qint64 maxSize = std::numeric_limits<int>::max() - 64;
+    return size >= 0 && size <= maxSize;
+}
+
+bool KoStore::writeCompressedFile(const QString &name, const CompressedData &/*data*/)
+{
+    errorStore << "KoStore: the backend cannot write precompressed file" << name << endl;
+    return false;
+}
+
 void KoStore::setSubstitution(const QString &name, const QString &substitution)
 {
     Q_D(KoStore);
@@ -23,6 +23,7 @@
 
 #include <QByteArray>
 #include <QIODevice>
+#include <QVector>
 #include "kritastore_export.h"
 
 class QWidget;
@@ -264,6 +265,83 @@ public:
      */
     virtual void setCompressionEnabled(bool e);
 
+    /**
+     * @return whether the files written into the store are compressed
+     */
+    virtual bool compressionEnabled() const;
+
+    /**
+     * The data of a file compressed in advance by compressData(). It can
+     * be prepared in any thread and then written into the store with
+     * writeCompressedData().
+     */
+    struct CompressedData {
+        QByteArray data;
+        quint32 crc = 0;
+        qint64 uncompressedSize = 0;
+        bool isCompressed = false;
+
+        /**
+         * When non-zero, every \p chunkSize bytes of the uncompressed
+         * data were compressed independently of the previous ones, and
+         * \p compressedChunkSizes lists the sizes of the resulting parts
+         * of the stream. The stream is still a valid deflate stream.
+         */
+        qint64 chunkSize = 0;
+        QVector<quint32> compressedChunkSizes;
+    };
+
+    /**
+     * Compresses \p data in the same way as the backend would do when
+     * writing it into a file. The method does not touch the state of
+     * the store, so it is safe to call it from several threads at once
+     * while the store is busy writing other files.
+     *
+     * The checksum of the data is always calculated by the zip backend,
+     * even if the data is left uncompressed.
+     *
+     * If \p chunkSize is non-zero, the zip backend compresses the data in
+     * chunks of that size and saves their index along with the file.
+     * When such a file is opened for reading, device() supports seeking
+     * and inflates only the chunks that are actually read.
+     *
+     * The default implementation doesn't compress anything.
+     */
+    virtual CompressedData compressData(const QByteArray &data, bool compressionEnabled, qint64 chunkSize = 0) const;
+
+    /**
+     * Writes a file \p name with the data prepared by compressData().
+     * It is an equivalent of open(), write() and close(), except that
+     * the store doesn't spend any time on compression.
+     *
+     * @param name The filename, see open()
+     * @return true on success.
+     */
+    bool writeCompressedData(const QString &name, const CompressedData &data);
+
+    /**
+     * Reads the file \p name without decompressing it. The data can be
+     * decompressed later with decompressData(), which is safe to be
+     * called from any thread.
+     *
+     * Files that are too big to be held in a single QByteArray are
+     * rejected, they should be read with open() and device() instead.
+     *
+     * @param name The filename, see open()
+     * @return true on success.
+     */
+    bool readCompressedData(const QString &name, CompressedData *data);
+
+    /**
+     * Decompresses the data read by readCompressedData() into \p result.
+     * The compressed data is always a raw deflate stream, as it is stored
+     * in zip archives, so the method doesn't need the store itself. It can
+     * be called from any thread, even after the store has been destroyed.
+     *
+     * @return true on success.
+     */
+    static bool decompressData(const CompressedData &data, QByteArray *result);
+
     /// When reading, in the paths in the store where name occurs, substitution is used.
     void setSubstitution(const QString &name, const QString &substitution);
 
@@ -303,6 +381,26 @@ protected:
      */
     virtual bool closeWrite() = 0;
 
+    /**
+     * Write a file with already compressed data. Only called when the
+     * data has been compressed by the compressData() of the same backend.
+     * @param name "absolute path" (in the archive) to the file to write
+     * @return true on success
+     */
+    virtual bool writeCompressedFile(const QString &name, const CompressedData &data);
+
+    /**
+     * Read the content of the currently opened file without decompressing
+     * it. The default implementation just reads the uncompressed data.
+     * @return true on success
+     */
+    virtual bool readCompressedFile(CompressedData *data);
+
+    /**
+     * @return true if \p size bytes can be held in a single QByteArray
+     */
+    static bool fitsIntoByteArray(qint64 size);
+
     /**
      * Enter a subdirectory of the current directory.
      * The directory might not exist yet in Write mode.
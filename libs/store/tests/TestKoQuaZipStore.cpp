@@ -0,0 +1,309 @@
+/* This file is part of the KDE project
+ * Copyright (c) 2020 Krita Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "TestKoQuaZipStore.h"
+
+#include <KoStore.h>
+
+#include <QBuffer>
+#include <QScopedPointer>
+#include <QTemporaryFile>
+#include <QTest>
+
+namespace {
+QByteArray generateData(int size)
+{
+    QByteArray data(size, '\0');
+
+    // something compressible, but not trivially
+    for (int i = 0; i < size; i++) {
+        data[i] = char((i / 7) ^ (i % 13));
+    }
+
+    return data;
+}
+}
+
+void TestKoQuaZipStore::testCompressedDataRoundtrip_data()
+{
+    QTest::addColumn<int>("size");
+    QTest::addColumn<bool>("compressionEnabled");
+
+    QTest::newRow("empty") << 0 << true;
+    QTest::newRow("small") << 17 << true;
+    QTest::newRow("large") << 1000000 << true;
+    QTest::newRow("large-uncompressed") << 1000000 << false;
+}
+
+void TestKoQuaZipStore::testCompressedDataRoundtrip()
+{
+    QFETCH(int, size);
+    QFETCH(bool, compressionEnabled);
+
+    const QByteArray data = generateData(size);
+    const QByteArray plainData = generateData(1000);
+
+    QByteArray archive;
+
+    {
+        QBuffer buffer(&archive);
+        QScopedPointer<KoStore> store(KoStore::createStore(&buffer, KoStore::Write, "application/x-krita", KoStore::Zip));
+        QVERIFY(!store->bad());
+
+        const KoStore::CompressedData compressed = store->compressData(data, compressionEnabled);
+        QCOMPARE(compressed.uncompressedSize, qint64(size));
+        QVERIFY(!compressed.isCompressed || compressed.data.size() < size);
+
+        QVERIFY(store->writeCompressedData("layers/layer1", compressed));
+
+        // the usual way of writing should not be affected
+        QVERIFY(store->open("layers/layer2"));
+        QCOMPARE(store->write(plainData), qint64(plainData.size()));
+        QVERIFY(store->close());
+
+        QVERIFY(store->finalize());
+    }
+
+    {
+        QBuffer buffer(&archive);
+        QScopedPointer<KoStore> store(KoStore::createStore(&buffer, KoStore::Read, "application/x-krita", KoStore::Zip));
+        QVERIFY(!store->bad());
+
+        QVERIFY(store->open("layers/layer1"));
+        QCOMPARE(store->size(), qint64(size));
+        QCOMPARE(store->read(store->size()), data);
+        QVERIFY(store->close());
+
+        QVERIFY(store->open("layers/layer2"));
+        QCOMPARE(store->read(store->size()), plainData);
+        QVERIFY(store->close());
+    }
+}
+
+void TestKoQuaZipStore::testCompressedDataDuplicate()
+{
+    QByteArray archive;
+    QBuffer buffer(&archive);
+    QScopedPointer<KoStore> store(KoStore::createStore(&buffer, KoStore::Write, "application/x-krita", KoStore::Zip));
+
+    const KoStore::CompressedData compressed = store->compressData(generateData(1000), true);
+    QVERIFY(compressed.isCompressed);
+
+    QVERIFY(store->writeCompressedData("layer1", compressed));
+    QVERIFY(!store->writeCompressedData("layer1", compressed));
+    QVERIFY(!store->writeCompressedData("tar:/layer1", compressed));
+}
+
+void TestKoQuaZipStore::testReadCompressedData_data()
+{
+    QTest::addColumn<int>("size");
+    QTest::addColumn<bool>("compressionEnabled");
+
+    QTest::newRow("empty") << 0 << true;
+    QTest::newRow("large") << 1000000 << true;
+    QTest::newRow("large-uncompressed") << 1000000 << false;
+}
+
+void TestKoQuaZipStore::testReadCompressedData()
+{
+    QFETCH(int, size);
+    QFETCH(bool, compressionEnabled);
+
+    const QByteArray data = generateData(size);
+    QByteArray archive;
+
+    {
+        QBuffer buffer(&archive);
+        QScopedPointer<KoStore> store(KoStore::createStore(&buffer, KoStore::Write, "application/x-krita", KoStore::Zip));
+        store->setCompressionEnabled(compressionEnabled);
+        QCOMPARE(store->compressionEnabled(), compressionEnabled);
+
+        QVERIFY(store->open("layers/layer1"));
+        QCOMPARE(store->write(data), qint64(size));
+        QVERIFY(store->close());
+        QVERIFY(store->finalize());
+    }
+
+    QBuffer buffer(&archive);
+    QScopedPointer<KoStore> store(KoStore::createStore(&buffer, KoStore::Read, "application/x-krita", KoStore::Zip));
+
+    KoStore::CompressedData compressed;
+    QVERIFY(store->readCompressedData("layers/layer1", &compressed));
+    QCOMPARE(compressed.uncompressedSize, qint64(size));
+
+    QByteArray result;
+    QVERIFY(store->decompressData(compressed, &result));
+    QCOMPARE(result, data);
+
+    // corrupted data should be detected
+    if (compressed.isCompressed) {
+        compressed.crc ^= 0x1;
+        QVERIFY(!store->decompressData(compressed, &result));
+
+        // sizes that don't fit into a QByteArray are rejected, not truncated
+        compressed.crc ^= 0x1;
+        compressed.uncompressedSize = qint64(3) << 30;
+        QVERIFY(!store->decompressData(compressed, &result));
+    }
+
+    // the store is still usable in the usual way
+    QVERIFY(store->open("layers/layer1"));
+    QCOMPARE(store->read(store->size()), data);
+    QVERIFY(store->close());
+
+    QVERIFY(!store->readCompressedData("layers/nonexistent", &compressed));
+}
+
+void TestKoQuaZipStore::testCopyCompressedData_data()
+{
+    QTest::addColumn<bool>("compressionEnabled");
+
+    QTest::newRow("compressed") << true;
+    QTest::newRow("uncompressed") << false;
+}
+
+void TestKoQuaZipStore::testCopyCompressedData()
+{
+    QFETCH(bool, compressionEnabled);
+
+    const QByteArray data = generateData(100000);
+    QByteArray sourceArchive;
+    QByteArray targetArchive;
+
+    KoStore::CompressedData compressed;
+
+    {
+        QBuffer buffer(&sourceArchive);
+        QScopedPointer<KoStore> store(KoStore::createStore(&buffer, KoStore::Write, "application/x-krita", KoStore::Zip));
+
+        compressed = store->compressData(data, compressionEnabled);
+        QVERIFY(store->writeCompressedData("layers/layer1", compressed));
+        QVERIFY(store->finalize());
+    }
+
+    {
+        QBuffer sourceBuffer(&sourceArchive);
+        QScopedPointer<KoStore> source(KoStore::createStore(&sourceBuffer, KoStore::Read, "application/x-krita", KoStore::Zip));
+
+        QBuffer targetBuffer(&targetArchive);
+        QScopedPointer<KoStore> target(KoStore::createStore(&targetBuffer, KoStore::Write, "application/x-krita", KoStore::Zip));
+
+        KoStore::CompressedData copied;
+        QVERIFY(source->readCompressedData("layers/layer1", &copied));
+
+        // the checksum is known even for the data that was not compressed
+        QCOMPARE(copied.crc, compressed.crc);
+        QCOMPARE(copied.uncompressedSize, compressed.uncompressedSize);
+
+        QVERIFY(target->writeCompressedData("layers/layer2", copied));
+        QVERIFY(target->finalize());
+    }
+
+    QBuffer buffer(&targetArchive);
+    QScopedPointer<KoStore> store(KoStore::createStore(&buffer, KoStore::Read, "application/x-krita", KoStore::Zip));
+
+    QVERIFY(store->open("layers/layer2"));
+    QCOMPARE(store->read(store->size()), data);
+    QVERIFY(store->close());
+}
+
+void TestKoQuaZipStore::testChunkedRandomAccess_data()
+{
+    QTest::addColumn<bool>("useFileName");
+
+    QTest::newRow("device") << false;
+    QTest::newRow("file") << true;
+}
+
+void TestKoQuaZipStore::testChunkedRandomAccess()
+{
+    QFETCH(bool, useFileName);
+
+    const int chunkSize = 65536;
+    const QByteArray data = generateData(1000000);
+    const QByteArray plainData = generateData(1000);
+
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    file.close();
+
+    QByteArray archive;
+    QBuffer writeBuffer(&archive);
+    QBuffer readBuffer(&archive);
+
+    KoStore::CompressedData compressed;
+
+    {
+        QScopedPointer<KoStore> store(useFileName ?
+                                      KoStore::createStore(file.fileName(), KoStore::Write, "application/x-krita", KoStore::Zip) :
+                                      KoStore::createStore(&writeBuffer, KoStore::Write, "application/x-krita", KoStore::Zip));
+
+        compressed = store->compressData(data, true, chunkSize);
+        QVERIFY(compressed.isCompressed);
+        QCOMPARE(compressed.chunkSize, qint64(chunkSize));
+        QCOMPARE(compressed.compressedChunkSizes.size(), (data.size() + chunkSize - 1) / chunkSize);
+
+        QVERIFY(store->writeCompressedData("layers/layer1", compressed));
+
+        QVERIFY(store->open("layers/layer2"));
+        QCOMPARE(store->write(plainData), qint64(plainData.size()));
+        QVERIFY(store->close());
+
+        QVERIFY(store->finalize());
+    }
+
+    QScopedPointer<KoStore> store(useFileName ?
+                                  KoStore::createStore(file.fileName(), KoStore::Read, "application/x-krita", KoStore::Zip) :
+                                  KoStore::createStore(&readBuffer, KoStore::Read, "application/x-krita", KoStore::Zip));
+    QVERIFY(!store->bad());
+
+    QVERIFY(store->open("layers/layer1"));
+    QCOMPARE(store->size(), qint64(data.size()));
+    QVERIFY(!store->device()->isSequential());
+
+    // read the pieces in the reverse order, crossing the borders of the chunks
+    const int pieceSize = 100000;
+    for (int pos = data.size() - pieceSize; pos >= 0; pos -= pieceSize) {
+        QVERIFY(store->seek(pos));
+        QCOMPARE(store->read(pieceSize), data.mid(pos, pieceSize));
+    }
+
+    QVERIFY(store->seek(0));
+    QCOMPARE(store->read(store->size()), data);
+    QVERIFY(store->atEnd());
+    QVERIFY(store->close());
+
+    // the files without the index are read as usual
+    QVERIFY(store->open("layers/layer2"));
+    QCOMPARE(store->read(store->size()), plainData);
+    QVERIFY(store->close());
+
+    // the index survives copying of the raw data
+    KoStore::CompressedData copied;
+    QVERIFY(store->readCompressedData("layers/layer1", &copied));
+    QCOMPARE(copied.chunkSize, compressed.chunkSize);
+    QCOMPARE(copied.compressedChunkSizes, compressed.compressedChunkSizes);
+
+    // the data is still a valid deflate stream
+    QByteArray result;
+    QVERIFY(KoStore::decompressData(copied, &result));
+    QCOMPARE(result, data);
+}
+
+QTEST_GUILESS_MAIN(TestKoQuaZipStore)
@@ -1102,21 +1102,22 @@ void KisDocument::slotAutoSaveImpl(std::unique_ptr<KisDocument> &&optionalCloned
                                              KritaUtils::ExportFileJob(autoSaveFileName, nativeFormatMimeType(), KritaUtils::SaveIsExporting | KritaUtils::SaveInAutosaveMode),
                                              0,
                                              std::move(optionalClonedDocument));
+    } else if (!isSaving()) {
+        /**
+         * The image is busy, but we shouldn't postpone the autosave or
+         * block the GUI until the strokes are finished. Instead, the
+         * copy-on-write snapshot of the image is taken by a stroke as
+         * soon as the current strokes are done, and the snapshot is
+         * saved in the background.
+         */
+        startCloningDocumentForAutosave();
+        return;
     } else {
         emit statusBarMessage(i18n("Autosaving postponed: document is busy..."), errorMessageTimeout);
     }
 
     if (!started && !hadClonedDocument && d->autoSaveFailureCount >= 3) {
-        KisCloneDocumentStroke *stroke = new KisCloneDocumentStroke(this);
-        connect(stroke, SIGNAL(sigDocumentCloned(KisDocument*)),
-                this, SLOT(slotInitiateAsyncAutosaving(KisDocument*)),
-                Qt::BlockingQueuedConnection);
-
-        KisStrokeId strokeId = d->image->startStroke(stroke);
-        d->image->endStroke(strokeId);
-
-        setInfiniteAutoSaveInterval();
-
+        startCloningDocumentForAutosave();
     } else if (!started) {
         setEmergencyAutoSaveInterval();
     } else {
@@ -1124,6 +1125,20 @@ void KisDocument::slotAutoSaveImpl(std::unique_ptr<KisDocument> &&optionalCloned
     }
 }
 
+void KisDocument::startCloningDocumentForAutosave()
+{
+    KisCloneDocumentStroke *stroke = new KisCloneDocumentStroke(this);
+    connect(stroke, SIGNAL(sigDocumentCloned(KisDocument*)),
+            this, SLOT(slotInitiateAsyncAutosaving(KisDocument*)),
+            Qt::BlockingQueuedConnection);
+
+    KisStrokeId strokeId = d->image->startStroke(stroke);
+    d->image->endStroke(strokeId);
+
+    // the autosave is restarted when the cloned document is ready
+    setInfiniteAutoSaveInterval();
+}
+
 void KisDocument::slotAutoSave()
 {
     slotAutoSaveImpl(std::unique_ptr<KisDocument>());
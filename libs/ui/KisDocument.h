@@ -688,6 +688,13 @@ private:
 
     void slotAutoSaveImpl(std::unique_ptr<KisDocument> &&optionalClonedDocument);
 
+    /**
+     * Takes a snapshot of the document in a stroke, without locking the
+     * image or waiting for the current strokes in the GUI thread. The
+     * snapshot is autosaved in slotInitiateAsyncAutosaving().
+     */
+    void startCloningDocumentForAutosave();
+
     class Private;
     Private *const d;
 };
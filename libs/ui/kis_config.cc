@@ -999,6 +999,36 @@ void KisConfig::setForceAlwaysFullSizedOutline(bool value) const
     m_cfg.writeEntry("forceAlwaysFullSizedOutline", value);
 }
 
+bool KisConfig::predictStrokeInput(bool defaultValue) const
+{
+    return (defaultValue ? false : m_cfg.readEntry("predictStrokeInput", false));
+}
+
+void KisConfig::setPredictStrokeInput(bool value) const
+{
+    m_cfg.writeEntry("predictStrokeInput", value);
+}
+
+int KisConfig::strokePredictionTime(bool defaultValue) const
+{
+    return (defaultValue ? 20 : m_cfg.readEntry("strokePredictionTime", 20));
+}
+
+void KisConfig::setStrokePredictionTime(int value) const
+{
+    m_cfg.writeEntry("strokePredictionTime", value);
+}
+
+QString KisConfig::strokeRecordingLocation(bool defaultValue) const
+{
+    return (defaultValue ? QString() : m_cfg.readEntry("strokeRecordingLocation", QString()));
+}
+
+void KisConfig::setStrokeRecordingLocation(const QString &value) const
+{
+    m_cfg.writeEntry("strokeRecordingLocation", value);
+}
+
 KisConfig::SessionOnStartup KisConfig::sessionOnStartup(bool defaultValue) const
 {
     int value = defaultValue ? SOS_BlankSession : m_cfg.readEntry("sessionOnStartup", (int)SOS_BlankSession);
@@ -1795,6 +1825,46 @@ void KisConfig::setCompressKra(bool compress)
     m_cfg.writeEntry("compressLayersInKra", compress);
 }
 
+bool KisConfig::lazyLoadKra(bool defaultValue) const
+{
+    return (defaultValue ? false : m_cfg.readEntry("lazyLoadLayersInKra", false));
+}
+
+void KisConfig::setLazyLoadKra(bool lazy)
+{
+    m_cfg.writeEntry("lazyLoadLayersInKra", lazy);
+}
+
+bool KisConfig::reuseUnchangedKraData(bool defaultValue) const
+{
+    return (defaultValue ? true : m_cfg.readEntry("reuseUnchangedLayersInKra", true));
+}
+
+void KisConfig::setReuseUnchangedKraData(bool reuse)
+{
+    m_cfg.writeEntry("reuseUnchangedLayersInKra", reuse);
+}
+
+bool KisConfig::fastKraPreviews(bool defaultValue) const
+{
+    return (defaultValue ? true : m_cfg.readEntry("fastPreviewsInKra", true));
+}
+
+void KisConfig::setFastKraPreviews(bool fast)
+{
+    m_cfg.writeEntry("fastPreviewsInKra", fast);
+}
+
+int KisConfig::kraMergedImageCompression(bool defaultValue) const
+{
+    return (defaultValue ? 6 : m_cfg.readEntry("mergedImageCompressionInKra", 6));
+}
+
+void KisConfig::setKraMergedImageCompression(int compression)
+{
+    m_cfg.writeEntry("mergedImageCompressionInKra", compression);
+}
+
 bool KisConfig::toolOptionsInDocker(bool defaultValue) const
 {
     return (defaultValue ? true : m_cfg.readEntry("ToolOptionsInDocker", true));
@@ -265,6 +265,19 @@ public:
     bool forceAlwaysFullSizedOutline(bool defaultValue = false) const;
     void setForceAlwaysFullSizedOutline(bool value) const;
 
+    bool predictStrokeInput(bool defaultValue = false) const;
+    void setPredictStrokeInput(bool value) const;
+
+    int strokePredictionTime(bool defaultValue = false) const;
+    void setStrokePredictionTime(int value) const;
+
+    /**
+     * The directory where all freehand strokes are recorded for
+     * replaying in benchmarks. Empty string disables the recording.
+     */
+    QString strokeRecordingLocation(bool defaultValue = false) const;
+    void setStrokeRecordingLocation(const QString &value) const;
+
     enum SessionOnStartup {
         SOS_BlankSession,
         SOS_PreviousSession,
@@ -519,6 +532,18 @@ public:
     bool compressKra(bool defaultValue = false) const;
     void setCompressKra(bool compress);
 
+    bool lazyLoadKra(bool defaultValue = false) const;
+    void setLazyLoadKra(bool lazy);
+
+    bool reuseUnchangedKraData(bool defaultValue = false) const;
+    void setReuseUnchangedKraData(bool reuse);
+
+    bool fastKraPreviews(bool defaultValue = false) const;
+    void setFastKraPreviews(bool fast);
+
+    int kraMergedImageCompression(bool defaultValue = false) const;
+    void setKraMergedImageCompression(int compression);
+
     bool toolOptionsInDocker(bool defaultValue = false) const;
     void setToolOptionsInDocker(bool inDocker);
 
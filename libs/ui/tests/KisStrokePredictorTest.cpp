@@ -0,0 +1,82 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisStrokePredictorTest.h"
+
+#include <QPointF>
+
+#include "kis_global.h"
+#include "KisStrokePredictor.h"
+
+
+void KisStrokePredictorTest::testLinearMotion()
+{
+    KisStrokePredictor predictor;
+
+    QCOMPARE(predictor.predictedPosition(10), QPointF());
+
+    // 0.5 px/ms along X and 0.25 px/ms along Y
+    for (int i = 0; i < 10; i++) {
+        predictor.addSample(QPointF(0.5 * 5 * i, 0.25 * 5 * i), 5 * i);
+    }
+
+    QCOMPARE(predictor.lastPosition(), QPointF(22.5, 11.25));
+    QCOMPARE(predictor.predictedPosition(0), QPointF(22.5, 11.25));
+
+    const QPointF predicted = predictor.predictedPosition(20);
+    QVERIFY(kisDistance(predicted, QPointF(32.5, 16.25)) < 1e-3);
+}
+
+void KisStrokePredictorTest::testDuplicatedTimestamps()
+{
+    KisStrokePredictor predictor;
+
+    predictor.addSample(QPointF(0, 0), 0);
+    predictor.addSample(QPointF(5, 0), 10);
+    predictor.addSample(QPointF(7, 0), 10);
+    predictor.addSample(QPointF(10, 0), 10);
+    predictor.addSample(QPointF(20, 0), 20);
+
+    QCOMPARE(predictor.lastPosition(), QPointF(20, 0));
+
+    const QPointF predicted = predictor.predictedPosition(10);
+    QVERIFY(kisDistance(predicted, QPointF(30, 0)) < 1e-3);
+}
+
+void KisStrokePredictorTest::testStop()
+{
+    KisStrokePredictor predictor;
+
+    predictor.addSample(QPointF(0, 0), 0);
+    predictor.addSample(QPointF(10, 0), 10);
+
+    // the offset is limited by the path inside the fitting window
+    const QPointF predicted = predictor.predictedPosition(100);
+    QVERIFY(kisDistance(predicted, QPointF(20, 0)) < 1e-3);
+
+    // the stylus stays at the same position
+    for (int i = 2; i < 20; i++) {
+        predictor.addSample(QPointF(10, 0), 10 * i);
+    }
+    QCOMPARE(predictor.predictedPosition(20), QPointF(10, 0));
+
+    predictor.reset();
+    QVERIFY(predictor.isEmpty());
+}
+
+QTEST_MAIN(KisStrokePredictorTest)
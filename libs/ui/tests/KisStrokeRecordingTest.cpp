@@ -0,0 +1,120 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisStrokeRecordingTest.h"
+
+#include <QBuffer>
+
+#include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+#include <brushengine/kis_paintop_preset.h>
+
+#include "testutil.h"
+#include "KisStrokeRecording.h"
+
+
+void KisStrokeRecordingTest::testRoundTrip()
+{
+    KisPaintOpPresetSP preset(new KisPaintOpPreset(TestUtil::fetchDataFileLazy("autobrush_300px.kpp")));
+    QVERIFY(preset->load());
+
+    const KoColor color(Qt::red, KoColorSpaceRegistry::instance()->rgb8());
+
+    KisPaintInformation pi1(QPointF(10.5, 20.25), 0.3, 0.1, -0.2, 45.0, 0.5, 1.0, 10.0, 2.5);
+    pi1.setCanvasRotation(90.0);
+    pi1.setCanvasMirroredH(true);
+
+    KisPaintInformation pi2(QPointF(110.0, 120.0), 0.7, 0.0, 0.0, 0.0, 0.0, 1.0, 20.0, 3.0);
+    KisPaintInformation pi3(QPointF(210.0, -20.0), 1.0, 0.0, 0.0, 0.0, 0.0, 1.0, 30.0, 3.5);
+
+    KisStrokeRecording recording;
+    recording.start(preset, color, QPointF(10.5, 20.25), 0.5, 2, 12345);
+    recording.addPaintAt(0, pi1);
+    recording.addPaintLine(1, pi1, pi2);
+    recording.addPaintBezierCurve(0, pi2, QPointF(150, 100), QPointF(180, 0), pi3);
+
+    QByteArray data;
+    {
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::WriteOnly);
+        QVERIFY(recording.save(&buffer));
+    }
+
+    KisStrokeRecording restored;
+    {
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::ReadOnly);
+        QVERIFY(restored.load(&buffer));
+    }
+
+    QCOMPARE(restored.presetName(), preset->name());
+    QCOMPARE(restored.paintColor(), color);
+    QCOMPARE(restored.startPos(), QPointF(10.5, 20.25));
+    QCOMPARE(restored.startAngle(), 0.5);
+    QCOMPARE(restored.numStrokeInfos(), 2);
+    QCOMPARE(restored.randomSeed(), 12345);
+    QCOMPARE(restored.duration(), 30.0);
+    QCOMPARE(restored.bounds(), recording.bounds());
+
+    QCOMPARE(restored.events().size(), 3);
+
+    const KisStrokeRecording::Event &point = restored.events()[0];
+    QCOMPARE(point.type, KisStrokeRecording::Event::PAINT_AT);
+    QCOMPARE(point.strokeInfoId, 0);
+    QCOMPARE(point.pi1.pos(), pi1.pos());
+    QCOMPARE(point.pi1.pressure(), pi1.pressure());
+    QCOMPARE(point.pi1.xTilt(), pi1.xTilt());
+    QCOMPARE(point.pi1.yTilt(), pi1.yTilt());
+    QCOMPARE(point.pi1.rotation(), pi1.rotation());
+    QCOMPARE(point.pi1.tangentialPressure(), pi1.tangentialPressure());
+    QCOMPARE(point.pi1.currentTime(), pi1.currentTime());
+    QCOMPARE(point.pi1.drawingSpeed(), pi1.drawingSpeed());
+    QCOMPARE(point.pi1.canvasRotation(), 90.0);
+    QCOMPARE(point.pi1.canvasMirroredH(), true);
+    QCOMPARE(point.pi1.canvasMirroredV(), false);
+
+    const KisStrokeRecording::Event &line = restored.events()[1];
+    QCOMPARE(line.type, KisStrokeRecording::Event::PAINT_LINE);
+    QCOMPARE(line.strokeInfoId, 1);
+    QCOMPARE(line.pi2.pos(), pi2.pos());
+    QCOMPARE(line.pi2.pressure(), pi2.pressure());
+
+    const KisStrokeRecording::Event &curve = restored.events()[2];
+    QCOMPARE(curve.type, KisStrokeRecording::Event::PAINT_BEZIER_CURVE);
+    QCOMPARE(curve.control1, QPointF(150, 100));
+    QCOMPARE(curve.control2, QPointF(180, 0));
+    QCOMPARE(curve.pi2.pos(), pi3.pos());
+
+    KisPaintOpPresetSP restoredPreset = restored.createPreset();
+    QVERIFY(restoredPreset);
+    QCOMPARE(restoredPreset->paintOp(), preset->paintOp());
+}
+
+void KisStrokeRecordingTest::testInvalidFile()
+{
+    QByteArray data("definitely not a stroke recording");
+
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+
+    KisStrokeRecording recording;
+    QVERIFY(!recording.load(&buffer));
+    QVERIFY(recording.isEmpty());
+}
+
+QTEST_MAIN(KisStrokeRecordingTest)
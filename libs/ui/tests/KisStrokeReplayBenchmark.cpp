@@ -0,0 +1,338 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisStrokeReplayBenchmark.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+
+#include <KoColor.h>
+#include <KoResourcePaths.h>
+#include <brushengine/kis_paintop_preset.h>
+
+#include "stroke_testing_utils.h"
+#include "strokes/freehand_stroke.h"
+#include "strokes/KisFreehandStrokeInfo.h"
+#include "KisAsyncronousStrokeUpdateHelper.h"
+#include "KisRunnableStrokeJobData.h"
+#include "KisStrokeRecording.h"
+#include "kis_canvas_resource_provider.h"
+#include "kis_memory_statistics_server.h"
+#include "kis_resources_snapshot.h"
+#include "kis_image.h"
+#include "kis_paint_device.h"
+#include "kis_timing_information.h"
+
+
+namespace {
+
+struct ReplayResult
+{
+    int numDabs = 0;
+    qint64 strokeTime = 0;
+
+    qreal meanLatency = 0.0;
+    qint64 maxLatency = 0;
+
+    qint64 peakMemory = 0;
+    qint64 historicalMemory = 0;
+
+    QImage image;
+};
+
+/**
+ * Measures the time between submitting an event into the stroke and
+ * the moment the projection containing the end point of the event is
+ * updated. Updates are reported from the worker threads.
+ */
+class LatencyCollector
+{
+public:
+    void addPendingEvent(const QPointF &pos, qint64 time) {
+        QMutexLocker l(&m_mutex);
+        m_pendingEvents.append(qMakePair(pos, time));
+    }
+
+    void reportUpdate(const QRect &rc, qint64 time) {
+        QMutexLocker l(&m_mutex);
+
+        auto it = m_pendingEvents.begin();
+        while (it != m_pendingEvents.end()) {
+            if (rc.contains(it->first.toPoint())) {
+                const qint64 latency = time - it->second;
+
+                m_totalLatency += latency;
+                m_maxLatency = qMax(m_maxLatency, latency);
+                m_numEvents++;
+
+                it = m_pendingEvents.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    qreal meanLatency() const {
+        return m_numEvents ? qreal(m_totalLatency) / m_numEvents : 0.0;
+    }
+
+    qint64 maxLatency() const {
+        return m_maxLatency;
+    }
+
+private:
+    QMutex m_mutex;
+    QVector<QPair<QPointF, qint64>> m_pendingEvents;
+    qint64 m_totalLatency = 0;
+    qint64 m_maxLatency = 0;
+    int m_numEvents = 0;
+};
+
+KisStrokeJobData* createJob(const KisStrokeRecording::Event &event)
+{
+    switch (event.type) {
+    case KisStrokeRecording::Event::PAINT_AT:
+        return new FreehandStrokeStrategy::Data(event.strokeInfoId, event.pi1);
+    case KisStrokeRecording::Event::PAINT_LINE:
+        return new FreehandStrokeStrategy::Data(event.strokeInfoId, event.pi1, event.pi2);
+    case KisStrokeRecording::Event::PAINT_BEZIER_CURVE:
+        return new FreehandStrokeStrategy::Data(event.strokeInfoId,
+                                                event.pi1, event.control1, event.control2, event.pi2);
+    }
+
+    return 0;
+}
+
+QPointF eventEndPoint(const KisStrokeRecording::Event &event)
+{
+    return event.type == KisStrokeRecording::Event::PAINT_AT ? event.pi1.pos() : event.pi2.pos();
+}
+
+/**
+ * Replays \p recording with \p preset on a new image. When \p paced is
+ * true, the events are submitted with the same timing as they were
+ * recorded with and the update latency is measured, otherwise all the
+ * events are submitted at once to measure the throughput of the paintop.
+ */
+ReplayResult replayStroke(const KisStrokeRecording &recording, KisPaintOpPresetSP preset, bool paced)
+{
+    ReplayResult result;
+
+    const int margin = 500;
+    const QRect strokeRect = recording.bounds().toAlignedRect();
+    const QSize imageSize(qMax(strokeRect.right(), 0) + margin,
+                          qMax(strokeRect.bottom(), 0) + margin);
+
+    KisImageSP image = utils::createImage(0, imageSize);
+    QScopedPointer<KoCanvasResourceProvider> manager(utils::createResourceManager(image, 0, QString()));
+
+    QVariant i;
+    i.setValue(preset);
+    manager->setResource(KisCanvasResourceProvider::CurrentPaintOpPreset, i);
+
+    KoColor paintColor = recording.paintColor();
+    paintColor.convertTo(image->colorSpace());
+    i.setValue(paintColor);
+    manager->setResource(KoCanvasResourceProvider::ForegroundColor, i);
+
+    KisNodeSP node = image->root()->firstChild();
+    KisResourcesSnapshotSP resources = new KisResourcesSnapshot(image, node, manager.data());
+
+    // the same intervals as KisToolFreehandHelper uses
+    KisDistanceInitInfo startDistInfo(recording.startPos(),
+                                      recording.startAngle(),
+                                      resources->needsSpacingUpdates() ? 50.0 : LONG_TIME,
+                                      resources->needsAirbrushing() ? 50.0 : LONG_TIME,
+                                      0);
+    const KisDistanceInformation startDist = startDistInfo.makeDistInfo();
+
+    QVector<KisFreehandStrokeInfo*> strokeInfos;
+    for (int i = 0; i < recording.numStrokeInfos(); i++) {
+        strokeInfos << new KisFreehandStrokeInfo(startDist);
+    }
+
+    FreehandStrokeStrategy *stroke =
+        new FreehandStrokeStrategy(resources, strokeInfos, kundo2_noi18n("Replayed Stroke"));
+    stroke->setRandomSeed(recording.randomSeed());
+
+    QElapsedTimer timer;
+    LatencyCollector latency;
+
+    QMetaObject::Connection updatesConnection;
+
+    if (paced) {
+        updatesConnection =
+            QObject::connect(image.data(), &KisImage::sigImageUpdated, image.data(),
+                             [&latency, &timer] (const QRect &rc) {
+                                 latency.reportUpdate(rc, timer.elapsed());
+                             },
+                             Qt::DirectConnection);
+    }
+
+    /**
+     * The freehand helper emits asynchronous updates on a timer, here we
+     * just request them after every event
+     */
+    const bool needsAsynchronousUpdates = resources->presetNeedsAsynchronousUpdates();
+
+    timer.start();
+    KisStrokeId strokeId = image->startStroke(stroke);
+
+    Q_FOREACH (const KisStrokeRecording::Event &event, recording.events()) {
+        if (paced) {
+            const qint64 delay = qRound64(event.time()) - timer.elapsed();
+            if (delay > 0) {
+                QThread::msleep(delay);
+            }
+
+            latency.addPendingEvent(eventEndPoint(event), timer.elapsed());
+        }
+
+        image->addJob(strokeId, createJob(event));
+
+        if (paced && needsAsynchronousUpdates) {
+            image->addJob(strokeId, new KisAsyncronousStrokeUpdateHelper::UpdateData(false));
+        }
+
+        if (paced) {
+            const KisMemoryStatisticsServer::Statistics stats =
+                KisMemoryStatisticsServer::instance()->fetchMemoryStatistics(image);
+            result.peakMemory = qMax(result.peakMemory, stats.realMemorySize);
+        }
+    }
+
+    image->addJob(strokeId, new KisAsyncronousStrokeUpdateHelper::UpdateData(true));
+
+    int numDabs = 0;
+    image->addJob(strokeId,
+                  new KisRunnableStrokeJobData(
+                      [strokeInfos, &numDabs] () {
+                          Q_FOREACH (KisFreehandStrokeInfo *info, strokeInfos) {
+                              numDabs += info->dragDistance->currentDabSeqNo();
+                          }
+                      }));
+
+    image->endStroke(strokeId);
+    image->waitForDone();
+
+    result.strokeTime = timer.elapsed();
+    result.numDabs = numDabs;
+    result.meanLatency = latency.meanLatency();
+    result.maxLatency = latency.maxLatency();
+
+    QObject::disconnect(updatesConnection);
+
+    const KisMemoryStatisticsServer::Statistics stats =
+        KisMemoryStatisticsServer::instance()->fetchMemoryStatistics(image);
+    result.peakMemory = qMax(result.peakMemory, stats.realMemorySize);
+    result.historicalMemory = stats.historicalMemorySize;
+
+    result.image = node->paintDevice()->convertToQImage(0, 0, 0, image->width(), image->height());
+
+    return result;
+}
+
+QStringList recordingDirectories()
+{
+    QStringList dirs;
+
+    const QString envDirs = QString::fromLocal8Bit(qgetenv("KRITA_STROKE_RECORDINGS"));
+    if (!envDirs.isEmpty()) {
+        dirs << envDirs.split(QDir::listSeparator(), QString::SkipEmptyParts);
+    }
+
+    dirs << QString(FILES_DATA_DIR) + QDir::separator() + "stroke_recordings";
+
+    return dirs;
+}
+
+}
+
+void KisStrokeReplayBenchmark::initTestCase()
+{
+    KoResourcePaths::addResourceType("kis_brushes", "data", FILES_DATA_DIR);
+}
+
+void KisStrokeReplayBenchmark::testReplay_data()
+{
+    QTest::addColumn<QString>("fileName");
+
+    int numRecordings = 0;
+
+    Q_FOREACH (const QString &path, recordingDirectories()) {
+        QDir dir(path);
+
+        Q_FOREACH (const QFileInfo &info, dir.entryInfoList(QStringList() << "*.kstroke", QDir::Files, QDir::Name)) {
+            QTest::newRow(qPrintable(info.fileName())) << info.absoluteFilePath();
+            numRecordings++;
+        }
+    }
+
+    if (!numRecordings) {
+        QSKIP("No stroke recordings found, set KRITA_STROKE_RECORDINGS to a directory with *.kstroke files");
+    }
+}
+
+void KisStrokeReplayBenchmark::testReplay()
+{
+    QFETCH(QString, fileName);
+
+    KisStrokeRecording recording;
+    QVERIFY(recording.load(fileName));
+
+    KisPaintOpPresetSP preset;
+
+    const QString presetOverride = QString::fromLocal8Bit(qgetenv("KRITA_STROKE_REPLAY_PRESET"));
+    if (!presetOverride.isEmpty()) {
+        preset = new KisPaintOpPreset(presetOverride);
+        QVERIFY(preset->load());
+    } else {
+        preset = recording.createPreset();
+        QVERIFY(preset);
+    }
+
+    /**
+     * The first run warms up the caches of the brushes and the tile
+     * pool, it is also used as a reference for the determinism check
+     */
+    const ReplayResult reference = replayStroke(recording, preset->clone(), false);
+    const ReplayResult unpaced = replayStroke(recording, preset->clone(), false);
+
+    QCOMPARE(unpaced.numDabs, reference.numDabs);
+    QVERIFY(unpaced.image == reference.image);
+
+    const ReplayResult paced = replayStroke(recording, preset->clone(), true);
+
+    qDebug() << qPrintable(
+        QString("%1 (%2): %3 dabs, %4 ms, %5 dabs/s, latency %6 ms (max %7 ms), memory %8 KiB (history %9 KiB)")
+            .arg(QFileInfo(fileName).fileName())
+            .arg(preset->name())
+            .arg(unpaced.numDabs)
+            .arg(unpaced.strokeTime)
+            .arg(unpaced.strokeTime ? 1000.0 * unpaced.numDabs / unpaced.strokeTime : 0.0, 0, 'f', 1)
+            .arg(paced.meanLatency, 0, 'f', 1)
+            .arg(paced.maxLatency)
+            .arg(paced.peakMemory / 1024)
+            .arg(paced.historicalMemory / 1024));
+}
+
+QTEST_MAIN(KisStrokeReplayBenchmark)
@@ -0,0 +1,45 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISSTROKEREPLAYBENCHMARK_H
+#define KISSTROKEREPLAYBENCHMARK_H
+
+#include <QtTest>
+
+/**
+ * Replays the strokes recorded with KisToolFreehandHelper (see
+ * KisConfig::strokeRecordingLocation()) and reports the painting speed,
+ * update latency and memory consumption for each of them.
+ *
+ * The recordings are searched in the directories listed in
+ * KRITA_STROKE_RECORDINGS environment variable and in
+ * data/stroke_recordings. KRITA_STROKE_REPLAY_PRESET can be set to
+ * a .kpp file to replay all the strokes with that preset instead of
+ * the recorded ones.
+ */
+class KisStrokeReplayBenchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+
+    void testReplay_data();
+    void testReplay();
+};
+
+#endif // KISSTROKEREPLAYBENCHMARK_H
@@ -0,0 +1,156 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisStrokePredictor.h"
+
+#include <boost/circular_buffer.hpp>
+#include <QPointF>
+
+#include "kis_global.h"
+
+#define MAX_PREDICTION_HISTORY 16
+#define VELOCITY_WINDOW 50.0
+
+
+struct KisStrokePredictor::Private
+{
+    Private(int historySize)
+        : samples(historySize)
+    {
+    }
+
+    struct Sample {
+        Sample()
+            : time(0)
+        {
+        }
+
+        Sample(const QPointF &_pos, qreal _time)
+            : pos(_pos), time(_time)
+        {
+        }
+
+        QPointF pos;
+        qreal time;
+    };
+
+    typedef boost::circular_buffer<Sample> SampleBuffer;
+    SampleBuffer samples;
+};
+
+
+KisStrokePredictor::KisStrokePredictor()
+    : m_d(new Private(MAX_PREDICTION_HISTORY))
+{
+}
+
+KisStrokePredictor::~KisStrokePredictor()
+{
+}
+
+void KisStrokePredictor::reset()
+{
+    m_d->samples.clear();
+}
+
+void KisStrokePredictor::addSample(const QPointF &pos, qreal time)
+{
+    /**
+     * High resolution tablet events may share the same timestamp,
+     * only the latest of them is meaningful for the fit
+     */
+    if (!m_d->samples.empty() && m_d->samples.back().time >= time) {
+        m_d->samples.back().pos = pos;
+        return;
+    }
+
+    m_d->samples.push_back(Private::Sample(pos, time));
+}
+
+bool KisStrokePredictor::isEmpty() const
+{
+    return m_d->samples.empty();
+}
+
+QPointF KisStrokePredictor::lastPosition() const
+{
+    return !m_d->samples.empty() ? m_d->samples.back().pos : QPointF();
+}
+
+qreal KisStrokePredictor::fitWindow()
+{
+    return VELOCITY_WINDOW;
+}
+
+QPointF KisStrokePredictor::predictedPosition(qreal horizon) const
+{
+    if (m_d->samples.size() < 2 || horizon <= 0) {
+        return lastPosition();
+    }
+
+    const Private::Sample &last = m_d->samples.back();
+
+    Private::SampleBuffer::const_reverse_iterator it = m_d->samples.rbegin();
+    Private::SampleBuffer::const_reverse_iterator end = m_d->samples.rend();
+
+    int numSamples = 0;
+    qreal sumTime = 0;
+    QPointF sumPos;
+
+    for (; it != end && last.time - it->time <= VELOCITY_WINDOW; ++it) {
+        sumTime += it->time;
+        sumPos += it->pos;
+        numSamples++;
+    }
+
+    if (numSamples < 2) {
+        return last.pos;
+    }
+
+    const qreal meanTime = sumTime / numSamples;
+    const QPointF meanPos = sumPos / numSamples;
+
+    qreal timeVariance = 0;
+    QPointF covariance;
+    qreal pathLength = 0;
+
+    it = m_d->samples.rbegin();
+    for (int i = 0; i < numSamples; i++, ++it) {
+        const qreal dt = it->time - meanTime;
+        timeVariance += pow2(dt);
+        covariance += dt * (it->pos - meanPos);
+
+        if (i > 0) {
+            pathLength += kisDistance(it->pos, (it - 1)->pos);
+        }
+    }
+
+    if (timeVariance <= 0) {
+        return last.pos;
+    }
+
+    const QPointF velocity = covariance / timeVariance;
+    QPointF offset = velocity * horizon;
+
+    const qreal offsetLength = kisDistance(QPointF(), offset);
+    if (offsetLength > pathLength) {
+        offset *= pathLength / offsetLength;
+    }
+
+    return last.pos + offset;
+}
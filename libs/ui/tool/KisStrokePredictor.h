@@ -0,0 +1,81 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISSTROKEPREDICTOR_H
+#define KISSTROKEPREDICTOR_H
+
+#include <QScopedPointer>
+#include <QtGlobal>
+
+#include "kritaui_export.h"
+
+class QPointF;
+
+/**
+ * Extrapolates the position of the stylus from the recent input events.
+ *
+ * The velocity is estimated with a least squares fit over the events of
+ * the last few dozens of milliseconds, which makes it robust to the jitter
+ * of the event timestamps. The extrapolated offset is never longer than the
+ * path travelled inside the fitting window, so the prediction doesn't
+ * overshoot much when the stylus stops abruptly.
+ *
+ * KisSpeedSmoother and KisStrokeSpeedMeasurer are not reused here: they
+ * only provide the magnitude of the speed, and the former also lags behind
+ * the stylus on purpose, while the prediction needs the current direction.
+ *
+ * The predictor is used for drawing a provisional preview of the stroke
+ * ahead of the real dabs, which are delayed by smoothing and by the
+ * update pipeline.
+ */
+class KRITAUI_EXPORT KisStrokePredictor
+{
+public:
+    KisStrokePredictor();
+    ~KisStrokePredictor();
+
+    void reset();
+
+    /**
+     * Adds an input event at \p pos that happened at \p time (in
+     * milliseconds since the start of the stroke)
+     */
+    void addSample(const QPointF &pos, qreal time);
+
+    bool isEmpty() const;
+    QPointF lastPosition() const;
+
+    /**
+     * \return the expected position of the stylus \p horizon
+     * milliseconds after the last added sample
+     */
+    QPointF predictedPosition(qreal horizon) const;
+
+    /**
+     * \return the time span (in milliseconds) of the most recent samples
+     * the velocity is fitted on. A prediction is stale when no new
+     * sample arrived during this period.
+     */
+    static qreal fitWindow();
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif // KISSTROKEPREDICTOR_H
@@ -0,0 +1,433 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisStrokeRecording.h"
+
+#include <QBuffer>
+#include <QDataStream>
+#include <QDomDocument>
+#include <QFile>
+#include <QSaveFile>
+
+#include <brushengine/kis_paintop_preset.h>
+
+#include "kis_algebra_2d.h"
+#include "kis_debug.h"
+
+namespace {
+
+/**
+ * File layout: magic, format version and a zlib-compressed payload
+ * written with QDataStream. The payload is versioned by the header
+ * only, so any change in it must bump the version.
+ */
+const quint32 recordingMagic = 0x4B53524B; // "KSRK"
+const quint32 recordingVersion = 1;
+const QDataStream::Version streamVersion = QDataStream::Qt_5_9;
+
+void writePaintInfo(QDataStream &stream, const KisPaintInformation &pi)
+{
+    stream << pi.pos()
+           << pi.pressure()
+           << pi.xTilt()
+           << pi.yTilt()
+           << pi.rotation()
+           << pi.tangentialPressure()
+           << pi.perspective()
+           << pi.currentTime()
+           << pi.drawingSpeed()
+           << pi.canvasRotation()
+           << pi.canvasMirroredH()
+           << pi.canvasMirroredV();
+}
+
+KisPaintInformation readPaintInfo(QDataStream &stream)
+{
+    QPointF pos;
+    qreal pressure = 0.0;
+    qreal xTilt = 0.0;
+    qreal yTilt = 0.0;
+    qreal rotation = 0.0;
+    qreal tangentialPressure = 0.0;
+    qreal perspective = 0.0;
+    qreal time = 0.0;
+    qreal speed = 0.0;
+    qreal canvasRotation = 0.0;
+    bool canvasMirroredH = false;
+    bool canvasMirroredV = false;
+
+    stream >> pos
+           >> pressure
+           >> xTilt
+           >> yTilt
+           >> rotation
+           >> tangentialPressure
+           >> perspective
+           >> time
+           >> speed
+           >> canvasRotation
+           >> canvasMirroredH
+           >> canvasMirroredV;
+
+    KisPaintInformation pi(pos, pressure, xTilt, yTilt,
+                           rotation, tangentialPressure, perspective,
+                           time, speed);
+    pi.setCanvasRotation(canvasRotation);
+    pi.setCanvasMirroredH(canvasMirroredH);
+    pi.setCanvasMirroredV(canvasMirroredV);
+
+    return pi;
+}
+
+}
+
+qreal KisStrokeRecording::Event::time() const
+{
+    return type == PAINT_AT ? pi1.currentTime() : pi2.currentTime();
+}
+
+struct KisStrokeRecording::Private
+{
+    QString presetXml;
+    QString presetName;
+    KoColor paintColor;
+    QPointF startPos;
+    qreal startAngle = 0.0;
+    int numStrokeInfos = 1;
+    int randomSeed = 0;
+
+    QVector<Event> events;
+};
+
+KisStrokeRecording::KisStrokeRecording()
+    : m_d(new Private)
+{
+}
+
+KisStrokeRecording::KisStrokeRecording(const KisStrokeRecording &rhs)
+    : m_d(new Private(*rhs.m_d))
+{
+}
+
+KisStrokeRecording &KisStrokeRecording::operator=(const KisStrokeRecording &rhs)
+{
+    if (&rhs != this) {
+        *m_d = *rhs.m_d;
+    }
+
+    return *this;
+}
+
+KisStrokeRecording::~KisStrokeRecording()
+{
+}
+
+void KisStrokeRecording::start(KisPaintOpPresetSP preset,
+                               const KoColor &paintColor,
+                               const QPointF &startPos,
+                               qreal startAngle,
+                               int numStrokeInfos,
+                               int randomSeed)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(preset);
+
+    m_d->events.clear();
+
+    /**
+     * KisPaintOpPreset::toXML() sanitizes the settings of the preset,
+     * so we should not call it on the preset that is used for painting
+     */
+    QDomDocument doc;
+    QDomElement root = doc.createElement("Preset");
+    preset->clone()->toXML(doc, root);
+    doc.appendChild(root);
+
+    m_d->presetXml = doc.toString();
+    m_d->presetName = preset->name();
+    m_d->paintColor = paintColor;
+    m_d->startPos = startPos;
+    m_d->startAngle = startAngle;
+    m_d->numStrokeInfos = numStrokeInfos;
+    m_d->randomSeed = randomSeed;
+}
+
+void KisStrokeRecording::addPaintAt(int strokeInfoId, const KisPaintInformation &pi)
+{
+    Event event;
+    event.type = Event::PAINT_AT;
+    event.strokeInfoId = strokeInfoId;
+    event.pi1 = pi;
+
+    m_d->events.append(event);
+}
+
+void KisStrokeRecording::addPaintLine(int strokeInfoId,
+                                      const KisPaintInformation &pi1,
+                                      const KisPaintInformation &pi2)
+{
+    Event event;
+    event.type = Event::PAINT_LINE;
+    event.strokeInfoId = strokeInfoId;
+    event.pi1 = pi1;
+    event.pi2 = pi2;
+
+    m_d->events.append(event);
+}
+
+void KisStrokeRecording::addPaintBezierCurve(int strokeInfoId,
+                                             const KisPaintInformation &pi1,
+                                             const QPointF &control1,
+                                             const QPointF &control2,
+                                             const KisPaintInformation &pi2)
+{
+    Event event;
+    event.type = Event::PAINT_BEZIER_CURVE;
+    event.strokeInfoId = strokeInfoId;
+    event.pi1 = pi1;
+    event.pi2 = pi2;
+    event.control1 = control1;
+    event.control2 = control2;
+
+    m_d->events.append(event);
+}
+
+bool KisStrokeRecording::isEmpty() const
+{
+    return m_d->events.isEmpty();
+}
+
+const QVector<KisStrokeRecording::Event> &KisStrokeRecording::events() const
+{
+    return m_d->events;
+}
+
+KisPaintOpPresetSP KisStrokeRecording::createPreset() const
+{
+    QDomDocument doc;
+    if (!doc.setContent(m_d->presetXml)) {
+        return KisPaintOpPresetSP();
+    }
+
+    KisPaintOpPresetSP preset(new KisPaintOpPreset());
+    preset->fromXML(doc.documentElement());
+
+    return preset->valid() ? preset : KisPaintOpPresetSP();
+}
+
+QString KisStrokeRecording::presetName() const
+{
+    return m_d->presetName;
+}
+
+KoColor KisStrokeRecording::paintColor() const
+{
+    return m_d->paintColor;
+}
+
+QPointF KisStrokeRecording::startPos() const
+{
+    return m_d->startPos;
+}
+
+qreal KisStrokeRecording::startAngle() const
+{
+    return m_d->startAngle;
+}
+
+int KisStrokeRecording::numStrokeInfos() const
+{
+    return m_d->numStrokeInfos;
+}
+
+int KisStrokeRecording::randomSeed() const
+{
+    return m_d->randomSeed;
+}
+
+qreal KisStrokeRecording::duration() const
+{
+    return !m_d->events.isEmpty() ? m_d->events.last().time() : 0.0;
+}
+
+QRectF KisStrokeRecording::bounds() const
+{
+    QRectF rect;
+
+    Q_FOREACH (const Event &event, m_d->events) {
+        KisAlgebra2D::accumulateBounds(event.pi1.pos(), &rect);
+
+        if (event.type != Event::PAINT_AT) {
+            KisAlgebra2D::accumulateBounds(event.pi2.pos(), &rect);
+        }
+
+        if (event.type == Event::PAINT_BEZIER_CURVE) {
+            KisAlgebra2D::accumulateBounds(event.control1, &rect);
+            KisAlgebra2D::accumulateBounds(event.control2, &rect);
+        }
+    }
+
+    return rect;
+}
+
+bool KisStrokeRecording::save(const QString &fileName) const
+{
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        warnKrita << "Could not open the stroke recording for writing" << fileName;
+        return false;
+    }
+
+    return save(&file) && file.commit();
+}
+
+bool KisStrokeRecording::save(QIODevice *device) const
+{
+    QByteArray payload;
+
+    {
+        QBuffer buffer(&payload);
+        buffer.open(QIODevice::WriteOnly);
+
+        QDataStream stream(&buffer);
+        stream.setVersion(streamVersion);
+
+        stream << m_d->presetXml
+               << m_d->presetName
+               << m_d->paintColor.toXML()
+               << m_d->startPos
+               << m_d->startAngle
+               << qint32(m_d->numStrokeInfos)
+               << qint32(m_d->randomSeed)
+               << quint32(m_d->events.size());
+
+        Q_FOREACH (const Event &event, m_d->events) {
+            stream << quint8(event.type) << qint32(event.strokeInfoId);
+
+            writePaintInfo(stream, event.pi1);
+
+            if (event.type != Event::PAINT_AT) {
+                writePaintInfo(stream, event.pi2);
+            }
+
+            if (event.type == Event::PAINT_BEZIER_CURVE) {
+                stream << event.control1 << event.control2;
+            }
+        }
+    }
+
+    QDataStream stream(device);
+    stream.setVersion(streamVersion);
+    stream << recordingMagic << recordingVersion << qCompress(payload);
+
+    return stream.status() == QDataStream::Ok;
+}
+
+bool KisStrokeRecording::load(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        warnKrita << "Could not open the stroke recording" << fileName;
+        return false;
+    }
+
+    return load(&file);
+}
+
+bool KisStrokeRecording::load(QIODevice *device)
+{
+    QDataStream header(device);
+    header.setVersion(streamVersion);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    header >> magic >> version;
+
+    if (magic != recordingMagic || version != recordingVersion) {
+        warnKrita << "Unsupported stroke recording format" << QString::number(magic, 16) << version;
+        return false;
+    }
+
+    QByteArray compressedPayload;
+    header >> compressedPayload;
+
+    QByteArray payload = qUncompress(compressedPayload);
+    if (header.status() != QDataStream::Ok || payload.isEmpty()) {
+        warnKrita << "Stroke recording is corrupted";
+        return false;
+    }
+
+    QDataStream stream(payload);
+    stream.setVersion(streamVersion);
+
+    Private data;
+
+    QString paintColorXml;
+    qint32 numStrokeInfos = 0;
+    qint32 randomSeed = 0;
+    quint32 numEvents = 0;
+
+    stream >> data.presetXml
+           >> data.presetName
+           >> paintColorXml
+           >> data.startPos
+           >> data.startAngle
+           >> numStrokeInfos
+           >> randomSeed
+           >> numEvents;
+
+    data.paintColor = KoColor::fromXML(paintColorXml);
+    data.numStrokeInfos = numStrokeInfos;
+    data.randomSeed = randomSeed;
+
+    for (quint32 i = 0; i < numEvents && stream.status() == QDataStream::Ok; i++) {
+        quint8 type = 0;
+        qint32 strokeInfoId = 0;
+
+        stream >> type >> strokeInfoId;
+
+        if (type > Event::PAINT_BEZIER_CURVE ||
+            strokeInfoId < 0 || strokeInfoId >= numStrokeInfos) {
+
+            warnKrita << "Stroke recording contains an invalid event" << i;
+            return false;
+        }
+
+        Event event;
+        event.type = Event::Type(type);
+        event.strokeInfoId = strokeInfoId;
+        event.pi1 = readPaintInfo(stream);
+
+        if (event.type != Event::PAINT_AT) {
+            event.pi2 = readPaintInfo(stream);
+        }
+
+        if (event.type == Event::PAINT_BEZIER_CURVE) {
+            stream >> event.control1 >> event.control2;
+        }
+
+        data.events.append(event);
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        warnKrita << "Stroke recording is truncated";
+        return false;
+    }
+
+    *m_d = data;
+    return true;
+}
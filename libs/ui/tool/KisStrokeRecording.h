@@ -0,0 +1,138 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISSTROKERECORDING_H
+#define KISSTROKERECORDING_H
+
+#include <QPointF>
+#include <QRectF>
+#include <QScopedPointer>
+#include <QVector>
+
+#include <KoColor.h>
+#include <brushengine/kis_paint_information.h>
+
+#include "kis_types.h"
+#include "kritaui_export.h"
+
+class QIODevice;
+
+/**
+ * A compact record of a freehand stroke: the preset, the paint color, the
+ * random seed and the stream of paint information the freehand helper
+ * sent to FreehandStrokeStrategy.
+ *
+ * The events are recorded after smoothing and stabilization, so replaying
+ * them reproduces the stroke exactly as it was painted (the random sources
+ * of the stroke are seeded with randomSeed()). The preset can also be
+ * replaced with any other one to measure how another paintop handles the
+ * same input.
+ *
+ * The recordings are saved in a versioned binary format, see save().
+ */
+class KRITAUI_EXPORT KisStrokeRecording
+{
+public:
+    struct Event {
+        enum Type {
+            PAINT_AT = 0,
+            PAINT_LINE,
+            PAINT_BEZIER_CURVE
+        };
+
+        Type type = PAINT_AT;
+        int strokeInfoId = 0;
+
+        KisPaintInformation pi1;
+        KisPaintInformation pi2;
+        QPointF control1;
+        QPointF control2;
+
+        /**
+         * The time when the event was generated, in milliseconds
+         * since the start of the stroke
+         */
+        qreal time() const;
+    };
+
+public:
+    KisStrokeRecording();
+    KisStrokeRecording(const KisStrokeRecording &rhs);
+    KisStrokeRecording& operator=(const KisStrokeRecording &rhs);
+    ~KisStrokeRecording();
+
+    /**
+     * Resets the recording and stores the state the stroke was started in
+     */
+    void start(KisPaintOpPresetSP preset,
+               const KoColor &paintColor,
+               const QPointF &startPos,
+               qreal startAngle,
+               int numStrokeInfos,
+               int randomSeed);
+
+    void addPaintAt(int strokeInfoId, const KisPaintInformation &pi);
+    void addPaintLine(int strokeInfoId,
+                      const KisPaintInformation &pi1,
+                      const KisPaintInformation &pi2);
+    void addPaintBezierCurve(int strokeInfoId,
+                             const KisPaintInformation &pi1,
+                             const QPointF &control1,
+                             const QPointF &control2,
+                             const KisPaintInformation &pi2);
+
+    bool isEmpty() const;
+    const QVector<Event>& events() const;
+
+    /**
+     * \return a new preset restored from the recording. The paintop of
+     * the preset must be registered in KisPaintOpRegistry, otherwise null
+     * is returned.
+     */
+    KisPaintOpPresetSP createPreset() const;
+    QString presetName() const;
+
+    KoColor paintColor() const;
+    QPointF startPos() const;
+    qreal startAngle() const;
+    int numStrokeInfos() const;
+    int randomSeed() const;
+
+    /**
+     * \return the duration of the stroke in milliseconds
+     */
+    qreal duration() const;
+
+    /**
+     * \return the rect covered by the positions of the events (and
+     * the control points of the curves)
+     */
+    QRectF bounds() const;
+
+    bool save(const QString &fileName) const;
+    bool save(QIODevice *device) const;
+
+    bool load(const QString &fileName);
+    bool load(QIODevice *device);
+
+private:
+    struct Private;
+    QScopedPointer<Private> m_d;
+};
+
+#endif // KISSTROKERECORDING_H
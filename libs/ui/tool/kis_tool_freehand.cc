@@ -29,12 +29,14 @@
 #include <QApplication>
 #include <QDesktopWidget>
 #include <QScreen>
+#include <QtMath>
 
 #include <Eigen/Core>
 
 #include <kis_icon.h>
 #include <KoPointerEvent.h>
 #include <KoViewConverter.h>
+#include <KoCanvasResourceProvider.h>
 #include <KoCanvasController.h>
 
 //pop up palette
@@ -52,12 +54,14 @@
 // Krita/ui
 #include "kis_abstract_perspective_grid.h"
 #include "kis_config.h"
+#include "kis_global.h"
 #include "canvas/kis_canvas2.h"
 #include "kis_cursor.h"
 #include <KisViewManager.h>
 #include <kis_painting_assistants_decoration.h>
 #include "kis_painting_information_builder.h"
 #include "kis_tool_freehand_helper.h"
+#include "KisStrokePredictor.h"
 #include "strokes/freehand_stroke.h"
 
 using namespace std::placeholders; // For _1 placeholder
@@ -79,6 +83,10 @@ KisToolFreehand::KisToolFreehand(KoCanvasBase * canvas, const QCursor & cursor,
     m_helper = new KisToolFreehandHelper(m_infoBuilder, transactionText);
 
     connect(m_helper, SIGNAL(requestExplicitUpdateOutline()), SLOT(explicitUpdateOutline()));
+
+    m_predictedStrokeExpiryTimer.setSingleShot(true);
+    m_predictedStrokeExpiryTimer.setInterval(qCeil(KisStrokePredictor::fitWindow()));
+    connect(&m_predictedStrokeExpiryTimer, SIGNAL(timeout()), SLOT(clearPredictedStroke()));
 }
 
 KisToolFreehand::~KisToolFreehand()
@@ -162,9 +170,16 @@ void KisToolFreehand::deactivate()
         endStroke();
         setMode(KisTool::HOVER_MODE);
     }
+    clearPredictedStroke();
     KisToolPaint::deactivate();
 }
 
+void KisToolFreehand::requestStrokeCancellation()
+{
+    clearPredictedStroke();
+    KisToolPaint::requestStrokeCancellation();
+}
+
 void KisToolFreehand::initStroke(KoPointerEvent *event)
 {
     m_helper->initPaint(event,
@@ -234,6 +249,7 @@ void KisToolFreehand::continuePrimaryAction(KoPointerEvent *event)
      * Actual painting
      */
     doStroke(event);
+    updatePredictedStroke();
 }
 
 void KisToolFreehand::endPrimaryAction(KoPointerEvent *event)
@@ -242,6 +258,7 @@ void KisToolFreehand::endPrimaryAction(KoPointerEvent *event)
     CHECK_MODE_SANITY_OR_RETURN(KisTool::PAINT_MODE);
 
     endStroke();
+    updatePredictedStroke();
 
     if (m_assistant && static_cast<KisCanvas2*>(canvas())->paintingAssistantsDecoration()) {
         static_cast<KisCanvas2*>(canvas())->paintingAssistantsDecoration()->endStroke();
@@ -436,6 +453,72 @@ qreal KisToolFreehand::calculatePerspective(const QPointF &documentPoint)
     return perspective;
 }
 
+void KisToolFreehand::updatePredictedStroke()
+{
+    m_predictedStrokePath = m_helper->predictedStrokePath();
+
+    QRectF predictedStrokeDocRect;
+
+    if (!m_predictedStrokePath.isEmpty() && currentPaintOpPreset()) {
+        // one extra pixel for antialiasing
+        const qreal radius = 0.5 * currentPaintOpPreset()->settings()->paintOpSize() + 1.0;
+        predictedStrokeDocRect = currentImage()->pixelToDocument(
+            m_predictedStrokePath.boundingRect().adjusted(-radius, -radius, radius, radius));
+    }
+
+    if (!m_oldPredictedStrokeDocRect.isEmpty()) {
+        canvas()->updateCanvas(m_oldPredictedStrokeDocRect);
+    }
+
+    if (!predictedStrokeDocRect.isEmpty()) {
+        canvas()->updateCanvas(predictedStrokeDocRect);
+    }
+
+    m_oldPredictedStrokeDocRect = predictedStrokeDocRect;
+
+    if (!m_predictedStrokePath.isEmpty()) {
+        m_predictedStrokeExpiryTimer.start();
+    } else {
+        m_predictedStrokeExpiryTimer.stop();
+    }
+}
+
+void KisToolFreehand::clearPredictedStroke()
+{
+    m_predictedStrokeExpiryTimer.stop();
+    m_predictedStrokePath = QPainterPath();
+
+    if (!m_oldPredictedStrokeDocRect.isEmpty()) {
+        canvas()->updateCanvas(m_oldPredictedStrokeDocRect);
+        m_oldPredictedStrokeDocRect = QRectF();
+    }
+}
+
+void KisToolFreehand::paint(QPainter &gc, const KoViewConverter &converter)
+{
+    /**
+     * The predicted part of the stroke is painted as a plain
+     * translucent line of the brush size. It is only a hint
+     * for the user, the real dabs will cover it soon.
+     */
+    if (!m_predictedStrokePath.isEmpty() && currentPaintOpPreset()) {
+        const qreal brushSize = currentPaintOpPreset()->settings()->paintOpSize();
+        const qreal viewBrushSize =
+            kisDistance(pixelToView(QPointF(brushSize, 0)), pixelToView(QPointF()));
+
+        QColor color = canvas()->resourceManager()->foregroundColor().toQColor();
+        color.setAlphaF(0.4 * color.alphaF());
+
+        gc.save();
+        gc.setRenderHint(QPainter::Antialiasing);
+        gc.setPen(QPen(color, qMax(1.0, viewBrushSize), Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
+        gc.drawPath(pixelToView(m_predictedStrokePath));
+        gc.restore();
+    }
+
+    KisToolPaint::paint(gc, converter);
+}
+
 void KisToolFreehand::explicitUpdateOutline()
 {
     requestUpdateOutline(m_outlineDocPoint, 0);
@@ -23,6 +23,8 @@
 #include <brushengine/kis_paintop_settings.h>
 #include <kis_distance_information.h>
 
+#include <QTimer>
+
 #include "kis_types.h"
 #include "kis_tool_paint.h"
 #include "kis_smoothing_options.h"
@@ -47,10 +49,12 @@ public:
     ~KisToolFreehand() override;
     int flags() const override;
     void mouseMoveEvent(KoPointerEvent *event) override;
+    void paint(QPainter &gc, const KoViewConverter &converter) override;
 
 public Q_SLOTS:
     void activate(ToolActivation toolActivation, const QSet<KoShape*> &shapes) override;
     void deactivate() override;
+    void requestStrokeCancellation() override;
 
 protected:
     bool tryPickByPaintOp(KoPointerEvent *event, AlternateAction action);
@@ -90,6 +94,14 @@ protected Q_SLOTS:
     void setOnlyOneAssistantSnap(bool assistant);
     void slotDoResizeBrush(qreal newSize);
 
+private Q_SLOTS:
+    /**
+     * Removes the predicted part of the stroke from the canvas. Called
+     * when the stroke is finished or cancelled and when the stylus
+     * stopped moving for longer than the predictor's fit window.
+     */
+    void clearPredictedStroke();
+
 private:
     friend class KisToolFreehandPaintingInformationBuilder;
 
@@ -105,6 +117,12 @@ private:
      */
     qreal calculatePerspective(const QPointF &documentPoint);
 
+    /**
+     * Fetches the predicted part of the stroke from the helper and
+     * requests the canvas update for its old and new areas
+     */
+    void updatePredictedStroke();
+
 protected:
     friend class KisViewManager;
     friend class KisView;
@@ -122,6 +140,10 @@ private:
     qreal m_lastPaintOpSize;
     QPoint m_initialGestureGlobalPoint;
 
+    QPainterPath m_predictedStrokePath;
+    QRectF m_oldPredictedStrokeDocRect;
+    QTimer m_predictedStrokeExpiryTimer;
+
     bool m_paintopBasedPickingInAction;
     KisSignalCompressorWithParam<qreal> m_brushResizeCompressor;
 };
@@ -20,6 +20,9 @@
 
 #include <QTimer>
 #include <QQueue>
+#include <QDateTime>
+#include <QDir>
+#include <QtConcurrent>
 
 #include <klocalizedstring.h>
 
@@ -37,6 +40,8 @@
 #include "kis_update_time_monitor.h"
 #include "kis_stabilized_events_sampler.h"
 #include "KisStabilizerDelayedPaintHelper.h"
+#include "KisStrokePredictor.h"
+#include "KisStrokeRecording.h"
 #include "kis_config.h"
 
 #include "kis_random_source.h"
@@ -111,6 +116,18 @@ struct KisToolFreehandHelper::Private
     KisStabilizedEventsSampler stabilizedSampler;
     KisStabilizerDelayedPaintHelper stabilizerDelayedPaintHelper;
 
+    // Predicted stroke preview data
+    bool usingPrediction = false;
+    int predictionTime = 0;
+    KisStrokePredictor predictor;
+    bool hasLastQueuedPos = false;
+    QPointF lastQueuedPos;
+
+    // Stroke recording for the replay benchmarks
+    bool recordingStroke = false;
+    QString recordingLocation;
+    KisStrokeRecording recording;
+
     qreal effectiveSmoothnessDistance() const;
 };
 
@@ -227,6 +244,26 @@ QPainterPath KisToolFreehandHelper::paintOpOutline(const QPointF &savedCursorPos
     return outline;
 }
 
+QPainterPath KisToolFreehandHelper::predictedStrokePath() const
+{
+    QPainterPath path;
+
+    if (!m_d->usingPrediction || !m_d->strokeId || m_d->predictor.isEmpty()) {
+        return path;
+    }
+
+    /**
+     * The multihand helper doesn't report the queued positions, so
+     * for it the preview covers the extrapolated part only
+     */
+    path.moveTo(m_d->hasLastQueuedPos ?
+                m_d->lastQueuedPos : m_d->predictor.lastPosition());
+    path.lineTo(m_d->predictor.lastPosition());
+    path.lineTo(m_d->predictor.predictedPosition(m_d->predictionTime));
+
+    return path;
+}
+
 void KisToolFreehandHelper::cursorMoved(const QPointF &cursorPos)
 {
     m_d->lastCursorPos.pushThroughHistory(cursorPos);
@@ -279,6 +316,19 @@ void KisToolFreehandHelper::initPaintImpl(qreal startAngle,
 
     m_d->previousPaintInformation = pi;
 
+    {
+        KisConfig cfg(true);
+        m_d->usingPrediction = cfg.predictStrokeInput();
+        m_d->predictionTime = cfg.strokePredictionTime();
+        m_d->recordingLocation = cfg.strokeRecordingLocation();
+    }
+    m_d->predictor.reset();
+    m_d->hasLastQueuedPos = false;
+
+    if (m_d->usingPrediction) {
+        m_d->predictor.addSample(pi.pos(), pi.currentTime());
+    }
+
     m_d->resources = new KisResourcesSnapshot(image,
                                               currentNode,
                                               resourceManager,
@@ -300,9 +350,22 @@ void KisToolFreehandHelper::initPaintImpl(qreal startAngle,
     createPainters(m_d->strokeInfos,
                    startDist);
 
-    KisStrokeStrategy *stroke =
+    FreehandStrokeStrategy *stroke =
         new FreehandStrokeStrategy(m_d->resources, m_d->strokeInfos, m_d->transactionText);
 
+    m_d->recordingStroke = !m_d->recordingLocation.isEmpty();
+    if (m_d->recordingStroke) {
+        const int seed = qrand();
+        stroke->setRandomSeed(seed);
+
+        m_d->recording.start(m_d->resources->currentPaintOpPreset(),
+                             m_d->resources->currentFgColor(),
+                             m_d->previousPaintInformation.pos(),
+                             startAngle,
+                             m_d->strokeInfos.size(),
+                             seed);
+    }
+
     m_d->strokeId = m_d->strokesFacade->startStroke(stroke);
 
     m_d->history.clear();
@@ -434,6 +497,10 @@ void KisToolFreehandHelper::paintEvent(KoPointerEvent *event)
                                              elapsedStrokeTime());
     KisUpdateTimeMonitor::instance()->reportMouseMove(info.pos());
 
+    if (m_d->usingPrediction) {
+        m_d->predictor.addSample(info.pos(), info.currentTime());
+    }
+
     paint(info);
 }
 
@@ -631,6 +698,10 @@ void KisToolFreehandHelper::endPaint()
 
     m_d->strokesFacade->endStroke(m_d->strokeId);
     m_d->strokeId.clear();
+
+    if (m_d->recordingStroke) {
+        saveStrokeRecording();
+    }
 }
 
 void KisToolFreehandHelper::cancelPaint()
@@ -661,6 +732,8 @@ void KisToolFreehandHelper::cancelPaint()
     m_d->strokesFacade->cancelStroke(m_d->strokeId);
     m_d->strokeId.clear();
 
+    m_d->recordingStroke = false;
+
 }
 
 int KisToolFreehandHelper::elapsedStrokeTime() const
@@ -889,6 +962,10 @@ void KisToolFreehandHelper::paintAt(int strokeInfoId,
     m_d->strokesFacade->addJob(m_d->strokeId,
                                new FreehandStrokeStrategy::Data(strokeInfoId, pi));
 
+    if (m_d->recordingStroke) {
+        m_d->recording.addPaintAt(strokeInfoId, pi);
+    }
+
 }
 
 void KisToolFreehandHelper::paintLine(int strokeInfoId,
@@ -899,6 +976,10 @@ void KisToolFreehandHelper::paintLine(int strokeInfoId,
     m_d->strokesFacade->addJob(m_d->strokeId,
                                new FreehandStrokeStrategy::Data(strokeInfoId, pi1, pi2));
 
+    if (m_d->recordingStroke) {
+        m_d->recording.addPaintLine(strokeInfoId, pi1, pi2);
+    }
+
 }
 
 void KisToolFreehandHelper::paintBezierCurve(int strokeInfoId,
@@ -936,6 +1017,39 @@ void KisToolFreehandHelper::paintBezierCurve(int strokeInfoId,
                                new FreehandStrokeStrategy::Data(strokeInfoId,
                                                                 pi1, control1, control2, pi2));
 
+    if (m_d->recordingStroke) {
+        m_d->recording.addPaintBezierCurve(strokeInfoId, pi1, control1, control2, pi2);
+    }
+
+}
+
+void KisToolFreehandHelper::saveStrokeRecording()
+{
+    m_d->recordingStroke = false;
+
+    const KisStrokeRecording recording = m_d->recording;
+    m_d->recording = KisStrokeRecording();
+
+    const QString location = m_d->recordingLocation;
+    const QString name =
+        QString("stroke-%1.kstroke")
+            .arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss-zzz"));
+
+    /**
+     * Compressing a long stroke and writing it to disk takes a while,
+     * so do it in the background not to stall the beginning of the
+     * next stroke. The recording keeps the preset serialized, so the
+     * copy doesn't share anything with the GUI thread.
+     */
+    QtConcurrent::run([recording, location, name] () {
+        QDir dir(location);
+        if (!dir.mkpath(".")) {
+            warnKrita << "Could not create the directory for stroke recordings" << location;
+            return;
+        }
+
+        recording.save(dir.filePath(name));
+    });
 }
 
 void KisToolFreehandHelper::createPainters(QVector<KisFreehandStrokeInfo*> &strokeInfos,
@@ -947,12 +1061,16 @@ void KisToolFreehandHelper::createPainters(QVector<KisFreehandStrokeInfo*> &stro
 void KisToolFreehandHelper::paintAt(const KisPaintInformation &pi)
 {
     paintAt(0, pi);
+    m_d->hasLastQueuedPos = true;
+    m_d->lastQueuedPos = pi.pos();
 }
 
 void KisToolFreehandHelper::paintLine(const KisPaintInformation &pi1,
                                       const KisPaintInformation &pi2)
 {
     paintLine(0, pi1, pi2);
+    m_d->hasLastQueuedPos = true;
+    m_d->lastQueuedPos = pi2.pos();
 }
 
 void KisToolFreehandHelper::paintBezierCurve(const KisPaintInformation &pi1,
@@ -961,4 +1079,6 @@ void KisToolFreehandHelper::paintBezierCurve(const KisPaintInformation &pi1,
                                              const KisPaintInformation &pi2)
 {
     paintBezierCurve(0, pi1, control1, control2, pi2);
+    m_d->hasLastQueuedPos = true;
+    m_d->lastQueuedPos = pi2.pos();
 }
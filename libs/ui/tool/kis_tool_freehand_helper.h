@@ -84,6 +84,16 @@ public:
                                 const KisPaintOpSettingsSP globalSettings,
                                 KisPaintOpSettings::OutlineMode mode) const;
 
+    /**
+     * A provisional preview of the part of the stroke that has not been
+     * passed to the paintop yet (in image pixel coordinates). It starts
+     * at the last position sent to the stroke, passes through the latest
+     * input event and ends at the position extrapolated by the configured
+     * prediction time. The path is empty when the prediction is disabled
+     * in the settings or no stroke is running.
+     */
+    QPainterPath predictedStrokePath() const;
+
 Q_SIGNALS:
     /**
      * The signal is emitted when the outline should be updated
@@ -148,6 +158,8 @@ private:
                                                const KisPaintInformation &lastPaintInfo);
     int computeAirbrushTimerInterval() const;
 
+    void saveStrokeRecording();
+
 private Q_SLOTS:
     void finishStroke();
     void doAirbrushing();
@@ -21,8 +21,9 @@
 
 #include <KoMixColorsOp.h>
 #include <kis_group_layer.h>
+#include <kis_paint_device.h>
+#include <kis_global.h>
 #include <kis_transaction.h>
-#include <kis_sequential_iterator.h>
 #include <kis_properties_configuration.h>
 #include <kconfiggroup.h>
 #include <ksharedconfig.h>
@@ -49,25 +50,31 @@ namespace KisToolUtils {
 
         // Sampling radius.
         if (!pure && radius > 1) {
-            QVector<const quint8*> pixels;
             const int effectiveRadius = radius - 1;
 
             const QRect pickRect(pos.x() - effectiveRadius, pos.y() - effectiveRadius,
                                  2 * effectiveRadius + 1, 2 * effectiveRadius + 1);
-            KisSequentialConstIterator it(dev, pickRect);
+
+            const int pixelSize = cs->pixelSize();
+            QVector<quint8> pixels(pickRect.width() * pickRect.height() * pixelSize);
+            dev->readBytes(pixels.data(), pickRect);
+
+            // the picking area is a circle, so we mix the colors through a mask
+            QVector<quint8> mask(pickRect.width() * pickRect.height());
+            quint8 *maskPtr = mask.data();
 
             const int radiusSq = pow2(effectiveRadius);
 
-            while (it.nextPixel()) {
-                const QPoint realPos(it.x(),  it.y());
-                const QPoint pt = realPos - pos;
-                if (pow2(pt.x()) + pow2(pt.y()) < radiusSq) {
-                    pixels << it.oldRawData();
+            for (int y = -effectiveRadius; y <= effectiveRadius; y++) {
+                for (int x = -effectiveRadius; x <= effectiveRadius; x++) {
+                    *maskPtr++ = pow2(x) + pow2(y) < radiusSq ? 255 : 0;
                 }
             }
 
-            const quint8 **cpixels = const_cast<const quint8**>(pixels.constData());
-            cs->mixColorsOp()->mixColors(cpixels, pixels.size(), pickedColor.data());
+            cs->mixColorsOp()->mixColorsRect(pixels.constData(), pickRect.width() * pixelSize,
+                                             mask.constData(), pickRect.width(),
+                                             pickRect.width(), pickRect.height(),
+                                             pickedColor.data());
         } else {
             dev->pixel(pos.x(), pos.y(), &pickedColor);
         }
@@ -339,6 +339,11 @@ KisStrokeStrategy* FreehandStrokeStrategy::createLodClone(int levelOfDetail)
     return clone;
 }
 
+void FreehandStrokeStrategy::setRandomSeed(int seed)
+{
+    m_d->randomSource = KisStrokeRandomSource(seed);
+}
+
 void FreehandStrokeStrategy::notifyUserStartedStroke()
 {
     m_d->efficiencyMeasurer.notifyCursorMoveStarted();
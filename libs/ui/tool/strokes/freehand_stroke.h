@@ -197,6 +197,14 @@ public:
     void notifyUserStartedStroke() override;
     void notifyUserEndedStroke() override;
 
+    /**
+     * Makes the stroke use random sources seeded with \p seed instead of
+     * the random ones. Two strokes with the same seed and the same input
+     * paint exactly the same dabs. Must be called before the stroke is
+     * started.
+     */
+    void setRandomSeed(int seed);
+
 protected:
     FreehandStrokeStrategy(const FreehandStrokeStrategy &rhs, int levelOfDetail);
 
@@ -34,6 +34,7 @@
 #include <QMessageBox>
 #include <QDomDocument>
 #include <QThread>
+#include <QtConcurrent>
 
 #include <QFileInfo>
 
@@ -149,9 +150,6 @@ struct EXRConverter::Private {
 
     QString errorMessage;
 
-    template <class WrapperType>
-    void unmultiplyAlpha(typename WrapperType::pixel_type *pixel);
-
     template<typename _T_>
     void decodeData4(Imf::InputFile& file, ExrPaintLayerInfo& info, KisPaintLayerSP layer, int width, int xstart, int ystart, int height, Imf::PixelType ptype);
 
@@ -316,12 +314,17 @@ struct GrayPixelWrapper
     pixel_type &pixel;
 };
 
+/**
+ * Unmultiplies the color channels of \p pixel in place. Returns true if
+ * the alpha channel had to be increased to keep the colors consistent.
+ */
 template <class WrapperType>
-void EXRConverter::Private::unmultiplyAlpha(typename WrapperType::pixel_type *pixel)
+bool unmultiplyAlpha(typename WrapperType::pixel_type *pixel)
 {
     typedef typename WrapperType::pixel_type pixel_type;
     typedef typename WrapperType::channel_type channel_type;
 
+    bool alphaWasModified = false;
     WrapperType srcPixel(*pixel);
 
     if (!srcPixel.checkMultipliedColorsConsistent()) {
@@ -352,6 +355,8 @@ void EXRConverter::Private::unmultiplyAlpha(typename WrapperType::pixel_type *pi
     } else if (srcPixel.alpha() > 0.0) {
         srcPixel.setUnmultiplied(srcPixel.pixel, srcPixel.alpha());
     }
+
+    return alphaWasModified;
 }
 
 template <typename T, typename Pixel, int size, int alphaPos>
@@ -372,60 +377,134 @@ void multiplyAlpha(Pixel *pixel)
     }
 }
 
+/**
+ * The layers are decoded in bands of scanlines, so that the temporary
+ * buffer doesn't grow with the size of the image. The height of a band
+ * is a multiple of 64, which is a multiple of the line buffers of all
+ * the EXR compression methods (1, 16 or 32 lines), so no line buffer
+ * is decompressed twice.
+ */
+int exrBandHeight(int width, int pixelSize)
+{
+    const int bandSizeLimit = 16 * 1024 * 1024;
+    const int bandAlignment = 64;
+
+    const int rows = bandSizeLimit / qMax(1, width * pixelSize);
+    return qMax(bandAlignment, rows / bandAlignment * bandAlignment);
+}
+
+/**
+ * Reads the lines [ystart, ystart + height) of \p file band by band.
+ * \p insertSlices should add the slices of the layer to the frame buffer,
+ * and \p writeBand should copy the pixels of the band into the layer and
+ * return true if it had to modify the alpha channel of any of them.
+ *
+ * While OpenEXR decompresses the next band in its thread pool, the
+ * previous one is written into the paint device in a separate thread.
+ */
+template<typename Pixel, class InsertSlices, class WriteBand>
+bool readPixelsInBands(Imf::InputFile& file, int width, int xstart, int ystart, int height,
+                       InsertSlices insertSlices, WriteBand writeBand)
+{
+    const int bandHeight = exrBandHeight(width, sizeof(Pixel));
+    const int bufferSize = width * qMin(bandHeight, height);
+
+    QVector<Pixel> buffers[2] = {QVector<Pixel>(bufferSize), QVector<Pixel>(bufferSize)};
+    int currentBuffer = 0;
+
+    QFuture<bool> pendingWrite;
+    bool alphaWasModified = false;
+
+    try {
+        for (int y = ystart; y < ystart + height; y += bandHeight) {
+            const int rows = qMin(bandHeight, ystart + height - y);
+            Pixel *data = buffers[currentBuffer].data();
+
+            Imf::FrameBuffer frameBuffer;
+            insertSlices(&frameBuffer, data - xstart - y * width);
+            file.setFrameBuffer(frameBuffer);
+            file.readPixels(y, y + rows - 1);
+
+            pendingWrite.waitForFinished();
+            alphaWasModified |= pendingWrite.resultCount() > 0 && pendingWrite.result();
+            const QRect bandRect(xstart, y, width, rows);
+            pendingWrite = QtConcurrent::run([writeBand, data, bandRect] () { return writeBand(data, bandRect); });
+
+            currentBuffer = !currentBuffer;
+        }
+    } catch (...) {
+        pendingWrite.waitForFinished();
+        throw;
+    }
+
+    pendingWrite.waitForFinished();
+    alphaWasModified |= pendingWrite.resultCount() > 0 && pendingWrite.result();
+
+    return alphaWasModified;
+}
+
 template<typename _T_>
 void EXRConverter::Private::decodeData4(Imf::InputFile& file, ExrPaintLayerInfo& info, KisPaintLayerSP layer, int width, int xstart, int ystart, int height, Imf::PixelType ptype)
 {
     typedef Rgba<_T_> Rgba;
 
-    QVector<Rgba> pixels(width * height);
-
-    bool hasAlpha = info.channelMap.contains("A");
-
-    Imf::FrameBuffer frameBuffer;
-    Rgba* frameBufferData = (pixels.data()) - xstart - ystart * width;
-    frameBuffer.insert(info.channelMap["R"].toLatin1().constData(),
-            Imf::Slice(ptype, (char *) &frameBufferData->r,
-                       sizeof(Rgba) * 1,
-                       sizeof(Rgba) * width));
-    frameBuffer.insert(info.channelMap["G"].toLatin1().constData(),
-            Imf::Slice(ptype, (char *) &frameBufferData->g,
-                       sizeof(Rgba) * 1,
-                       sizeof(Rgba) * width));
-    frameBuffer.insert(info.channelMap["B"].toLatin1().constData(),
-            Imf::Slice(ptype, (char *) &frameBufferData->b,
-                       sizeof(Rgba) * 1,
-                       sizeof(Rgba) * width));
-    if (hasAlpha) {
-        frameBuffer.insert(info.channelMap["A"].toLatin1().constData(),
-                Imf::Slice(ptype, (char *) &frameBufferData->a,
-                           sizeof(Rgba) * 1,
-                           sizeof(Rgba) * width));
-    }
+    const bool hasAlpha = info.channelMap.contains("A");
 
-    file.setFrameBuffer(frameBuffer);
-    file.readPixels(ystart, height + ystart - 1);
-    Rgba *rgba = pixels.data();
+    const QByteArray redName = info.channelMap["R"].toLatin1();
+    const QByteArray greenName = info.channelMap["G"].toLatin1();
+    const QByteArray blueName = info.channelMap["B"].toLatin1();
+    const QByteArray alphaName = info.channelMap["A"].toLatin1();
 
-    QRect paintRegion(xstart, ystart, width, height);
-    KisSequentialIterator it(layer->paintDevice(), paintRegion);
-    while (it.nextPixel()) {
+    auto insertSlices = [&] (Imf::FrameBuffer *frameBuffer, Rgba *frameBufferData) {
+        frameBuffer->insert(redName.constData(),
+                Imf::Slice(ptype, (char *) &frameBufferData->r,
+                           sizeof(Rgba) * 1,
+                           sizeof(Rgba) * width));
+        frameBuffer->insert(greenName.constData(),
+                Imf::Slice(ptype, (char *) &frameBufferData->g,
+                           sizeof(Rgba) * 1,
+                           sizeof(Rgba) * width));
+        frameBuffer->insert(blueName.constData(),
+                Imf::Slice(ptype, (char *) &frameBufferData->b,
+                           sizeof(Rgba) * 1,
+                           sizeof(Rgba) * width));
         if (hasAlpha) {
-            unmultiplyAlpha<RgbPixelWrapper<_T_> >(rgba);
+            frameBuffer->insert(alphaName.constData(),
+                    Imf::Slice(ptype, (char *) &frameBufferData->a,
+                               sizeof(Rgba) * 1,
+                               sizeof(Rgba) * width));
         }
+    };
 
-        typename KoRgbTraits<_T_>::Pixel* dst = reinterpret_cast<typename KoRgbTraits<_T_>::Pixel*>(it.rawData());
+    KisPaintDeviceSP device = layer->paintDevice();
 
-        dst->red = rgba->r;
-        dst->green = rgba->g;
-        dst->blue = rgba->b;
-        if (hasAlpha) {
-            dst->alpha = rgba->a;
-        } else {
-            dst->alpha = 1.0;
+    auto writeBand = [device, hasAlpha] (Rgba *rgba, const QRect &bandRect) {
+        bool alphaWasModified = false;
+
+        KisSequentialIterator it(device, bandRect);
+        while (it.nextPixel()) {
+            if (hasAlpha) {
+                alphaWasModified |= unmultiplyAlpha<RgbPixelWrapper<_T_> >(rgba);
+            }
+
+            typename KoRgbTraits<_T_>::Pixel* dst = reinterpret_cast<typename KoRgbTraits<_T_>::Pixel*>(it.rawData());
+
+            dst->red = rgba->r;
+            dst->green = rgba->g;
+            dst->blue = rgba->b;
+            if (hasAlpha) {
+                dst->alpha = rgba->a;
+            } else {
+                dst->alpha = 1.0;
+            }
+
+            ++rgba;
         }
 
-        ++rgba;
-    }
+        return alphaWasModified;
+    };
+
+    alphaWasModified |= readPixelsInBands<Rgba>(file, width, xstart, ystart, height, insertSlices, writeBand);
 }
 
 template<typename _T_>
@@ -437,49 +516,52 @@ void EXRConverter::Private::decodeData1(Imf::InputFile& file, ExrPaintLayerInfo&
     KIS_ASSERT_RECOVER_RETURN(
                 layer->paintDevice()->colorSpace()->colorModelId() == GrayAColorModelID);
 
-    QVector<pixel_type> pixels(width * height);
-
     Q_ASSERT(info.channelMap.contains("G"));
     dbgFile << "G -> " << info.channelMap["G"];
 
-    bool hasAlpha = info.channelMap.contains("A");
+    const bool hasAlpha = info.channelMap.contains("A");
     dbgFile << "Has Alpha:" << hasAlpha;
 
+    const QByteArray grayName = info.channelMap["G"].toLatin1();
+    const QByteArray alphaName = info.channelMap["A"].toLatin1();
 
-    Imf::FrameBuffer frameBuffer;
-    pixel_type* frameBufferData = (pixels.data()) - xstart - ystart * width;
-    frameBuffer.insert(info.channelMap["G"].toLatin1().constData(),
-            Imf::Slice(ptype, (char *) &frameBufferData->gray,
-                       sizeof(pixel_type) * 1,
-                       sizeof(pixel_type) * width));
-
-    if (hasAlpha) {
-        frameBuffer.insert(info.channelMap["A"].toLatin1().constData(),
-                Imf::Slice(ptype, (char *) &frameBufferData->alpha,
+    auto insertSlices = [&] (Imf::FrameBuffer *frameBuffer, pixel_type *frameBufferData) {
+        frameBuffer->insert(grayName.constData(),
+                Imf::Slice(ptype, (char *) &frameBufferData->gray,
                            sizeof(pixel_type) * 1,
                            sizeof(pixel_type) * width));
-    }
 
-    file.setFrameBuffer(frameBuffer);
-    file.readPixels(ystart, height + ystart - 1);
+        if (hasAlpha) {
+            frameBuffer->insert(alphaName.constData(),
+                    Imf::Slice(ptype, (char *) &frameBufferData->alpha,
+                               sizeof(pixel_type) * 1,
+                               sizeof(pixel_type) * width));
+        }
+    };
 
-    pixel_type *srcPtr = pixels.data();
+    KisPaintDeviceSP device = layer->paintDevice();
 
-    QRect paintRegion(xstart, ystart, width, height);
-    KisSequentialIterator it(layer->paintDevice(), paintRegion);
-    do {
+    auto writeBand = [device, hasAlpha] (pixel_type *srcPtr, const QRect &bandRect) {
+        bool alphaWasModified = false;
 
-        if (hasAlpha) {
-            unmultiplyAlpha<GrayPixelWrapper<_T_> >(srcPtr);
-        }
+        KisSequentialIterator it(device, bandRect);
+        while (it.nextPixel()) {
+            if (hasAlpha) {
+                alphaWasModified |= unmultiplyAlpha<GrayPixelWrapper<_T_> >(srcPtr);
+            }
 
-        pixel_type* dstPtr = reinterpret_cast<pixel_type*>(it.rawData());
+            pixel_type* dstPtr = reinterpret_cast<pixel_type*>(it.rawData());
 
-        dstPtr->gray = srcPtr->gray;
-        dstPtr->alpha = hasAlpha ? srcPtr->alpha : channel_type(1.0);
+            dstPtr->gray = srcPtr->gray;
+            dstPtr->alpha = hasAlpha ? srcPtr->alpha : channel_type(1.0);
 
-        ++srcPtr;
-    } while (it.nextPixel());
+            ++srcPtr;
+        }
+
+        return alphaWasModified;
+    };
+
+    alphaWasModified |= readPixelsInBands<pixel_type>(file, width, xstart, ystart, height, insertSlices, writeBand);
 }
 
 bool recCheckGroup(const ExrGroupLayerInfo& group, QStringList list, int idx1, int idx2)
@@ -953,7 +1035,7 @@ class Encoder
 public:
     virtual ~Encoder() {}
     virtual void prepareFrameBuffer(Imf::FrameBuffer*, int line) = 0;
-    virtual void encodeData(int line) = 0;
+    virtual void encodeData(int line, int numLines) = 0;
 
 };
 
@@ -961,10 +1043,10 @@ template<typename _T_, int size, int alphaPos>
 class EncoderImpl : public Encoder
 {
 public:
-    EncoderImpl(Imf::OutputFile* _file, const ExrPaintLayerSaveInfo* _info, int width) : file(_file), info(_info), pixels(width), m_width(width) {}
+    EncoderImpl(Imf::OutputFile* _file, const ExrPaintLayerSaveInfo* _info, int width, int bandHeight) : file(_file), info(_info), pixels(width * bandHeight), m_width(width) {}
     ~EncoderImpl() override {}
     void prepareFrameBuffer(Imf::FrameBuffer*, int line) override;
-    void encodeData(int line) override;
+    void encodeData(int line, int numLines) override;
 private:
     typedef ExrPixel_<_T_, size> ExrPixel;
     Imf::OutputFile* file;
@@ -988,12 +1070,12 @@ void EncoderImpl<_T_, size, alphaPos>::prepareFrameBuffer(Imf::FrameBuffer* fram
 }
 
 template<typename _T_, int size, int alphaPos>
-void EncoderImpl<_T_, size, alphaPos>::encodeData(int line)
+void EncoderImpl<_T_, size, alphaPos>::encodeData(int line, int numLines)
 {
     ExrPixel *rgba = pixels.data();
-    KisHLineConstIteratorSP it = info->layerDevice->createHLineConstIteratorNG(0, line, m_width);
-    do {
-        const _T_* dst = reinterpret_cast < const _T_* >(it->oldRawData());
+    KisSequentialConstIterator it(info->layerDevice, QRect(0, line, m_width, numLines));
+    while (it.nextPixel()) {
+        const _T_* dst = reinterpret_cast < const _T_* >(it.oldRawData());
 
         for (int i = 0; i < size; ++i) {
             rgba->data[i] = dst[i];
@@ -1004,40 +1086,40 @@ void EncoderImpl<_T_, size, alphaPos>::encodeData(int line)
         }
 
         ++rgba;
-    } while (it->nextPixel());
+    }
 }
 
-Encoder* encoder(Imf::OutputFile& file, const ExrPaintLayerSaveInfo& info, int width)
+Encoder* encoder(Imf::OutputFile& file, const ExrPaintLayerSaveInfo& info, int width, int bandHeight)
 {
     dbgFile << "Create encoder for" << info.name << info.channels << info.layerDevice->colorSpace()->channelCount();
     switch (info.layerDevice->colorSpace()->channelCount()) {
     case 1: {
         if (info.layerDevice->colorSpace()->colorDepthId() == Float16BitsColorDepthID) {
             Q_ASSERT(info.pixelType == Imf::HALF);
-            return new EncoderImpl < half, 1, -1 > (&file, &info, width);
+            return new EncoderImpl < half, 1, -1 > (&file, &info, width, bandHeight);
         } else if (info.layerDevice->colorSpace()->colorDepthId() == Float32BitsColorDepthID) {
             Q_ASSERT(info.pixelType == Imf::FLOAT);
-            return new EncoderImpl < float, 1, -1 > (&file, &info, width);
+            return new EncoderImpl < float, 1, -1 > (&file, &info, width, bandHeight);
         }
         break;
     }
     case 2: {
         if (info.layerDevice->colorSpace()->colorDepthId() == Float16BitsColorDepthID) {
             Q_ASSERT(info.pixelType == Imf::HALF);
-            return new EncoderImpl<half, 2, 1>(&file, &info, width);
+            return new EncoderImpl<half, 2, 1>(&file, &info, width, bandHeight);
         } else if (info.layerDevice->colorSpace()->colorDepthId() == Float32BitsColorDepthID) {
             Q_ASSERT(info.pixelType == Imf::FLOAT);
-            return new EncoderImpl<float, 2, 1>(&file, &info, width);
+            return new EncoderImpl<float, 2, 1>(&file, &info, width, bandHeight);
         }
         break;
     }
     case 4: {
         if (info.layerDevice->colorSpace()->colorDepthId() == Float16BitsColorDepthID) {
             Q_ASSERT(info.pixelType == Imf::HALF);
-            return new EncoderImpl<half, 4, 3>(&file, &info, width);
+            return new EncoderImpl<half, 4, 3>(&file, &info, width, bandHeight);
         } else if (info.layerDevice->colorSpace()->colorDepthId() == Float32BitsColorDepthID) {
             Q_ASSERT(info.pixelType == Imf::FLOAT);
-            return new EncoderImpl<float, 4, 3>(&file, &info, width);
+            return new EncoderImpl<float, 4, 3>(&file, &info, width, bandHeight);
         }
         break;
     }
@@ -1047,23 +1129,39 @@ Encoder* encoder(Imf::OutputFile& file, const ExrPaintLayerSaveInfo& info, int w
     return 0;
 }
 
+/**
+ * The layers are written in bands of scanlines. OpenEXR compresses the
+ * line buffers of a band in its thread pool, and the pixels of the next
+ * band are fetched from all the layers concurrently.
+ */
 void encodeData(Imf::OutputFile& file, const QList<ExrPaintLayerSaveInfo>& informationObjects, int width, int height)
 {
+    int pixelSize = 0;
+    Q_FOREACH (const ExrPaintLayerSaveInfo& info, informationObjects) {
+        pixelSize += info.layerDevice->pixelSize();
+    }
+
+    const int bandHeight = qMin(exrBandHeight(width, pixelSize), height);
+
     QList<Encoder*> encoders;
     Q_FOREACH (const ExrPaintLayerSaveInfo& info, informationObjects) {
-        encoders.push_back(encoder(file, info, width));
+        encoders.push_back(encoder(file, info, width, bandHeight));
     }
 
-    for (int y = 0; y < height; ++y) {
+    for (int y = 0; y < height; y += bandHeight) {
+        const int numLines = qMin(bandHeight, height - y);
+
         Imf::FrameBuffer frameBuffer;
         Q_FOREACH (Encoder* encoder, encoders) {
             encoder->prepareFrameBuffer(&frameBuffer, y);
         }
         file.setFrameBuffer(frameBuffer);
-        Q_FOREACH (Encoder* encoder, encoders) {
-            encoder->encodeData(y);
-        }
-        file.writePixels(1);
+
+        QtConcurrent::blockingMap(encoders, [y, numLines] (Encoder *encoder) {
+            encoder->encodeData(y, numLines);
+        });
+
+        file.writePixels(numLines);
     }
     qDeleteAll(encoders);
 }
@@ -25,6 +25,12 @@
 
 #include <half.h>
 #include <KisMimeDatabase.h>
+#include <KoColorModelStandardIds.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColorSpaceTraits.h>
+#include <kis_paint_layer.h>
+#include <kis_sequential_iterator.h>
+#include <kis_undo_stores.h>
 #include "filestest.h"
 
 #ifndef FILES_DATA_DIR
@@ -105,6 +111,55 @@ void KisExrTest::testRoundTrip()
 
 }
 
+void KisExrTest::testRoundTripTallImage()
+{
+    /**
+     * The image is taller than one band of scanlines, so both the
+     * importer and the exporter have to process it in several parts
+     */
+    const QRect imageRect(0, 0, 2048, 1300);
+
+    QScopedPointer<KisDocument> doc1(KisPart::instance()->createDocument());
+    doc1->setFileBatchMode(true);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), Float16BitsColorDepthID.id(), 0);
+    KisImageSP image = new KisImage(new KisSurrogateUndoStore(), imageRect.width(), imageRect.height(), cs, "tall image");
+    KisPaintLayerSP layer = new KisPaintLayer(image, "layer1", OPACITY_OPAQUE_U8);
+    image->addNode(layer);
+    doc1->setCurrentImage(image);
+
+    KisSequentialIterator it(layer->paintDevice(), imageRect);
+    while (it.nextPixel()) {
+        KoRgbF16Traits::Pixel *pixel = reinterpret_cast<KoRgbF16Traits::Pixel*>(it.rawData());
+        pixel->red = half(float(it.x()) / imageRect.width());
+        pixel->green = half(float(it.y()) / imageRect.height());
+        pixel->blue = half(float((it.x() ^ it.y()) & 0xff) / 255.0f);
+        pixel->alpha = half(1.0f);
+    }
+
+    QTemporaryFile savedFile(QDir::tempPath() + QLatin1String("/krita_XXXXXX") + QLatin1String(".exr"));
+    savedFile.setAutoRemove(true);
+    savedFile.open();
+
+    const QString savedFileName(savedFile.fileName());
+    const QByteArray mimeType = KisMimeDatabase::mimeTypeForFile(savedFileName, false).toLatin1();
+
+    bool r = doc1->exportDocumentSync(QUrl::fromLocalFile(savedFileName), mimeType);
+    QVERIFY(r);
+
+    QScopedPointer<KisDocument> doc2(KisPart::instance()->createDocument());
+    doc2->setFileBatchMode(true);
+    r = doc2->importDocument(QUrl::fromLocalFile(savedFileName));
+
+    QVERIFY(r);
+    QVERIFY(doc2->image());
+    QCOMPARE(doc2->image()->bounds(), imageRect);
+
+    QVERIFY(TestUtil::comparePaintDevicesClever<half>(
+                layer->paintDevice(),
+                doc2->image()->root()->firstChild()->paintDevice()));
+}
+
 KISTEST_MAIN(KisExrTest)
 
 
@@ -30,6 +30,7 @@ private Q_SLOTS:
     void testExportToReadonly();
     void testImportIncorrectFormat();
     void testRoundTrip();
+    void testRoundTripTallImage();
 };
 
 #endif
@@ -36,6 +36,8 @@
 #include <kis_image.h>
 #include <kis_paint_layer.h>
 #include <kis_png_converter.h>
+#include <kis_config.h>
+#include <kis_kra_preview_utils.h>
 #include <KisDocument.h>
 
 static const char CURRENT_DTD_VERSION[] = "2.0";
@@ -241,8 +243,16 @@ QDomDocument KraConverter::createDomDocument()
 
 KisImportExportErrorCode KraConverter::savePreview(KoStore *store)
 {
-    QPixmap pix = m_doc->generatePreview(QSize(256, 256));
-    QImage preview(pix.toImage().convertToFormat(QImage::Format_ARGB32, Qt::ColorOnly));
+    QImage preview;
+
+    if (KisConfig(true).fastKraPreviews()) {
+        preview = KisKraPreviewUtils::createThumbnail(m_image->projection(), m_image->bounds(), QSize(256, 256));
+        preview = preview.convertToFormat(QImage::Format_ARGB32, Qt::ColorOnly);
+    } else {
+        QPixmap pix = m_doc->generatePreview(QSize(256, 256));
+        preview = pix.toImage().convertToFormat(QImage::Format_ARGB32, Qt::ColorOnly);
+    }
+
     if (preview.size() == QSize(0,0)) {
         QSize newSize = m_doc->savingImage()->bounds().size();
         newSize.scale(QSize(256, 256), Qt::KeepAspectRatio);
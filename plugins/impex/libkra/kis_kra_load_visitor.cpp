@@ -28,6 +28,11 @@
 #include <QBuffer>
 #include <QByteArray>
 #include <QMessageBox>
+#include <QFuture>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <functional>
 
 #include <KoHashGenerator.h>
 #include <KoHashGeneratorProvider.h>
@@ -68,10 +73,96 @@
 #include "kis_raster_keyframe_channel.h"
 #include "kis_paint_device_frames_interface.h"
 #include "kis_filter_registry.h"
+#include "kis_config.h"
+#include "KisRunnableBasedStrokeStrategy.h"
+#include "KisRunnableStrokeJobData.h"
 
 
 using namespace KRA;
 
+namespace {
+
+/**
+ * Puts the pixel data of the hidden layers and the non-current frames
+ * into the devices after the image has been opened. The stroke is
+ * exclusive, so no other stroke or update may access the devices while
+ * they are being filled.
+ */
+class DeferredPaintDevicesStrokeStrategy : public KisRunnableBasedStrokeStrategy
+{
+public:
+    DeferredPaintDevicesStrokeStrategy()
+        : KisRunnableBasedStrokeStrategy("kra-deferred-loading")
+    {
+        enableJob(JOB_DOSTROKE);
+
+        setExclusive(true);
+        setClearsRedoOnStart(false);
+        setRequestsOtherStrokesToEnd(false);
+    }
+};
+
+/**
+ * Decodes the pixel data into a standalone data manager, so that it
+ * could be done without touching the paint device itself.
+ *
+ * The data manager must have the same default pixel as the destination
+ * one, otherwise bitBltRough() would copy its default tiles into the
+ * areas of the destination that have no tiles stored.
+ */
+KisDataManagerSP decodePixelData(const KoStore::CompressedData &data, const QByteArray &defaultPixel)
+{
+    QByteArray buffer;
+    if (!KoStore::decompressData(data, &buffer)) {
+        return KisDataManagerSP();
+    }
+
+    QBuffer stream(&buffer);
+    stream.open(QIODevice::ReadOnly);
+
+    KisDataManagerSP dataManager =
+        new KisDataManager(quint32(defaultPixel.size()),
+                           reinterpret_cast<const quint8*>(defaultPixel.constData()));
+
+    return dataManager->read(&stream) ? dataManager : KisDataManagerSP();
+}
+
+}
+
+struct KisKraLoadVisitor::PendingPaintDevice
+{
+    KisPaintDeviceSP device;
+    KisDataManagerSP dataManager;
+    QString location;
+    bool deferred = false;
+
+    /// resets the caches of the frame after its data has been replaced
+    std::function<void()> finishCallback;
+
+    QFuture<KisDataManagerSP> future;
+
+    bool apply() {
+        KisDataManagerSP decoded = future.result();
+
+        if (decoded) {
+            const QRect rc = decoded->extent();
+            if (!rc.isEmpty()) {
+                // the tiles are shared, not copied
+                dataManager->bitBltRough(decoded.data(), rc);
+            }
+        }
+
+        finishCallback();
+
+        KisPixelSelection *pixelSelection = dynamic_cast<KisPixelSelection*>(device.data());
+        if (pixelSelection) {
+            pixelSelection->invalidateOutlineCache();
+        }
+
+        return bool(decoded);
+    }
+};
+
 QString expandEncodedDirectory(const QString& _intern)
 {
 
@@ -109,6 +200,9 @@ KisKraLoadVisitor::KisKraLoadVisitor(KisImageSP image,
     , m_keyframeFilenames(keyframeFilenames)
     , m_name(name)
     , m_shapeController(shapeController)
+    , m_lazyLoading(KisConfig(true).lazyLoadKra())
+    // limit the amount of the decoded data kept in memory
+    , m_maxPendingPaintDevices(2 * qMax(1, QThread::idealThreadCount()))
 {
     m_store->pushDirectory();
 
@@ -194,7 +288,7 @@ bool KisKraLoadVisitor::visit(KisPaintLayer *layer)
 {
     loadNodeKeyframes(layer);
 
-    if (!loadPaintDevice(layer->paintDevice(), getLocation(layer))) {
+    if (!loadPaintDevice(layer->paintDevice(), getLocation(layer), !layer->visible(true))) {
         return false;
     }
     if (!loadProfile(layer->paintDevice(), getLocation(layer, DOT_ICC))) {
@@ -436,15 +530,86 @@ bool KisKraLoadVisitor::visit(KisColorizeMask *mask)
         loadPaintDevice(stroke.dev, fileName);
     }
 
-    mask->setKeyStrokesDirect(QList<KisLazyFillTools::KeyStroke>::fromVector(strokes));
-
     loadPaintDevice(mask->coloringProjection(), COLORIZE_COLORING_DEVICE);
+
+    // the mask reads the devices right away
+    applyPendingPaintDevices(true);
+
+    mask->setKeyStrokesDirect(QList<KisLazyFillTools::KeyStroke>::fromVector(strokes));
     mask->resetCache();
 
     m_store->popDirectory();
     return true;
 }
 
+void KisKraLoadVisitor::loadPendingPaintDevices()
+{
+    applyPendingPaintDevices(true);
+    startDeferredPaintDevices();
+}
+
+void KisKraLoadVisitor::applyPendingPaintDevices(bool waitForAll)
+{
+    while (!m_pendingPaintDevices.isEmpty()) {
+        PendingPaintDeviceSP pending = m_pendingPaintDevices.head();
+
+        if (!waitForAll &&
+            !pending->future.isFinished() &&
+            m_pendingPaintDevices.size() <= m_maxPendingPaintDevices) {
+
+            break;
+        }
+
+        m_pendingPaintDevices.dequeue();
+
+        if (pending->deferred) {
+            /**
+             * The deferred devices are not waited for at the end of
+             * loading, but they still count as being decoded while
+             * they stay in the queue.
+             */
+            if (!waitForAll) {
+                pending->future.waitForFinished();
+            }
+
+            m_deferredPaintDevices << pending;
+            continue;
+        }
+
+        if (!pending->apply()) {
+            m_warningMessages << i18n("Could not read pixel data: %1.", pending->location);
+        }
+    }
+}
+
+void KisKraLoadVisitor::startDeferredPaintDevices()
+{
+    if (m_deferredPaintDevices.isEmpty()) return;
+
+    const QList<PendingPaintDeviceSP> devices = m_deferredPaintDevices;
+    m_deferredPaintDevices.clear();
+
+    /**
+     * The stroke is started right away, so that it doesn't depend on
+     * the event loop (which is not running when the file is converted
+     * from the command line). Every stroke and barrier lock of the image,
+     * including the ones taken for saving and exporting, is executed
+     * after the data has been put into the devices.
+     */
+    KisStrokeId strokeId = m_image->startStroke(new DeferredPaintDevicesStrokeStrategy());
+
+    Q_FOREACH (PendingPaintDeviceSP pending, devices) {
+        m_image->addJob(strokeId, new KisRunnableStrokeJobData([pending] () {
+            if (!pending->apply()) {
+                warnFile << "Could not read pixel data:" << pending->location;
+            }
+            pending->device->setDirty();
+        }));
+    }
+
+    m_image->endStroke(strokeId);
+}
+
 QStringList KisKraLoadVisitor::errorMessages() const
 {
     return m_errorMessages;
@@ -457,13 +622,19 @@ QStringList KisKraLoadVisitor::warningMessages() const
 
 struct SimpleDevicePolicy
 {
-    bool read(KisPaintDeviceSP dev, QIODevice *stream) {
-        return dev->read(stream);
+    KisDataManagerSP dataManager(KisPaintDeviceSP dev) const {
+        return dev->dataManager();
     }
 
     void setDefaultPixel(KisPaintDeviceSP dev, const KoColor &defaultPixel) const {
+        // resets the cache of the device as well
         return dev->setDefaultPixel(defaultPixel);
     }
+
+    void invalidateCache(KisPaintDeviceSP dev) const {
+        // the color space is the same, so nothing is converted
+        dev->setDefaultPixel(dev->defaultPixel());
+    }
 };
 
 struct FramedDevicePolicy
@@ -471,18 +642,23 @@ struct FramedDevicePolicy
     FramedDevicePolicy(int frameId)
         :  m_frameId(frameId) {}
 
-    bool read(KisPaintDeviceSP dev, QIODevice *stream) {
-        return dev->framesInterface()->readFrame(stream, m_frameId);
+    KisDataManagerSP dataManager(KisPaintDeviceSP dev) const {
+        return dev->framesInterface()->frameDataManager(m_frameId);
     }
 
     void setDefaultPixel(KisPaintDeviceSP dev, const KoColor &defaultPixel) const {
-        return dev->framesInterface()->setFrameDefaultPixel(defaultPixel, m_frameId);
+        dev->framesInterface()->setFrameDefaultPixel(defaultPixel, m_frameId);
+        dev->framesInterface()->invalidateFrameCache(m_frameId);
+    }
+
+    void invalidateCache(KisPaintDeviceSP dev) const {
+        dev->framesInterface()->invalidateFrameCache(m_frameId);
     }
 
     int m_frameId;
 };
 
-bool KisKraLoadVisitor::loadPaintDevice(KisPaintDeviceSP device, const QString& location)
+bool KisKraLoadVisitor::loadPaintDevice(KisPaintDeviceSP device, const QString& location, bool isHidden)
 {
     // Layer data
     KisPaintDeviceFramesInterface *frameInterface = device->framesInterface();
@@ -493,9 +669,10 @@ bool KisKraLoadVisitor::loadPaintDevice(KisPaintDeviceSP device, const QString&
     }
 
     if (!frameInterface || frames.count() <= 1) {
-        return loadPaintDeviceFrame(device, location, SimpleDevicePolicy());
+        return loadPaintDeviceFrame(device, location, SimpleDevicePolicy(), m_lazyLoading && isHidden);
     } else {
         KisRasterKeyframeChannel *keyframeChannel = device->keyframeChannel();
+        const int currentFrameId = frameInterface->currentFrameId();
 
         for (int i = 0; i < frames.count(); i++) {
             int id = frames[i];
@@ -507,7 +684,9 @@ bool KisKraLoadVisitor::loadPaintDevice(KisPaintDeviceSP device, const QString&
                 QString frameFilename = getLocation(keyframeChannel->frameFilename(id));
                 Q_ASSERT(!frameFilename.isEmpty());
 
-                if (!loadPaintDeviceFrame(device, frameFilename, FramedDevicePolicy(id))) {
+                const bool deferred = m_lazyLoading && (isHidden || id != currentFrameId);
+
+                if (!loadPaintDeviceFrame(device, frameFilename, FramedDevicePolicy(id), deferred)) {
                     m_warningMessages << i18n("Could not load keyframe pixel data for frame %1 in %2.", id, location);
                 }
             }
@@ -518,36 +697,64 @@ bool KisKraLoadVisitor::loadPaintDevice(KisPaintDeviceSP device, const QString&
 }
 
 template<class DevicePolicy>
-bool KisKraLoadVisitor::loadPaintDeviceFrame(KisPaintDeviceSP device, const QString &location, DevicePolicy policy)
+bool KisKraLoadVisitor::loadPaintDeviceFrame(KisPaintDeviceSP device, const QString &location, DevicePolicy policy, bool deferred)
 {
-    {
-        const int pixelSize = device->colorSpace()->pixelSize();
-        KoColor color(Qt::transparent, device->colorSpace());
+    const int pixelSize = device->colorSpace()->pixelSize();
+    KoColor color(Qt::transparent, device->colorSpace());
 
-        if (m_store->open(location + ".defaultpixel")) {
-            if (m_store->size() == pixelSize) {
-                m_store->read((char*)color.data(), pixelSize);
-            }
-
-            m_store->close();
+    if (m_store->open(location + ".defaultpixel")) {
+        if (m_store->size() == pixelSize) {
+            m_store->read((char*)color.data(), pixelSize);
         }
 
-        policy.setDefaultPixel(device, color);
+        m_store->close();
     }
 
-    if (m_store->open(location)) {
-        if (!policy.read(device, m_store->device())) {
-            m_warningMessages << i18n("Could not read pixel data: %1.", location);
-            device->disconnect();
+    /**
+     * The default pixel is set right away, before the profile of the
+     * layer is assigned. Otherwise it would be converted from the
+     * default profile of the color space into the loaded one.
+     */
+    policy.setDefaultPixel(device, color);
+
+    KoStore::CompressedData data;
+
+    if (!m_store->readCompressedData(location, &data)) {
+        /**
+         * The store refuses to read huge files at once, so read them
+         * right from the stream in the GUI thread
+         */
+        if (m_store->open(location)) {
+            if (!policy.dataManager(device)->read(m_store->device())) {
+                m_warningMessages << i18n("Could not read pixel data: %1.", location);
+                device->disconnect();
+                m_store->close();
+                return true;
+            }
             m_store->close();
-            return true;
+            policy.invalidateCache(device);
+        } else {
+            m_warningMessages << i18n("Could not load pixel data: %1.", location);
         }
-        m_store->close();
-    } else {
-        m_warningMessages << i18n("Could not load pixel data: %1.", location);
         return true;
     }
 
+    PendingPaintDeviceSP pending(new PendingPaintDevice());
+    pending->device = device;
+    pending->dataManager = policy.dataManager(device);
+    pending->location = location;
+    pending->deferred = deferred;
+    pending->finishCallback = [device, policy] () {
+        policy.invalidateCache(device);
+    };
+
+    const QByteArray defaultPixel(reinterpret_cast<const char*>(pending->dataManager->defaultPixel()),
+                                  pixelSize);
+    pending->future = QtConcurrent::run(&decodePixelData, data, defaultPixel);
+
+    m_pendingPaintDevices.enqueue(pending);
+    applyPendingPaintDevices(false);
+
     return true;
 }
 
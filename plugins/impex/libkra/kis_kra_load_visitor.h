@@ -22,6 +22,9 @@
 
 #include <QRect>
 #include <QStringList>
+#include <QList>
+#include <QQueue>
+#include <QSharedPointer>
 
 // kritaimage
 #include "kis_types.h"
@@ -65,15 +68,34 @@ public:
     bool visit(KisSelectionMask *mask) override;
     bool visit(KisColorizeMask *mask) override;
 
+    /**
+     * The pixel data of the devices is decoded in the worker threads
+     * while the visitor walks through the nodes. This method waits for
+     * the decoding to finish and moves the data into the devices. It
+     * should be called after the visitor has been accepted by the root
+     * layer.
+     *
+     * In lazy loading mode (see KisConfig::lazyLoadKra()) the hidden layers
+     * and the frames other than the current one are not waited for. They
+     * are decoded in the background and put into the devices by a separate
+     * exclusive stroke of the image, so every stroke and barrier lock that
+     * might access them is executed after the data has arrived.
+     */
+    void loadPendingPaintDevices();
+
     QStringList errorMessages() const;
     QStringList warningMessages() const;
 
 private:
+    struct PendingPaintDevice;
+    typedef QSharedPointer<PendingPaintDevice> PendingPaintDeviceSP;
 
-    bool loadPaintDevice(KisPaintDeviceSP device, const QString& location);
+    bool loadPaintDevice(KisPaintDeviceSP device, const QString& location, bool isHidden = false);
+    void applyPendingPaintDevices(bool waitForAll);
+    void startDeferredPaintDevices();
 
     template<class DevicePolicy>
-    bool loadPaintDeviceFrame(KisPaintDeviceSP device, const QString &location, DevicePolicy policy);
+    bool loadPaintDeviceFrame(KisPaintDeviceSP device, const QString &location, DevicePolicy policy, bool deferred);
 
     bool loadProfile(KisPaintDeviceSP device,  const QString& location);
     bool loadFilterConfiguration(KisFilterConfigurationSP kfc, const QString& location);
@@ -106,6 +128,10 @@ private:
     QStringList m_warningMessages;
     KoShapeControllerBase *m_shapeController;
     QMap<QByteArray, const KoColorProfile *> m_profileCache;
+    bool m_lazyLoading;
+    int m_maxPendingPaintDevices;
+    QQueue<PendingPaintDeviceSP> m_pendingPaintDevices;
+    QList<PendingPaintDeviceSP> m_deferredPaintDevices;
 };
 
 #endif // KIS_KRA_LOAD_VISITOR_H_
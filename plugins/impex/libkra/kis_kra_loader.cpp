@@ -440,6 +440,8 @@ void KisKraLoader::loadBinaryData(KoStore * store, KisImageSP image, const QStri
     }
 
     image->rootLayer()->accept(visitor);
+    visitor.loadPendingPaintDevices();
+
     if (!visitor.errorMessages().isEmpty()) {
         m_d->errorMessages.append(visitor.errorMessages());
     }
@@ -0,0 +1,426 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_kra_preview_utils.h"
+
+#include <QByteArray>
+#include <QFuture>
+#include <QIODevice>
+#include <QQueue>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <utility>
+
+#include <zlib.h>
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColorProfile.h>
+#include <KoMixColorsOp.h>
+#include <KoStore.h>
+#include <KoStoreDevice.h>
+#include <KoUnit.h>
+
+#include "kis_assert.h"
+#include "kis_debug.h"
+#include "kis_paint_device.h"
+
+
+namespace {
+
+/**
+ * The size of the raw data of a stripe. The stripes should be big enough
+ * for deflate to find the repeating patterns, and small enough to keep
+ * all the threads busy.
+ */
+const int STRIPE_DATA_SIZE = 4 * 1024 * 1024;
+
+const quint8 PNG_FILTER_PAETH = 4;
+
+struct EncodedStripe {
+    QByteArray data;
+    quint32 adler = 0;
+    qint64 rawSize = 0;
+    bool isValid = false;
+};
+
+inline void appendUInt32(QByteArray &array, quint32 value)
+{
+    const char bytes[] = {char(value >> 24), char(value >> 16), char(value >> 8), char(value)};
+    array.append(bytes, 4);
+}
+
+bool writeChunk(QIODevice *io, const char *type, const QByteArray &data)
+{
+    QByteArray chunk;
+    chunk.reserve(data.size() + 12);
+
+    appendUInt32(chunk, quint32(data.size()));
+    chunk.append(type, 4);
+    chunk.append(data);
+
+    const quint32 crc = quint32(crc32(0, reinterpret_cast<const Bytef*>(chunk.constData() + 4), uInt(data.size() + 4)));
+    appendUInt32(chunk, crc);
+
+    return io->write(chunk) == chunk.size();
+}
+
+inline quint8 paethPredictor(int a, int b, int c)
+{
+    const int p = a + b - c;
+    const int pa = qAbs(p - a);
+    const int pb = qAbs(p - b);
+    const int pc = qAbs(p - c);
+
+    return quint8(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+}
+
+/**
+ * Reads \p rc of \p dev converted into \p dstColorSpace. The rows are
+ * converted from BGRA into RGBA order, as PNG wants them.
+ */
+void readRgbaPixels(KisPaintDeviceSP dev, const QRect &rc, const KoColorSpace *dstColorSpace, quint8 *dst)
+{
+    const KoColorSpace *srcColorSpace = dev->colorSpace();
+    const int numPixels = rc.width() * rc.height();
+
+    if (srcColorSpace == dstColorSpace) {
+        dev->readBytes(dst, rc);
+    } else {
+        QByteArray buffer(numPixels * int(srcColorSpace->pixelSize()), Qt::Uninitialized);
+        dev->readBytes(reinterpret_cast<quint8*>(buffer.data()), rc);
+
+        srcColorSpace->convertPixelsTo(reinterpret_cast<const quint8*>(buffer.constData()),
+                                       dst, dstColorSpace, quint32(numPixels),
+                                       KoColorConversionTransformation::internalRenderingIntent(),
+                                       KoColorConversionTransformation::internalConversionFlags());
+    }
+
+    for (int i = 0; i < numPixels; i++) {
+        std::swap(dst[4 * i], dst[4 * i + 2]);
+    }
+}
+
+/**
+ * Filters the rows of the stripe with Paeth filter and deflates them. The
+ * stripes are independent deflate streams, all of them but the last one
+ * end with a sync flush, so that they could be concatenated.
+ */
+EncodedStripe encodeStripe(KisPaintDeviceSP dev, const QRect &imageRect, const QRect &stripeRect,
+                           const KoColorSpace *dstColorSpace, int compressionLevel, bool isLastStripe)
+{
+    EncodedStripe result;
+
+    const int rowSize = stripeRect.width() * 4;
+    const int numRows = stripeRect.height();
+
+    // the row above the stripe is needed for filtering, for the first row of the image it is zero
+    QByteArray pixels((numRows + 1) * rowSize, 0);
+    quint8 *pixelsPtr = reinterpret_cast<quint8*>(pixels.data());
+
+    if (stripeRect.top() > imageRect.top()) {
+        readRgbaPixels(dev, stripeRect.adjusted(0, -1, 0, 0), dstColorSpace, pixelsPtr);
+    } else {
+        readRgbaPixels(dev, stripeRect, dstColorSpace, pixelsPtr + rowSize);
+    }
+
+    const int filteredRowSize = rowSize + 1;
+    QByteArray filtered(numRows * filteredRowSize, Qt::Uninitialized);
+    quint8 *filteredPtr = reinterpret_cast<quint8*>(filtered.data());
+
+    for (int row = 0; row < numRows; row++) {
+        const quint8 *prev = pixelsPtr + row * rowSize;
+        const quint8 *curr = prev + rowSize;
+        quint8 *dst = filteredPtr + row * filteredRowSize;
+
+        *dst++ = PNG_FILTER_PAETH;
+
+        for (int i = 0; i < 4; i++) {
+            dst[i] = quint8(curr[i] - paethPredictor(0, prev[i], 0));
+        }
+
+        for (int i = 4; i < rowSize; i++) {
+            dst[i] = quint8(curr[i] - paethPredictor(curr[i - 4], prev[i], prev[i - 4]));
+        }
+    }
+
+    pixels.clear();
+
+    result.rawSize = filtered.size();
+    result.adler = quint32(adler32(adler32(0, Z_NULL, 0), filteredPtr, uInt(filtered.size())));
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+
+    if (deflateInit2(&stream, compressionLevel, Z_DEFLATED, -MAX_WBITS, 8, Z_FILTERED) != Z_OK) {
+        warnFile << "Could not initialize zlib stream";
+        return result;
+    }
+
+    // the sync flush marker takes a few extra bytes
+    result.data.resize(int(deflateBound(&stream, uLong(filtered.size()))) + 16);
+
+    stream.next_in = filteredPtr;
+    stream.avail_in = uInt(filtered.size());
+    stream.next_out = reinterpret_cast<Bytef*>(result.data.data());
+    stream.avail_out = uInt(result.data.size());
+
+    const int r = deflate(&stream, isLastStripe ? Z_FINISH : Z_SYNC_FLUSH);
+
+    result.isValid = isLastStripe ?
+        r == Z_STREAM_END :
+        r == Z_OK && stream.avail_in == 0 && stream.avail_out > 0;
+
+    result.data.resize(int(stream.total_out));
+    deflateEnd(&stream);
+
+    if (!result.isValid) {
+        warnFile << "Could not compress PNG stripe, zlib error" << r;
+    }
+
+    return result;
+}
+
+QByteArray createHeader(const QRect &rc)
+{
+    QByteArray header;
+    appendUInt32(header, quint32(rc.width()));
+    appendUInt32(header, quint32(rc.height()));
+
+    const char format[] = {
+        8, // bit depth
+        6, // RGBA
+        0, // deflate
+        0, // adaptive filtering
+        0  // no interlace
+    };
+    header.append(format, sizeof(format));
+
+    return header;
+}
+
+QByteArray createPhysicalDimensions(qreal xRes, qreal yRes)
+{
+    // the resolution of the image is in pixels per point
+    QByteArray dimensions;
+    appendUInt32(dimensions, quint32(qRound(CM_TO_POINT(xRes) * 100.0)));
+    appendUInt32(dimensions, quint32(qRound(CM_TO_POINT(yRes) * 100.0)));
+    dimensions.append(char(1)); // meters
+
+    return dimensions;
+}
+
+QByteArray createIccProfile(const KoColorProfile *profile)
+{
+    const QByteArray rawData = profile->rawData();
+
+    QByteArray compressed(int(compressBound(uLong(rawData.size()))), Qt::Uninitialized);
+    uLongf compressedSize = uLongf(compressed.size());
+
+    if (compress(reinterpret_cast<Bytef*>(compressed.data()), &compressedSize,
+                 reinterpret_cast<const Bytef*>(rawData.constData()), uLong(rawData.size())) != Z_OK) {
+        return QByteArray();
+    }
+    compressed.resize(int(compressedSize));
+
+    QByteArray chunk("icc");
+    chunk.append(char(0)); // end of the name
+    chunk.append(char(0)); // deflate
+    chunk.append(compressed);
+
+    return chunk;
+}
+
+}
+
+namespace KisKraPreviewUtils
+{
+
+bool writePng(QIODevice *io, KisPaintDeviceSP dev, const QRect &rc,
+              qreal xRes, qreal yRes, int compressionLevel)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(!rc.isEmpty(), false);
+
+    compressionLevel = qBound(0, compressionLevel, 9);
+
+    // the same conversion KisPNGConverter::saveDeviceToStore() does
+    const KoColorSpace *dstColorSpace =
+        dev->colorSpace()->id() == "RGBA" ?
+        dev->colorSpace() : KoColorSpaceRegistry::instance()->rgb8();
+
+    bool result = io->write("\x89PNG\r\n\x1a\n", 8) == 8;
+    result &= writeChunk(io, "IHDR", createHeader(rc));
+    result &= writeChunk(io, "pHYs", createPhysicalDimensions(xRes, yRes));
+
+    // sRGB is the default for PNG, the profile is saved only if it is different
+    const KoColorProfile *profile = dstColorSpace->profile();
+    if (profile && !profile->name().contains(QLatin1String("srgb"), Qt::CaseInsensitive)) {
+        const QByteArray iccProfile = createIccProfile(profile);
+        if (!iccProfile.isEmpty()) {
+            result &= writeChunk(io, "iCCP", iccProfile);
+        }
+    }
+
+    if (!result) return false;
+
+    const int stripeHeight = qBound(1, STRIPE_DATA_SIZE / (rc.width() * 4 + 1), rc.height());
+    const int maxPendingStripes = 2 * qMax(1, QThread::idealThreadCount());
+
+    QQueue<QFuture<EncodedStripe>> pendingStripes;
+    quint32 adler = quint32(adler32(0, Z_NULL, 0));
+    bool isFirstStripe = true;
+
+    auto writeStripe = [&] (const EncodedStripe &stripe, bool isLastStripe) {
+        if (!stripe.isValid) return false;
+
+        QByteArray data;
+
+        if (isFirstStripe) {
+            // zlib header: deflate with 32k window, no dictionary
+            data.append("\x78\x9c", 2);
+            adler = stripe.adler;
+            isFirstStripe = false;
+        } else {
+            adler = quint32(adler32_combine(adler, stripe.adler, z_off_t(stripe.rawSize)));
+        }
+
+        data.append(stripe.data);
+
+        if (isLastStripe) {
+            appendUInt32(data, adler);
+        }
+
+        return writeChunk(io, "IDAT", data);
+    };
+
+    for (int y = rc.top(); y <= rc.bottom(); y += stripeHeight) {
+        const QRect stripeRect(rc.x(), y, rc.width(), qMin(stripeHeight, rc.bottom() - y + 1));
+        const bool isLastStripe = stripeRect.bottom() == rc.bottom();
+
+        pendingStripes.enqueue(
+            QtConcurrent::run([dev, rc, stripeRect, dstColorSpace, compressionLevel, isLastStripe] () {
+                return encodeStripe(dev, rc, stripeRect, dstColorSpace, compressionLevel, isLastStripe);
+            }));
+
+        while (pendingStripes.size() >= maxPendingStripes) {
+            result &= writeStripe(pendingStripes.dequeue().result(), false);
+        }
+    }
+
+    while (!pendingStripes.isEmpty()) {
+        QFuture<EncodedStripe> future = pendingStripes.dequeue();
+        result &= writeStripe(future.result(), pendingStripes.isEmpty());
+    }
+
+    result &= writeChunk(io, "IEND", QByteArray());
+
+    return result;
+}
+
+bool saveMergedImage(KoStore *store, const QString &filename,
+                     KisPaintDeviceSP dev, const QRect &rc,
+                     qreal xRes, qreal yRes, int compressionLevel)
+{
+    // PNG data is compressed already
+    const bool compressionEnabled = store->compressionEnabled();
+    store->setCompressionEnabled(false);
+
+    bool result = false;
+
+    if (store->open(filename)) {
+        KoStoreDevice io(store);
+        if (io.open(QIODevice::WriteOnly)) {
+            result = writePng(&io, dev, rc, xRes, yRes, compressionLevel);
+            io.close();
+        }
+        result &= store->close();
+    }
+
+    store->setCompressionEnabled(compressionEnabled);
+
+    if (!result) {
+        dbgFile << "Saving PNG failed:" << filename;
+    }
+
+    return result;
+}
+
+QImage createThumbnail(KisPaintDeviceSP dev, const QRect &rc, const QSize &size)
+{
+    QSize thumbnailSize = rc.size();
+    thumbnailSize.scale(size, Qt::KeepAspectRatio);
+
+    if (thumbnailSize.isEmpty()) {
+        return QImage();
+    }
+
+    const int factor =
+        qMax(1, qMin(rc.width() / thumbnailSize.width(),
+                     rc.height() / thumbnailSize.height()) / 2);
+
+    const QSize reducedSize((rc.width() + factor - 1) / factor,
+                            (rc.height() + factor - 1) / factor);
+
+    const KoColorSpace *cs = dev->colorSpace();
+    const int pixelSize = int(cs->pixelSize());
+    const KoMixColorsOp *mixOp = cs->mixColorsOp();
+
+    QByteArray reduced(reducedSize.width() * reducedSize.height() * pixelSize, Qt::Uninitialized);
+    quint8 *reducedPtr = reinterpret_cast<quint8*>(reduced.data());
+
+    const int stripeHeight = qMax(1, STRIPE_DATA_SIZE / (rc.width() * pixelSize * factor));
+
+    QVector<int> stripes;
+    for (int y = 0; y < reducedSize.height(); y += stripeHeight) {
+        stripes << y;
+    }
+
+    QtConcurrent::blockingMap(stripes, [&] (int firstRow) {
+        const int numRows = qMin(stripeHeight, reducedSize.height() - firstRow);
+
+        const QRect srcRect = QRect(rc.x(), rc.y() + firstRow * factor,
+                                    rc.width(), numRows * factor) & rc;
+
+        const int srcRowStride = srcRect.width() * pixelSize;
+        QByteArray src(srcRect.height() * srcRowStride, Qt::Uninitialized);
+        const quint8 *srcPtr = reinterpret_cast<const quint8*>(src.constData());
+        dev->readBytes(reinterpret_cast<quint8*>(src.data()), srcRect);
+
+        for (int row = 0; row < numRows; row++) {
+            const int blockHeight = qMin(factor, srcRect.height() - row * factor);
+            quint8 *dst = reducedPtr + (firstRow + row) * reducedSize.width() * pixelSize;
+
+            for (int col = 0; col < reducedSize.width(); col++) {
+                const int blockWidth = qMin(factor, srcRect.width() - col * factor);
+                const quint8 *block = srcPtr + row * factor * srcRowStride + col * factor * pixelSize;
+
+                mixOp->mixColorsRect(block, srcRowStride, blockWidth, blockHeight, dst);
+                dst += pixelSize;
+            }
+        }
+    });
+
+    KisPaintDeviceSP reducedDevice = new KisPaintDevice(cs);
+    reducedDevice->writeBytes(reducedPtr, QRect(QPoint(), reducedSize));
+
+    QImage image = reducedDevice->convertToQImage(0, QRect(QPoint(), reducedSize));
+    return image.scaled(thumbnailSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+}
+
+}
@@ -0,0 +1,74 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KIS_KRA_PREVIEW_UTILS_H
+#define KIS_KRA_PREVIEW_UTILS_H
+
+#include <QImage>
+#include <QRect>
+
+#include "kis_types.h"
+#include "kritalibkra_export.h"
+
+class QIODevice;
+class KoStore;
+
+/**
+ * Generation of mergedimage.png and preview.png of .kra files. Both
+ * images are created from the projection of the saved image, which can
+ * be huge, so the work is split between all the available threads.
+ */
+namespace KisKraPreviewUtils
+{
+
+/**
+ * Writes \p rc of \p dev into \p io as an 8-bit RGBA PNG image.
+ *
+ * The image is split into horizontal stripes that are color converted,
+ * filtered and deflated in parallel. Every stripe is flushed to a byte
+ * boundary, so the stripes can simply be concatenated into one zlib
+ * stream. They are written as soon as they are ready, in order, so
+ * the whole image is never kept in memory.
+ *
+ * @param compressionLevel the zlib compression level, 0-9
+ * @return true on success
+ */
+KRITALIBKRA_EXPORT bool writePng(QIODevice *io, KisPaintDeviceSP dev, const QRect &rc,
+                                 qreal xRes, qreal yRes, int compressionLevel);
+
+/**
+ * Writes \p rc of \p dev into file \p filename of \p store with
+ * writePng(). The store doesn't try to compress the data once more.
+ */
+KRITALIBKRA_EXPORT bool saveMergedImage(KoStore *store, const QString &filename,
+                                        KisPaintDeviceSP dev, const QRect &rc,
+                                        qreal xRes, qreal yRes, int compressionLevel);
+
+/**
+ * Scales \p rc of \p dev down to fit into \p size, keeping the aspect
+ * ratio. The image is first reduced with a box filter in parallel
+ * stripes to about twice the size of the thumbnail, then the small
+ * intermediate image is smoothly scaled to the final size.
+ *
+ * @return the thumbnail in sRGB color space
+ */
+KRITALIBKRA_EXPORT QImage createThumbnail(KisPaintDeviceSP dev, const QRect &rc, const QSize &size);
+
+}
+
+#endif // KIS_KRA_PREVIEW_UTILS_H
@@ -0,0 +1,60 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_kra_save_cache.h"
+
+#include <QFileInfo>
+#include <QGlobalStatic>
+#include <QMutexLocker>
+
+Q_GLOBAL_STATIC(KisKraSaveCache, s_instance)
+
+namespace {
+QString normalizedFileName(const QString &fileName)
+{
+    return QFileInfo(fileName).absoluteFilePath();
+}
+}
+
+KisKraSaveCache *KisKraSaveCache::instance()
+{
+    return s_instance;
+}
+
+QByteArray KisKraSaveCache::key(const QByteArray &contentHash, bool compressionEnabled)
+{
+    return contentHash + (compressionEnabled ? "c" : "s");
+}
+
+KisKraSaveCache::Entries KisKraSaveCache::entries(const QString &fileName) const
+{
+    QMutexLocker l(&m_mutex);
+    return m_files.value(normalizedFileName(fileName));
+}
+
+void KisKraSaveCache::setEntries(const QString &fileName, const Entries &entries)
+{
+    QMutexLocker l(&m_mutex);
+    m_files.insert(normalizedFileName(fileName), entries);
+}
+
+void KisKraSaveCache::forgetEntries(const QString &fileName)
+{
+    QMutexLocker l(&m_mutex);
+    m_files.remove(normalizedFileName(fileName));
+}
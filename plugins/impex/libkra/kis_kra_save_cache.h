@@ -0,0 +1,88 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KIS_KRA_SAVE_CACHE_H
+#define KIS_KRA_SAVE_CACHE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+#include "kritalibkra_export.h"
+
+/**
+ * Remembers where the pixel data of the paint devices has been written
+ * during the last save of every .kra file. When the file is saved again,
+ * the devices whose content didn't change are copied from the previous
+ * version of the file as raw zip entries, without serializing and
+ * compressing them once more. It makes saving (and especially
+ * autosaving) of big documents much faster when only a few layers have
+ * been modified.
+ *
+ * The devices are identified by the hash of their content (see
+ * KisTiledDataManager::contentHash()), not by the nodes, because the
+ * image is cloned for every save. The checksum and the size of every
+ * entry are verified before copying, so the entries are not reused if
+ * the file has been changed by someone else in the meantime.
+ *
+ * The object is shared between all the documents and is thread-safe.
+ */
+class KRITALIBKRA_EXPORT KisKraSaveCache
+{
+public:
+    struct Entry {
+        QString location;
+        quint32 crc = 0;
+        qint64 uncompressedSize = 0;
+    };
+
+    /// the key is the content hash combined with the compression mode
+    typedef QHash<QByteArray, Entry> Entries;
+
+    static KisKraSaveCache* instance();
+
+    /**
+     * @return the key of the device with \p contentHash written with
+     * compression mode \p compressionEnabled
+     */
+    static QByteArray key(const QByteArray &contentHash, bool compressionEnabled);
+
+    /**
+     * @return the entries written during the last save of \p fileName
+     */
+    Entries entries(const QString &fileName) const;
+
+    /**
+     * Replaces the entries of \p fileName with the ones written during
+     * the current save
+     */
+    void setEntries(const QString &fileName, const Entries &entries);
+
+    /**
+     * Forgets about the entries of \p fileName, e.g. if the file could
+     * not be saved
+     */
+    void forgetEntries(const QString &fileName);
+
+private:
+    mutable QMutex m_mutex;
+    QHash<QString, Entries> m_files;
+};
+
+#endif // KIS_KRA_SAVE_CACHE_H
@@ -23,6 +23,11 @@
 
 #include <QBuffer>
 #include <QByteArray>
+#include <QFuture>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <functional>
 
 #include <KoColorProfile.h>
 #include <KoStore.h>
@@ -32,6 +37,7 @@
 #include <generator/kis_generator_layer.h>
 #include <kis_adjustment_layer.h>
 #include <kis_annotation.h>
+#include <kis_datamanager.h>
 #include <kis_group_layer.h>
 #include <kis_image.h>
 #include <kis_layer.h>
@@ -55,7 +61,7 @@
 #include <kis_meta_data_io_backend.h>
 
 #include "kis_config.h"
-#include "kis_store_paintdevice_writer.h"
+#include "kis_paint_device_writer.h"
 #include "flake/kis_shape_selection.h"
 
 #include "kis_raster_keyframe_channel.h"
@@ -69,19 +75,73 @@
 
 using namespace KRA;
 
+namespace {
+
+/**
+ * Collects the data written by the paint device in memory, so that
+ * it could be compressed outside the store
+ */
+class KisBufferPaintDeviceWriter : public KisPaintDeviceWriter
+{
+public:
+    bool write(const QByteArray &data) override {
+        m_buffer.append(data);
+        return true;
+    }
+
+    bool write(const char* data, qint64 length) override {
+        m_buffer.append(data, int(length));
+        return true;
+    }
+
+    QByteArray m_buffer;
+};
+
+/**
+ * The pixel data is compressed in independent chunks, so that the
+ * readers could seek inside big layers without inflating everything
+ * that precedes the data they need
+ */
+const qint64 pixelDataChunkSize = 1 << 20;
+
+}
+
+struct KisKraSaveVisitor::PendingPaintDevice
+{
+    QString location;
+    QByteArray defaultPixel;
+
+    /// serializes and compresses the device, safe to be called from any thread
+    std::function<bool(KoStore::CompressedData*)> encode;
+
+    /// filled by the worker thread, valid only after the future has finished
+    KoStore::CompressedData data;
+    QByteArray key;
+    bool canBeReused = false;
+    KisKraSaveCache::Entry previousEntry;
+    QFuture<bool> future;
+};
+
 KisKraSaveVisitor::KisKraSaveVisitor(KoStore *store, const QString & name, QMap<const KisNode*, QString> nodeFileNames)
     : KisNodeVisitor()
     , m_store(store)
     , m_external(false)
     , m_name(name)
     , m_nodeFileNames(nodeFileNames)
-    , m_writer(new KisStorePaintDeviceWriter(store))
+    , m_compressKra(KisConfig(true).compressKra())
+    , m_reuseUnchangedData(KisConfig(true).reuseUnchangedKraData())
+    , m_previousStore(0)
+    // limit the amount of the uncompressed data kept in memory
+    , m_maxPendingPaintDevices(2 * qMax(1, QThread::idealThreadCount()))
 {
 }
 
 KisKraSaveVisitor::~KisKraSaveVisitor()
 {
-    delete m_writer;
+    // the workers reference the store, they must not outlive the visitor
+    Q_FOREACH (QSharedPointer<PendingPaintDevice> pending, m_pendingPaintDevices) {
+        pending->future.waitForFinished();
+    }
 }
 
 void KisKraSaveVisitor::setExternalUri(const QString &uri)
@@ -310,11 +370,105 @@ bool KisKraSaveVisitor::visit(KisColorizeMask *mask)
     return true;
 }
 
+void KisKraSaveVisitor::writePendingPaintDevices()
+{
+    writeFinishedPaintDevices(true);
+}
+
+void KisKraSaveVisitor::setPreviousStore(KoStore *previousStore, const KisKraSaveCache::Entries &entries)
+{
+    m_previousStore = previousStore;
+    m_previousEntries = entries;
+}
+
+KisKraSaveCache::Entries KisKraSaveVisitor::savedEntries() const
+{
+    return m_savedEntries;
+}
+
 QStringList KisKraSaveVisitor::errorMessages() const
 {
     return m_errorMessages;
 }
 
+void KisKraSaveVisitor::writeFinishedPaintDevices(bool waitForAll)
+{
+    if (!waitForAll && m_store->isOpen()) return;
+
+    // the blobs that were not worth compressing are written in the usual way
+    m_store->setCompressionEnabled(m_compressKra);
+
+    while (!m_pendingPaintDevices.isEmpty()) {
+        QSharedPointer<PendingPaintDevice> pending = m_pendingPaintDevices.head();
+
+        if (!waitForAll &&
+            !pending->future.isFinished() &&
+            m_pendingPaintDevices.size() <= m_maxPendingPaintDevices) {
+
+            break;
+        }
+
+        m_pendingPaintDevices.dequeue();
+
+        bool result = pending->future.result();
+
+        if (result && pending->canBeReused &&
+            !readPreviousData(pending->previousEntry, &pending->data)) {
+
+            // the previous file has been changed, so encode the device once more
+            result = pending->encode(&pending->data);
+        }
+
+        if (!result) {
+            m_errorMessages << i18n("Failed to save the pixel data for %1.", pending->location);
+            continue;
+        }
+
+        if (!m_store->writeCompressedData(pending->location, pending->data)) {
+            m_errorMessages << i18n("Failed to open %1.", pending->location);
+        } else if (!pending->key.isEmpty()) {
+            KisKraSaveCache::Entry entry;
+            entry.location = pending->location;
+            entry.crc = pending->data.crc;
+            entry.uncompressedSize = pending->data.uncompressedSize;
+            m_savedEntries.insert(pending->key, entry);
+        }
+
+        m_store->writeCompressedData(pending->location + ".defaultpixel",
+                                     m_store->compressData(pending->defaultPixel, m_compressKra));
+    }
+
+    m_store->setCompressionEnabled(true);
+}
+
+bool KisKraSaveVisitor::readPreviousData(const KisKraSaveCache::Entry &entry, KoStore::CompressedData *data)
+{
+    if (!m_previousStore) return false;
+
+    KoStore::CompressedData previousData;
+
+    if (!m_previousStore->readCompressedData(entry.location, &previousData) ||
+        !previousData.isCompressed ||
+        previousData.crc != entry.crc ||
+        previousData.uncompressedSize != entry.uncompressedSize) {
+
+        return false;
+    }
+
+    *data = previousData;
+    return true;
+}
+
+QString KisKraSaveVisitor::absoluteLocation(const QString &location) const
+{
+    /**
+     * The device is written into the store later, when the current
+     * directory of the store may already be different (e.g. colorize
+     * mask pushes its own one)
+     */
+    return location.startsWith("tar:/") ? location : "tar:/" + m_store->currentPath() + location;
+}
+
 struct SimpleDevicePolicy
 {
     bool write(KisPaintDeviceSP dev, KisPaintDeviceWriter &store) {
@@ -324,6 +478,10 @@ struct SimpleDevicePolicy
     KoColor defaultPixel(KisPaintDeviceSP dev) const {
         return dev->defaultPixel();
     }
+
+    QByteArray contentHash(KisPaintDeviceSP dev) const {
+        return dev->dataManager()->contentHash();
+    }
 };
 
 struct FramedDevicePolicy
@@ -339,16 +497,16 @@ struct FramedDevicePolicy
         return dev->framesInterface()->frameDefaultPixel(m_frameId);
     }
 
+    QByteArray contentHash(KisPaintDeviceSP dev) const {
+        return dev->framesInterface()->frameDataManager(m_frameId)->contentHash();
+    }
+
     int m_frameId;
 };
 
 bool KisKraSaveVisitor::savePaintDevice(KisPaintDeviceSP device,
                                         QString location)
 {
-    // Layer data
-    KisConfig cfg(true);
-    m_store->setCompressionEnabled(cfg.compressKra());
-
     KisPaintDeviceFramesInterface *frameInterface = device->framesInterface();
     QList<int> frames;
 
@@ -373,7 +531,6 @@ bool KisKraSaveVisitor::savePaintDevice(KisPaintDeviceSP device,
         }
     }
 
-    m_store->setCompressionEnabled(true);
     return true;
 }
 
@@ -381,19 +538,49 @@ bool KisKraSaveVisitor::savePaintDevice(KisPaintDeviceSP device,
 template<class DevicePolicy>
 bool KisKraSaveVisitor::savePaintDeviceFrame(KisPaintDeviceSP device, QString location, DevicePolicy policy)
 {
-    if (m_store->open(location)) {
-        if (!policy.write(device, *m_writer)) {
-            device->disconnect();
-            m_store->close();
+    QSharedPointer<PendingPaintDevice> pending(new PendingPaintDevice());
+    pending->location = absoluteLocation(location);
+    pending->defaultPixel = QByteArray((const char*)policy.defaultPixel(device).data(),
+                                       device->colorSpace()->pixelSize());
+
+    const KoStore *store = m_store;
+    const bool compressionEnabled = m_compressKra;
+
+    pending->encode = [device, policy, store, compressionEnabled] (KoStore::CompressedData *data) mutable {
+        KisBufferPaintDeviceWriter writer;
+        if (!policy.write(device, writer)) {
             return false;
         }
 
-        m_store->close();
-    }
-    if (m_store->open(location + ".defaultpixel")) {
-        m_store->write((char*)policy.defaultPixel(device).data(), device->colorSpace()->pixelSize());
-        m_store->close();
-    }
+        *data = store->compressData(writer.m_buffer, compressionEnabled, pixelDataChunkSize);
+        return true;
+    };
+
+    const bool reuseUnchangedData = m_reuseUnchangedData;
+    const KisKraSaveCache::Entries previousEntries = m_previousEntries;
+
+    pending->future = QtConcurrent::run([pending, device, policy, reuseUnchangedData, previousEntries, compressionEnabled] () {
+        /**
+         * Hashing the tiles is much cheaper than compressing them, so it
+         * is worth checking whether the previous file already contains
+         * exactly the same data
+         */
+        if (reuseUnchangedData) {
+            pending->key = KisKraSaveCache::key(policy.contentHash(device), compressionEnabled);
+
+            KisKraSaveCache::Entries::const_iterator it = previousEntries.constFind(pending->key);
+            if (it != previousEntries.constEnd()) {
+                pending->previousEntry = *it;
+                pending->canBeReused = true;
+                return true;
+            }
+        }
+
+        return pending->encode(&pending->data);
+    });
+
+    m_pendingPaintDevices.enqueue(pending);
+    writeFinishedPaintDevices(false);
 
     return true;
 }
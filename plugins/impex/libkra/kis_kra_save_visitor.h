@@ -22,14 +22,16 @@
 
 #include <QRect>
 #include <QStringList>
+#include <QQueue>
+#include <QSharedPointer>
 
 #include "kis_types.h"
 #include "kis_node_visitor.h"
 #include "kis_image.h"
 #include "kritalibkra_export.h"
+#include "kis_kra_save_cache.h"
 
-class KisPaintDeviceWriter;
-class KoStore;
+#include <KoStore.h>
 
 class KRITALIBKRA_EXPORT KisKraSaveVisitor : public KisNodeVisitor
 {
@@ -67,10 +69,40 @@ public:
 
     bool visit(KisColorizeMask *mask) override;
 
+    /**
+     * The pixel data of the devices is compressed in the worker threads
+     * while the visitor walks through the nodes. The ready blobs are
+     * written into the store in the same order the devices have been
+     * visited. This method waits for all the pending devices and writes
+     * them, it should be called after the visitor has been accepted by
+     * the root layer. The errors are reported via errorMessages().
+     */
+    void writePendingPaintDevices();
+
+    /**
+     * Makes the visitor copy the pixel data of the devices that have not
+     * changed since the previous save from \p previousStore instead of
+     * encoding them once more. \p entries describe the data written into
+     * \p previousStore, see KisKraSaveCache. The store should stay alive
+     * until the visitor is destroyed.
+     */
+    void setPreviousStore(KoStore *previousStore, const KisKraSaveCache::Entries &entries);
+
+    /**
+     * @return the pixel data entries written by the visitor, they can be
+     * reused by the next save of the same file
+     */
+    KisKraSaveCache::Entries savedEntries() const;
+
     /// @return a list with everything that went wrong while saving
     QStringList errorMessages() const;
 
 private:
+    struct PendingPaintDevice;
+
+    void writeFinishedPaintDevices(bool waitForAll);
+    bool readPreviousData(const KisKraSaveCache::Entry &entry, KoStore::CompressedData *data);
+    QString absoluteLocation(const QString &location) const;
 
     bool savePaintDevice(KisPaintDeviceSP device, QString location);
 
@@ -91,8 +123,14 @@ private:
     QString m_uri;
     QString m_name;
     QMap<const KisNode*, QString> m_nodeFileNames;
-    KisPaintDeviceWriter *m_writer;
     QStringList m_errorMessages;
+    bool m_compressKra;
+    bool m_reuseUnchangedData;
+    KoStore *m_previousStore;
+    KisKraSaveCache::Entries m_previousEntries;
+    KisKraSaveCache::Entries m_savedEntries;
+    int m_maxPendingPaintDevices;
+    QQueue<QSharedPointer<PendingPaintDevice>> m_pendingPaintDevices;
 };
 
 #endif // KIS_KRA_SAVE_VISITOR_H_
@@ -19,6 +19,8 @@
 #include "kis_kra_saver.h"
 
 #include "kis_kra_tags.h"
+#include "kis_kra_preview_utils.h"
+#include "kis_kra_save_cache.h"
 #include "kis_kra_save_visitor.h"
 #include "kis_kra_savexml_visitor.h"
 
@@ -59,6 +61,7 @@
 #include "kis_dom_utils.h"
 #include "kis_grid_config.h"
 #include "kis_guides_config.h"
+#include "kis_config.h"
 #include "KisProofingConfiguration.h"
 
 #include <KisMirrorAxisConfig.h>
@@ -241,19 +244,47 @@ bool KisKraSaver::saveBinaryData(KoStore* store, KisImageSP image, const QString
 {
     QString location;
 
+    const bool reuseUnchangedData =
+        KisConfig(true).reuseUnchangedKraData() && !m_d->filename.isEmpty();
+
+    // the unchanged layers are copied from the previous version of the file
+    QScopedPointer<KoStore> previousStore;
+    KisKraSaveCache::Entries previousEntries;
+
+    if (reuseUnchangedData) {
+        previousEntries = KisKraSaveCache::instance()->entries(m_d->filename);
+
+        if (!previousEntries.isEmpty() && QFileInfo(m_d->filename).exists()) {
+            previousStore.reset(KoStore::createStore(m_d->filename, KoStore::Read, "", KoStore::Zip));
+            if (previousStore->bad()) {
+                previousStore.reset();
+            }
+        }
+    }
+
     // Save the layers data
     KisKraSaveVisitor visitor(store, m_d->imageName, m_d->nodeFileNames);
 
     if (external)
         visitor.setExternalUri(uri);
 
+    if (previousStore) {
+        visitor.setPreviousStore(previousStore.data(), previousEntries);
+    }
+
     image->rootLayer()->accept(visitor);
+    visitor.writePendingPaintDevices();
 
     m_d->errorMessages.append(visitor.errorMessages());
     if (!m_d->errorMessages.isEmpty()) {
+        KisKraSaveCache::instance()->forgetEntries(m_d->filename);
         return false;
     }
 
+    if (reuseUnchangedData) {
+        KisKraSaveCache::instance()->setEntries(m_d->filename, visitor.savedEntries());
+    }
+
     // saving annotations
     // XXX this only saves EXIF and ICC info. This would probably need
     // a redesign of the dtd of the krita file to do this more generally correct
@@ -333,7 +364,15 @@ bool KisKraSaver::saveBinaryData(KoStore* store, KisImageSP image, const QString
 
     if (!autosave) {
         KisPaintDeviceSP dev = image->projection();
-        KisPNGConverter::saveDeviceToStore("mergedimage.png", image->bounds(), image->xRes(), image->yRes(), dev, store);
+        KisConfig cfg(true);
+
+        if (cfg.fastKraPreviews()) {
+            KisKraPreviewUtils::saveMergedImage(store, "mergedimage.png", dev, image->bounds(),
+                                                image->xRes(), image->yRes(),
+                                                cfg.kraMergedImageCompression());
+        } else {
+            KisPNGConverter::saveDeviceToStore("mergedimage.png", image->bounds(), image->xRes(), image->yRes(), dev, store);
+        }
     }
 
     saveAssistants(store, uri,external);
@@ -0,0 +1,285 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisKraSaveBenchmark.h"
+
+#include <QTest>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QScopedPointer>
+#include <QBuffer>
+
+#include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+#include <KisDocument.h>
+#include <KisPart.h>
+#include <KoStore.h>
+
+#include "kis_image.h"
+#include "kis_group_layer.h"
+#include "kis_paint_layer.h"
+#include "kis_sequential_iterator.h"
+#include <kis_count_visitor.h>
+#include <KoProperties.h>
+#include "kis_config.h"
+#include "testutil.h"
+#include "kis_png_converter.h"
+#include "kis_kra_preview_utils.h"
+
+#include <sdk/tests/kistest.h>
+
+namespace {
+
+const int IMAGE_WIDTH = 1024;
+const int IMAGE_HEIGHT = 1024;
+const int NUM_LAYERS = 150;
+const int LARGE_PROJECTION_SIZE = 8192;
+
+/**
+ * A large document with layers that are not trivial for the
+ * compressor: a gradient with a bit of noise over a part of
+ * the canvas, every layer covers a different area
+ */
+KisDocument* createLargeDocument()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, IMAGE_WIDTH, IMAGE_HEIGHT, cs, "save benchmark");
+
+    KisDocument *doc = qobject_cast<KisDocument*>(KisPart::instance()->createDocument());
+    doc->setCurrentImage(image);
+
+    qsrand(1);
+
+    for (int i = 0; i < NUM_LAYERS; i++) {
+        KisPaintLayerSP layer = new KisPaintLayer(image, QString("layer%1").arg(i), OPACITY_OPAQUE_U8, cs);
+
+        const int x = (i * 37) % (IMAGE_WIDTH / 2);
+        const int y = (i * 91) % (IMAGE_HEIGHT / 2);
+        const QRect rc(x, y, IMAGE_WIDTH / 2 + (i * 13) % (IMAGE_WIDTH / 2), IMAGE_HEIGHT / 2);
+
+        KisSequentialIterator it(layer->paintDevice(), rc);
+        while (it.nextPixel()) {
+            quint8 *pixel = it.rawData();
+            const int noise = qrand() & 0x7;
+            pixel[0] = quint8((it.x() + noise) & 0xff);
+            pixel[1] = quint8((it.y() + i) & 0xff);
+            pixel[2] = quint8((it.x() + it.y() + noise) & 0xff);
+            pixel[3] = 0xff;
+        }
+
+        image->addNode(layer, image->root());
+    }
+
+    return doc;
+}
+
+/**
+ * A big projection-like device for measuring mergedimage.png
+ * and preview.png generation
+ */
+KisPaintDeviceSP createLargeProjection()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    qsrand(1);
+
+    KisSequentialIterator it(dev, QRect(0, 0, LARGE_PROJECTION_SIZE, LARGE_PROJECTION_SIZE));
+    while (it.nextPixel()) {
+        quint8 *pixel = it.rawData();
+        const int noise = qrand() & 0x7;
+        pixel[0] = quint8((it.x() / 4 + noise) & 0xff);
+        pixel[1] = quint8((it.y() / 4) & 0xff);
+        pixel[2] = quint8((it.x() + it.y() + noise) / 16 & 0xff);
+        pixel[3] = 0xff;
+    }
+
+    return dev;
+}
+
+}
+
+void KisKraSaveBenchmark::initTestCase()
+{
+    KisConfig cfg(false);
+    m_compressKra = cfg.compressKra();
+    m_reuseUnchangedKraData = cfg.reuseUnchangedKraData();
+}
+
+void KisKraSaveBenchmark::benchmarkSave_data()
+{
+    QTest::addColumn<bool>("compressKra");
+
+    QTest::newRow("compressed") << true;
+    QTest::newRow("uncompressed") << false;
+}
+
+void KisKraSaveBenchmark::benchmarkSave()
+{
+    QFETCH(bool, compressKra);
+
+    KisConfig(false).setCompressKra(compressKra);
+
+    QScopedPointer<KisDocument> doc(createLargeDocument());
+    const QString fileName = QString("save_benchmark_%1.kra").arg(QTest::currentDataTag());
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QBENCHMARK_ONCE {
+        QVERIFY(doc->exportDocumentSync(QUrl::fromLocalFile(fileName), doc->mimeType()));
+    }
+
+    qDebug() << "Saved" << NUM_LAYERS << "layers in" << timer.elapsed() << "ms," << QFileInfo(fileName).size() / 1024 << "KiB";
+
+    KisConfig(false).setCompressKra(m_compressKra);
+
+    // check that the file is still consistent
+    QScopedPointer<KisDocument> doc2(KisPart::instance()->createDocument());
+    QVERIFY(doc2->loadNativeFormat(fileName));
+
+    QStringList list;
+    KisCountVisitor cv1(list, KoProperties());
+    doc->image()->rootLayer()->accept(cv1);
+    KisCountVisitor cv2(list, KoProperties());
+    doc2->image()->rootLayer()->accept(cv2);
+    QCOMPARE(cv2.count(), cv1.count());
+}
+
+void KisKraSaveBenchmark::benchmarkResaveAfterEdit_data()
+{
+    QTest::addColumn<bool>("reuseUnchangedData");
+
+    QTest::newRow("reuse") << true;
+    QTest::newRow("full") << false;
+}
+
+void KisKraSaveBenchmark::benchmarkResaveAfterEdit()
+{
+    QFETCH(bool, reuseUnchangedData);
+
+    KisConfig(false).setReuseUnchangedKraData(reuseUnchangedData);
+
+    QScopedPointer<KisDocument> doc(createLargeDocument());
+    const QString fileName = QString("resave_benchmark_%1.kra").arg(QTest::currentDataTag());
+
+    QVERIFY(doc->exportDocumentSync(QUrl::fromLocalFile(fileName), doc->mimeType()));
+
+    // the usual autosave scenario: a single stroke on one of the layers
+    KisNodeSP layer = doc->image()->root()->lastChild();
+    layer->paintDevice()->fill(QRect(100, 100, 200, 50), KoColor(Qt::red, layer->colorSpace()));
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QBENCHMARK_ONCE {
+        QVERIFY(doc->exportDocumentSync(QUrl::fromLocalFile(fileName), doc->mimeType()));
+    }
+
+    qDebug() << "Saved" << NUM_LAYERS << "layers after editing one in" << timer.elapsed() << "ms";
+
+    KisConfig(false).setReuseUnchangedKraData(m_reuseUnchangedKraData);
+
+    QScopedPointer<KisDocument> doc2(KisPart::instance()->createDocument());
+    QVERIFY(doc2->loadNativeFormat(fileName));
+
+    KisNodeSP layer2 = doc2->image()->root()->lastChild();
+    QVERIFY(layer2);
+
+    QPoint pt;
+    QVERIFY(TestUtil::comparePaintDevices(pt, layer->paintDevice(), layer2->paintDevice()));
+}
+
+void KisKraSaveBenchmark::benchmarkMergedImage_data()
+{
+    QTest::addColumn<bool>("fastPreviews");
+    QTest::addColumn<int>("compression");
+
+    QTest::newRow("png-converter") << false << 0;
+    QTest::newRow("parallel-6") << true << 6;
+    QTest::newRow("parallel-1") << true << 1;
+}
+
+void KisKraSaveBenchmark::benchmarkMergedImage()
+{
+    QFETCH(bool, fastPreviews);
+    QFETCH(int, compression);
+
+    KisPaintDeviceSP dev = createLargeProjection();
+    const QRect rc(0, 0, LARGE_PROJECTION_SIZE, LARGE_PROJECTION_SIZE);
+
+    QByteArray archive;
+    QBuffer buffer(&archive);
+    QScopedPointer<KoStore> store(KoStore::createStore(&buffer, KoStore::Write, "application/x-krita", KoStore::Zip));
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QBENCHMARK_ONCE {
+        if (fastPreviews) {
+            QVERIFY(KisKraPreviewUtils::saveMergedImage(store.data(), "mergedimage.png", dev, rc, 1.0, 1.0, compression));
+        } else {
+            QVERIFY(KisPNGConverter::saveDeviceToStore("mergedimage.png", rc, 1.0, 1.0, dev, store.data()));
+        }
+    }
+
+    QVERIFY(store->finalize());
+
+    qDebug() << "Saved merged image in" << timer.elapsed() << "ms," << archive.size() / 1024 << "KiB";
+}
+
+void KisKraSaveBenchmark::benchmarkThumbnail_data()
+{
+    QTest::addColumn<bool>("fastPreviews");
+
+    QTest::newRow("transform-worker") << false;
+    QTest::newRow("parallel") << true;
+}
+
+void KisKraSaveBenchmark::benchmarkThumbnail()
+{
+    QFETCH(bool, fastPreviews);
+
+    KisPaintDeviceSP dev = createLargeProjection();
+    const QRect rc(0, 0, LARGE_PROJECTION_SIZE, LARGE_PROJECTION_SIZE);
+
+    QImage thumbnail;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QBENCHMARK_ONCE {
+        if (fastPreviews) {
+            thumbnail = KisKraPreviewUtils::createThumbnail(dev, rc, QSize(256, 256));
+        } else {
+            // the same thing KisDocument::generatePreview() does
+            KisImageSP image = new KisImage(0, rc.width(), rc.height(), dev->colorSpace(), "thumbnail benchmark");
+            KisPaintLayerSP layer = new KisPaintLayer(image, "layer", OPACITY_OPAQUE_U8, dev);
+            image->addNode(layer, image->root());
+            image->initialRefreshGraph();
+
+            thumbnail = image->convertToQImage(QSize(256, 256), 0);
+        }
+    }
+
+    qDebug() << "Created thumbnail in" << timer.elapsed() << "ms";
+
+    QCOMPARE(thumbnail.size(), QSize(256, 256));
+}
+
+KISTEST_MAIN(KisKraSaveBenchmark)
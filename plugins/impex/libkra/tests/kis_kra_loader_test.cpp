@@ -25,10 +25,16 @@
 #include <KoColorSpaceRegistry.h>
 #include <KoColorSpace.h>
 #include <KoColor.h>
+#include <KoStore.h>
+#include <KoXmlReader.h>
 
 #include "kis_image.h"
 #include "testutil.h"
 #include "KisPart.h"
+#include "kis_config.h"
+#include "kis_kra_loader.h"
+#include "kis_paint_layer.h"
+#include "kis_paint_device_frames_interface.h"
 
 #include <filter/kis_filter_registry.h>
 #include <generator/kis_generator_registry.h>
@@ -116,11 +122,64 @@ void KisKraLoaderTest::testObligeSingleChildNonTranspPixel()
     testObligeSingleChildImpl(false);
 }
 
-void KisKraLoaderTest::testLoadAnimated()
+/**
+ * Loads the file the same way KraConverter does, but locks the image
+ * before the pixel data is loaded, so that the stroke that puts the
+ * deferred data into the devices is not executed until the image is
+ * unlocked.
+ */
+static KisImageSP loadImageLocked(KisDocument *doc, const QString &fileName, bool lazyLoading)
+{
+    KisConfig cfg(false);
+    const bool oldLazyLoading = cfg.lazyLoadKra();
+    cfg.setLazyLoadKra(lazyLoading);
+
+    QScopedPointer<KoStore> store(KoStore::createStore(fileName, KoStore::Read, "", KoStore::Zip));
+    KIS_ASSERT(!store->bad());
+
+    KoXmlDocument xmlDoc;
+    const bool opened = store->open("root");
+    KIS_ASSERT(opened);
+    const bool parsed = xmlDoc.setContent(store->device());
+    KIS_ASSERT(parsed);
+    store->close();
+
+    const KoXmlElement root = xmlDoc.documentElement();
+    const KoXmlElement imageElement = root.firstChildElement("IMAGE");
+
+    KisKraLoader loader(doc, root.attribute("syntaxVersion", "3").toInt());
+    KisImageSP image = loader.loadXML(imageElement);
+    KIS_ASSERT(image);
+    doc->hackPreliminarySetImage(image);
+
+    image->lock();
+    loader.loadBinaryData(store.data(), image, fileName, true);
+
+    cfg.setLazyLoadKra(oldLazyLoading);
+
+    return image;
+}
+
+static void testLoadAnimatedImpl(bool lazyLoading)
 {
     QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
-    doc->loadNativeFormat(QString(FILES_DATA_DIR) + QDir::separator() + "load_test_animation.kra");
-    KisImageSP image = doc->image();
+    KisImageSP image = loadImageLocked(doc.data(), QString(FILES_DATA_DIR) + QDir::separator() + "load_test_animation.kra", lazyLoading);
+
+    {
+        KisNodeSP node = image->root()->firstChild();
+        KisPaintDeviceFramesInterface *frames = node->paintDevice()->framesInterface();
+
+        QCOMPARE(frames->frames().size(), 3);
+
+        Q_FOREACH (int id, frames->frames()) {
+            const bool isDeferred = lazyLoading && id != frames->currentFrameId();
+            QCOMPARE(frames->frameDataManager(id)->extent().isEmpty(), isDeferred);
+        }
+    }
+
+    // let the deferred frames be put into the devices
+    image->unlock();
+    image->waitForDone();
 
     KisNodeSP node1 = image->root()->firstChild();
     KisNodeSP node2 = node1->nextSibling();
@@ -174,6 +233,116 @@ void KisKraLoaderTest::testLoadAnimated()
     QCOMPARE(dev->defaultPixel(), red);
 }
 
+void KisKraLoaderTest::testLoadAnimated()
+{
+    testLoadAnimatedImpl(false);
+}
+
+void KisKraLoaderTest::testLoadAnimatedLazily()
+{
+    testLoadAnimatedImpl(true);
+}
+
+void KisKraLoaderTest::testLoadHiddenLayerLazily()
+{
+    const QRect rc(0, 0, 300, 200);
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    {
+        QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+        KisImageSP image = new KisImage(0, rc.width(), rc.height(), cs, "hidden layer test");
+        doc->setCurrentImage(image);
+
+        KisPaintLayerSP visibleLayer = new KisPaintLayer(image, "visible", OPACITY_OPAQUE_U8);
+        KisPaintLayerSP hiddenLayer = new KisPaintLayer(image, "hidden", OPACITY_OPAQUE_U8);
+
+        visibleLayer->paintDevice()->fill(QRect(10, 10, 100, 100), KoColor(Qt::red, cs));
+        hiddenLayer->paintDevice()->fill(QRect(50, 20, 200, 150), KoColor(Qt::blue, cs));
+        hiddenLayer->setVisible(false);
+
+        image->addNode(visibleLayer, image->root());
+        image->addNode(hiddenLayer, image->root());
+        image->initialRefreshGraph();
+
+        QVERIFY(doc->exportDocumentSync(QUrl::fromLocalFile("load_hidden_layer_lazily.kra"), doc->mimeType()));
+    }
+
+    QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+    KisImageSP image = loadImageLocked(doc.data(), "load_hidden_layer_lazily.kra", true);
+
+    KisNodeSP visibleLayer = image->root()->findChildByName("visible");
+    KisNodeSP hiddenLayer = image->root()->findChildByName("hidden");
+
+    QVERIFY(visibleLayer);
+    QVERIFY(hiddenLayer);
+    QVERIFY(!hiddenLayer->visible());
+
+    // the data of the hidden layer is not there yet
+    QCOMPARE(visibleLayer->paintDevice()->exactBounds(), QRect(10, 10, 100, 100));
+    QVERIFY(hiddenLayer->paintDevice()->extent().isEmpty());
+
+    image->unlock();
+    image->waitForDone();
+
+    QCOMPARE(visibleLayer->paintDevice()->exactBounds(), QRect(10, 10, 100, 100));
+    QCOMPARE(hiddenLayer->paintDevice()->exactBounds(), QRect(50, 20, 200, 150));
+
+    KoColor color(cs);
+    hiddenLayer->paintDevice()->pixel(60, 30, &color);
+    QCOMPARE(color, KoColor(Qt::blue, cs));
+}
+
+void KisKraLoaderTest::testDefaultPixelWithCustomProfile()
+{
+    const QRect rc(0, 0, 400, 300);
+    const QRect fillRect1(10, 10, 50, 50);
+    const QRect fillRect2(300, 200, 40, 40);
+
+    const KoColorSpace *imageCs = KoColorSpaceRegistry::instance()->rgb8();
+    const KoColorSpace *layerCs = KoColorSpaceRegistry::instance()->rgb8("sRGB-elle-V2-g10.icc");
+    QVERIFY(layerCs);
+    QVERIFY(!(*layerCs == *imageCs));
+
+    const KoColor defaultPixel(QColor(200, 50, 30), layerCs);
+
+    {
+        QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+        KisImageSP image = new KisImage(0, rc.width(), rc.height(), imageCs, "default pixel test");
+        doc->setCurrentImage(image);
+
+        KisPaintLayerSP layer = new KisPaintLayer(image, "layer", OPACITY_OPAQUE_U8, layerCs);
+        layer->paintDevice()->setDefaultPixel(defaultPixel);
+        // the fills are far apart, so there are no tiles between them
+        layer->paintDevice()->fill(fillRect1, KoColor(Qt::green, layerCs));
+        layer->paintDevice()->fill(fillRect2, KoColor(Qt::green, layerCs));
+
+        image->addNode(layer, image->root());
+        image->initialRefreshGraph();
+
+        QVERIFY(doc->exportDocumentSync(QUrl::fromLocalFile("default_pixel_custom_profile.kra"), doc->mimeType()));
+    }
+
+    QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+    QVERIFY(doc->loadNativeFormat("default_pixel_custom_profile.kra"));
+
+    KisNodeSP layer = doc->image()->root()->firstChild();
+    QVERIFY(layer);
+
+    KisPaintDeviceSP dev = layer->paintDevice();
+    QVERIFY(*dev->colorSpace() == *layerCs);
+
+    // the bytes of the default pixel should be loaded as they are
+    QVERIFY(dev->defaultPixel() == defaultPixel);
+    QCOMPARE(dev->nonDefaultPixelArea(), fillRect1 | fillRect2);
+
+    // the areas without tiles should keep the default pixel
+    KoColor pixel;
+    dev->pixel(150, 120, &pixel);
+    QVERIFY(pixel == defaultPixel);
+    dev->pixel(320, 30, &pixel);
+    QVERIFY(pixel == defaultPixel);
+}
+
 
 
 void KisKraLoaderTest::testImportFromWriteonly()
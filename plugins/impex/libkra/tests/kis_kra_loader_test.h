@@ -32,6 +32,10 @@ private Q_SLOTS:
     void testObligeSingleChildNonTranspPixel();
 
     void testLoadAnimated();
+    void testLoadAnimatedLazily();
+    void testLoadHiddenLayerLazily();
+
+    void testDefaultPixelWithCustomProfile();
 
     void testImportFromWriteonly();
     void testImportIncorrectFormat();
@@ -21,6 +21,7 @@
 #include <QTest>
 
 #include <QBitArray>
+#include <QBuffer>
 
 #include <KisDocument.h>
 #include <KoDocumentInfo.h>
@@ -346,6 +347,110 @@ void KisKraSaverTest::testRoundTripAnimation()
 
 }
 
+#include "kis_kra_save_cache.h"
+#include "kis_config.h"
+
+void KisKraSaverTest::testSaveUnchangedLayersReused()
+{
+    const QString fileName = "save_unchanged_layers.kra";
+    KisConfig(false).setReuseUnchangedKraData(true);
+    KisKraSaveCache::instance()->forgetEntries(fileName);
+
+    QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+
+    QRect imageRect(0,0,512,512);
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(new KisSurrogateUndoStore(), imageRect.width(), imageRect.height(), cs, "test image");
+
+    QList<KisPaintLayerSP> layers;
+    for (int i = 0; i < 3; i++) {
+        KisPaintLayerSP layer = new KisPaintLayer(image, QString("paint%1").arg(i), OPACITY_OPAQUE_U8);
+        layer->paintDevice()->fill(QRect(50 * i, 100, 150, 150), KoColor(QColor(80 * i, 0, 0), cs));
+        image->addNode(layer);
+        layers << layer;
+    }
+
+    doc->setCurrentImage(image);
+    QVERIFY(doc->exportDocumentSync(QUrl::fromLocalFile(fileName), doc->mimeType()));
+
+    KisKraSaveCache::Entries entries = KisKraSaveCache::instance()->entries(fileName);
+    QCOMPARE(entries.size(), layers.size());
+
+    // the second layer is changed, the first one is moved, which is not a change of the data
+    layers[1]->paintDevice()->fill(QRect(300, 300, 10, 10), KoColor(Qt::blue, cs));
+    layers[0]->paintDevice()->moveTo(10, 20);
+
+    // one of the entries doesn't match the file anymore, it should not be reused
+    entries.begin()->crc ^= 0x1;
+    KisKraSaveCache::instance()->setEntries(fileName, entries);
+
+    QVERIFY(doc->exportDocumentSync(QUrl::fromLocalFile(fileName), doc->mimeType()));
+    QCOMPARE(KisKraSaveCache::instance()->entries(fileName).size(), layers.size());
+
+    QScopedPointer<KisDocument> doc2(KisPart::instance()->createDocument());
+    QVERIFY(doc2->loadNativeFormat(fileName));
+
+    Q_FOREACH (KisPaintLayerSP layer, layers) {
+        KisNodeSP node = TestUtil::findNode(doc2->image()->root(), layer->name());
+        QVERIFY(node);
+
+        QPoint pt;
+        QVERIFY(TestUtil::comparePaintDevices(pt, layer->paintDevice(), node->paintDevice()));
+        QCOMPARE(node->paintDevice()->x(), layer->paintDevice()->x());
+        QCOMPARE(node->paintDevice()->y(), layer->paintDevice()->y());
+    }
+}
+
+#include "kis_kra_preview_utils.h"
+#include "kis_sequential_iterator.h"
+
+void KisKraSaverTest::testWriteMergedImagePng()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    // the image is big enough to be split into several stripes
+    const QRect rc(0, 0, 2000, 1200);
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    KisSequentialIterator it(dev, rc);
+    while (it.nextPixel()) {
+        quint8 *pixel = it.rawData();
+        pixel[0] = quint8(it.x());
+        pixel[1] = quint8(it.y());
+        pixel[2] = quint8(it.x() * it.y());
+        pixel[3] = quint8(it.x() + 3 * it.y());
+    }
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    QVERIFY(KisKraPreviewUtils::writePng(&buffer, dev, rc, 1.0, 1.0, 6));
+    buffer.close();
+
+    QImage result;
+    QVERIFY(result.loadFromData(data, "PNG"));
+    QCOMPARE(result.size(), rc.size());
+
+    const QImage reference = dev->convertToQImage(0, rc);
+    QCOMPARE(result.convertToFormat(QImage::Format_ARGB32), reference.convertToFormat(QImage::Format_ARGB32));
+}
+
+void KisKraSaverTest::testCreateThumbnail()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    const QRect rc(0, 0, 2000, 1000);
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->fill(rc, KoColor(Qt::red, cs));
+    dev->fill(QRect(1000, 0, 1000, 1000), KoColor(Qt::blue, cs));
+
+    const QImage thumbnail = KisKraPreviewUtils::createThumbnail(dev, rc, QSize(256, 256));
+    QCOMPARE(thumbnail.size(), QSize(256, 128));
+
+    QCOMPARE(QColor(thumbnail.pixel(10, 64)), QColor(Qt::red));
+    QCOMPARE(QColor(thumbnail.pixel(245, 64)), QColor(Qt::blue));
+}
+
 #include "lazybrush/kis_lazy_fill_tools.h"
 
 void KisKraSaverTest::testRoundTripColorizeMask()
@@ -41,6 +41,11 @@ private Q_SLOTS:
 
     void testRoundTripAnimation();
 
+    void testSaveUnchangedLayersReused();
+
+    void testWriteMergedImagePng();
+    void testCreateThumbnail();
+
     void testRoundTripColorizeMask();
 
     void testRoundTripShapeLayer();
@@ -21,6 +21,7 @@
 #include <QtGlobal>
 #include <QMap>
 #include <QIODevice>
+#include <QtConcurrent>
 
 
 #include <KoColorSpace.h>
@@ -157,8 +158,9 @@ inline typename Traits::channels_type readChannelValue(const QMap<quint16, QByte
 {
     typedef typename Traits::channels_type channels_type;
 
-    if (channelBytes.contains(channelId)) {
-        const QByteArray &bytes = channelBytes[channelId];
+    QMap<quint16, QByteArray>::const_iterator it = channelBytes.constFind(channelId);
+    if (it != channelBytes.constEnd()) {
+        const QByteArray &bytes = *it;
         if (col < bytes.size()) {
             return convertByteOrder<Traits>(reinterpret_cast<const channels_type *>(bytes.constData())[col]);
         }
@@ -391,41 +393,230 @@ psd_status psd_unzip_with_prediction(psd_uchar *src_buf, psd_int src_len,
 /* End of third party block                                           */
 /**********************************************************************/
 
-QMap<quint16, QByteArray> fetchChannelsBytes(QIODevice *io, QVector<ChannelInfo*> channelInfoRecords,
-                                            int row, int width, int channelSize, bool processMasks)
+/**
+ * The channels are decoded in bands of rows, so that only a limited amount
+ * of the compressed and uncompressed data is kept in memory. Inside a band,
+ * the stripes of rows are decompressed and written into the device in
+ * parallel. The stripes are aligned to the tiles of the device, so that
+ * the threads never write into the same tile.
+ */
+const int bandSizeLimit = 64 * 1024 * 1024;
+const int stripeHeight = 64;
+
+struct Stripe {
+    int firstRow;
+    int numRows;
+};
+
+QVector<Stripe> splitIntoStripes(KisPaintDeviceSP dev, const QRect &layerRect)
 {
-    const int uncompressedLength = width * channelSize;
+    QVector<Stripe> stripes;
 
-    QMap<quint16, QByteArray> channelBytes;
+    const int topInDevice = layerRect.top() - dev->y();
+    int row = 0;
 
-    Q_FOREACH (ChannelInfo *channelInfo, channelInfoRecords) {
-        // user supplied masks are ignored here
-        if (!processMasks && channelInfo->channelId < -1) continue;
+    while (row < layerRect.height()) {
+        const int y = topInDevice + row;
+        const int tileRow = y >= 0 ? y / stripeHeight : (y - stripeHeight + 1) / stripeHeight;
+        const int nextRow = qMin(layerRect.height(), (tileRow + 1) * stripeHeight - topInDevice);
+
+        stripes.append({row, nextRow - row});
+        row = nextRow;
+    }
+
+    return stripes;
+}
+
+typedef boost::function<void(int, const QMap<quint16, QByteArray>&, int, quint8*)> PixelFunc;
+
+/**
+ * Writes \p numRows rows of the layer starting at \p firstRow. \p rowBytes
+ * should return the uncompressed bytes of a row of a channel.
+ */
+template <class RowBytesFunc>
+void writeRows(KisPaintDeviceSP dev,
+               const QRect &layerRect,
+               const QVector<ChannelInfo*> &infoRecords,
+               int firstRow, int numRows,
+               int channelSize,
+               PixelFunc pixelFunc,
+               RowBytesFunc rowBytes)
+{
+    KisHLineIteratorSP it = dev->createHLineIteratorNG(layerRect.left(), layerRect.top() + firstRow, layerRect.width());
 
-        io->seek(channelInfo->channelDataStart + channelInfo->channelOffset);
+    for (int row = firstRow; row < firstRow + numRows; row++) {
+        QMap<quint16, QByteArray> channelBytes;
 
-        if (channelInfo->compressionType == Compression::Uncompressed) {
-            channelBytes[channelInfo->channelId] = io->read(uncompressedLength);
-            channelInfo->channelOffset += uncompressedLength;
+        Q_FOREACH (ChannelInfo *channelInfo, infoRecords) {
+            channelBytes.insert(channelInfo->channelId, rowBytes(channelInfo, row));
         }
-        else if (channelInfo->compressionType == Compression::RLE) {
-            int rleLength = channelInfo->rleRowLengths[row];
-            QByteArray compressedBytes = io->read(rleLength);
-            QByteArray uncompressedBytes = Compression::uncompress(uncompressedLength, compressedBytes, channelInfo->compressionType);
-            channelBytes.insert(channelInfo->channelId, uncompressedBytes);
-            channelInfo->channelOffset += rleLength;
+
+        for (qint64 col = 0; col < layerRect.width(); col++) {
+            pixelFunc(channelSize, channelBytes, col, it->rawData());
+            it->nextPixel();
         }
-        else {
-            QString error = QString("Unsupported Compression mode: %1").arg(channelInfo->compressionType);
-            dbgFile << "ERROR: fetchChannelsBytes:" << error;
+        it->nextRow();
+    }
+}
+
+void readZipCompressed(KisPaintDeviceSP dev,
+                       QIODevice *io,
+                       const QRect &layerRect,
+                       QVector<ChannelInfo*> infoRecords,
+                       int channelSize,
+                       PixelFunc pixelFunc)
+{
+    const int rowLength = channelSize * layerRect.width();
+    const int numBytes = rowLength * layerRect.height();
+
+    struct ChannelData {
+        ChannelInfo *info;
+        QByteArray compressedBytes;
+        QByteArray uncompressedBytes;
+        bool status;
+    };
+
+    QVector<ChannelData> channels;
+
+    Q_FOREACH (ChannelInfo *info, infoRecords) {
+        io->seek(info->channelDataStart);
+        channels.append({info, io->read(info->channelDataLength), QByteArray(), false});
+    }
+
+    // the channels are compressed as a whole, so they are inflated in parallel
+    QtConcurrent::blockingMap(channels, [&] (ChannelData &channel) {
+        channel.uncompressedBytes = QByteArray(numBytes, 0);
+
+        if (channel.info->compressionType == Compression::ZIP) {
+            channel.status = psd_unzip_without_prediction((quint8*)channel.compressedBytes.data(), channel.compressedBytes.size(),
+                                                          (quint8*)channel.uncompressedBytes.data(), channel.uncompressedBytes.size());
+        } else {
+            channel.status = psd_unzip_with_prediction((quint8*)channel.compressedBytes.data(), channel.compressedBytes.size(),
+                                                       (quint8*)channel.uncompressedBytes.data(), channel.uncompressedBytes.size(),
+                                                       layerRect.width(), channelSize * 8);
+        }
+
+        channel.compressedBytes.clear();
+    });
+
+    QMap<quint16, QByteArray> channelBytes;
+
+    Q_FOREACH (const ChannelData &channel, channels) {
+        if (!channel.status) {
+            ChannelInfo *info = channel.info;
+            QString error = QString("Failed to unzip channel data: id = %1, compression = %2").arg(info->channelId).arg(info->compressionType);
+            dbgFile << "ERROR:" << error;
+            dbgFile << "      " << ppVar(info->channelId);
+            dbgFile << "      " << ppVar(info->channelDataStart);
+            dbgFile << "      " << ppVar(info->channelDataLength);
+            dbgFile << "      " << ppVar(info->compressionType);
             throw KisAslReaderUtils::ASLParseException(error);
         }
+
+        channelBytes.insert(channel.info->channelId, channel.uncompressedBytes);
     }
 
-    return channelBytes;
+    auto rowBytes = [&] (ChannelInfo *info, int row) {
+        return QByteArray::fromRawData(channelBytes.constFind(info->channelId)->constData() + row * rowLength, rowLength);
+    };
+
+    QVector<Stripe> stripes = splitIntoStripes(dev, layerRect);
+
+    QtConcurrent::blockingMap(stripes, [&] (const Stripe &stripe) {
+        writeRows(dev, layerRect, infoRecords, stripe.firstRow, stripe.numRows, channelSize, pixelFunc, rowBytes);
+    });
 }
 
-typedef boost::function<void(int, const QMap<quint16, QByteArray>&, int, quint8*)> PixelFunc;
+void readRowCompressed(KisPaintDeviceSP dev,
+                       QIODevice *io,
+                       const QRect &layerRect,
+                       QVector<ChannelInfo*> infoRecords,
+                       int channelSize,
+                       PixelFunc pixelFunc)
+{
+    const int rowLength = channelSize * layerRect.width();
+    const int numRows = layerRect.height();
+
+    // the offsets of the rows in the channel data, the last one is the end of the data
+    QMap<quint16, QVector<qint64>> rowOffsets;
+
+    Q_FOREACH (ChannelInfo *channelInfo, infoRecords) {
+        QVector<qint64> &offsets = rowOffsets[channelInfo->channelId];
+        offsets.resize(numRows + 1);
+        offsets[0] = 0;
+
+        for (int row = 0; row < numRows; row++) {
+            qint64 length = rowLength;
+
+            if (channelInfo->compressionType == Compression::RLE) {
+                if (row >= channelInfo->rleRowLengths.size()) {
+                    QString error = QString("Not enough RLE row lengths: id = %1").arg(channelInfo->channelId);
+                    throw KisAslReaderUtils::ASLParseException(error);
+                }
+                length = channelInfo->rleRowLengths[row];
+            }
+
+            offsets[row + 1] = offsets[row] + length;
+        }
+    }
+
+    const int rowsPerBand = qMax(1, bandSizeLimit / qMax(1, rowLength * infoRecords.size()));
+    const QVector<Stripe> stripes = splitIntoStripes(dev, layerRect);
+
+    for (int i = 0; i < stripes.size();) {
+        // collect the stripes of the next band
+        QVector<Stripe> bandStripes;
+        int bandRows = 0;
+        do {
+            bandStripes.append(stripes[i]);
+            bandRows += stripes[i].numRows;
+            i++;
+        } while (i < stripes.size() && bandRows + stripes[i].numRows <= rowsPerBand);
+
+        const int bandFirstRow = bandStripes.first().firstRow;
+
+        QMap<quint16, QByteArray> bandBytes;
+
+        Q_FOREACH (ChannelInfo *channelInfo, infoRecords) {
+            const QVector<qint64> &offsets = rowOffsets[channelInfo->channelId];
+            io->seek(channelInfo->channelDataStart + offsets[bandFirstRow]);
+            bandBytes.insert(channelInfo->channelId, io->read(offsets[bandFirstRow + bandRows] - offsets[bandFirstRow]));
+        }
+
+        QtConcurrent::blockingMap(bandStripes, [&] (const Stripe &stripe) {
+            QMap<quint16, QByteArray> stripeBytes;
+
+            Q_FOREACH (ChannelInfo *channelInfo, infoRecords) {
+                const QVector<qint64> &offsets = *rowOffsets.constFind(channelInfo->channelId);
+                const QByteArray &srcBytes = *bandBytes.constFind(channelInfo->channelId);
+                QByteArray dstBytes(stripe.numRows * rowLength, Qt::Uninitialized);
+
+                for (int row = 0; row < stripe.numRows; row++) {
+                    const qint64 start = qMin(qint64(srcBytes.size()), offsets[stripe.firstRow + row] - offsets[bandFirstRow]);
+                    const qint64 end = qMin(qint64(srcBytes.size()), offsets[stripe.firstRow + row + 1] - offsets[bandFirstRow]);
+
+                    const quint8 *src = reinterpret_cast<const quint8*>(srcBytes.constData()) + start;
+                    quint8 *dst = reinterpret_cast<quint8*>(dstBytes.data()) + row * rowLength;
+
+                    if (channelInfo->compressionType == Compression::RLE) {
+                        Compression::unpackBits(src, end - start, dst, rowLength);
+                    } else {
+                        memcpy(dst, src, end - start);
+                        memset(dst + (end - start), 0, rowLength - (end - start));
+                    }
+                }
+
+                stripeBytes.insert(channelInfo->channelId, dstBytes);
+            }
+
+            auto rowBytes = [&] (ChannelInfo *info, int row) {
+                return QByteArray::fromRawData(stripeBytes.constFind(info->channelId)->constData() + (row - stripe.firstRow) * rowLength, rowLength);
+            };
+
+            writeRows(dev, layerRect, infoRecords, stripe.firstRow, stripe.numRows, channelSize, pixelFunc, rowBytes);
+        });
+    }
+}
 
 void readCommon(KisPaintDeviceSP dev,
                 QIODevice *io,
@@ -442,63 +633,37 @@ void readCommon(KisPaintDeviceSP dev,
         return;
     }
 
-    if (infoRecords.first()->compressionType == Compression::ZIP ||
-        infoRecords.first()->compressionType == Compression::ZIPWithPrediction) {
-
-        const int numPixels = channelSize * layerRect.width() * layerRect.height();
+    const bool zipCompressed =
+        infoRecords.first()->compressionType == Compression::ZIP ||
+        infoRecords.first()->compressionType == Compression::ZIPWithPrediction;
 
-        QMap<quint16, QByteArray> channelBytes;
+    QVector<ChannelInfo*> channels;
 
-        Q_FOREACH (ChannelInfo *info, infoRecords) {
-            io->seek(info->channelDataStart);
-            QByteArray compressedBytes = io->read(info->channelDataLength);
-            QByteArray uncompressedBytes(numPixels, 0);
+    Q_FOREACH (ChannelInfo *channelInfo, infoRecords) {
+        // user supplied masks are ignored here
+        if (!processMasks && channelInfo->channelId < -1) continue;
 
-            bool status = false;
-            if (infoRecords.first()->compressionType == Compression::ZIP) {
-                status = psd_unzip_without_prediction((quint8*)compressedBytes.data(), compressedBytes.size(),
-                                                      (quint8*)uncompressedBytes.data(), uncompressedBytes.size());
-            } else {
-                status = psd_unzip_with_prediction((quint8*)compressedBytes.data(), compressedBytes.size(),
-                                                   (quint8*)uncompressedBytes.data(), uncompressedBytes.size(),
-                                                   layerRect.width(), channelSize * 8);
-            }
+        const Compression::CompressionType type = channelInfo->compressionType;
+        const bool supported = zipCompressed ?
+            type == Compression::ZIP || type == Compression::ZIPWithPrediction :
+            type == Compression::Uncompressed || type == Compression::RLE;
 
-            if (!status) {
-                QString error = QString("Failed to unzip channel data: id = %1, compression = %2").arg(info->channelId).arg(info->compressionType);
-                dbgFile << "ERROR:" << error;
-                dbgFile << "      " << ppVar(info->channelId);
-                dbgFile << "      " << ppVar(info->channelDataStart);
-                dbgFile << "      " << ppVar(info->channelDataLength);
-                dbgFile << "      " << ppVar(info->compressionType);
-                throw KisAslReaderUtils::ASLParseException(error);
-            }
+        if (!supported) {
 
-            channelBytes.insert(info->channelId, uncompressedBytes);
-        }
-
-        KisSequentialIterator it(dev, layerRect);
-        int col = 0;
-        while (it.nextPixel()) {
-            pixelFunc(channelSize, channelBytes, col, it.rawData());
-            col++;
+            QString error = QString("Unsupported Compression mode: %1").arg(channelInfo->compressionType);
+            dbgFile << "ERROR: readCommon:" << error;
+            throw KisAslReaderUtils::ASLParseException(error);
         }
 
-    } else {
-        KisHLineIteratorSP it = dev->createHLineIteratorNG(layerRect.left(), layerRect.top(), layerRect.width());
-        for (int i = 0 ; i < layerRect.height(); i++) {
-            QMap<quint16, QByteArray> channelBytes;
+        channels.append(channelInfo);
+    }
 
-            channelBytes = fetchChannelsBytes(io, infoRecords,
-                                              i, layerRect.width(),
-                                              channelSize, processMasks);
+    if (channels.isEmpty()) return;
 
-            for (qint64 col = 0; col < layerRect.width(); col++){
-                pixelFunc(channelSize, channelBytes, col, it->rawData());
-                it->nextPixel();
-            }
-            it->nextRow();
-        }
+    if (zipCompressed) {
+        readZipCompressed(dev, io, layerRect, channels, channelSize, pixelFunc);
+    } else {
+        readRowCompressed(dev, io, layerRect, channels, channelSize, pixelFunc);
     }
 }
 
@@ -569,23 +734,58 @@ void writeChannelDataRLE(QIODevice *io, const quint8 *plane, const int channelSi
         }
 
         // write zero's for the channel lengths block
-        for(int i = 0; i < rc.height(); ++i) {
-            // XXX: choose size for PSB!
-            const quint16 fakeRLEBLockSize = 0;
-            SAFE_WRITE_EX(io, fakeRLEBLockSize);
+        // XXX: choose size for PSB!
+        const QByteArray fakeRLEBlock(rc.height() * sizeof(quint16), 0);
+        if (io->write(fakeRLEBlock) != fakeRLEBlock.size()) {
+            throw KisAslWriterUtils::ASLWriteException("Failed to write RLE sizes block");
         }
     }
 
-    quint32 stride = channelSize * rc.width();
-    for (qint32 row = 0; row < rc.height(); ++row) {
+    /**
+     * The rows are compressed in parallel, band by band, so that only a
+     * limited amount of the compressed data is kept in memory
+     */
+    const int stride = channelSize * rc.width();
+    const int maxCompressedRowSize = Compression::packBitsBound(stride);
+    const int rowsPerBand = qBound(1, bandSizeLimit / qMax(1, maxCompressedRowSize), rc.height());
+
+    QByteArray compressedBand(rowsPerBand * maxCompressedRowSize, Qt::Uninitialized);
+    QVector<int> compressedRowSizes(rowsPerBand);
+    QVector<quint16> rleRowSizes;
+    rleRowSizes.reserve(rc.height());
+
+    for (int bandFirstRow = 0; bandFirstRow < rc.height(); bandFirstRow += rowsPerBand) {
+        const int numRows = qMin(rowsPerBand, rc.height() - bandFirstRow);
+
+        QVector<int> rows;
+        for (int row = 0; row < numRows; row++) {
+            rows.append(row);
+        }
 
-        QByteArray uncompressed = QByteArray::fromRawData((const char*)plane + row * stride, stride);
-        QByteArray compressed = Compression::compress(uncompressed, Compression::RLE);
+        QtConcurrent::blockingMap(rows, [&] (int row) {
+            const quint8 *src = plane + qint64(bandFirstRow + row) * stride;
+            quint8 *dst = reinterpret_cast<quint8*>(compressedBand.data()) + row * maxCompressedRowSize;
+            compressedRowSizes[row] = Compression::packBits(src, stride, dst);
+        });
 
-        KisAslWriterUtils::OffsetStreamPusher<quint16> rleExternalTag(io, 0, channelRLESizePos + row * sizeof(quint16));
+        for (int row = 0; row < numRows; row++) {
+            const char *data = compressedBand.constData() + row * maxCompressedRowSize;
 
-        if (io->write(compressed) != compressed.size()) {
-            throw KisAslWriterUtils::ASLWriteException("Failed to write image data");
+            if (io->write(data, compressedRowSizes[row]) != compressedRowSizes[row]) {
+                throw KisAslWriterUtils::ASLWriteException("Failed to write image data");
+            }
+
+            rleRowSizes.append(qToBigEndian(quint16(compressedRowSizes[row])));
+        }
+    }
+
+    {
+        KisOffsetKeeper keeper(io);
+        io->seek(channelRLESizePos);
+
+        const qint64 rleBlockSize = rleRowSizes.size() * sizeof(quint16);
+        if (io->write(reinterpret_cast<const char*>(rleRowSizes.constData()), rleBlockSize) != rleBlockSize) {
+            throw KisAslWriterUtils::ASLWriteException("Failed to write RLE sizes block");
         }
     }
 }
@@ -690,14 +890,22 @@ void writePixelDataCommon(QIODevice *io,
 
     // write down the planes
 
+    // the byte order of the planes is converted in parallel
+    QVector<int> planeIndexes;
+    for (int i = 0; i < writingInfoList.size(); i++) {
+        planeIndexes.append(i);
+    }
+
+    QtConcurrent::blockingMap(planeIndexes, [&] (int i) {
+        preparePixelForWrite(planes[i], numPixels, channelSize, writingInfoList[i].channelId, colorMode);
+    });
+
     try {
         for (int i = 0; i < writingInfoList.size(); i++) {
             const ChannelWritingInfo &info = writingInfoList[i];
 
             dbgFile << "\tWriting channel" << i << "psd channel id" << info.channelId;
 
-            preparePixelForWrite(planes[i], numPixels, channelSize, info.channelId, colorMode);
-
             dbgFile << "\t\tchannel start" << ppVar(io->pos());
 
             writeChannelDataRLE(io, planes[i], channelSize, rc, info.sizeFieldOffset, info.rleBlockOffset, writeCompressionType);
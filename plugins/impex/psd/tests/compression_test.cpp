@@ -97,5 +97,69 @@ void CompressionTest::testCompressionUncompressed()
 
 }
 
+void CompressionTest::testPackBits_data()
+{
+    QTest::addColumn<QByteArray>("data");
+
+    QByteArray random;
+    QByteArray runs;
+    QByteArray mixed;
+
+    for (int i = 0; i < 70000; ++i) {
+        random.append(char(rand()));
+        runs.append(char(i / 300));
+        mixed.append(char(i % 1000 < 500 ? i / 7 : rand() % 3));
+    }
+
+    QTest::newRow("empty") << QByteArray();
+    QTest::newRow("single") << QByteArray("a");
+    QTest::newRow("pair") << QByteArray("aa");
+    QTest::newRow("literal-128") << random.left(128);
+    QTest::newRow("literal-129") << random.left(129);
+    QTest::newRow("run-128") << QByteArray(128, 'x');
+    QTest::newRow("run-129") << QByteArray(129, 'x');
+    QTest::newRow("random") << random;
+    QTest::newRow("runs") << runs;
+    QTest::newRow("mixed") << mixed;
+}
+
+void CompressionTest::testPackBits()
+{
+    QFETCH(QByteArray, data);
+
+    QByteArray compressed(Compression::packBitsBound(data.size()), Qt::Uninitialized);
+    const int compressedSize =
+        Compression::packBits(reinterpret_cast<const quint8*>(data.constData()), data.size(),
+                              reinterpret_cast<quint8*>(compressed.data()));
+
+    QVERIFY(compressedSize <= compressed.size());
+    compressed.resize(compressedSize);
+
+    QByteArray uncompressed(data.size(), Qt::Uninitialized);
+    const bool result =
+        Compression::unpackBits(reinterpret_cast<const quint8*>(compressed.constData()), compressed.size(),
+                                reinterpret_cast<quint8*>(uncompressed.data()), uncompressed.size());
+
+    QVERIFY(result);
+    QCOMPARE(uncompressed, data);
+}
+
+void CompressionTest::testUnpackBitsMalformed()
+{
+    // a literal packet of 5 bytes with only 3 bytes of data
+    const quint8 truncated[] = {4, 'a', 'b', 'c'};
+    quint8 dst[6] = {1, 1, 1, 1, 1, 1};
+
+    QVERIFY(!Compression::unpackBits(truncated, sizeof(truncated), dst, sizeof(dst)));
+    QCOMPARE(QByteArray((const char*)dst, sizeof(dst)), QByteArray("abc\0\0\0", 6));
+
+    // a replicate packet longer than the destination
+    const quint8 overrun[] = {quint8(-9), 'z'};
+    quint8 dst2[4] = {0, 0, 0, 0};
+
+    QVERIFY(!Compression::unpackBits(overrun, sizeof(overrun), dst2, sizeof(dst2)));
+    QCOMPARE(QByteArray((const char*)dst2, sizeof(dst2)), QByteArray("zzzz"));
+}
+
 QTEST_MAIN(CompressionTest)
 
@@ -29,6 +29,9 @@ private Q_SLOTS:
     void testCompressionRLE();
     void testCompressionZIP();
     void testCompressionUncompressed();
+    void testPackBits_data();
+    void testPackBits();
+    void testUnpackBitsMalformed();
 
 };
 
@@ -0,0 +1,150 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_raw_canvas_export.h"
+
+#include <QDataStream>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <kpluginfactory.h>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KisExportCheckRegistry.h>
+
+#include <KisDocument.h>
+#include <kis_debug.h>
+#include <kis_image.h>
+#include <kis_group_layer.h>
+#include <kis_layer.h>
+#include <kis_paint_device.h>
+
+#include "kis_raw_canvas_format.h"
+
+K_PLUGIN_FACTORY_WITH_JSON(KisRawCanvasExportFactory, "krita_raw_canvas_export.json", registerPlugin<KisRawCanvasExport>();)
+
+KisRawCanvasExport::KisRawCanvasExport(QObject *parent, const QVariantList &)
+    : KisImportExportFilter(parent)
+{
+}
+
+KisRawCanvasExport::~KisRawCanvasExport()
+{
+}
+
+KisImportExportErrorCode KisRawCanvasExport::convert(KisDocument *document, QIODevice *io,  KisPropertiesConfigurationSP configuration)
+{
+    Q_UNUSED(configuration);
+
+    KisImageSP image = document->savingImage();
+    KIS_ASSERT_RECOVER_RETURN_VALUE(image, ImportExportCodes::InternalError);
+
+    KisRawCanvas::Header header;
+    header.size = image->bounds().size();
+    header.xRes = image->xRes();
+    header.yRes = image->yRes();
+    header.colorSpace = image->colorSpace();
+
+    QVector<KisPaintDeviceSP> devices;
+
+    // every top-level layer is saved as its rendered result
+    for (KisNodeSP node = image->root()->firstChild(); node; node = node->nextSibling()) {
+        if (!node->inherits("KisLayer")) continue;
+
+        KisPaintDeviceSP dev = node->projection();
+        if (!dev) continue;
+
+        KisRawCanvas::LayerInfo info;
+        info.name = node->name();
+        info.colorSpace = dev->colorSpace();
+        info.opacity = node->opacity();
+        info.visible = node->visible();
+        info.compositeOpId = node->compositeOpId();
+        info.offset = QPoint(dev->x(), dev->y());
+        info.defaultPixel = QByteArray(reinterpret_cast<const char*>(dev->defaultPixel().data()),
+                                       dev->pixelSize());
+        info.tiles = KisRawCanvas::tilesOfDevice(dev);
+
+        header.layers.append(info);
+        devices.append(dev);
+    }
+
+    QDataStream stream(io);
+    if (!KisRawCanvas::writeHeader(stream, header)) {
+        return ImportExportCodes::ErrorWhileWriting;
+    }
+
+    const qint64 padding = KisRawCanvas::dataOffset(io->pos()) - io->pos();
+    if (io->write(QByteArray(padding, 0)) != padding) {
+        return ImportExportCodes::ErrorWhileWriting;
+    }
+
+    struct TileJob {
+        QRect rect;
+        quint8 *data;
+    };
+
+    // the tiles are read from the devices in parallel in batches
+    const int batchSize = 16 * QThread::idealThreadCount();
+
+    for (int i = 0; i < header.layers.size(); i++) {
+        const KisRawCanvas::LayerInfo &info = header.layers[i];
+        KisPaintDeviceSP dev = devices[i];
+        const qint64 tileDataSize = info.tileDataSize();
+
+        for (int first = 0; first < info.tiles.size(); first += batchSize) {
+            const int numTiles = qMin(batchSize, info.tiles.size() - first);
+
+            QByteArray batch(numTiles * tileDataSize, Qt::Uninitialized);
+            quint8 *batchPtr = reinterpret_cast<quint8*>(batch.data());
+
+            QVector<TileJob> jobs;
+            for (int j = 0; j < numTiles; j++) {
+                jobs.append({KisRawCanvas::tileRect(info.tiles[first + j], info.offset),
+                             batchPtr + j * tileDataSize});
+            }
+
+            QtConcurrent::blockingMap(jobs, [dev] (const TileJob &job) {
+                dev->readBytes(job.data, job.rect);
+            });
+
+            if (io->write(batch) != batch.size()) {
+                return ImportExportCodes::ErrorWhileWriting;
+            }
+        }
+    }
+
+    return ImportExportCodes::OK;
+}
+
+void KisRawCanvasExport::initializeCapabilities()
+{
+    addCapability(KisExportCheckRegistry::instance()->get("MultiLayerCheck")->create(KisExportCheckBase::SUPPORTED));
+    addCapability(KisExportCheckRegistry::instance()->get("sRGBProfileCheck")->create(KisExportCheckBase::SUPPORTED));
+    addCapability(KisExportCheckRegistry::instance()->get("ColorModelHomogenousCheck")->create(KisExportCheckBase::SUPPORTED));
+
+    // the pixels are stored in the native format of any color space
+    Q_FOREACH (const QString &id, KisExportCheckRegistry::instance()->keys()) {
+        if (id.startsWith("ColorModelCheck/") || id.startsWith("ColorModelPerLayerCheck/")) {
+            addCapability(KisExportCheckRegistry::instance()->get(id)->create(KisExportCheckBase::SUPPORTED));
+        }
+    }
+}
+
+#include "kis_raw_canvas_export.moc"
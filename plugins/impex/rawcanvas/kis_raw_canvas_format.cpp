@@ -0,0 +1,246 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_raw_canvas_format.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QDataStream>
+#include <QRegion>
+
+#include <KoColorProfile.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+
+#include <kis_debug.h>
+#include <kis_paint_device.h>
+
+namespace {
+
+const char magic[] = "KRCANVAS";
+const int magicSize = 8;
+
+/// the largest width and height accepted by the importer
+const int maxImageSize = 100000;
+
+void writeColorSpace(QDataStream &stream, const KoColorSpace *cs)
+{
+    const KoColorProfile *profile = cs->profile();
+
+    stream << cs->colorModelId().id();
+    stream << cs->colorDepthId().id();
+    stream << (profile ? profile->rawData() : QByteArray());
+}
+
+const KoColorSpace* readColorSpace(QDataStream &stream)
+{
+    QString colorModelId;
+    QString colorDepthId;
+    QByteArray profileData;
+
+    stream >> colorModelId >> colorDepthId >> profileData;
+    if (stream.status() != QDataStream::Ok) return 0;
+
+    KoColorSpaceRegistry *registry = KoColorSpaceRegistry::instance();
+    const KoColorProfile *profile = 0;
+
+    if (!profileData.isEmpty()) {
+        profile = registry->createColorProfile(colorModelId, colorDepthId, profileData);
+        if (!profile) {
+            warnFile << "Could not load the profile of the color space" << colorModelId << colorDepthId;
+        }
+    }
+
+    return registry->colorSpace(colorModelId, colorDepthId, profile);
+}
+
+}
+
+namespace KisRawCanvas
+{
+
+qint64 LayerInfo::tileDataSize() const
+{
+    return qint64(tileSize) * tileSize * colorSpace->pixelSize();
+}
+
+qint64 Header::dataSize() const
+{
+    qint64 size = 0;
+
+    Q_FOREACH (const LayerInfo &layer, layers) {
+        size += layer.tiles.size() * layer.tileDataSize();
+    }
+
+    return size;
+}
+
+bool writeHeader(QDataStream &stream, const Header &header)
+{
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    stream.writeRawData(magic, magicSize);
+    stream << version;
+    stream << quint32(tileSize);
+    stream << qint32(header.size.width()) << qint32(header.size.height());
+    stream << header.xRes << header.yRes;
+    writeColorSpace(stream, header.colorSpace);
+
+    stream << quint32(header.layers.size());
+
+    Q_FOREACH (const LayerInfo &layer, header.layers) {
+        stream << layer.name;
+        writeColorSpace(stream, layer.colorSpace);
+        stream << layer.opacity << layer.visible << layer.compositeOpId;
+        stream << qint32(layer.offset.x()) << qint32(layer.offset.y());
+        stream << layer.defaultPixel;
+
+        stream << quint32(layer.tiles.size());
+        Q_FOREACH (const QPoint &tile, layer.tiles) {
+            stream << qint32(tile.x()) << qint32(tile.y());
+        }
+    }
+
+    return stream.status() == QDataStream::Ok;
+}
+
+bool readHeader(QDataStream &stream, qint64 fileSize, Header *header)
+{
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    char fileMagic[magicSize];
+    if (stream.readRawData(fileMagic, magicSize) != magicSize ||
+        memcmp(fileMagic, magic, magicSize) != 0) {
+
+        return false;
+    }
+
+    quint32 fileVersion = 0;
+    quint32 fileTileSize = 0;
+    qint32 width = 0;
+    qint32 height = 0;
+
+    stream >> fileVersion >> fileTileSize >> width >> height;
+    stream >> header->xRes >> header->yRes;
+
+    if (stream.status() != QDataStream::Ok ||
+        fileVersion != version ||
+        fileTileSize != quint32(tileSize) ||
+        width <= 0 || width > maxImageSize ||
+        height <= 0 || height > maxImageSize) {
+
+        dbgFile << "Unsupported raw canvas" << ppVar(fileVersion) << ppVar(fileTileSize) << ppVar(width) << ppVar(height);
+        return false;
+    }
+
+    header->size = QSize(width, height);
+    header->colorSpace = readColorSpace(stream);
+    if (!header->colorSpace) return false;
+
+    quint32 numLayers = 0;
+    stream >> numLayers;
+    if (stream.status() != QDataStream::Ok) return false;
+
+    qint64 totalDataSize = 0;
+
+    for (quint32 i = 0; i < numLayers; i++) {
+        LayerInfo layer;
+
+        stream >> layer.name;
+        layer.colorSpace = readColorSpace(stream);
+        if (!layer.colorSpace) return false;
+
+        qint32 x = 0;
+        qint32 y = 0;
+        quint32 numTiles = 0;
+
+        stream >> layer.opacity >> layer.visible >> layer.compositeOpId;
+        stream >> x >> y;
+        stream >> layer.defaultPixel;
+        stream >> numTiles;
+
+        if (stream.status() != QDataStream::Ok ||
+            layer.defaultPixel.size() != int(layer.colorSpace->pixelSize())) {
+
+            return false;
+        }
+
+        layer.offset = QPoint(x, y);
+
+        // don't trust the number of tiles before allocating memory for them
+        totalDataSize += numTiles * layer.tileDataSize();
+        if (totalDataSize > fileSize) {
+            dbgFile << "The raw canvas is truncated" << ppVar(totalDataSize) << ppVar(fileSize);
+            return false;
+        }
+
+        layer.tiles.resize(numTiles);
+        for (quint32 j = 0; j < numTiles; j++) {
+            qint32 col = 0;
+            qint32 row = 0;
+            stream >> col >> row;
+            layer.tiles[j] = QPoint(col, row);
+        }
+
+        if (stream.status() != QDataStream::Ok) return false;
+
+        header->layers.append(layer);
+    }
+
+    return true;
+}
+
+qint64 dataOffset(qint64 headerSize)
+{
+    return (headerSize + dataAlignment - 1) / dataAlignment * dataAlignment;
+}
+
+QVector<QPoint> tilesOfDevice(KisPaintDeviceSP dev)
+{
+    QVector<QPoint> tiles;
+
+    const QRegion region = dev->region().translated(-dev->x(), -dev->y());
+
+    Q_FOREACH (const QRect &rc, region.rects()) {
+        // the rects consist of whole tiles, so the division is exact
+        for (int row = rc.top() / tileSize; row < (rc.top() + rc.height()) / tileSize; row++) {
+            for (int col = rc.left() / tileSize; col < (rc.left() + rc.width()) / tileSize; col++) {
+                tiles.append(QPoint(col, row));
+            }
+        }
+    }
+
+    std::sort(tiles.begin(), tiles.end(),
+              [] (const QPoint &lhs, const QPoint &rhs) {
+                  return lhs.y() < rhs.y() || (lhs.y() == rhs.y() && lhs.x() < rhs.x());
+              });
+
+    return tiles;
+}
+
+QRect tileRect(const QPoint &tile, const QPoint &offset)
+{
+    return QRect(tile.x() * tileSize + offset.x(),
+                 tile.y() * tileSize + offset.y(),
+                 tileSize, tileSize);
+}
+
+}
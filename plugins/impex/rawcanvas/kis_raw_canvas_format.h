@@ -0,0 +1,116 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KIS_RAW_CANVAS_FORMAT_H
+#define KIS_RAW_CANVAS_FORMAT_H
+
+#include <QByteArray>
+#include <QPoint>
+#include <QRect>
+#include <QSize>
+#include <QString>
+#include <QVector>
+
+#include <kis_types.h>
+
+class QDataStream;
+class KoColorSpace;
+
+/**
+ * Krita Raw Canvas (.krc) is an uncompressed layered format for
+ * exchanging huge layers between applications without the cost of
+ * encoding and decoding PNG or TIFF files.
+ *
+ * The file starts with a header written with QDataStream in
+ * little-endian byte order:
+ *
+ *   magic "KRCANVAS", version, tile size, image size, resolution,
+ *   image color space, number of layers and the description of every
+ *   layer: name, color space, opacity, visibility, composite op,
+ *   offset, default pixel and the list of (column, row) of its tiles.
+ *
+ * The tile data begins at the first page boundary after the header.
+ * The tiles of all the layers are stored one after another in the
+ * order of the lists. Every tile is 64x64 pixels of the layer's color
+ * space stored row by row, exactly the layout of the tiles of
+ * KisTiledDataManager, so a tile is copied into the paint device with
+ * a single memcpy() from the memory-mapped file. The tiles of the
+ * device which were never written are not stored.
+ */
+namespace KisRawCanvas
+{
+
+const quint32 version = 1;
+const int tileSize = 64;
+const qint64 dataAlignment = 4096;
+
+struct LayerInfo
+{
+    QString name;
+    const KoColorSpace *colorSpace = 0;
+    quint8 opacity = 255;
+    bool visible = true;
+    QString compositeOpId;
+    QPoint offset;
+    QByteArray defaultPixel;
+
+    /// columns and rows of the tiles of the data manager of the layer
+    QVector<QPoint> tiles;
+
+    qint64 tileDataSize() const;
+};
+
+struct Header
+{
+    QSize size;
+    double xRes = 1.0;
+    double yRes = 1.0;
+    const KoColorSpace *colorSpace = 0;
+    QVector<LayerInfo> layers;
+
+    /// the size of the tile data of all the layers
+    qint64 dataSize() const;
+};
+
+bool writeHeader(QDataStream &stream, const Header &header);
+
+/**
+ * Reads and validates the header. \p fileSize is used for rejecting
+ * the headers which claim more data than the file can hold.
+ */
+bool readHeader(QDataStream &stream, qint64 fileSize, Header *header);
+
+/**
+ * The offset of the tile data in a file with the header of size
+ * \p headerSize
+ */
+qint64 dataOffset(qint64 headerSize);
+
+/**
+ * The tiles of the data manager of \p dev, sorted row by row
+ */
+QVector<QPoint> tilesOfDevice(KisPaintDeviceSP dev);
+
+/**
+ * The rect of \p tile in the coordinates of a device with \p offset
+ */
+QRect tileRect(const QPoint &tile, const QPoint &offset);
+
+}
+
+#endif // KIS_RAW_CANVAS_FORMAT_H
@@ -0,0 +1,130 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_raw_canvas_import.h"
+
+#include <QDataStream>
+#include <QFile>
+
+#include <kpluginfactory.h>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+
+#include <KisDocument.h>
+#include <kis_debug.h>
+#include <kis_image.h>
+#include <kis_group_layer.h>
+#include <kis_paint_device.h>
+#include <kis_paint_layer.h>
+
+#include "kis_raw_canvas_format.h"
+
+K_PLUGIN_FACTORY_WITH_JSON(KisRawCanvasImportFactory, "krita_raw_canvas_import.json", registerPlugin<KisRawCanvasImport>();)
+
+KisRawCanvasImport::KisRawCanvasImport(QObject *parent, const QVariantList &)
+    : KisImportExportFilter(parent)
+{
+}
+
+KisRawCanvasImport::~KisRawCanvasImport()
+{
+}
+
+KisImportExportErrorCode KisRawCanvasImport::convert(KisDocument *document, QIODevice *io,  KisPropertiesConfigurationSP configuration)
+{
+    Q_UNUSED(configuration);
+
+    QDataStream stream(io);
+    KisRawCanvas::Header header;
+
+    if (!KisRawCanvas::readHeader(stream, io->size(), &header)) {
+        return ImportExportCodes::FileFormatIncorrect;
+    }
+
+    const qint64 dataOffset = KisRawCanvas::dataOffset(io->pos());
+    const qint64 dataSize = header.dataSize();
+
+    if (dataOffset + dataSize > io->size()) {
+        return ImportExportCodes::FileFormatIncorrect;
+    }
+
+    /**
+     * The tiles are copied directly from the mapped file. If the device
+     * cannot be mapped, they are read one by one.
+     */
+    QFile *file = qobject_cast<QFile*>(io);
+    uchar *mappedData = file && dataSize > 0 ? file->map(dataOffset, dataSize) : 0;
+    QByteArray tileBuffer;
+
+    KisImageSP image = new KisImage(document->createUndoStore(),
+                                    header.size.width(), header.size.height(),
+                                    header.colorSpace, "imported from raw canvas");
+    image->setResolution(header.xRes, header.yRes);
+
+    qint64 tileOffset = 0;
+
+    Q_FOREACH (const KisRawCanvas::LayerInfo &info, header.layers) {
+        KisPaintLayerSP layer = new KisPaintLayer(image, info.name, info.opacity, info.colorSpace);
+        layer->setVisible(info.visible);
+
+        if (info.colorSpace->hasCompositeOp(info.compositeOpId)) {
+            layer->setCompositeOpId(info.compositeOpId);
+        }
+
+        KisPaintDeviceSP dev = layer->paintDevice();
+        dev->setDefaultPixel(KoColor(reinterpret_cast<const quint8*>(info.defaultPixel.constData()), info.colorSpace));
+        dev->moveTo(info.offset);
+
+        const qint64 tileDataSize = info.tileDataSize();
+
+        Q_FOREACH (const QPoint &tile, info.tiles) {
+            const quint8 *tileData = 0;
+
+            if (mappedData) {
+                tileData = mappedData + tileOffset;
+            } else {
+                if (!io->seek(dataOffset + tileOffset)) {
+                    return ImportExportCodes::FileFormatIncorrect;
+                }
+
+                tileBuffer = io->read(tileDataSize);
+                if (tileBuffer.size() != tileDataSize) {
+                    return ImportExportCodes::FileFormatIncorrect;
+                }
+
+                tileData = reinterpret_cast<const quint8*>(tileBuffer.constData());
+            }
+
+            // the rect covers exactly one tile of the device
+            dev->writeBytes(tileData, KisRawCanvas::tileRect(tile, info.offset));
+            tileOffset += tileDataSize;
+        }
+
+        image->addNode(layer, image->rootLayer());
+    }
+
+    if (mappedData) {
+        file->unmap(mappedData);
+    }
+
+    document->setCurrentImage(image);
+    return ImportExportCodes::OK;
+}
+
+#include "kis_raw_canvas_import.moc"
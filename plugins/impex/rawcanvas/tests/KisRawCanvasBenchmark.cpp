@@ -0,0 +1,110 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisRawCanvasBenchmark.h"
+
+#include <QTest>
+
+#include <KoColor.h>
+#include <KoColorModelStandardIds.h>
+#include <KoColorSpaceRegistry.h>
+
+#include <KisDocument.h>
+#include <KisPart.h>
+#include <kis_image.h>
+#include <kis_group_layer.h>
+#include <kis_paint_layer.h>
+#include <kis_sequential_iterator.h>
+#include <kis_undo_stores.h>
+
+#include <sdk/tests/kistest.h>
+
+
+namespace {
+
+void fillPattern(KisPaintDeviceSP dev, const QRect &rect)
+{
+    const int pixelSize = dev->pixelSize();
+
+    KisSequentialIterator it(dev, rect);
+    while (it.nextPixel()) {
+        quint8 *data = it.rawData();
+        for (int i = 0; i < pixelSize; i++) {
+            data[i] = quint8(it.x() * 7 + it.y() * 13 + i * 31);
+        }
+    }
+}
+
+KisImageSP createBenchmarkImage(const QSize &size)
+{
+    const KoColorSpace *rgb8 = KoColorSpaceRegistry::instance()->rgb8();
+    const KoColorSpace *gray16 = KoColorSpaceRegistry::instance()->colorSpace(GrayAColorModelID.id(), Integer16BitsColorDepthID.id(), 0);
+
+    KisImageSP image = new KisImage(new KisSurrogateUndoStore(), size.width(), size.height(), rgb8, "raw canvas benchmark");
+
+    KisPaintLayerSP layer1 = new KisPaintLayer(image, "layer1", OPACITY_OPAQUE_U8);
+    fillPattern(layer1->paintDevice(), QRect(QPoint(), size));
+    image->addNode(layer1, image->rootLayer());
+
+    KisPaintLayerSP layer2 = new KisPaintLayer(image, "layer2", OPACITY_OPAQUE_U8, gray16);
+    fillPattern(layer2->paintDevice(), QRect(QPoint(), size / 2));
+    image->addNode(layer2, image->rootLayer());
+
+    return image;
+}
+
+}
+
+void KisRawCanvasBenchmark::benchmarkRoundTrip_data()
+{
+    QTest::addColumn<QString>("mimeType");
+    QTest::addColumn<QString>("suffix");
+
+    QTest::newRow("krc") << QString("application/x-krita-raw-canvas") << ".krc";
+    QTest::newRow("kra") << QString("application/x-krita") << ".kra";
+}
+
+void KisRawCanvasBenchmark::benchmarkRoundTrip()
+{
+    QFETCH(QString, mimeType);
+    QFETCH(QString, suffix);
+
+    KisImageSP image = createBenchmarkImage(QSize(4096, 4096));
+
+    QScopedPointer<KisDocument> doc1(KisPart::instance()->createDocument());
+    doc1->setFileBatchMode(true);
+    doc1->setCurrentImage(image);
+
+    QTemporaryFile savedFile(QDir::tempPath() + QLatin1String("/krita_XXXXXX") + suffix);
+    savedFile.setAutoRemove(true);
+    savedFile.open();
+
+    const QString savedFileName(savedFile.fileName());
+
+    QBENCHMARK_ONCE {
+        bool r = doc1->exportDocumentSync(QUrl::fromLocalFile(savedFileName), mimeType.toLatin1());
+        QVERIFY(r);
+
+        QScopedPointer<KisDocument> doc2(KisPart::instance()->createDocument());
+        doc2->setFileBatchMode(true);
+        r = doc2->importDocument(QUrl::fromLocalFile(savedFileName));
+        QVERIFY(r);
+    }
+}
+
+KISTEST_MAIN(KisRawCanvasBenchmark)
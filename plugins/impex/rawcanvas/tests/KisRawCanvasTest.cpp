@@ -0,0 +1,161 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisRawCanvasTest.h"
+
+#include <QTest>
+#include <QCoreApplication>
+
+#include <KoColor.h>
+#include <KoColorModelStandardIds.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoCompositeOpRegistry.h>
+
+#include <KisDocument.h>
+#include <KisPart.h>
+#include <kis_image.h>
+#include <kis_group_layer.h>
+#include <kis_paint_layer.h>
+#include <kis_sequential_iterator.h>
+#include <kis_undo_stores.h>
+
+#include "filestest.h"
+
+#ifndef FILES_DATA_DIR
+#error "FILES_DATA_DIR not set. A directory with the data used for testing the importing of files in krita"
+#endif
+
+
+const QString RawCanvasMimetype = "application/x-krita-raw-canvas";
+
+
+void KisRawCanvasTest::testImportFromWriteonly()
+{
+    TestUtil::testImportFromWriteonly(QString(FILES_DATA_DIR), RawCanvasMimetype);
+}
+
+
+void KisRawCanvasTest::testExportToReadonly()
+{
+    TestUtil::testExportToReadonly(QString(FILES_DATA_DIR), RawCanvasMimetype);
+}
+
+
+void KisRawCanvasTest::testImportIncorrectFormat()
+{
+    TestUtil::testImportIncorrectFormat(QString(FILES_DATA_DIR), RawCanvasMimetype);
+}
+
+namespace {
+
+void fillPattern(KisPaintDeviceSP dev, const QRect &rect)
+{
+    const int pixelSize = dev->pixelSize();
+
+    KisSequentialIterator it(dev, rect);
+    while (it.nextPixel()) {
+        quint8 *data = it.rawData();
+        for (int i = 0; i < pixelSize; i++) {
+            data[i] = quint8(it.x() * 7 + it.y() * 13 + i * 31);
+        }
+    }
+}
+
+QByteArray devicePixels(KisPaintDeviceSP dev, const QRect &rect)
+{
+    QByteArray pixels(rect.width() * rect.height() * dev->pixelSize(), Qt::Uninitialized);
+    dev->readBytes(reinterpret_cast<quint8*>(pixels.data()), rect);
+    return pixels;
+}
+
+KisImageSP createTestImage(const QSize &size)
+{
+    const KoColorSpace *rgb8 = KoColorSpaceRegistry::instance()->rgb8();
+    const KoColorSpace *gray16 = KoColorSpaceRegistry::instance()->colorSpace(GrayAColorModelID.id(), Integer16BitsColorDepthID.id(), 0);
+
+    KisImageSP image = new KisImage(new KisSurrogateUndoStore(), size.width(), size.height(), rgb8, "raw canvas test");
+    image->setResolution(2.0, 3.0);
+
+    KisPaintLayerSP layer1 = new KisPaintLayer(image, "layer1", OPACITY_OPAQUE_U8);
+    layer1->paintDevice()->moveTo(17, -30);
+    fillPattern(layer1->paintDevice(), QRect(10, 0, size.width() - 20, size.height()));
+    image->addNode(layer1, image->rootLayer());
+
+    KisPaintLayerSP layer2 = new KisPaintLayer(image, "layer2", 128, gray16);
+    layer2->setVisible(false);
+    layer2->setCompositeOpId(COMPOSITE_MULT);
+    layer2->paintDevice()->setDefaultPixel(KoColor(Qt::white, gray16));
+    fillPattern(layer2->paintDevice(), QRect(100, 150, 70, 40));
+    image->addNode(layer2, image->rootLayer());
+
+    return image;
+}
+
+}
+
+void KisRawCanvasTest::testRoundTrip()
+{
+    KisImageSP image = createTestImage(QSize(300, 200));
+
+    QScopedPointer<KisDocument> doc1(KisPart::instance()->createDocument());
+    doc1->setFileBatchMode(true);
+    doc1->setCurrentImage(image);
+
+    QTemporaryFile savedFile(QDir::tempPath() + QLatin1String("/krita_XXXXXX") + QLatin1String(".krc"));
+    savedFile.setAutoRemove(true);
+    savedFile.open();
+
+    const QString savedFileName(savedFile.fileName());
+
+    bool r = doc1->exportDocumentSync(QUrl::fromLocalFile(savedFileName), RawCanvasMimetype.toLatin1());
+    QVERIFY(r);
+
+    QScopedPointer<KisDocument> doc2(KisPart::instance()->createDocument());
+    doc2->setFileBatchMode(true);
+    r = doc2->importDocument(QUrl::fromLocalFile(savedFileName));
+
+    QVERIFY(r);
+    KisImageSP image2 = doc2->image();
+    QVERIFY(image2);
+    QCOMPARE(image2->bounds(), image->bounds());
+    QCOMPARE(image2->xRes(), image->xRes());
+    QCOMPARE(image2->yRes(), image->yRes());
+    QCOMPARE(image2->root()->childCount(), image->root()->childCount());
+
+    for (KisNodeSP node1 = image->root()->firstChild(), node2 = image2->root()->firstChild();
+         node1 && node2;
+         node1 = node1->nextSibling(), node2 = node2->nextSibling()) {
+
+        QCOMPARE(node2->name(), node1->name());
+        QCOMPARE(node2->opacity(), node1->opacity());
+        QCOMPARE(node2->visible(), node1->visible());
+        QCOMPARE(node2->compositeOpId(), node1->compositeOpId());
+
+        KisPaintDeviceSP dev1 = node1->paintDevice();
+        KisPaintDeviceSP dev2 = node2->paintDevice();
+
+        QVERIFY(*dev2->colorSpace() == *dev1->colorSpace());
+        QVERIFY(dev2->defaultPixel() == dev1->defaultPixel());
+        QCOMPARE(dev2->offset(), dev1->offset());
+        QCOMPARE(dev2->extent(), dev1->extent());
+        QVERIFY(devicePixels(dev2, dev1->extent()) == devicePixels(dev1, dev1->extent()));
+    }
+}
+
+
+KISTEST_MAIN(KisRawCanvasTest)
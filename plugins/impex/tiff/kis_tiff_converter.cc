@@ -25,6 +25,8 @@
 #include <QApplication>
 
 #include <QFileInfo>
+#include <QThread>
+#include <QtConcurrent>
 
 #include <KoDocumentInfo.h>
 #include <KoUnit.h>
@@ -199,6 +201,176 @@ QPair<QString, QString> getColorSpaceForColorType(uint16 sampletype, uint16 colo
     }
     return QPair<QString, QString>();
 }
+
+/**
+ * The layout of the pixel data of a TIFF directory. The data is stored in
+ * blocks, strips or rows of tiles, which can be decoded independently.
+ */
+struct TIFFBlockLayout {
+    bool tiled;
+    uint32 width;
+    uint32 height;
+    uint32 tileWidth;
+    uint32 blockHeight; // the height of the tiles or the number of rows per strip
+    uint16 depth;
+    uint16 nbchannels;
+    uint16 planarconfig;
+    uint16 vsubsampling;
+    uint16 *lineSizeCoeffs;
+};
+
+/**
+ * Decodes the rows [firstRow, lastRow) of the current directory of \p image
+ * into the paint device of \p tiffReader. \p firstRow should be the first
+ * row of a block. All the buffers are allocated locally, so several ranges
+ * can be decoded in parallel, each one with its own handle of the file.
+ */
+void decodeBlocks(TIFF *image, const TIFFBlockLayout &layout, KisTIFFReaderBase *tiffReader, uint32 firstRow, uint32 lastRow)
+{
+    tdata_t buf = 0;
+    tdata_t* ps_buf = 0; // used only for planar configuration separated
+    KisBufferStreamBase* tiffstream;
+
+    if (layout.tiled) {
+        const uint32 tileWidth = layout.tileWidth;
+        const uint32 tileHeight = layout.blockHeight;
+        uint32 x, y;
+        uint32 linewidth = (tileWidth * layout.depth * layout.nbchannels) / 8;
+        if (layout.planarconfig == PLANARCONFIG_CONTIG) {
+            buf = _TIFFmalloc(TIFFTileSize(image));
+            if (layout.depth < 16) {
+                tiffstream = new KisBufferStreamContigBelow16((uint8*)buf, layout.depth, linewidth);
+            }
+            else if (layout.depth < 32) {
+                tiffstream = new KisBufferStreamContigBelow32((uint8*)buf, layout.depth, linewidth);
+            }
+            else {
+                tiffstream = new KisBufferStreamContigAbove32((uint8*)buf, layout.depth, linewidth);
+            }
+        }
+        else {
+            ps_buf = new tdata_t[layout.nbchannels];
+            uint32 * lineSizes = new uint32[layout.nbchannels];
+            tmsize_t baseSize = TIFFTileSize(image);
+            for (uint i = 0; i < layout.nbchannels; i++) {
+                ps_buf[i] = _TIFFmalloc(baseSize);
+                lineSizes[i] = tileWidth;;
+            }
+            tiffstream = new KisBufferStreamSeperate((uint8**) ps_buf, layout.nbchannels, layout.depth, lineSizes);
+            delete [] lineSizes;
+        }
+        dbgFile << linewidth << "" << layout.nbchannels;
+        for (y = firstRow; y < lastRow; y += tileHeight) {
+            for (x = 0; x < layout.width; x += tileWidth) {
+                dbgFile << "Reading tile x =" << x << " y =" << y;
+                if (layout.planarconfig == PLANARCONFIG_CONTIG) {
+                    TIFFReadTile(image, buf, x, y, 0, (tsample_t) - 1);
+                }
+                else {
+                    for (uint i = 0; i < layout.nbchannels; i++) {
+                        TIFFReadTile(image, ps_buf[i], x, y, 0, i);
+                    }
+                }
+                uint32 realTileWidth = (x + tileWidth) < layout.width ? tileWidth : layout.width - x;
+                for (uint yintile = 0; y + yintile < lastRow && yintile < tileHeight / layout.vsubsampling;) {
+                    tiffReader->copyDataToChannels(x, y + yintile , realTileWidth, tiffstream);
+                    yintile += 1;
+                    tiffstream->moveToLine(yintile);
+                }
+                tiffstream->restart();
+            }
+        }
+    }
+    else {
+        tsize_t stripsize = TIFFStripSize(image);
+        const uint32 rowsPerStrip = layout.blockHeight;
+        if (layout.planarconfig == PLANARCONFIG_CONTIG) {
+            buf = _TIFFmalloc(stripsize);
+            if (layout.depth < 16) {
+                tiffstream = new KisBufferStreamContigBelow16((uint8*)buf, layout.depth, stripsize / rowsPerStrip);
+            }
+            else if (layout.depth < 32) {
+                tiffstream = new KisBufferStreamContigBelow32((uint8*)buf, layout.depth, stripsize / rowsPerStrip);
+            }
+            else {
+                tiffstream = new KisBufferStreamContigAbove32((uint8*)buf, layout.depth, stripsize / rowsPerStrip);
+            }
+        }
+        else {
+            ps_buf = new tdata_t[layout.nbchannels];
+            uint32 scanLineSize = stripsize / rowsPerStrip;
+            dbgFile << " scanLineSize for each plan =" << scanLineSize;
+            uint32 * lineSizes = new uint32[layout.nbchannels];
+            for (uint i = 0; i < layout.nbchannels; i++) {
+                ps_buf[i] = _TIFFmalloc(stripsize);
+                lineSizes[i] = scanLineSize / layout.lineSizeCoeffs[i];
+            }
+            tiffstream = new KisBufferStreamSeperate((uint8**) ps_buf, layout.nbchannels, layout.depth, lineSizes);
+            delete [] lineSizes;
+        }
+
+        dbgFile << "Scanline size =" << TIFFRasterScanlineSize(image) << " / strip size =" << TIFFStripSize(image) << " / rowsPerStrip =" << rowsPerStrip << " stripsize/rowsPerStrip =" << stripsize / rowsPerStrip;
+        uint32 y = firstRow;
+        dbgFile << " NbOfStrips =" << TIFFNumberOfStrips(image) << " rowsPerStrip =" << rowsPerStrip << " stripsize =" << stripsize;
+        while (y < lastRow) {
+            if (layout.planarconfig == PLANARCONFIG_CONTIG) {
+                TIFFReadEncodedStrip(image, TIFFComputeStrip(image, y, 0) , buf, (tsize_t) - 1);
+            }
+            else {
+                for (uint i = 0; i < layout.nbchannels; i++) {
+                    TIFFReadEncodedStrip(image, TIFFComputeStrip(image, y, i), ps_buf[i], (tsize_t) - 1);
+                }
+            }
+            for (uint32 yinstrip = 0 ; yinstrip < rowsPerStrip && y < lastRow ;) {
+                uint linesread = tiffReader->copyDataToChannels(0, y, layout.width, tiffstream);
+                y += linesread;
+                yinstrip += linesread;
+                tiffstream->moveToLine(yinstrip);
+            }
+            tiffstream->restart();
+        }
+    }
+    delete tiffstream;
+    if (layout.planarconfig == PLANARCONFIG_CONTIG) {
+        _TIFFfree(buf);
+    } else {
+        for (uint i = 0; i < layout.nbchannels; i++) {
+            _TIFFfree(ps_buf[i]);
+        }
+        delete[] ps_buf;
+    }
+}
+
+struct TIFFDecodingRange {
+    uint32 firstRow;
+    uint32 lastRow;
+    bool decoded;
+};
+
+/**
+ * Splits the image into ranges of blocks, which can be decoded in parallel.
+ * The borders of the ranges are aligned to the tiles of the paint device,
+ * so that the threads never write into the same tile.
+ */
+QVector<TIFFDecodingRange> splitIntoDecodingRanges(const TIFFBlockLayout &layout)
+{
+    const uint32 deviceTileSize = 64;
+
+    uint32 alignment = layout.blockHeight;
+    while (alignment % deviceTileSize != 0 && alignment < layout.height) {
+        alignment += layout.blockHeight;
+    }
+
+    const uint32 numRanges = 2 * QThread::idealThreadCount();
+    const uint32 rangeHeight = qMax(alignment, (layout.height / numRanges + alignment - 1) / alignment * alignment);
+
+    QVector<TIFFDecodingRange> ranges;
+    for (uint32 y = 0; y < layout.height; y += rangeHeight) {
+        ranges.append({y, qMin(layout.height, y + rangeHeight), false});
+    }
+
+    return ranges;
+}
 }
 
 KisPropertiesConfigurationSP KisTIFFOptions::toProperties() const
@@ -490,10 +662,6 @@ KisImportExportErrorCode KisTIFFConverter::readTIFFDirectory(TIFF* image)
         }
     }
     KisPaintLayer* layer = new KisPaintLayer(m_image.data(), m_image -> nextLayerName(), quint8_MAX);
-    tdata_t buf = 0;
-    tdata_t* ps_buf = 0; // used only for planar configuration separated
-    KisBufferStreamBase* tiffstream;
-
     KisTIFFReaderBase* tiffReader = 0;
 
     quint8 poses[5];
@@ -609,123 +777,66 @@ KisImportExportErrorCode KisTIFFConverter::readTIFFDirectory(TIFF* image)
         return ImportExportCodes::FileFormatIncorrect;
     }
 
-    if (TIFFIsTiled(image)) {
+    TIFFBlockLayout layout;
+    layout.tiled = TIFFIsTiled(image);
+    layout.width = width;
+    layout.height = height;
+    layout.tileWidth = 0;
+    layout.blockHeight = 0;
+    layout.depth = depth;
+    layout.nbchannels = nbchannels;
+    layout.planarconfig = planarconfig;
+    layout.vsubsampling = vsubsampling;
+    layout.lineSizeCoeffs = lineSizeCoeffs;
+
+    if (layout.tiled) {
         dbgFile << "tiled image";
-        uint32 tileWidth, tileHeight;
-        uint32 x, y;
-        TIFFGetField(image, TIFFTAG_TILEWIDTH, &tileWidth);
-        TIFFGetField(image, TIFFTAG_TILELENGTH, &tileHeight);
-        uint32 linewidth = (tileWidth * depth * nbchannels) / 8;
-        if (planarconfig == PLANARCONFIG_CONTIG) {
-            buf = _TIFFmalloc(TIFFTileSize(image));
-            if (depth < 16) {
-                tiffstream = new KisBufferStreamContigBelow16((uint8*)buf, depth, linewidth);
-            }
-            else if (depth < 32) {
-                tiffstream = new KisBufferStreamContigBelow32((uint8*)buf, depth, linewidth);
-            }
-            else {
-                tiffstream = new KisBufferStreamContigAbove32((uint8*)buf, depth, linewidth);
-            }
-        }
-        else {
-            ps_buf = new tdata_t[nbchannels];
-            uint32 * lineSizes = new uint32[nbchannels];
-            tmsize_t baseSize = TIFFTileSize(image);
-            for (uint i = 0; i < nbchannels; i++) {
-                ps_buf[i] = _TIFFmalloc(baseSize);
-                lineSizes[i] = tileWidth;;
-            }
-            tiffstream = new KisBufferStreamSeperate((uint8**) ps_buf, nbchannels, depth, lineSizes);
-            delete [] lineSizes;
-        }
-        dbgFile << linewidth << "" << nbchannels << "" << layer->paintDevice()->colorSpace()->colorChannelCount();
-        for (y = 0; y < height; y += tileHeight) {
-            for (x = 0; x < width; x += tileWidth) {
-                dbgFile << "Reading tile x =" << x << " y =" << y;
-                if (planarconfig == PLANARCONFIG_CONTIG) {
-                    TIFFReadTile(image, buf, x, y, 0, (tsample_t) - 1);
-                }
-                else {
-                    for (uint i = 0; i < nbchannels; i++) {
-                        TIFFReadTile(image, ps_buf[i], x, y, 0, i);
-                    }
-                }
-                uint32 realTileWidth = (x + tileWidth) < width ? tileWidth : width - x;
-                for (uint yintile = 0; y + yintile < height && yintile < tileHeight / vsubsampling;) {
-                    tiffReader->copyDataToChannels(x, y + yintile , realTileWidth, tiffstream);
-                    yintile += 1;
-                    tiffstream->moveToLine(yintile);
-                }
-                tiffstream->restart();
-            }
-        }
-    }
-    else {
+        TIFFGetField(image, TIFFTAG_TILEWIDTH, &layout.tileWidth);
+        TIFFGetField(image, TIFFTAG_TILELENGTH, &layout.blockHeight);
+    } else {
         dbgFile << "striped image";
-        tsize_t stripsize = TIFFStripSize(image);
-        uint32 rowsPerStrip;
-        TIFFGetFieldDefaulted(image, TIFFTAG_ROWSPERSTRIP, &rowsPerStrip);
-        dbgFile << rowsPerStrip << "" << height;
-        rowsPerStrip = qMin(rowsPerStrip, height); // when TIFFNumberOfStrips(image) == 1 it might happen that rowsPerStrip is incorrectly set
-        if (planarconfig == PLANARCONFIG_CONTIG) {
-            buf = _TIFFmalloc(stripsize);
-            if (depth < 16) {
-                tiffstream = new KisBufferStreamContigBelow16((uint8*)buf, depth, stripsize / rowsPerStrip);
-            }
-            else if (depth < 32) {
-                tiffstream = new KisBufferStreamContigBelow32((uint8*)buf, depth, stripsize / rowsPerStrip);
-            }
-            else {
-                tiffstream = new KisBufferStreamContigAbove32((uint8*)buf, depth, stripsize / rowsPerStrip);
-            }
-        }
-        else {
-            ps_buf = new tdata_t[nbchannels];
-            uint32 scanLineSize = stripsize / rowsPerStrip;
-            dbgFile << " scanLineSize for each plan =" << scanLineSize;
-            uint32 * lineSizes = new uint32[nbchannels];
-            for (uint i = 0; i < nbchannels; i++) {
-                ps_buf[i] = _TIFFmalloc(stripsize);
-                lineSizes[i] = scanLineSize / lineSizeCoeffs[i];
-            }
-            tiffstream = new KisBufferStreamSeperate((uint8**) ps_buf, nbchannels, depth, lineSizes);
-            delete [] lineSizes;
-        }
+        TIFFGetFieldDefaulted(image, TIFFTAG_ROWSPERSTRIP, &layout.blockHeight);
+        dbgFile << layout.blockHeight << "" << height;
+        layout.blockHeight = qMin(layout.blockHeight, height); // when TIFFNumberOfStrips(image) == 1 it might happen that rowsPerStrip is incorrectly set
+    }
 
-        dbgFile << "Scanline size =" << TIFFRasterScanlineSize(image) << " / strip size =" << TIFFStripSize(image) << " / rowsPerStrip =" << rowsPerStrip << " stripsize/rowsPerStrip =" << stripsize / rowsPerStrip;
-        uint32 y = 0;
-        dbgFile << " NbOfStrips =" << TIFFNumberOfStrips(image) << " rowsPerStrip =" << rowsPerStrip << " stripsize =" << stripsize;
-        for (uint32 strip = 0; y < height; strip++) {
-            if (planarconfig == PLANARCONFIG_CONTIG) {
-                TIFFReadEncodedStrip(image, TIFFComputeStrip(image, y, 0) , buf, (tsize_t) - 1);
-            }
-            else {
-                for (uint i = 0; i < nbchannels; i++) {
-                    TIFFReadEncodedStrip(image, TIFFComputeStrip(image, y, i), ps_buf[i], (tsize_t) - 1);
-                }
+    /**
+     * YCbCr readers collect the pixels in their own buffers, and color
+     * transformations are not guaranteed to be reentrant, so such images
+     * are decoded sequentially
+     */
+    QVector<TIFFDecodingRange> ranges;
+    if (color_type != PHOTOMETRIC_YCBCR && !transform && layout.blockHeight > 0) {
+        ranges = splitIntoDecodingRanges(layout);
+    }
+
+    if (ranges.size() > 1) {
+        const QByteArray fileName(TIFFFileName(image));
+        const tdir_t directory = TIFFCurrentDirectory(image);
+
+        QtConcurrent::blockingMap(ranges, [&] (TIFFDecodingRange &range) {
+            TIFF *handle = TIFFOpen(fileName.constData(), "r");
+            if (!handle) return;
+
+            if (TIFFSetDirectory(handle, directory)) {
+                decodeBlocks(handle, layout, tiffReader, range.firstRow, range.lastRow);
+                range.decoded = true;
             }
-            for (uint32 yinstrip = 0 ; yinstrip < rowsPerStrip && y < height ;) {
-                uint linesread = tiffReader->copyDataToChannels(0, y, width, tiffstream);
-                y += linesread;
-                yinstrip += linesread;
-                tiffstream->moveToLine(yinstrip);
+            TIFFClose(handle);
+        });
+
+        Q_FOREACH (const TIFFDecodingRange &range, ranges) {
+            if (!range.decoded) {
+                decodeBlocks(image, layout, tiffReader, range.firstRow, range.lastRow);
             }
-            tiffstream->restart();
         }
+    } else {
+        decodeBlocks(image, layout, tiffReader, 0, height);
     }
+
     tiffReader->finalize();
     delete[] lineSizeCoeffs;
     delete tiffReader;
-    delete tiffstream;
-    if (planarconfig == PLANARCONFIG_CONTIG) {
-        _TIFFfree(buf);
-    } else {
-        for (uint i = 0; i < nbchannels; i++) {
-            _TIFFfree(ps_buf[i]);
-        }
-        delete[] ps_buf;
-    }
 
     m_image->addNode(KisNodeSP(layer), m_image->rootLayer().data());
     return ImportExportCodes::OK;
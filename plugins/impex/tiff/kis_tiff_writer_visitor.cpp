@@ -24,6 +24,11 @@
 #include <KoID.h>
 #include <KoColorSpaceRegistry.h>
 
+#include <QThread>
+#include <QtConcurrent>
+
+#include <zlib.h>
+
 #include <KoConfig.h>
 #ifdef HAVE_OPENEXR
 #include <half.h>
@@ -174,6 +179,135 @@ bool KisTIFFWriterVisitor::copyDataToStrips(KisHLineConstIteratorSP it, tdata_t
     return false;
 }
 
+bool KisTIFFWriterVisitor::copyRowToBuffer(KisPaintDeviceSP pd, int y, int width, tdata_t buff, uint16 color_type, uint8 depth, uint16 sample_format)
+{
+    bool r = true;
+    KisHLineConstIteratorSP it = pd->createHLineConstIteratorNG(0, y, width);
+    switch (color_type) {
+    case PHOTOMETRIC_MINISBLACK: {
+            quint8 poses[] = { 0, 1 };
+            r = copyDataToStrips(it, buff, depth, sample_format, 1, poses);
+        }
+        break;
+    case PHOTOMETRIC_RGB: {
+            quint8 poses[4];
+            if (sample_format == SAMPLEFORMAT_IEEEFP) {
+                poses[2] = 2; poses[1] = 1; poses[0] = 0; poses[3] = 3;
+            } else {
+                poses[0] = 2; poses[1] = 1; poses[2] = 0; poses[3] = 3;
+            }
+            r = copyDataToStrips(it, buff, depth, sample_format, 3, poses);
+        }
+        break;
+    case PHOTOMETRIC_SEPARATED: {
+            quint8 poses[] = { 0, 1, 2, 3, 4 };
+            r = copyDataToStrips(it, buff, depth, sample_format, 4, poses);
+        }
+        break;
+    case PHOTOMETRIC_ICCLAB: {
+            quint8 poses[] = { 0, 1, 2, 3 };
+            r = copyDataToStrips(it, buff, depth, sample_format, 3, poses);
+        }
+        break;
+    }
+    return r;
+}
+
+namespace {
+const int rowsPerStrip = 8;
+
+/**
+ * Horizontal differencing, the same libtiff does for PREDICTOR_HORIZONTAL
+ */
+template <typename T>
+void applyHorizontalPredictor(quint8 *data, int numRows, tsize_t rowSize, int samplesPerPixel)
+{
+    const int numSamples = rowSize / sizeof(T);
+
+    for (int row = 0; row < numRows; row++) {
+        T *samples = reinterpret_cast<T*>(data + row * rowSize);
+        for (int i = numSamples - 1; i >= samplesPerPixel; i--) {
+            samples[i] -= samples[i - samplesPerPixel];
+        }
+    }
+}
+}
+
+bool KisTIFFWriterVisitor::writeStripsInParallel(KisPaintDeviceSP pd, uint16 color_type, uint8 depth, uint16 sample_format, qint32 width, qint32 height)
+{
+    struct Strip {
+        int index;
+        QByteArray data;
+        bool isValid;
+    };
+
+    const tsize_t scanlineSize = TIFFScanlineSize(image());
+    const int samplesPerPixel = m_options->alpha ? pd->channelCount() : pd->channelCount() - 1;
+    const int numStrips = (height + rowsPerStrip - 1) / rowsPerStrip;
+
+    // the strips are compressed in batches to limit the memory usage
+    const int batchSize = 4 * QThread::idealThreadCount();
+
+    for (int firstStrip = 0; firstStrip < numStrips; firstStrip += batchSize) {
+        QVector<Strip> strips;
+        for (int i = firstStrip; i < qMin(numStrips, firstStrip + batchSize); i++) {
+            strips.append({i, QByteArray(), false});
+        }
+
+        QtConcurrent::blockingMap(strips, [&] (Strip &strip) {
+            const int firstRow = strip.index * rowsPerStrip;
+            const int numRows = qMin(rowsPerStrip, height - firstRow);
+
+            QByteArray rawData(numRows * scanlineSize, Qt::Uninitialized);
+            quint8 *rawPtr = reinterpret_cast<quint8*>(rawData.data());
+
+            for (int row = 0; row < numRows; row++) {
+                if (!copyRowToBuffer(pd, firstRow + row, width, rawPtr + row * scanlineSize, color_type, depth, sample_format)) {
+                    return;
+                }
+            }
+
+            // libtiff doesn't apply the predictor to uncompressed strips
+            if (m_options->compressionType != COMPRESSION_NONE &&
+                m_options->predictor == PREDICTOR_HORIZONTAL) {
+                if (depth == 8) {
+                    applyHorizontalPredictor<quint8>(rawPtr, numRows, scanlineSize, samplesPerPixel);
+                } else if (depth == 16) {
+                    applyHorizontalPredictor<quint16>(rawPtr, numRows, scanlineSize, samplesPerPixel);
+                } else {
+                    applyHorizontalPredictor<quint32>(rawPtr, numRows, scanlineSize, samplesPerPixel);
+                }
+            }
+
+            if (m_options->compressionType == COMPRESSION_NONE) {
+                strip.data = rawData;
+            } else {
+                uLongf compressedSize = compressBound(rawData.size());
+                strip.data.resize(compressedSize);
+
+                if (compress2(reinterpret_cast<Bytef*>(strip.data.data()), &compressedSize,
+                              reinterpret_cast<const Bytef*>(rawData.constData()), rawData.size(),
+                              m_options->deflateCompress) != Z_OK) {
+                    return;
+                }
+                strip.data.resize(compressedSize);
+            }
+
+            strip.isValid = true;
+        });
+
+        Q_FOREACH (const Strip &strip, strips) {
+            if (!strip.isValid ||
+                TIFFWriteRawStrip(image(), strip.index, const_cast<char*>(strip.data.constData()), strip.data.size()) < 0) {
+
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
 bool KisTIFFWriterVisitor::saveLayerProjection(KisLayer *layer)
 {
     dbgFile << "visiting on layer" << layer->name() << "";
@@ -222,7 +356,7 @@ bool KisTIFFWriterVisitor::saveLayerProjection(KisLayer *layer)
     // Use contiguous configuration
     TIFFSetField(image(), TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
     // Use 8 rows per strip
-    TIFFSetField(image(), TIFFTAG_ROWSPERSTRIP, 8);
+    TIFFSetField(image(), TIFFTAG_ROWSPERSTRIP, rowsPerStrip);
 
     // Save profile
     if (m_options->saveProfile) {
@@ -232,45 +366,33 @@ bool KisTIFFWriterVisitor::saveLayerProjection(KisLayer *layer)
             TIFFSetField(image(), TIFFTAG_ICCPROFILE, ba.size(), ba.constData());
         }
     }
-    tsize_t stripsize = TIFFStripSize(image());
-    tdata_t buff = _TIFFmalloc(stripsize);
     qint32 height = layer->image()->height();
     qint32 width = layer->image()->width();
-    bool r = true;
-    for (int y = 0; y < height; y++) {
-        KisHLineConstIteratorSP it = pd->createHLineConstIteratorNG(0, y, width);
-        switch (color_type) {
-        case PHOTOMETRIC_MINISBLACK: {
-                quint8 poses[] = { 0, 1 };
-                r = copyDataToStrips(it, buff, depth, sample_format, 1, poses);
-            }
-            break;
-        case PHOTOMETRIC_RGB: {
-                quint8 poses[4];
-                if (sample_format == SAMPLEFORMAT_IEEEFP) {
-                    poses[2] = 2; poses[1] = 1; poses[0] = 0; poses[3] = 3;
-                } else {
-                    poses[0] = 2; poses[1] = 1; poses[2] = 0; poses[3] = 3;
-                }
-                r = copyDataToStrips(it, buff, depth, sample_format, 3, poses);
-            }
-            break;
-        case PHOTOMETRIC_SEPARATED: {
-                quint8 poses[] = { 0, 1, 2, 3, 4 };
-                r = copyDataToStrips(it, buff, depth, sample_format, 4, poses);
-            }
-            break;
-        case PHOTOMETRIC_ICCLAB: {
-                quint8 poses[] = { 0, 1, 2, 3 };
-                r = copyDataToStrips(it, buff, depth, sample_format, 3, poses);
-            }
-            break;
+
+    const bool canCompressInParallel =
+        (m_options->compressionType == COMPRESSION_NONE ||
+         m_options->compressionType == COMPRESSION_DEFLATE ||
+         m_options->compressionType == COMPRESSION_ADOBE_DEFLATE) &&
+        (m_options->predictor == PREDICTOR_NONE ||
+         m_options->predictor == PREDICTOR_HORIZONTAL);
+
+    if (canCompressInParallel) {
+        if (!writeStripsInParallel(pd, color_type, depth, sample_format, width, height)) {
             return false;
         }
-        if (!r) return false;
-        TIFFWriteScanline(image(), buff, y, (tsample_t) - 1);
+    } else {
+        tsize_t stripsize = TIFFStripSize(image());
+        tdata_t buff = _TIFFmalloc(stripsize);
+        for (int y = 0; y < height; y++) {
+            if (!copyRowToBuffer(pd, y, width, buff, color_type, depth, sample_format)) {
+                _TIFFfree(buff);
+                return false;
+            }
+            TIFFWriteScanline(image(), buff, y, (tsample_t) - 1);
+        }
+        _TIFFfree(buff);
     }
-    _TIFFfree(buff);
+
     TIFFWriteDirectory(image());
     return true;
 }
@@ -110,6 +110,12 @@ private:
         return m_image;
     }
     bool copyDataToStrips(KisHLineConstIteratorSP it, tdata_t buff, uint8 depth, uint16 sample_format, uint8 nbcolorssamples, quint8* poses);
+    bool copyRowToBuffer(KisPaintDeviceSP pd, int y, int width, tdata_t buff, uint16 color_type, uint8 depth, uint16 sample_format);
+    /**
+     * Compresses the strips in worker threads and writes them with
+     * TIFFWriteRawStrip(). Only deflate and no compression are supported.
+     */
+    bool writeStripsInParallel(KisPaintDeviceSP pd, uint16 color_type, uint8 depth, uint16 sample_format, qint32 width, qint32 height);
     bool saveLayerProjection(KisLayer *);
 private:
     TIFF* m_image;
@@ -30,6 +30,12 @@
 #include "kisexiv2/kis_exiv2.h"
 #include  <sdk/tests/kistest.h>
 #include <KoColorModelStandardIdsUtils.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColorSpaceTraits.h>
+#include <kis_properties_configuration.h>
+#include <kis_paint_layer.h>
+#include <kis_sequential_iterator.h>
+#include <kis_undo_stores.h>
 
 #ifndef FILES_DATA_DIR
 #error "FILES_DATA_DIR not set. A directory with the data used for testing the importing of files in krita"
@@ -118,6 +124,60 @@ void KisTiffTest::testRoundTripRGBF16()
 #endif
 }
 
+void KisTiffTest::testRoundTripDeflateTallImage()
+{
+    /**
+     * The image has many more strips than one batch of the exporter
+     * and is split into several ranges of rows by the importer
+     */
+    const QRect imageRect(0, 0, 1000, 1500);
+
+    QScopedPointer<KisDocument> doc1(KisPart::instance()->createDocument());
+    doc1->setFileBatchMode(true);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), Integer16BitsColorDepthID.id(), 0);
+    KisImageSP image = new KisImage(new KisSurrogateUndoStore(), imageRect.width(), imageRect.height(), cs, "tall image");
+    KisPaintLayerSP layer = new KisPaintLayer(image, "layer1", OPACITY_OPAQUE_U8);
+    image->addNode(layer);
+    doc1->setCurrentImage(image);
+
+    KisSequentialIterator it(layer->paintDevice(), imageRect);
+    while (it.nextPixel()) {
+        KoBgrU16Traits::Pixel *pixel = reinterpret_cast<KoBgrU16Traits::Pixel*>(it.rawData());
+        pixel->red = it.x() * 65;
+        pixel->green = it.y() * 43;
+        pixel->blue = (it.x() ^ it.y()) * 17;
+        pixel->alpha = 0xffff - (it.x() & 0xff);
+    }
+
+    QTemporaryFile savedFile(QDir::tempPath() + QLatin1String("/krita_XXXXXX") + QLatin1String(".tiff"));
+    savedFile.setAutoRemove(true);
+    savedFile.open();
+
+    const QString savedFileName(savedFile.fileName());
+
+    KisPropertiesConfigurationSP cfg = new KisPropertiesConfiguration();
+    cfg->setProperty("compressiontype", 2); // deflate
+    cfg->setProperty("predictor", 1); // horizontal differencing
+
+    bool r = doc1->exportDocumentSync(QUrl::fromLocalFile(savedFileName), TiffMimetype.toLatin1(), cfg);
+    QVERIFY(r);
+
+    QScopedPointer<KisDocument> doc2(KisPart::instance()->createDocument());
+    doc2->setFileBatchMode(true);
+    r = doc2->importDocument(QUrl::fromLocalFile(savedFileName));
+
+    QVERIFY(r);
+    QVERIFY(doc2->image());
+    QCOMPARE(doc2->image()->bounds(), imageRect);
+
+    QPoint errorPoint;
+    QVERIFY(TestUtil::comparePaintDevices(
+                errorPoint,
+                layer->paintDevice(),
+                doc2->image()->root()->firstChild()->paintDevice()));
+}
+
 void KisTiffTest::testSaveTiffColorSpace(QString colorModel, QString colorDepth, QString colorProfile)
 {
     const KoColorSpace *space = KoColorSpaceRegistry::instance()->colorSpace(colorModel, colorDepth, colorProfile);
@@ -27,6 +27,7 @@ class KisTiffTest : public QObject
 private Q_SLOTS:
     void testFiles();
     void testRoundTripRGBF16();
+    void testRoundTripDeflateTallImage();
 
     void testSaveTiffColorSpace(QString colorModel, QString colorDepth, QString colorProfile);
     void testSaveTiffRgbaColorSpace();
@@ -39,6 +39,14 @@
 #include <kis_lod_transform.h>
 #include <kis_spacing_information.h>
 #include <KoColorModelStandardIds.h>
+#include <kis_texture_option.h>
+#include <kis_default_bounds_base.h>
+#include <kis_pointer_utils.h>
+
+#include <KisDabCacheUtils.h>
+#include <KisDabRenderingExecutor.h>
+#include <KisRenderedDab.h>
+#include <KisRunnableStrokeJobData.h>
 
 KisColorSmudgeOp::KisColorSmudgeOp(const KisPaintOpSettingsSP settings, KisPainter* painter, KisNodeSP node, KisImageSP image)
     : KisBrushBasedPaintOp(settings, painter)
@@ -53,11 +61,20 @@ KisColorSmudgeOp::KisColorSmudgeOp(const KisPaintOpSettingsSP settings, KisPaint
     , m_smudgeRateOption()
     , m_colorRateOption("ColorRate", KisPaintOpOption::GENERAL, false)
     , m_smudgeRadiusOption()
+    , m_avgUpdateTimePerDab(50)
+    , m_minUpdatePeriod(10)
+    , m_maxUpdatePeriod(100)
 {
     Q_UNUSED(node);
 
     Q_ASSERT(settings);
     Q_ASSERT(painter);
+
+    /**
+     * The dab masks are rendered by the threads of the executor, so
+     * we should forbid the brushes to do threading internally
+     */
+    m_brush->setThreadingAllowed(false);
     m_sizeOption.readOptionSetting(settings);
     m_opacityOption.readOptionSetting(settings);
     m_spacingOption.readOptionSetting(settings);
@@ -110,6 +127,41 @@ KisColorSmudgeOp::KisColorSmudgeOp(const KisPaintOpSettingsSP settings, KisPaint
     if (m_overlayModeOption.isChecked() && m_image && m_image->projection()){
         m_preciseImageDeviceWrapper.reset(new KisPrecisePaintDeviceWrapper(m_image->projection()));
     }
+
+    KisBrushSP baseBrush = m_brush;
+    auto resourcesFactory =
+        [baseBrush, settings, painter] () {
+            KisDabCacheUtils::DabRenderingResources *resources =
+                new KisDabCacheUtils::DabRenderingResources();
+            resources->brush = baseBrush->clone();
+
+            resources->textureOption.reset(new KisTextureProperties(painter->device()->defaultBounds()->currentLevelOfDetail()));
+            resources->textureOption->fillProperties(settings);
+
+            return resources;
+        };
+
+    m_dabExecutor.reset(
+        new KisDabRenderingExecutor(
+                    KoColorSpaceRegistry::instance()->alpha8(),
+                    resourcesFactory,
+                    painter->runnableStrokeJobsInterface(),
+                    &m_mirrorOption,
+                    &m_precisionOption));
+
+    if (m_smudgeRateOption.getMode() == KisSmudgeOption::SMEARING_MODE) {
+        /**
+        * Disable handling of the subpixel precision. In the smudge op we
+        * should read from the aligned areas of the image, so having
+        * additional internal offsets, created by the subpixel precision,
+        * will worsen the quality (at least because
+        * QRectF(dstDabRect).center() will not point to the real center
+        * of the brush anymore).
+        * Of course, this only really matters with smearing_mode (bug:327235),
+        * and you only notice the lack of subpixel precision in the dulling methods.
+        */
+        m_dabExecutor->disableSubpixelPrecision();
+    }
 }
 
 KisColorSmudgeOp::~KisColorSmudgeOp()
@@ -118,23 +170,6 @@ KisColorSmudgeOp::~KisColorSmudgeOp()
     delete m_hsvTransform;
 }
 
-void KisColorSmudgeOp::updateMask(const KisPaintInformation& info, double scale, double rotation, const QPointF &cursorPoint)
-{
-    static const KoColorSpace *cs = KoColorSpaceRegistry::instance()->alpha8();
-    static KoColor color(Qt::black, cs);
-
-    m_maskDab = m_dabCache->fetchDab(cs,
-                                     color,
-                                     cursorPoint,
-                                     KisDabShape(scale, 1.0, rotation),
-                                     info,
-                                     1.0,
-                                     &m_dstDabRect);
-
-    // sanity check
-    KIS_ASSERT_RECOVER_NOOP(m_dstDabRect.size() == m_maskDab->bounds().size());
-}
-
 inline void KisColorSmudgeOp::getTopLeftAligned(const QPointF &pos, const QPointF &hotSpot, qint32 *x, qint32 *y)
 {
     QPointF topLeft = pos - hotSpot;
@@ -147,48 +182,12 @@ inline void KisColorSmudgeOp::getTopLeftAligned(const QPointF &pos, const QPoint
 KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
 {
     KisBrushSP brush = m_brush;
-    const bool useDullingMode = m_smudgeRateOption.getMode() == KisSmudgeOption::DULLING_MODE;
-
-    /* This is a fix for dulling + overlay + paint,
-     * this should allow the image to composite paint addition effects correctly
-     * while also respecting overlay mode. */
-    bool useAlternatePrecisionSource = (m_overlayModeOption.isChecked() &&
-                                        useDullingMode &&
-                                        m_preciseImageDeviceWrapper!= nullptr);
-
-    KisPrecisePaintDeviceWrapper &activeWrapper = useAlternatePrecisionSource ? *m_preciseImageDeviceWrapper :
-                                                                                 m_precisePainterWrapper;
 
     // Simple error catching
     if (!painter()->device() || !brush || !brush->canPaintFor(info)) {
         return KisSpacingInformation(1.0);
     }
 
-    if (m_smudgeRateOption.getMode() == KisSmudgeOption::SMEARING_MODE) {
-        /**
-        * Disable handling of the subpixel precision. In the smudge op we
-        * should read from the aligned areas of the image, so having
-        * additional internal offsets, created by the subpixel precision,
-        * will worsen the quality (at least because
-        * QRectF(m_dstDabRect).center() will not point to the real center
-        * of the brush anymore).
-        * Of course, this only really matters with smearing_mode (bug:327235),
-        * and you only notice the lack of subpixel precision in the dulling methods.
-        */
-        m_dabCache->disableSubpixelPrecision();
-    }
-
-#if 0
-    //if precision
-    KoColor colorSpaceChanger = painter()->paintColor();
-    const KoColorSpace* preciseColorSpace = colorSpaceChanger.colorSpace();
-    if (colorSpaceChanger.colorSpace()->colorDepthId().id() == "U8") {
-    preciseColorSpace = KoColorSpaceRegistry::instance()->colorSpace(colorSpaceChanger.colorSpace()->colorModelId().id(), "U16", colorSpaceChanger.profile() );
-        colorSpaceChanger.convertTo(preciseColorSpace);
-    }
-    painter()->setPaintColor(colorSpaceChanger);
-#endif
-
     // get the scaling factor calculated by the size option
     qreal scale = m_sizeOption.apply(info);
     scale *= KisLodTransform::lodToScale(painter()->device());
@@ -197,25 +196,95 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
 
     KisDabShape shape(scale, 1.0, rotation);
 
-    QPointF scatteredPos =
-        m_scatterOption.apply(info,
-                              brush->maskWidth(shape, 0, 0, info),
-                              brush->maskHeight(shape, 0, 0, info));
+    const qreal maskWidth = brush->maskWidth(shape, 0, 0, info);
+    const qreal maskHeight = brush->maskHeight(shape, 0, 0, info);
+
+    QPointF scatteredPos = m_scatterOption.apply(info, maskWidth, maskHeight);
+
+    /**
+     * All the sensor-based options are evaluated here, on the stroke
+     * thread. paintDab() gets only the resulting values, so it can run
+     * in parallel with the next calls to paintAt().
+     */
+    DabParameters params;
+    params.hotSpot = brush->hotSpot(shape, info);
+
+    if (m_smudgeRateOption.getMode() == KisSmudgeOption::DULLING_MODE &&
+        m_smudgeRadiusOption.isChecked()) {
+
+        params.smudgeRadius = m_smudgeRadiusOption.smudgeRadius(info, 0.5 * (maskWidth + maskHeight));
+    }
+
+    const qreal fpOpacity = (qreal(painter()->opacity()) / 255.0) * m_opacityOption.getOpacityf(info);
+
+    // opacity calculated by the rate option
+    params.smudgeRateOpacity = m_smudgeRateOption.getOpacity(info, 0.0, 1.0, fpOpacity);
+
+    // if the user selected the color smudge option,
+    // we will mix some color into the temporary painting device (m_tempDev)
+    if (m_colorRateOption.isChecked()) {
+        // this will apply the opacity (selected by the user) to copyPainter
+        // (but fit the rate inbetween the range 0.0 to (1.0-SmudgeRate))
+        qreal maxColorRate = qMax<qreal>(1.0 - m_smudgeRateOption.getRate(), 0.2);
+        params.colorRateOpacity = m_colorRateOption.getOpacity(info, 0.0, maxColorRate, fpOpacity);
+
+        // the current color (foreground color) or a gradient color (if enabled)
+        params.color = m_paintColor;
+        m_gradientOption.apply(params.color, m_gradient, info);
+        if (m_hsvTransform) {
+            Q_FOREACH (KisPressureHSVOption * option, m_hsvOptions) {
+                option->apply(m_hsvTransform, info);
+            }
+            m_hsvTransform->transform(params.color.data(), params.color.data(), 1);
+        }
+    }
+
+    static const KoColorSpace *cs = KoColorSpaceRegistry::instance()->alpha8();
+    static KoColor color(Qt::black, cs);
 
-    QPointF hotSpot = brush->hotSpot(shape, info);
+    KisDabCacheUtils::DabRequestInfo request(color,
+                                             scatteredPos,
+                                             shape,
+                                             info,
+                                             1.0);
+
+    /**
+     * The lock is held while the dab is being added, otherwise a
+     * concurrent doAsyncronousUpdate() might take the rendered dab
+     * before its parameters are available.
+     */
+    {
+        QMutexLocker l(&m_dabParametersMutex);
+        const int seqNo = m_dabExecutor->addDab(request, OPACITY_OPAQUE_F, OPACITY_OPAQUE_F);
+        m_dabParameters.insert(seqNo, params);
+    }
+
+    return effectiveSpacing(scale, rotation, m_spacingOption, info);
+}
+
+void KisColorSmudgeOp::paintDab(const KisRenderedDab &dab, const DabParameters &params)
+{
+    const bool useDullingMode = m_smudgeRateOption.getMode() == KisSmudgeOption::DULLING_MODE;
+
+    /* This is a fix for dulling + overlay + paint,
+     * this should allow the image to composite paint addition effects correctly
+     * while also respecting overlay mode. */
+    bool useAlternatePrecisionSource = (m_overlayModeOption.isChecked() &&
+                                        useDullingMode &&
+                                        m_preciseImageDeviceWrapper!= nullptr);
+
+    KisPrecisePaintDeviceWrapper &activeWrapper = useAlternatePrecisionSource ? *m_preciseImageDeviceWrapper :
+                                                                                 m_precisePainterWrapper;
 
     /**
-     * Update the brush mask.
-     *
-     * Upon leaving the function:
-     *   o m_maskDab stores the new mask
-     *   o m_maskBounds stores the extents of the mask paint device
-     *   o m_dstDabRect stores the destination rect where the mask is going
-     *     to be written to
+     * The mask of the dab is prepared by the dab rendering executor.
+     * dstDabRect stores the destination rect where the mask is going
+     * to be written to.
      */
-    updateMask(info, scale, rotation, scatteredPos);
+    const KisFixedPaintDeviceSP maskDab = dab.device;
+    const QRect dstDabRect = dab.realBounds();
 
-    QPointF newCenterPos = QRectF(m_dstDabRect).center();
+    QPointF newCenterPos = QRectF(dstDabRect).center();
     /**
      * Save the center of the current dab to know where to read the
      * data during the next pass. We do not save scatteredPos here,
@@ -223,21 +292,15 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
      * brush (due to rounding effects), which will result in a
      * really weird quality.
      */
-    QRect srcDabRect = m_dstDabRect.translated((m_lastPaintPos - newCenterPos).toPoint());
+    QRect srcDabRect = dstDabRect.translated((m_lastPaintPos - newCenterPos).toPoint());
 
     m_lastPaintPos = newCenterPos;
 
-    KisSpacingInformation spacingInfo =
-        effectiveSpacing(scale, rotation,
-                         m_spacingOption, info);
-
     if (m_firstRun) {
         m_firstRun = false;
-        return spacingInfo;
+        return;
     }
 
-    const qreal fpOpacity = (qreal(painter()->opacity()) / 255.0) * m_opacityOption.getOpacityf(info);
-
     if (m_image && m_overlayModeOption.isChecked()) {
         m_image->blockUpdates();
         m_backgroundPainter->bitBlt(QPoint(), m_image->projection(), srcDabRect);
@@ -246,25 +309,23 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
     else {
         // IMPORTANT: Clear the temporary painting device to transparent black.
         //            It will only clear the extents of the brush.
-        m_tempDev->clear(QRect(QPoint(), m_dstDabRect.size()));
+        m_tempDev->clear(QRect(QPoint(), dstDabRect.size()));
     }
 
     // stored in the color space of the paintColor
     KoColor dullingFillColor = m_paintColor;
 
-    QPoint canvasLocalSamplePoint = (srcDabRect.topLeft() + hotSpot).toPoint();
+    QPoint canvasLocalSamplePoint = (srcDabRect.topLeft() + params.hotSpot).toPoint();
 
     if (!useDullingMode) {
         activeWrapper.readRect(srcDabRect);
         m_smudgePainter->bitBlt(QPoint(), activeWrapper.preciseDevice(), srcDabRect);
     } else {
         if (m_smudgeRadiusOption.isChecked()) {
-            const qreal effectiveSize = 0.5 * (m_dstDabRect.width() + m_dstDabRect.height());
-
-            const QRect sampleRect = m_smudgeRadiusOption.sampleRect(info, effectiveSize, canvasLocalSamplePoint);
+            const QRect sampleRect = m_smudgeRadiusOption.sampleRect(params.smudgeRadius, canvasLocalSamplePoint);
             activeWrapper.readRect(sampleRect);
 
-            m_smudgeRadiusOption.apply(&dullingFillColor, info, effectiveSize, canvasLocalSamplePoint.x(), canvasLocalSamplePoint.y(), activeWrapper.preciseDevice());
+            m_smudgeRadiusOption.apply(&dullingFillColor, params.smudgeRadius, canvasLocalSamplePoint.x(), canvasLocalSamplePoint.y(), activeWrapper.preciseDevice());
             KIS_SAFE_ASSERT_RECOVER_NOOP(*dullingFillColor.colorSpace() == *m_tempDev->colorSpace());
         } else {
             // get the pixel on the canvas that lies beneath the hot spot
@@ -279,30 +340,20 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
     // if the user selected the color smudge option,
     // we will mix some color into the temporary painting device (m_tempDev)
     if (m_colorRateOption.isChecked()) {
-        // this will apply the opacity (selected by the user) to copyPainter
-        // (but fit the rate inbetween the range 0.0 to (1.0-SmudgeRate))
-        qreal maxColorRate = qMax<qreal>(1.0 - m_smudgeRateOption.getRate(), 0.2);
-        m_colorRateOption.apply(*m_colorRatePainter, info, 0.0, maxColorRate, fpOpacity);
+        m_colorRatePainter->setOpacity(params.colorRateOpacity);
 
         // paint a rectangle with the current color (foreground color)
         // or a gradient color (if enabled)
         // into the temporary painting device and use the user selected
         // composite mode
-        KoColor color = m_paintColor;
-        m_gradientOption.apply(color, m_gradient, info);
-        if (m_hsvTransform) {
-            Q_FOREACH (KisPressureHSVOption * option, m_hsvOptions) {
-                option->apply(m_hsvTransform, info);
-            }
-            m_hsvTransform->transform(color.data(), color.data(), 1);
-        }
+        KoColor color = params.color;
 
         if (!useDullingMode) {
             KIS_SAFE_ASSERT_RECOVER(*m_colorRatePainter->device()->colorSpace() == *color.colorSpace()) {
                 color.convertTo(m_colorRatePainter->device()->colorSpace());
             }
 
-            m_colorRatePainter->fill(0, 0, m_dstDabRect.width(), m_dstDabRect.height(), color);
+            m_colorRatePainter->fill(0, 0, dstDabRect.width(), dstDabRect.height(), color);
         } else {
             KIS_SAFE_ASSERT_RECOVER(*dullingFillColor.colorSpace() == *color.colorSpace()) {
                 color.convertTo(dullingFillColor.colorSpace());
@@ -318,10 +369,10 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
 
     if (useDullingMode) {
         KIS_SAFE_ASSERT_RECOVER_NOOP(*dullingFillColor.colorSpace() == *m_tempDev->colorSpace());
-        m_tempDev->fill(QRect(0, 0, m_dstDabRect.width(), m_dstDabRect.height()), dullingFillColor);
+        m_tempDev->fill(QRect(0, 0, dstDabRect.width(), dstDabRect.height()), dullingFillColor);
     }
 
-    m_precisePainterWrapper.readRects(m_finalPainter->calculateAllMirroredRects(m_dstDabRect));
+    m_precisePainterWrapper.readRects(m_finalPainter->calculateAllMirroredRects(dstDabRect));
 
     // if color is disabled (only smudge) and "overlay mode" is enabled
     // then first blit the region under the brush from the image projection
@@ -333,23 +384,109 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
         // TODO: check if this code is correct in mirrored mode! Technically, the
         //       painter renders the mirrored dab only, so we should also prepare
         //       the overlay for it in all the places.
-        m_finalPainter->bitBlt(m_dstDabRect.topLeft(), m_image->projection(), m_dstDabRect);
+        m_finalPainter->bitBlt(dstDabRect.topLeft(), m_image->projection(), dstDabRect);
         m_image->unblockUpdates();
     }
 
     // set opacity calculated by the rate option
-    m_smudgeRateOption.apply(*m_finalPainter, info, 0.0, 1.0, fpOpacity);
+    m_finalPainter->setOpacity(params.smudgeRateOpacity);
 
     // then blit the temporary painting device on the canvas at the current brush position
     // the alpha mask (maskDab) will be used here to only blit the pixels that are in the area (shape) of the brush
-    m_finalPainter->bitBltWithFixedSelection(m_dstDabRect.x(), m_dstDabRect.y(), m_tempDev, m_maskDab, m_dstDabRect.width(), m_dstDabRect.height());
-    m_finalPainter->renderMirrorMaskSafe(m_dstDabRect, m_tempDev, 0, 0, m_maskDab, !m_dabCache->needSeparateOriginal());
+    m_finalPainter->bitBltWithFixedSelection(dstDabRect.x(), dstDabRect.y(), m_tempDev, maskDab, dstDabRect.width(), dstDabRect.height());
+
+    // the mask may be shared with the following dabs by the dab cache, so it should be preserved
+    m_finalPainter->renderMirrorMaskSafe(dstDabRect, m_tempDev, 0, 0, maskDab, true);
 
     const QVector<QRect> dirtyRects = m_finalPainter->takeDirtyRegion();
     m_precisePainterWrapper.writeRects(dirtyRects);
     painter()->addDirtyRects(dirtyRects);
+}
+
+struct KisColorSmudgeOp::UpdateSharedState
+{
+    QList<KisRenderedDab> dabsQueue;
+    QVector<DabParameters> dabParameters;
+
+    QElapsedTimer dabRenderingTimer;
+};
+
+std::pair<int, bool> KisColorSmudgeOp::doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs)
+{
+    bool someDabsAreStillInQueue = false;
+    const bool hasPreparedDabsAtStart = m_dabExecutor->hasPreparedDabs();
+
+    if (!m_updateSharedState && hasPreparedDabsAtStart) {
+
+        m_updateSharedState = toQShared(new UpdateSharedState());
+        UpdateSharedStateSP state = m_updateSharedState;
+
+        {
+            const qreal dabRenderingTime = m_dabExecutor->averageDabRenderingTime();
+            const qreal totalRenderingTimePerDab = dabRenderingTime + m_avgUpdateTimePerDab.rollingMeanSafe();
+
+            // we limit the number of fetched dabs to fit the maximum update period and not
+            // make visual hiccups
+            const int dabsLimit =
+                totalRenderingTimePerDab > 0 ?
+                    qMax(10, int(m_maxUpdatePeriod / totalRenderingTimePerDab)) :
+                    -1;
+
+            state->dabsQueue = m_dabExecutor->takeReadyDabs(false, dabsLimit, &someDabsAreStillInQueue);
+        }
+
+        KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(!state->dabsQueue.isEmpty(),
+                                             std::make_pair(m_currentUpdatePeriod, false));
+
+        {
+            QMutexLocker l(&m_dabParametersMutex);
+
+            Q_FOREACH (const KisRenderedDab &dab, state->dabsQueue) {
+                state->dabParameters.append(m_dabParameters.take(dab.seqNo));
+            }
+        }
+
+        /**
+         * Every dab smudges the result of the previous one, so the masks
+         * are rendered by the executor in parallel, but the dabs themselves
+         * are painted by a single sequential job in the order of the stroke.
+         * This job runs concurrently with the stroke thread, which keeps
+         * preparing the masks for the following dabs.
+         */
+        jobs.append(
+            new KisRunnableStrokeJobData(
+                [state, this, someDabsAreStillInQueue] () {
+                    state->dabRenderingTimer.start();
+
+                    const int numDabs = state->dabsQueue.size();
+
+                    for (int i = 0; i < numDabs; i++) {
+                        paintDab(state->dabsQueue[i], state->dabParameters[i]);
+                    }
+
+                    const int updateRenderingTime = state->dabRenderingTimer.elapsed();
+                    const qreal currentUpdateTimePerDab = qreal(updateRenderingTime) / state->dabsQueue.size();
+                    m_avgUpdateTimePerDab(currentUpdateTimePerDab);
+
+                    const qreal totalRenderingTimePerDab =
+                        m_dabExecutor->averageDabRenderingTime() + currentUpdateTimePerDab;
+
+                    m_currentUpdatePeriod =
+                        someDabsAreStillInQueue ? m_minUpdatePeriod :
+                        qBound(m_minUpdatePeriod, int(1.5 * totalRenderingTimePerDab * numDabs), m_maxUpdatePeriod);
+
+                    // release all the dab devices
+                    state->dabsQueue.clear();
+
+                    m_updateSharedState.clear();
+                },
+                KisStrokeJobData::SEQUENTIAL));
+
+    } else if (m_updateSharedState && hasPreparedDabsAtStart) {
+        someDabsAreStillInQueue = true;
+    }
 
-    return spacingInfo;
+    return std::make_pair(m_currentUpdatePeriod, someDabsAreStillInQueue);
 }
 
 KisSpacingInformation KisColorSmudgeOp::updateSpacingImpl(const KisPaintInformation &info) const
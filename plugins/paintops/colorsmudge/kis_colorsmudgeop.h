@@ -20,6 +20,9 @@
 #define _KIS_COLORSMUDGEOP_H_
 
 #include <QRect>
+#include <QMutex>
+#include <QHash>
+#include <QElapsedTimer>
 
 #include <kis_brush_based_paintop.h>
 #include <kis_types.h>
@@ -38,11 +41,16 @@
 #include "kis_smudge_radius_option.h"
 #include "KisPrecisePaintDeviceWrapper.h"
 
+#include <KisRollingMeanAccumulatorWrapper.h>
+
 class QPointF;
 class KoAbstractGradient;
 class KisBrushBasedPaintOpSettings;
 class KisPainter;
 class KoColorSpace;
+class KisDabRenderingExecutor;
+struct KisRenderedDab;
+class KisRunnableStrokeJobData;
 
 class KisColorSmudgeOp: public KisBrushBasedPaintOp
 {
@@ -50,14 +58,37 @@ public:
     KisColorSmudgeOp(const KisPaintOpSettingsSP settings, KisPainter* painter, KisNodeSP node, KisImageSP image);
     ~KisColorSmudgeOp() override;
 
+    std::pair<int, bool> doAsyncronousUpdate(QVector<KisRunnableStrokeJobData *> &jobs) override;
+
 protected:
     KisSpacingInformation paintAt(const KisPaintInformation& info) override;
 
     KisSpacingInformation updateSpacingImpl(const KisPaintInformation &info) const override;
 
 private:
-    // Sets the m_maskDab _and m_maskDabRect
-    void updateMask(const KisPaintInformation& info, double scale, double rotation, const QPointF &cursorPoint);
+    /**
+     * The parameters of a dab evaluated by paintAt() on the stroke
+     * thread. They are keyed by the sequence number the dab rendering
+     * executor has assigned to the dab and are consumed by paintDab()
+     * together with the rendered mask.
+     */
+    struct DabParameters {
+        QPointF hotSpot;
+        int smudgeRadius = 0;
+        quint8 smudgeRateOpacity = OPACITY_OPAQUE_U8;
+        quint8 colorRateOpacity = OPACITY_OPAQUE_U8;
+        KoColor color;
+    };
+
+    struct UpdateSharedState;
+    typedef QSharedPointer<UpdateSharedState> UpdateSharedStateSP;
+
+    /**
+     * Does the smudging and blitting of a single dab. The dabs read the
+     * result of the previous ones, so this function should be called
+     * sequentially in the order of the dabs.
+     */
+    void paintDab(const KisRenderedDab &dab, const DabParameters &params);
 
     inline void getTopLeftAligned(const QPointF &pos, const QPointF &hotSpot, qint32 *x, qint32 *y);
 
@@ -84,12 +115,21 @@ private:
     KisPressureScatterOption  m_scatterOption;
     KisPressureGradientOption m_gradientOption;
     QList<KisPressureHSVOption*> m_hsvOptions;
-    QRect                     m_dstDabRect;
-    KisFixedPaintDeviceSP     m_maskDab;
     QPointF                   m_lastPaintPos;
 
     KoColorTransformation *m_hsvTransform {0};
     const KoCompositeOp *m_preciseColorRateCompositeOp {0};
+
+    QScopedPointer<KisDabRenderingExecutor> m_dabExecutor;
+    QMutex m_dabParametersMutex;
+    QHash<int, DabParameters> m_dabParameters;
+
+    UpdateSharedStateSP m_updateSharedState;
+    int m_currentUpdatePeriod = 20;
+    KisRollingMeanAccumulatorWrapper m_avgUpdateTimePerDab;
+
+    const int m_minUpdatePeriod;
+    const int m_maxUpdatePeriod;
 };
 
 #endif // _KIS_COLORSMUDGEOP_H_
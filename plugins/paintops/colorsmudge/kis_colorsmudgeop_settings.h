@@ -29,6 +29,8 @@ public:
     KisColorSmudgeOpSettings();
     ~KisColorSmudgeOpSettings() override;
 
+    bool needsAsynchronousUpdates() const override;
+
     QList<KisUniformPaintOpPropertySP> uniformProperties(KisPaintOpSettingsSP settings) override;
 
 private:
@@ -38,6 +38,12 @@ public:
      */
     void apply(KisPainter& painter, const KisPaintInformation& info, qreal scaleMin = 0.0, qreal scaleMax = 1.0, qreal multiplicator = 1.0) const;
 
+    /**
+     * Return the opacity apply() would set to the painter. Use it
+     * when the painter is used by a different thread.
+     */
+    quint8 getOpacity(const KisPaintInformation& info, qreal scaleMin = 0.0, qreal scaleMax = 1.0, qreal multiplicator = 1.0) const;
+
     void setRate(qreal rate) {
         KisCurveOption::setValue(rate);
     }
@@ -46,114 +46,75 @@ KisSmudgeRadiusOption::KisSmudgeRadiusOption():
     setValueRange(0.0,300.0);
 }
 
-QRect KisSmudgeRadiusOption::sampleRect(const KisPaintInformation& info,
-                                        qreal diameter,
-                                        const QPoint &pos) const
+int KisSmudgeRadiusOption::smudgeRadius(const KisPaintInformation& info, qreal diameter) const
 {
     const qreal sliderValue = computeSizeLikeValue(info);
-    const int smudgeRadius = ((sliderValue * diameter) * 0.5) / 100.0;
+    return ((sliderValue * diameter) * 0.5) / 100.0;
+}
 
+QRect KisSmudgeRadiusOption::sampleRect(int smudgeRadius, const QPoint &pos) const
+{
     return kisGrowRect(QRect(pos, QSize(1,1)), smudgeRadius + 1);
 }
 
 void KisSmudgeRadiusOption::apply(KoColor *resultColor,
-                                  const KisPaintInformation& info,
-                                  qreal diameter,
+                                  int smudgeRadius,
                                   qreal posx,
                                   qreal posy,
                                   KisPaintDeviceSP dev) const
 {
     if (!isChecked()) return;
 
-    qreal sliderValue = computeSizeLikeValue(info);
-
-    int smudgeRadius = ((sliderValue * diameter) * 0.5) / 100.0;
-
 
     KoColor color(Qt::transparent, dev->colorSpace());
 
     if (smudgeRadius == 1) {
         dev->pixel(posx, posy, &color);
     } else {
-
         const KoColorSpace* cs = dev->colorSpace();
         const int pixelSize = cs->pixelSize();
 
-        quint8* data = new quint8[pixelSize];
-        quint8* pixels[2];
-        qint16 weights[2];
-
-        pixels[1] = new quint8[pixelSize];
-        pixels[0] = new quint8[pixelSize];
-
-        int loop_increment = 1;
-        if(smudgeRadius >= 8)
-        {
-            loop_increment = (2*smudgeRadius)/16;
-        }
-        int i = 0;
-        int k = 0;
-        int j = 0;
-
-        KisRandomConstAccessorSP accessor = dev->createRandomConstAccessorNG(0, 0);
-        accessor->moveTo(posx, posy);
-        memcpy(color.data(), accessor->rawDataConst(), pixelSize);
-
-        for (int y = 0; y <= smudgeRadius; y = y + loop_increment) {
-            for (int x = 0; x <= smudgeRadius; x = x + loop_increment) {
-
-                for(j = 0;j < 2;j++)
-                {
-                    if(j == 1)
-                    {
-                        y = y*(-1);
-                    }
-                    for(k = 0;k < 2;k++)
-                    {
-                        if(k == 1)
-                        {
-                            x = x*(-1);
-                        }
-                        accessor->moveTo(posx + x, posy + y);
-                        memcpy(pixels[1], accessor->rawDataConst(), pixelSize);
-                        if(i == 0)
-                        {
-                            memcpy(pixels[0],accessor->rawDataConst(),pixelSize);
-                        }
-                        if (x == 0 && y == 0) {
-                            // Because the sum of the weights must be 255,
-                            // we cheat a bit, and weigh the center pixel differently in order
-                            // to sum to 255 in total
-                            // It's -(counts -1), because we'll add the center one implicitly
-                            // through that calculation
-                            weights[1] = (255 - ((i + 1) * (255 /(i+2) )) );
-                        } else {
-                            weights[1] = 255 /(i+2);
-                        }
-
-
-                        i++;
-                        if (i>smudgeRadius){i=0;}
-                        weights[0] = 255 - weights[1];
-                        const quint8** cpixels = const_cast<const quint8**>(pixels);
-                        cs->mixColorsOp()->mixColors(cpixels, weights,2, data);
-                        memcpy(pixels[0],data,pixelSize);
-
-
-                    }
-                    x = x*(-1);
+        const int loop_increment = smudgeRadius >= 8 ? (2 * smudgeRadius) / 16 : 1;
+
+        const int centerX = posx;
+        const int centerY = posy;
+
+        if (loop_increment == 1) {
+            /**
+             * Small radius: every pixel of the area is sampled, so we can
+             * read it as a whole and average it in a single call
+             */
+            const QRect rc(centerX - smudgeRadius, centerY - smudgeRadius,
+                           2 * smudgeRadius + 1, 2 * smudgeRadius + 1);
+
+            QVector<quint8> buffer(rc.width() * rc.height() * pixelSize);
+            dev->readBytes(buffer.data(), rc);
+
+            cs->mixColorsOp()->mixColorsRect(buffer.data(), rc.width() * pixelSize,
+                                             rc.width(), rc.height(), color.data());
+        } else {
+            /**
+             * Big radius: sample a sparse grid of pixels into a contiguous
+             * buffer and average the samples uniformly
+             */
+            const int gridRadius = (smudgeRadius / loop_increment) * loop_increment;
+            const int gridSize = 2 * (gridRadius / loop_increment) + 1;
+
+            QVector<quint8> buffer(gridSize * gridSize * pixelSize);
+            quint8 *dstPtr = buffer.data();
+
+            KisRandomConstAccessorSP accessor = dev->createRandomConstAccessorNG(0, 0);
+
+            for (int y = -gridRadius; y <= gridRadius; y += loop_increment) {
+                for (int x = -gridRadius; x <= gridRadius; x += loop_increment) {
+                    accessor->moveTo(centerX + x, centerY + y);
+                    memcpy(dstPtr, accessor->rawDataConst(), pixelSize);
+                    dstPtr += pixelSize;
                 }
-                y = y*(-1);
             }
 
+            cs->mixColorsOp()->mixColors(buffer.data(), gridSize * gridSize, color.data());
         }
-
-        color = KoColor(pixels[0],cs);
-
-        for (int l = 0; l < 2; l++){
-            delete[] pixels[l];
-        }
-        delete[] data;
     }
 
     *resultColor = color.convertedTo(resultColor->colorSpace());
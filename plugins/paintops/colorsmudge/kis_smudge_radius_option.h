@@ -29,15 +29,20 @@ class KisSmudgeRadiusOption: public KisRateOption
 public:
     KisSmudgeRadiusOption();
 
-    QRect sampleRect(const KisPaintInformation &info, qreal diameter, const QPoint &pos) const;
+    /**
+     * Evaluates the sensors and returns the radius of the sampled area
+     * for a dab of size \p diameter
+     */
+    int smudgeRadius(const KisPaintInformation &info, qreal diameter) const;
+
+    QRect sampleRect(int smudgeRadius, const QPoint &pos) const;
 
     /**
      * Set the opacity of the painter based on the rate
      * and the curve (if checked)
      */
     void apply(KoColor *resultColor,
-               const KisPaintInformation& info,
-               qreal diameter,
+               int smudgeRadius,
                qreal posx,
                qreal posy,
                KisPaintDeviceSP dev) const;
@@ -30,6 +30,8 @@
 #include "kis_types.h"
 #include "kis_spacing_information.h"
 #include <kis_lod_transform.h>
+#include <KoColor.h>
+#include <KisParallelDabRenderer.h>
 
 
 KisCurvePaintOp::KisCurvePaintOp(const KisPaintOpSettingsSP settings, KisPainter * painter, KisNodeSP node, KisImageSP image)
@@ -44,6 +46,10 @@ KisCurvePaintOp::KisCurvePaintOp(const KisPaintOpSettingsSP settings, KisPainter
     m_opacityOption.readOptionSetting(settings);
     m_lineWidthOption.readOptionSetting(settings);
     m_curvesOpacityOption.readOptionSetting(settings);
+
+    if (settings->needsAsynchronousUpdates()) {
+        m_dabRenderer.reset(new KisParallelDabRenderer(painter));
+    }
 }
 
 KisCurvePaintOp::~KisCurvePaintOp()
@@ -67,29 +73,53 @@ void KisCurvePaintOp::paintLine(const KisPaintInformation &pi1, const KisPaintIn
     Q_UNUSED(currentDistance);
     if (!painter()) return;
 
+    const LinePaths line = prepareLine(pi1, pi2);
+
+    quint8 origOpacity = m_opacityOption.apply(painter(), pi2);
+
+    if (m_dabRenderer) {
+        const KoColor color = painter()->paintColor();
+
+        m_dabRenderer->addDab(
+            [line, color] (KisPaintDeviceSP dab) {
+                KisPainter gc(dab);
+                gc.setPaintColor(color);
+                renderLine(&gc, line);
+            },
+            qreal(painter()->opacity()) / OPACITY_OPAQUE_U8);
+
+        painter()->setOpacity(origOpacity);
+        return;
+    }
+
     if (!m_dab) {
         m_dab = source()->createCompositionSourceDevice();
+        m_painter = new KisPainter(m_dab);
+        m_painter->setPaintColor(painter()->paintColor());
     }
     else {
         m_dab->clear();
     }
 
-    paintLine(m_dab, pi1, pi2);
+    renderLine(m_painter, line);
 
     QRect rc = m_dab->extent();
 
-    quint8 origOpacity = m_opacityOption.apply(painter(), pi2);
     painter()->bitBlt(rc.topLeft(), m_dab, rc);
     painter()->renderMirrorMask(rc, m_dab);
     painter()->setOpacity(origOpacity);
 }
 
-void KisCurvePaintOp::paintLine(KisPaintDeviceSP dab, const KisPaintInformation &pi1, const KisPaintInformation &pi2)
+std::pair<int, bool> KisCurvePaintOp::doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs)
 {
-    if (!m_painter) {
-        m_painter = new KisPainter(dab);
-        m_painter->setPaintColor(painter()->paintColor());
-    }
+    return m_dabRenderer ?
+        m_dabRenderer->doAsyncronousUpdate(jobs) :
+        KisPaintOp::doAsyncronousUpdate(jobs);
+}
+
+KisCurvePaintOp::LinePaths KisCurvePaintOp::prepareLine(const KisPaintInformation &pi1, const KisPaintInformation &pi2)
+{
+    LinePaths line;
 
     int maxPoints = m_curveProperties.curve_stroke_history_size;
 
@@ -102,32 +132,42 @@ void KisCurvePaintOp::paintLine(KisPaintDeviceSP dab, const KisPaintInformation
     const qreal additionalScale = KisLodTransform::lodToScale(painter()->device());
     const qreal lineWidth = additionalScale * m_lineWidthOption.apply(pi2, m_curveProperties.curve_line_width);
 
-    QPen pen(QBrush(Qt::white), lineWidth);
-    QPainterPath path;
+    line.pen = QPen(QBrush(Qt::white), lineWidth);
 
     if (m_curveProperties.curve_paint_connection_line) {
-        path.moveTo(pi1.pos());
-        path.lineTo(pi2.pos());
-        m_painter->drawPainterPath(path, pen);
-        path = QPainterPath();
+        line.connectionPath.moveTo(pi1.pos());
+        line.connectionPath.lineTo(pi2.pos());
     }
 
     if (m_points.length() >= maxPoints) {
         // alpha * 0.2;
-        path.moveTo(m_points.first());
+        line.curvePath.moveTo(m_points.first());
 
         if (m_curveProperties.curve_smoothing) {
-            path.quadTo(m_points.at(maxPoints / 2), m_points.last());
+            line.curvePath.quadTo(m_points.at(maxPoints / 2), m_points.last());
         }
         else {
             // control point is at 1/3 of the history, 2/3 of the history and endpoint at 3/3
             int step = maxPoints / 3;
-            path.cubicTo(m_points.at(step), m_points.at(step + step), m_points.last());
+            line.curvePath.cubicTo(m_points.at(step), m_points.at(step + step), m_points.last());
         }
 
         qreal curveOpacity = m_curvesOpacityOption.apply(pi2, m_curveProperties.curve_curves_opacity);
-        m_painter->setOpacity(qRound(255.0 * curveOpacity));
-        m_painter->drawPainterPath(path, pen);
-        m_painter->setOpacity(255); // full
+        line.curveOpacity = qRound(255.0 * curveOpacity);
+    }
+
+    return line;
+}
+
+void KisCurvePaintOp::renderLine(KisPainter *painter, const LinePaths &line)
+{
+    if (!line.connectionPath.isEmpty()) {
+        painter->drawPainterPath(line.connectionPath, line.pen);
+    }
+
+    if (!line.curvePath.isEmpty()) {
+        painter->setOpacity(line.curveOpacity);
+        painter->drawPainterPath(line.curvePath, line.pen);
+        painter->setOpacity(255); // full
     }
 }
@@ -28,7 +28,12 @@
 #include "kis_linewidth_option.h"
 #include "kis_curves_opacity_option.h"
 
+#include <QPen>
+#include <QPainterPath>
+#include <QScopedPointer>
+
 class KisPainter;
+class KisParallelDabRenderer;
 
 class KisCurvePaintOp : public KisPaintOp
 {
@@ -44,8 +49,22 @@ protected:
 
     KisSpacingInformation updateSpacingImpl(const KisPaintInformation &info) const override;
 
+    std::pair<int, bool> doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs) override;
+
 private:
-    void paintLine(KisPaintDeviceSP dab, const KisPaintInformation &pi1, const KisPaintInformation &pi2);
+    struct LinePaths {
+        QPen pen;
+        QPainterPath connectionPath;
+        QPainterPath curvePath;
+        quint8 curveOpacity = 255;
+    };
+
+    /**
+     * Updates the history of the stroke and generates the paths
+     * for the segment (pi1, pi2)
+     */
+    LinePaths prepareLine(const KisPaintInformation &pi1, const KisPaintInformation &pi2);
+    static void renderLine(KisPainter *painter, const LinePaths &line);
 
 private:
     KisPaintDeviceSP m_dab;
@@ -59,6 +78,11 @@ private:
     QList<QPointF> m_points;
     KisPainter * m_painter;
 
+    /**
+     * The paths are generated on the stroke thread, because they depend
+     * on the history of the stroke, and rasterized on the worker threads
+     */
+    QScopedPointer<KisParallelDabRenderer> m_dabRenderer;
 };
 
 #endif // KIS_CURVEPAINTOP_H_
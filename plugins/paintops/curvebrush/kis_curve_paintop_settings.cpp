@@ -53,6 +53,11 @@ bool KisCurvePaintOpSettings::paintIncremental()
     return (enumPaintActionType)getInt("PaintOpAction", WASH) == BUILDUP;
 }
 
+bool KisCurvePaintOpSettings::needsAsynchronousUpdates() const
+{
+    return true;
+}
+
 
 #include <brushengine/kis_slider_based_paintop_property.h>
 #include "kis_paintop_preset.h"
@@ -33,6 +33,7 @@ public:
     qreal paintOpSize() const override;
 
     bool paintIncremental() override;
+    bool needsAsynchronousUpdates() const override;
 
     QList<KisUniformPaintOpPropertySP> uniformProperties(KisPaintOpSettingsSP settings) override;
 
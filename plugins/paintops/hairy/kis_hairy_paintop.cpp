@@ -36,6 +36,7 @@
 #include <kis_fixed_paint_device.h>
 #include <kis_lod_transform.h>
 #include <kis_spacing_information.h>
+#include <KisParallelDabRenderer.h>
 
 
 #include "kis_brush.h"
@@ -76,6 +77,14 @@ KisHairyPaintOp::KisHairyPaintOp(const KisPaintOpSettingsSP settings, KisPainter
     m_rotationOption.resetAllSensors();
     m_opacityOption.resetAllSensors();
     m_sizeOption.resetAllSensors();
+
+    if (settings->needsAsynchronousUpdates()) {
+        m_dabRenderer.reset(new KisParallelDabRenderer(painter));
+    }
+}
+
+KisHairyPaintOp::~KisHairyPaintOp()
+{
 }
 
 
@@ -113,6 +122,13 @@ KisSpacingInformation KisHairyPaintOp::paintAt(const KisPaintInformation& info)
     return updateSpacingImpl(info);
 }
 
+std::pair<int, bool> KisHairyPaintOp::doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs)
+{
+    return m_dabRenderer ?
+        m_dabRenderer->doAsyncronousUpdate(jobs) :
+        KisPaintOp::doAsyncronousUpdate(jobs);
+}
+
 KisSpacingInformation KisHairyPaintOp::updateSpacingImpl(const KisPaintInformation &info) const
 {
     Q_UNUSED(info);
@@ -156,10 +172,14 @@ void KisHairyPaintOp::paintLine(const KisPaintInformation &pi1, const KisPaintIn
 
     m_brush.paintLine(m_dab, m_dev, pi1, pi, scale * m_properties.scaleFactor, mirrorFlip ? -rotation : rotation);
 
-    //QRect rc = m_dab->exactBounds();
-    QRect rc = m_dab->extent();
-    painter()->bitBlt(rc.topLeft(), m_dab, rc);
-    painter()->renderMirrorMask(rc, m_dab);
+    if (m_dabRenderer) {
+        m_dabRenderer->addRenderedDab(m_dab, qreal(painter()->opacity()) / OPACITY_OPAQUE_U8);
+    } else {
+        //QRect rc = m_dab->exactBounds();
+        QRect rc = m_dab->extent();
+        painter()->bitBlt(rc.topLeft(), m_dab, rc);
+        painter()->renderMirrorMask(rc, m_dab);
+    }
     painter()->setOpacity(origOpacity);
 
     // we don't use spacing in hairy brush, but history is
@@ -31,6 +31,10 @@
 #include <kis_pressure_rotation_option.h>
 #include <kis_pressure_opacity_option.h>
 
+#include <QScopedPointer>
+
+class KisParallelDabRenderer;
+
 class KisPainter;
 class KisBrushBasedPaintOpSettings;
 
@@ -39,6 +43,7 @@ class KisHairyPaintOp : public KisPaintOp
 
 public:
     KisHairyPaintOp(const KisPaintOpSettingsSP settings, KisPainter *painter, KisNodeSP node, KisImageSP image);
+    ~KisHairyPaintOp() override;
 
     void paintLine(const KisPaintInformation &pi1, const KisPaintInformation &pi2, KisDistanceInformation *currentDistance) override;
 
@@ -47,6 +52,8 @@ protected:
 
     KisSpacingInformation updateSpacingImpl(const KisPaintInformation &info) const override;
 
+    std::pair<int, bool> doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs) override;
+
 private:
     KisHairyProperties m_properties;
 
@@ -57,6 +64,12 @@ private:
     KisPressureSizeOption m_sizeOption;
     KisPressureOpacityOption m_opacityOption;
 
+    /**
+     * The bristles keep their state between the dabs, so the dabs
+     * are rendered on the stroke thread and only composited in parallel
+     */
+    QScopedPointer<KisParallelDabRenderer> m_dabRenderer;
+
     void loadSettings(const KisBrushBasedPaintOpSettings* settings);
 };
 
@@ -23,6 +23,7 @@
 
 #include "kis_hairy_paintop_settings.h"
 #include "kis_hairy_bristle_option.h"
+#include "kis_hairy_ink_option.h"
 #include "kis_brush_based_paintop_options_widget.h"
 #include "kis_boundary.h"
 
@@ -34,3 +35,8 @@ QPainterPath KisHairyPaintOpSettings::brushOutline(const KisPaintInformation &in
 {
     return brushOutlineImpl(info, mode, getDouble(HAIRY_BRISTLE_SCALE));
 }
+
+bool KisHairyPaintOpSettings::needsAsynchronousUpdates() const
+{
+    return !getBool(HAIRY_INK_SOAK, false);
+}
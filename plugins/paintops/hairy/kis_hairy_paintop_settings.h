@@ -36,6 +36,12 @@ public:
     using KisBrushBasedPaintOpSettings::brushOutline;
     QPainterPath brushOutline(const KisPaintInformation &info, const OutlineMode &mode) override;
 
+    /**
+     * Soaking ink reads the canvas, so it is incompatible with
+     * the delayed composition of the dabs
+     */
+    bool needsAsynchronousUpdates() const override;
+
 };
 
 #endif
@@ -29,6 +29,7 @@
 struct KisDabRenderingExecutor::Private
 {
     QScopedPointer<KisDabRenderingQueue> renderingQueue;
+    KisDabRenderingQueueCache *cache = 0;
     KisRunnableStrokeJobsInterface *runnableJobsInterface;
 };
 
@@ -44,27 +45,31 @@ KisDabRenderingExecutor::KisDabRenderingExecutor(const KoColorSpace *cs,
     m_d->renderingQueue.reset(
         new KisDabRenderingQueue(cs, resourcesFactory));
 
-    KisDabRenderingQueueCache *cache = new KisDabRenderingQueueCache();
-    cache->setMirrorPostprocessing(mirrorOption);
-    cache->setPrecisionOption(precisionOption);
+    m_d->cache = new KisDabRenderingQueueCache();
+    m_d->cache->setMirrorPostprocessing(mirrorOption);
+    m_d->cache->setPrecisionOption(precisionOption);
 
-    m_d->renderingQueue->setCacheInterface(cache);
+    m_d->renderingQueue->setCacheInterface(m_d->cache);
 }
 
 KisDabRenderingExecutor::~KisDabRenderingExecutor()
 {
 }
 
-void KisDabRenderingExecutor::addDab(const KisDabCacheUtils::DabRequestInfo &request,
-                                     qreal opacity, qreal flow)
+int KisDabRenderingExecutor::addDab(const KisDabCacheUtils::DabRequestInfo &request,
+                                    qreal opacity, qreal flow)
 {
-    KisDabRenderingJobSP job = m_d->renderingQueue->addDab(request, opacity, flow);
+    int seqNo = -1;
+
+    KisDabRenderingJobSP job = m_d->renderingQueue->addDab(request, opacity, flow, &seqNo);
     if (job) {
         m_d->runnableJobsInterface->addRunnableJob(
             new FreehandStrokeRunnableJobDataWithUpdate(
                         new KisDabRenderingJobRunner(job, m_d->renderingQueue.data(), m_d->runnableJobsInterface),
                         KisStrokeJobData::CONCURRENT));
     }
+
+    return seqNo;
 }
 
 QList<KisRenderedDab> KisDabRenderingExecutor::takeReadyDabs(bool returnMutableDabs,
@@ -79,6 +84,11 @@ bool KisDabRenderingExecutor::hasPreparedDabs() const
     return m_d->renderingQueue->hasPreparedDabs();
 }
 
+void KisDabRenderingExecutor::disableSubpixelPrecision()
+{
+    m_d->cache->disableSubpixelPrecision();
+}
+
 qreal KisDabRenderingExecutor::averageDabRenderingTime() const
 {
     return m_d->renderingQueue->averageExecutionTime();
@@ -19,7 +19,7 @@
 #ifndef KISDABRENDERINGEXECUTOR_H
 #define KISDABRENDERINGEXECUTOR_H
 
-#include "kritadefaultpaintops_export.h"
+#include "kritapaintop_export.h"
 
 #include <QScopedPointer>
 
@@ -33,7 +33,7 @@ class KisPrecisionOption;
 class KisRunnableStrokeJobsInterface;
 
 
-class KRITADEFAULTPAINTOPS_EXPORT KisDabRenderingExecutor
+class PAINTOP_EXPORT KisDabRenderingExecutor
 {
 public:
     KisDabRenderingExecutor(const KoColorSpace *cs,
@@ -43,13 +43,25 @@ public:
                             KisPrecisionOption *precisionOption = 0);
     ~KisDabRenderingExecutor();
 
-    void addDab(const KisDabCacheUtils::DabRequestInfo &request,
-                qreal opacity, qreal flow);
+    /**
+     * Queues the dab for rendering and returns its sequence number. The
+     * number is reported back in KisRenderedDab::seqNo, so the caller may
+     * associate its own data with the dab.
+     */
+    int addDab(const KisDabCacheUtils::DabRequestInfo &request,
+               qreal opacity, qreal flow);
 
     QList<KisRenderedDab> takeReadyDabs(bool returnMutableDabs = false, int oneTimeLimit = -1, bool *someDabsLeft = 0);
 
     bool hasPreparedDabs() const;
 
+    /**
+     * Disables subpixel positioning of the generated dabs. Should be
+     * called before the first dab is added. See
+     * KisDabCacheBase::disableSubpixelPrecision() for details.
+     */
+    void disableSubpixelPrecision();
+
     qreal averageDabRenderingTime() const; // msecs
     int averageDabSize() const;
 
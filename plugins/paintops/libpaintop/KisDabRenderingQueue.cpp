@@ -138,12 +138,16 @@ int KisDabRenderingQueue::Private::calculateLastDabJobIndex(int startSearchIndex
 }
 
 KisDabRenderingJobSP KisDabRenderingQueue::addDab(const KisDabCacheUtils::DabRequestInfo &request,
-                                                 qreal opacity, qreal flow)
+                                                 qreal opacity, qreal flow, int *seqNoResult)
 {
     QMutexLocker l(&m_d->mutex);
 
     const int seqNo = m_d->nextSeqNoToUse++;
 
+    if (seqNoResult) {
+        *seqNoResult = seqNo;
+    }
+
     KisDabCacheUtils::DabRenderingResources *resources = m_d->fetchResourcesFromCache();
     KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(resources, KisDabRenderingJobSP());
 
@@ -345,6 +349,7 @@ QList<KisRenderedDab> KisDabRenderingQueue::takeReadyDabs(bool returnMutableDabs
 
         dab.device = resultDevice;
         dab.offset = j->dstDabOffset();
+        dab.seqNo = j->seqNo;
         dab.opacity = j->opacity;
         dab.flow = j->flow;
 
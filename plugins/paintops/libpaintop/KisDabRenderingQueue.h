@@ -21,7 +21,7 @@
 
 #include <QScopedPointer>
 
-#include "kritadefaultpaintops_export.h"
+#include "kritapaintop_export.h"
 
 #include <QList>
 class KisDabRenderingJob;
@@ -29,7 +29,7 @@ struct KisRenderedDab;
 
 #include "KisDabCacheUtils.h"
 
-class KRITADEFAULTPAINTOPS_EXPORT KisDabRenderingQueue
+class PAINTOP_EXPORT KisDabRenderingQueue
 {
 public:
     struct CacheInterface {
@@ -49,8 +49,13 @@ public:
     KisDabRenderingQueue(const KoColorSpace *cs, KisDabCacheUtils::ResourcesFactory resourcesFactory);
     ~KisDabRenderingQueue();
 
+    /**
+     * Adds a dab to the queue. The sequence number assigned to the dab
+     * is written into \p seqNoResult (if non-null) and is reported back in
+     * KisRenderedDab::seqNo by takeReadyDabs().
+     */
     KisDabRenderingJobSP addDab(const KisDabCacheUtils::DabRequestInfo &request,
-                               qreal opacity, qreal flow);
+                               qreal opacity, qreal flow, int *seqNoResult = 0);
 
     QList<KisDabRenderingJobSP> notifyJobFinished(int seqNo, int usecsTime = -1);
 
@@ -22,13 +22,13 @@
 #include "KisDabRenderingQueue.h"
 #include "kis_dab_cache_base.h"
 
-#include "kritadefaultpaintops_export.h"
+#include "kritapaintop_export.h"
 
 class KisPressureMirrorOption;
 class KisPrecisionOption;
 class KisPressureSharpnessOption;
 
-class KRITADEFAULTPAINTOPS_EXPORT KisDabRenderingQueueCache : public KisDabRenderingQueue::CacheInterface, public KisDabCacheBase
+class PAINTOP_EXPORT KisDabRenderingQueueCache : public KisDabRenderingQueue::CacheInterface, public KisDabCacheBase
 {
 public:
 
@@ -0,0 +1,406 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisParallelDabRenderer.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QSharedPointer>
+#include <cmath>
+
+#include <kis_painter.h>
+#include <kis_paint_device.h>
+#include <kis_fixed_paint_device.h>
+#include <kis_paintop_utils.h>
+#include <kis_wrapped_rect.h>
+#include <kis_image_config.h>
+#include <kis_pointer_utils.h>
+#include <KisRenderedDab.h>
+#include <KisRollingMeanAccumulatorWrapper.h>
+
+#include <KisRunnableStrokeJobData.h>
+#include <KisRunnableStrokeJobsInterface.h>
+#include <tool/strokes/FreehandStrokeRunnableJobDataWithUpdate.h>
+
+
+namespace {
+
+struct DabJob
+{
+    KisRenderedDab dab;
+    bool completed = false;
+};
+
+typedef QSharedPointer<DabJob> DabJobSP;
+
+struct UpdateSharedState
+{
+    KisPainter *painter = 0;
+    QList<KisRenderedDab> dabsQueue;
+    QVector<QRect> allDirtyRects;
+    QElapsedTimer dabRenderingTimer;
+};
+
+typedef QSharedPointer<UpdateSharedState> UpdateSharedStateSP;
+
+/**
+ * Copies the rendered area of \p dev into a fixed device that
+ * can be passed to KisPainter::bltFixed()
+ */
+KisFixedPaintDeviceSP convertToFixedDab(KisPaintDeviceSP dev)
+{
+    const QRect rc = dev->extent();
+    if (rc.isEmpty()) return 0;
+
+    KisFixedPaintDeviceSP fixedDab = new KisFixedPaintDevice(dev->colorSpace());
+    fixedDab->setRect(rc);
+    fixedDab->lazyGrowBufferWithoutInitialization();
+    dev->readBytes(fixedDab->data(), rc);
+
+    return fixedDab;
+}
+
+}
+
+struct KisParallelDabRenderer::Private
+{
+    Private(KisPainter *_painter)
+        : painter(_painter),
+          avgDabRenderingTime(50),
+          avgUpdateTimePerDab(50),
+          avgNumDabs(50),
+          idealNumRects(KisImageConfig(true).maxNumberOfThreads())
+    {
+    }
+
+    KisPainter *painter;
+
+    QMutex mutex;
+    QList<DabJobSP> jobs;
+
+    UpdateSharedStateSP updateSharedState;
+
+    KisRollingMeanAccumulatorWrapper avgDabRenderingTime;
+    KisRollingMeanAccumulatorWrapper avgUpdateTimePerDab;
+    KisRollingMeanAccumulatorWrapper avgNumDabs;
+
+    const int idealNumRects;
+
+    const int minUpdatePeriod = 10;
+    const int maxUpdatePeriod = 100;
+    int currentUpdatePeriod = 20;
+
+    void addJob(DabJobSP job);
+    qreal averageDabRenderingTime();
+    QList<KisRenderedDab> takeReadyDabs(int limit, bool *someDabsLeft);
+    void addMirroringJobs(Qt::Orientation direction,
+                          QVector<QRect> &rects,
+                          UpdateSharedStateSP state,
+                          QVector<KisRunnableStrokeJobData*> &jobs);
+};
+
+KisParallelDabRenderer::KisParallelDabRenderer(KisPainter *painter)
+    : m_d(new Private(painter))
+{
+}
+
+KisParallelDabRenderer::~KisParallelDabRenderer()
+{
+}
+
+void KisParallelDabRenderer::Private::addJob(DabJobSP job)
+{
+    QMutexLocker l(&mutex);
+    jobs.append(job);
+}
+
+qreal KisParallelDabRenderer::Private::averageDabRenderingTime()
+{
+    QMutexLocker l(&mutex);
+    return avgDabRenderingTime.rollingMeanSafe();
+}
+
+void KisParallelDabRenderer::addDab(RenderFunction render, qreal opacity)
+{
+    DabJobSP job = toQShared(new DabJob());
+    job->dab.opacity = opacity;
+    job->dab.averageOpacity = opacity;
+
+    m_d->addJob(job);
+
+    KisPaintDeviceSP dev = createDabDevice();
+
+    m_d->painter->runnableStrokeJobsInterface()->addRunnableJob(
+        new FreehandStrokeRunnableJobDataWithUpdate(
+            [this, job, dev, render] () {
+                QElapsedTimer timer;
+                timer.start();
+
+                render(dev);
+                KisFixedPaintDeviceSP fixedDab = convertToFixedDab(dev);
+
+                QMutexLocker l(&m_d->mutex);
+
+                if (fixedDab) {
+                    job->dab.device = fixedDab;
+                    job->dab.offset = fixedDab->bounds().topLeft();
+                }
+                job->completed = true;
+
+                m_d->avgDabRenderingTime(timer.nsecsElapsed() / 1000000.0);
+            },
+            KisStrokeJobData::CONCURRENT));
+}
+
+void KisParallelDabRenderer::addRenderedDab(KisPaintDeviceSP dab, qreal opacity)
+{
+    DabJobSP job = toQShared(new DabJob());
+    job->dab.opacity = opacity;
+    job->dab.averageOpacity = opacity;
+
+    KisFixedPaintDeviceSP fixedDab = convertToFixedDab(dab);
+    if (fixedDab) {
+        job->dab.device = fixedDab;
+        job->dab.offset = fixedDab->bounds().topLeft();
+    }
+    job->completed = true;
+
+    m_d->addJob(job);
+}
+
+KisPaintDeviceSP KisParallelDabRenderer::createDabDevice() const
+{
+    return m_d->painter->device()->createCompositionSourceDevice();
+}
+
+bool KisParallelDabRenderer::hasPreparedDabs() const
+{
+    QMutexLocker l(&m_d->mutex);
+    return !m_d->jobs.isEmpty() && m_d->jobs.first()->completed;
+}
+
+QList<KisRenderedDab> KisParallelDabRenderer::Private::takeReadyDabs(int limit, bool *someDabsLeft)
+{
+    QMutexLocker l(&mutex);
+
+    QList<KisRenderedDab> result;
+    int numTaken = 0;
+
+    while (!jobs.isEmpty() && jobs.first()->completed &&
+           (limit < 0 || numTaken < limit)) {
+
+        DabJobSP job = jobs.takeFirst();
+        numTaken++;
+
+        // empty dabs are just dropped
+        if (job->dab.device) {
+            result.append(job->dab);
+        }
+    }
+
+    *someDabsLeft = !jobs.isEmpty();
+    return result;
+}
+
+void KisParallelDabRenderer::Private::addMirroringJobs(Qt::Orientation direction,
+                                                       QVector<QRect> &rects,
+                                                       UpdateSharedStateSP state,
+                                                       QVector<KisRunnableStrokeJobData*> &jobs)
+{
+    jobs.append(new KisRunnableStrokeJobData(0, KisStrokeJobData::SEQUENTIAL));
+
+    for (KisRenderedDab &dab : state->dabsQueue) {
+        jobs.append(
+            new KisRunnableStrokeJobData(
+                [state, &dab, direction] () {
+                    state->painter->mirrorDab(direction, &dab);
+                },
+                KisStrokeJobData::CONCURRENT));
+    }
+
+    jobs.append(new KisRunnableStrokeJobData(0, KisStrokeJobData::SEQUENTIAL));
+
+    for (QRect &rc : rects) {
+        state->painter->mirrorRect(direction, &rc);
+
+        jobs.append(
+            new KisRunnableStrokeJobData(
+                [rc, state] () {
+                    state->painter->bltFixed(rc, state->dabsQueue);
+                },
+                KisStrokeJobData::CONCURRENT));
+    }
+
+    state->allDirtyRects.append(rects);
+}
+
+std::pair<int, bool> KisParallelDabRenderer::doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs)
+{
+    bool someDabsAreStillInQueue = false;
+    const bool hasPreparedDabsAtStart = hasPreparedDabs();
+
+    if (!m_d->updateSharedState && hasPreparedDabsAtStart) {
+
+        m_d->updateSharedState = toQShared(new UpdateSharedState());
+        UpdateSharedStateSP state = m_d->updateSharedState;
+
+        state->painter = m_d->painter;
+
+        {
+            const qreal totalRenderingTimePerDab =
+                m_d->averageDabRenderingTime() +
+                m_d->avgUpdateTimePerDab.rollingMeanSafe();
+
+            // we limit the number of fetched dabs to fit the maximum update period and not
+            // make visual hiccups
+            const int dabsLimit =
+                totalRenderingTimePerDab > 0 ?
+                    qMax(10, int(m_d->maxUpdatePeriod / totalRenderingTimePerDab * m_d->idealNumRects)) :
+                    -1;
+
+            state->dabsQueue = m_d->takeReadyDabs(dabsLimit, &someDabsAreStillInQueue);
+        }
+
+        if (state->dabsQueue.isEmpty()) {
+            // all the fetched dabs were empty, nothing to paint
+            m_d->updateSharedState.clear();
+            return std::make_pair(m_d->currentUpdatePeriod, someDabsAreStillInQueue);
+        }
+
+        QVector<QRect> rects;
+
+        // wrap the dabs if needed, see comment in KisBrushOp::doAsyncronousUpdate()
+        if (m_d->painter->device()->defaultBounds()->wrapAroundMode()) {
+            const QRect wrapRect = m_d->painter->device()->defaultBounds()->bounds();
+
+            QList<KisRenderedDab> wrappedDabs;
+
+            Q_FOREACH (const KisRenderedDab &dab, state->dabsQueue) {
+                const QVector<QPoint> normalizationOrigins =
+                    KisWrappedRect::normalizationOriginsForRect(dab.realBounds(), wrapRect);
+
+                Q_FOREACH(const QPoint &pt, normalizationOrigins) {
+                    KisRenderedDab newDab = dab;
+
+                    newDab.offset = pt;
+
+                    rects.append(newDab.realBounds() & wrapRect);
+                    wrappedDabs.append(newDab);
+                }
+            }
+
+            state->dabsQueue = wrappedDabs;
+
+        } else {
+            Q_FOREACH (const KisRenderedDab &dab, state->dabsQueue) {
+                rects.append(dab.realBounds());
+            }
+        }
+
+        /**
+         * The engines don't report their spacing, so we estimate it from
+         * the dabs themselves: the diameter is the average size of a dab
+         * and the spacing is the average distance between the centers of
+         * the consecutive dabs relative to the diameter.
+         */
+        qreal totalSize = 0;
+        qreal totalDistance = 0;
+
+        for (int i = 0; i < rects.size(); i++) {
+            totalSize += qMax(rects[i].width(), rects[i].height());
+
+            if (i > 0) {
+                const QPoint diff = rects[i].center() - rects[i - 1].center();
+                totalDistance += std::sqrt(qreal(diff.x() * diff.x() + diff.y() * diff.y()));
+            }
+        }
+
+        const int diameter = qRound(totalSize / rects.size());
+        const qreal spacing =
+            rects.size() > 1 && diameter > 0 ?
+                qBound(0.0, totalDistance / (rects.size() - 1) / diameter, 2.0) : 1.0;
+
+        // split/merge rects into non-overlapping areas
+        rects = KisPaintOpUtils::splitDabsIntoRects(rects, m_d->idealNumRects, diameter, spacing);
+
+        state->allDirtyRects = rects;
+        state->dabRenderingTimer.start();
+
+        Q_FOREACH (const QRect &rc, rects) {
+            jobs.append(
+                new KisRunnableStrokeJobData(
+                    [rc, state] () {
+                        state->painter->bltFixed(rc, state->dabsQueue);
+                    },
+                    KisStrokeJobData::CONCURRENT));
+        }
+
+        // see the comment about the order of mirroring in KisBrushOp
+        if (state->painter->hasHorizontalMirroring()) {
+            m_d->addMirroringJobs(Qt::Horizontal, rects, state, jobs);
+        }
+
+        if (state->painter->hasVerticalMirroring()) {
+            m_d->addMirroringJobs(Qt::Vertical, rects, state, jobs);
+        }
+
+        if (state->painter->hasHorizontalMirroring() && state->painter->hasVerticalMirroring()) {
+            m_d->addMirroringJobs(Qt::Horizontal, rects, state, jobs);
+        }
+
+        jobs.append(
+            new KisRunnableStrokeJobData(
+                [state, this, someDabsAreStillInQueue] () {
+                    Q_FOREACH(const QRect &rc, state->allDirtyRects) {
+                        state->painter->addDirtyRect(rc);
+                    }
+
+                    const int updateRenderingTime = state->dabRenderingTimer.elapsed();
+                    const qreal dabRenderingTime = m_d->averageDabRenderingTime();
+
+                    m_d->avgNumDabs(state->dabsQueue.size());
+
+                    const qreal currentUpdateTimePerDab = qreal(updateRenderingTime) / state->dabsQueue.size();
+                    m_d->avgUpdateTimePerDab(currentUpdateTimePerDab);
+
+                    const qreal totalRenderingTimePerDab = dabRenderingTime + currentUpdateTimePerDab;
+
+                    const int approxDabRenderingTime =
+                        qreal(totalRenderingTimePerDab) * m_d->avgNumDabs.rollingMean() / m_d->idealNumRects;
+
+                    m_d->currentUpdatePeriod =
+                        someDabsAreStillInQueue ? m_d->minUpdatePeriod :
+                        qBound(m_d->minUpdatePeriod, int(1.5 * approxDabRenderingTime), m_d->maxUpdatePeriod);
+
+                    // release all the dab devices
+                    state->dabsQueue.clear();
+
+                    m_d->updateSharedState.clear();
+                },
+                KisStrokeJobData::SEQUENTIAL));
+
+    } else if (m_d->updateSharedState && hasPreparedDabsAtStart) {
+        someDabsAreStillInQueue = true;
+    } else if (!hasPreparedDabsAtStart) {
+        QMutexLocker l(&m_d->mutex);
+        someDabsAreStillInQueue = !m_d->jobs.isEmpty();
+    }
+
+    return std::make_pair(m_d->currentUpdatePeriod, someDabsAreStillInQueue);
+}
@@ -0,0 +1,104 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KISPARALLELDABRENDERER_H
+#define KISPARALLELDABRENDERER_H
+
+#include "kritapaintop_export.h"
+
+#include <QScopedPointer>
+#include <QVector>
+#include <functional>
+#include <utility>
+
+#include "kis_types.h"
+
+class KisPainter;
+class KisRunnableStrokeJobData;
+
+/**
+ * A rendering pipeline for the paintops that render their dabs
+ * into a temporary paint device and blit it onto the canvas, like
+ * spray, hairy, sketch, particle and curve engines.
+ *
+ * The paintop passes every dab to the renderer instead of blitting
+ * it. A dab can be either a render function, which is executed on a
+ * separate thread concurrently with other dabs (addDab()), or a device
+ * that has already been rendered on the stroke thread, because the
+ * rendering depends on the state of the engine (addRenderedDab()).
+ *
+ * The rendered dabs are composited onto the painter's device in
+ * doAsyncronousUpdate(): the area of the dabs is split into
+ * non-intersecting tile-aligned patches, which are processed in
+ * parallel. Inside every patch the dabs are applied in the order
+ * they were added, so the result is the same as if the dabs were
+ * blitted sequentially.
+ *
+ * The paintop should forward its doAsyncronousUpdate() call to the
+ * renderer and return true in needsAsynchronousUpdates() of its
+ * settings.
+ */
+class PAINTOP_EXPORT KisParallelDabRenderer
+{
+public:
+    /**
+     * The function renders the dab into an empty device \p dab that
+     * was created by createDabDevice(). It is called on a worker thread,
+     * so it must not access any data that can be changed by the stroke
+     * thread.
+     */
+    typedef std::function<void(KisPaintDeviceSP dab)> RenderFunction;
+
+public:
+    KisParallelDabRenderer(KisPainter *painter);
+    ~KisParallelDabRenderer();
+
+    /**
+     * Schedules rendering of a dab on a worker thread. The dab will be
+     * applied with \p opacity and the composite op of the painter.
+     */
+    void addDab(RenderFunction render, qreal opacity);
+
+    /**
+     * Adds a dab that has already been rendered on the calling thread.
+     * The pixels of \p dab are copied, so the paintop may clear and reuse
+     * the device for the next dab.
+     */
+    void addRenderedDab(KisPaintDeviceSP dab, qreal opacity);
+
+    /**
+     * Creates a device to render a dab into
+     */
+    KisPaintDeviceSP createDabDevice() const;
+
+    bool hasPreparedDabs() const;
+
+    /**
+     * Generates the jobs that composite all the prepared dabs. See
+     * KisPaintOp::doAsyncronousUpdate() for details.
+     */
+    std::pair<int, bool> doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs);
+
+private:
+    KisParallelDabRenderer(const KisParallelDabRenderer &rhs) = delete;
+
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif // KISPARALLELDABRENDERER_H
@@ -105,6 +105,14 @@ QRect KisTextureMaskInfo::maskBounds() const {
     return m_maskBounds;
 }
 
+const quint8 *KisTextureMaskInfo::tiledMaskData() const {
+    return m_tiledMask.constData();
+}
+
+int KisTextureMaskInfo::tiledMaskRowStride() const {
+    return 2 * m_maskBounds.width();
+}
+
 bool KisTextureMaskInfo::fillProperties(const KisPropertiesConfigurationSP setting)
 {
 
@@ -160,10 +168,14 @@ void KisTextureMaskInfo::recalculateMask()
     const QRgb* pixel = reinterpret_cast<const QRgb*>(mask.constBits());
     const int width = mask.width();
     const int height = mask.height();
+    const int tiledRowStride = 2 * width;
 
-    KisHLineIteratorSP iter = m_mask->createHLineIteratorNG(0, 0, width);
+    m_tiledMask.resize(tiledRowStride * height);
+    quint8 *tiledMaskPtr = m_tiledMask.data();
 
     for (int row = 0; row < height; ++row) {
+        quint8 *tiledRow = tiledMaskPtr + row * tiledRowStride;
+
         for (int col = 0; col < width; ++col) {
             const QRgb currentPixel = pixel[row * width + col];
 
@@ -194,10 +206,11 @@ void KisTextureMaskInfo::recalculateMask()
                 maskValue = OPACITY_OPAQUE_F;
             }
 
-            cs->setOpacity(iter->rawData(), maskValue, 1);
-            iter->nextPixel();
+            cs->setOpacity(tiledRow + col, qreal(maskValue), 1);
         }
-        iter->nextRow();
+
+        memcpy(tiledRow + width, tiledRow, width);
+        m_mask->writeBytes(tiledRow, QRect(0, row, width, 1));
     }
 
     m_maskBounds = QRect(0, 0, width, height);
@@ -23,6 +23,7 @@
 #include <kis_paint_device.h>
 #include <QSharedPointer>
 #include <QMutex>
+#include <QVector>
 
 
 #include <boost/operators.hpp>
@@ -50,6 +51,18 @@ public:
 
     QRect maskBounds() const;
 
+    /**
+     * The mask stored as a contiguous 8-bit plane, where every row is
+     * repeated twice. It lets the texture option read a span of up to
+     * maskBounds().width() pixels starting from any column of the pattern
+     * without wrapping the coordinates for every pixel.
+     *
+     * The plane has maskBounds().height() rows of tiledMaskRowStride()
+     * bytes each.
+     */
+    const quint8* tiledMaskData() const;
+    int tiledMaskRowStride() const;
+
     bool fillProperties(const KisPropertiesConfigurationSP setting);
 
     void recalculateMask();
@@ -70,6 +83,7 @@ private:
 
     KisPaintDeviceSP m_mask;
     QRect m_maskBounds;
+    QVector<quint8> m_tiledMask;
 
 };
 
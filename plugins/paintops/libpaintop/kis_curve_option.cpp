@@ -35,7 +35,7 @@ KisCurveOption::KisCurveOption(const QString& name, KisPaintOpOption::PaintopCat
     Q_FOREACH (const DynamicSensorType sensorType, KisDynamicSensor::sensorsTypes()) {
         KisDynamicSensorSP sensor = KisDynamicSensor::type2Sensor(sensorType, m_name);
         sensor->setActive(false);
-        replaceSensor(sensor);
+        m_sensorMap[sensorType] = sensor;
     }
     m_sensorMap[PRESSURE]->setActive(true);
 
@@ -51,6 +51,8 @@ KisCurveOption::KisCurveOption(const QString& name, KisPaintOpOption::PaintopCat
     points.push_back(QPointF(0.75,0.6));
     points.push_back(QPointF(1,0));
     m_commonCurve = KisCubicCurve(points);
+
+    compileSensorsProgram();
 }
 
 KisCurveOption::~KisCurveOption()
@@ -162,16 +164,16 @@ void KisCurveOption::readNamedOptionSetting(const QString& prefix, const KisProp
 
     m_sensorMap.clear();
 
-    // Replace all sensors with the inactive defaults
+    // Replace all sensors with the inactive defaults, the program is compiled in the end
     Q_FOREACH (const DynamicSensorType sensorType, KisDynamicSensor::sensorsTypes()) {
-        replaceSensor(KisDynamicSensor::type2Sensor(sensorType, m_name));
+        m_sensorMap[sensorType] = KisDynamicSensor::type2Sensor(sensorType, m_name);
     }
 
     QString sensorDefinition = setting->getString(prefix + "Sensor");
     if (!sensorDefinition.contains("sensorslist")) {
         KisDynamicSensorSP s = KisDynamicSensor::createFromXML(sensorDefinition, m_name);
         if (s) {
-            replaceSensor(s);
+            m_sensorMap[s->sensorType()] = s;
             s->setActive(true);
             commonCurve = s->curve();
             //dbgKrita << "\tsingle sensor" << s::id(s->sensorType()) << s->isActive() << "added";
@@ -188,7 +190,7 @@ void KisCurveOption::readNamedOptionSetting(const QString& prefix, const KisProp
                 if (childelt.tagName() == "ChildSensor") {
                     KisDynamicSensorSP s = KisDynamicSensor::createFromXML(childelt, m_name);
                     if (s) {
-                        replaceSensor(s);
+                        m_sensorMap[s->sensorType()] = s;
                         s->setActive(true);
                         commonCurve = s->curve();
                         //dbgKrita << "\tchild sensor" << s::id(s->sensorType()) << s->isActive() << "added";
@@ -235,12 +237,16 @@ void KisCurveOption::readNamedOptionSetting(const QString& prefix, const KisProp
 
     m_curveMode = setting->getInt(m_name + "curveMode");
     //dbgKrita << "-----------------";
+
+    // the settings are read at the start of the stroke, bake the curves now
+    compileSensorsProgram();
 }
 
 void KisCurveOption::replaceSensor(KisDynamicSensorSP s)
 {
     Q_ASSERT(s);
     m_sensorMap[s->sensorType()] = s;
+    compileSensorsProgram();
 }
 
 KisDynamicSensorSP KisCurveOption::sensor(DynamicSensorType sensorType, bool active) const
@@ -318,11 +324,13 @@ void KisCurveOption::setCurveMode(int mode)
 void KisCurveOption::setUseSameCurve(bool useSameCurve)
 {
     m_useSameCurve = useSameCurve;
+    compileSensorsProgram();
 }
 
 void KisCurveOption::setCommonCurve(KisCubicCurve curve)
 {
     m_commonCurve = curve;
+    compileSensorsProgram();
 }
 
 void KisCurveOption::setCurve(DynamicSensorType sensorType, bool useSameCurve, const KisCubicCurve &curve)
@@ -358,6 +366,8 @@ void KisCurveOption::setCurve(DynamicSensorType sensorType, bool useSameCurve, c
         }
         m_useSameCurve = useSameCurve;
     }
+
+    compileSensorsProgram();
 }
 
 void KisCurveOption::setValueRange(qreal min, qreal max)
@@ -371,60 +381,89 @@ void KisCurveOption::setValue(qreal value)
     m_value = qBound(m_minValue, value, m_maxValue);
 }
 
-KisCurveOption::ValueComponents KisCurveOption::computeValueComponents(const KisPaintInformation& info) const
+void KisCurveOption::compileSensorsProgram()
 {
-    ValueComponents components;
+    m_sensorsProgram.clear();
 
-    if (m_useCurve) {
-        QMap<DynamicSensorType, KisDynamicSensorSP>::const_iterator i;
-        QList<double> sensorValues;
-        for (i = m_sensorMap.constBegin(); i != m_sensorMap.constEnd(); ++i) {
-            KisDynamicSensorSP s(i.value());
-
-            if (s->isActive()) {
-                qreal valueFromCurve = m_useSameCurve ? s->parameter(info, m_commonCurve, true) : s->parameter(info);
-                if (s->isAdditive()) {
-                    components.additive += valueFromCurve;
-                    components.hasAdditive = true;
-                } else if (s->isAbsoluteRotation()) {
-                    components.absoluteOffset = valueFromCurve;
-                    components.hasAbsoluteOffset =true;
-                } else {
-                    sensorValues << valueFromCurve;
-                    components.hasScaling = true;
-                }
-            }
-        }
+    if (m_useSameCurve) {
+        m_commonCurveLut = m_commonCurve.floatTransfer(KisDynamicSensor::curveLutSize);
+    } else {
+        m_commonCurveLut.clear();
+    }
 
-        if (sensorValues.count() == 1) {
-            components.scaling = sensorValues.first();
-        } else {
+    QMap<DynamicSensorType, KisDynamicSensorSP>::const_iterator it;
+    for (it = m_sensorMap.constBegin(); it != m_sensorMap.constEnd(); ++it) {
+        KisDynamicSensor *s = it.value().data();
 
-            if (m_curveMode == 1){           // add
-                components.scaling = 0;
-                double i;
-                foreach (i, sensorValues) {
-                    components.scaling += i;
-                }
-            } else if (m_curveMode == 2){    //max
-                components.scaling = *std::max_element(sensorValues.begin(), sensorValues.end());
+        SensorInstruction instruction;
+        instruction.sensor = s;
+        instruction.useCommonCurve = m_useSameCurve;
+        instruction.role =
+            s->isAdditive() ? SensorInstruction::Additive :
+            s->isAbsoluteRotation() ? SensorInstruction::AbsoluteRotation :
+            SensorInstruction::Scaling;
 
-            } else if (m_curveMode == 3){    //min
-                components.scaling = *std::min_element(sensorValues.begin(), sensorValues.end());
+        m_sensorsProgram.append(instruction);
+    }
+}
 
-            } else if (m_curveMode == 4){    //difference
-                double max = *std::max_element(sensorValues.begin(), sensorValues.end());
-                double min = *std::min_element(sensorValues.begin(), sensorValues.end());
-                components.scaling = max-min;
+KisCurveOption::ValueComponents KisCurveOption::computeValueComponents(const KisPaintInformation& info) const
+{
+    ValueComponents components;
 
-            } else {                         //multuply - default
-                double i;
-                foreach (i, sensorValues) {
-                    components.scaling *= i;
-                }
+    if (m_useCurve) {
+        int numScalingValues = 0;
+        qreal scalingSum = 0.0;
+        qreal scalingProduct = 1.0;
+        qreal scalingMax = 0.0;
+        qreal scalingMin = 0.0;
+
+        const QVector<SensorInstruction> &program = m_sensorsProgram;
+
+        for (auto it = program.constBegin(); it != program.constEnd(); ++it) {
+            const SensorInstruction &instruction = *it;
+            if (!instruction.sensor->isActive()) continue;
+
+            const qreal valueFromCurve =
+                instruction.useCommonCurve ?
+                instruction.sensor->parameter(info, m_commonCurveLut) :
+                instruction.sensor->parameter(info);
+
+            switch (instruction.role) {
+            case SensorInstruction::Additive:
+                components.additive += valueFromCurve;
+                components.hasAdditive = true;
+                break;
+            case SensorInstruction::AbsoluteRotation:
+                components.absoluteOffset = valueFromCurve;
+                components.hasAbsoluteOffset = true;
+                break;
+            case SensorInstruction::Scaling:
+                scalingSum += valueFromCurve;
+                scalingProduct *= valueFromCurve;
+                scalingMax = !numScalingValues ? valueFromCurve : qMax(scalingMax, valueFromCurve);
+                scalingMin = !numScalingValues ? valueFromCurve : qMin(scalingMin, valueFromCurve);
+                numScalingValues++;
+                components.hasScaling = true;
+                break;
             }
         }
 
+        if (numScalingValues == 1) {
+            components.scaling = scalingSum;
+        } else if (numScalingValues > 1) {
+            if (m_curveMode == 1) {           // add
+                components.scaling = scalingSum;
+            } else if (m_curveMode == 2) {    // max
+                components.scaling = scalingMax;
+            } else if (m_curveMode == 3) {    // min
+                components.scaling = scalingMin;
+            } else if (m_curveMode == 4) {    // difference
+                components.scaling = scalingMax - scalingMin;
+            } else {                          // multiply - default
+                components.scaling = scalingProduct;
+            }
+        }
     }
 
     if (!m_separateCurveValue) {
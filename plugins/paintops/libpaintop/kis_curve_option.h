@@ -226,6 +226,36 @@ protected:
     QMap<DynamicSensorType, KisDynamicSensorSP> m_sensorMap;
 
 private:
+    /**
+     * The sensors are compiled into a flat list of instructions with the
+     * common curve baked into a lookup table, so computing the value of
+     * a dab doesn't need to walk through the sensor map and to sample the
+     * curves. The program is compiled once at the end of reading the
+     * settings and by the setters that change the sensor map or the
+     * common curve, so the const methods used on the paint path only
+     * read it and the option can be shared between threads.
+     *
+     * NOTE: the activity of the sensors is checked for every dab and
+     *       the curves of the sensors are baked by the sensors themselves,
+     *       so both may be changed through the pointers returned by
+     *       sensor() (e.g. by a subclass after reading the settings).
+     */
+    struct SensorInstruction {
+        enum Role {
+            Scaling,
+            Additive,
+            AbsoluteRotation
+        };
+
+        KisDynamicSensor *sensor;
+        bool useCommonCurve;
+        Role role;
+    };
+
+    void compileSensorsProgram();
+
+    QVector<SensorInstruction> m_sensorsProgram;
+    QVector<qreal> m_commonCurveLut;
 
     qreal m_value;
     qreal m_minValue;
@@ -510,34 +510,40 @@ void KisDynamicSensor::fromXML(const QDomElement& e)
     if (!curve_elt.isNull()) {
         m_customCurve = true;
         m_curve.fromString(curve_elt.text());
+        m_curveLut = m_curve.floatTransfer(curveLutSize);
     }
 }
 
 qreal KisDynamicSensor::parameter(const KisPaintInformation& info)
 {
-    return parameter(info, m_curve, m_customCurve);
+    return m_customCurve ? parameter(info, m_curveLut) : value(info);
 }
 
 qreal KisDynamicSensor::parameter(const KisPaintInformation& info, const KisCubicCurve curve, const bool customCurve)
 {
-    const qreal val = value(info);
     if (customCurve) {
-        qreal scaledVal = isAdditive() ? additiveToScaling(val) : val;
-
-        const QVector<qreal> transfer = curve.floatTransfer(256);
-        scaledVal = KisCubicCurve::interpolateLinear(scaledVal, transfer);
-
-        return isAdditive() ? scalingToAdditive(scaledVal) : scaledVal;
+        return parameter(info, curve.floatTransfer(curveLutSize));
     }
     else {
-        return val;
+        return value(info);
     }
 }
 
+qreal KisDynamicSensor::parameter(const KisPaintInformation& info, const QVector<qreal> &curveLut)
+{
+    const qreal val = value(info);
+    qreal scaledVal = isAdditive() ? additiveToScaling(val) : val;
+
+    scaledVal = KisCubicCurve::interpolateLinear(scaledVal, curveLut);
+
+    return isAdditive() ? scalingToAdditive(scaledVal) : scaledVal;
+}
+
 void KisDynamicSensor::setCurve(const KisCubicCurve& curve)
 {
     m_customCurve = true;
     m_curve = curve;
+    m_curveLut = m_curve.floatTransfer(curveLutSize);
 }
 
 const KisCubicCurve& KisDynamicSensor::curve() const
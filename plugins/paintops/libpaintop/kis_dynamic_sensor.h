@@ -122,6 +122,19 @@ public:
      */
     qreal parameter(const KisPaintInformation& info, const KisCubicCurve curve, const bool customCurve);
 
+    /**
+     * @return the value of this sensor for the given KisPaintInformation
+     * passed through a curve baked into a lookup table by KisCubicCurve::floatTransfer().
+     * Use it instead of passing the curve directly when the same curve is applied to
+     * every dab, so the table is not recalculated every time.
+     */
+    qreal parameter(const KisPaintInformation& info, const QVector<qreal> &curveLut);
+
+    /**
+     * The size of the lookup tables the curves are baked into
+     */
+    static const int curveLutSize = 256;
+
     /**
      * This function is call before beginning a stroke to reset the sensor.
      * Default implementation does nothing.
@@ -222,6 +235,7 @@ private:
     DynamicSensorType m_type;
     bool m_customCurve;
     KisCubicCurve m_curve;
+    QVector<qreal> m_curveLut;
     bool m_active;
 
 };
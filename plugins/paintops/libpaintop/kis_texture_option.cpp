@@ -230,44 +230,71 @@ void KisTextureProperties::apply(KisFixedPaintDeviceSP dab, const QPoint &offset
 {
     if (!m_enabled) return;
 
-    KisPaintDeviceSP fillDevice = new KisPaintDevice(KoColorSpaceRegistry::instance()->alpha8());
-    QRect rect = dab->bounds();
+    KIS_SAFE_ASSERT_RECOVER_RETURN(m_maskInfo->hasMask());
 
-    KisPaintDeviceSP mask = m_maskInfo->mask();
+    const QRect rect = dab->bounds();
     const QRect maskBounds = m_maskInfo->maskBounds();
 
-    KIS_SAFE_ASSERT_RECOVER_RETURN(mask);
+    const int maskWidth = maskBounds.width();
+    const int maskHeight = maskBounds.height();
 
-    int x = offset.x() % maskBounds.width() - m_offsetX;
-    int y = offset.y() % maskBounds.height() - m_offsetY;
+    const quint8 *tiledMask = m_maskInfo->tiledMaskData();
+    const int tiledMaskRowStride = m_maskInfo->tiledMaskRowStride();
 
+    auto positiveModulo = [] (int value, int divisor) {
+        const int result = value % divisor;
+        return result >= 0 ? result : result + divisor;
+    };
 
-    KisFillPainter fillPainter(fillDevice);
-    fillPainter.fillRect(x - 1, y - 1, rect.width() + 2, rect.height() + 2, mask, maskBounds);
-    fillPainter.end();
+    const int x = offset.x() % maskWidth - m_offsetX;
+    const int y = offset.y() % maskHeight - m_offsetY;
+    const int firstMaskColumn = positiveModulo(x, maskWidth);
 
-    qreal pressure = m_strengthOption.apply(info);
+    const float pressure = m_strengthOption.apply(info);
+    const int pressureOffset = (1.0 - pressure) * 255;
+
+    const KoColorSpace *cs = dab->colorSpace();
+    const int dabRowStride = rect.width() * dab->pixelSize();
     quint8 *dabData = dab->data();
 
-    KisHLineIteratorSP iter = fillDevice->createHLineIteratorNG(x, y, rect.width());
+    /**
+     * The texture is applied row-by-row: first, the row of the pattern is
+     * gathered into a contiguous buffer (the mask rows are pre-tiled, so
+     * it takes at most a couple of memcpy calls), then the buffer is
+     * combined with the alpha of the dab in a plain loop, which the
+     * compiler can vectorize, and written back with a single call to the
+     * color space.
+     */
+    QVector<quint8> textureRow(rect.width());
+    QVector<quint8> alphaRow(m_texturingMode == MULTIPLY ? 0 : rect.width());
+    quint8 *texturePtr = textureRow.data();
+    quint8 *alphaPtr = alphaRow.data();
+
     for (int row = 0; row < rect.height(); ++row) {
-        for (int col = 0; col < rect.width(); ++col) {
-            if (m_texturingMode == MULTIPLY) {
-                dab->colorSpace()->multiplyAlpha(dabData, quint8(*iter->oldRawData() * pressure), 1);
+        const quint8 *maskRow = tiledMask + positiveModulo(y + row, maskHeight) * tiledMaskRowStride;
+
+        for (int col = 0; col < rect.width(); col += maskWidth) {
+            memcpy(texturePtr + col, maskRow + firstMaskColumn, qMin(maskWidth, rect.width() - col));
+        }
+
+        if (m_texturingMode == MULTIPLY) {
+            for (int col = 0; col < rect.width(); ++col) {
+                texturePtr[col] = quint8(texturePtr[col] * pressure);
             }
-            else {
-                int pressureOffset = (1.0 - pressure) * 255;
 
-                qint16 maskA = *iter->oldRawData() + pressureOffset;
-                quint8 dabA = dab->colorSpace()->opacityU8(dabData);
+            cs->applyAlphaU8Mask(dabData, texturePtr, rect.width());
+        }
+        else {
+            cs->copyOpacityU8(dabData, alphaPtr, rect.width());
 
-                dabA = qMax(0, (qint16)dabA - maskA);
-                dab->colorSpace()->setOpacity(dabData, dabA, 1);
+            for (int col = 0; col < rect.width(); ++col) {
+                const int value = int(alphaPtr[col]) - int(texturePtr[col]) - pressureOffset;
+                alphaPtr[col] = quint8(qMax(0, value));
             }
 
-            iter->nextPixel();
-            dabData += dab->pixelSize();
+            cs->setOpacityU8(dabData, alphaPtr, rect.width());
         }
-        iter->nextRow();
+
+        dabData += dabRowStride;
     }
 }
@@ -22,9 +22,9 @@
 #include <KoColorSpace.h>
 #include <KoColorSpaceRegistry.h>
 
-#include <../KisDabRenderingQueue.h>
-#include <../KisRenderedDab.h>
-#include <../KisDabRenderingJob.h>
+#include <KisDabRenderingQueue.h>
+#include <KisRenderedDab.h>
+#include <KisDabRenderingJob.h>
 
 struct SurrogateCacheInterface : public KisDabRenderingQueue::CacheInterface
 {
@@ -119,8 +119,10 @@ void KisDabRenderingQueueTest::testCachedDabs()
     QVERIFY(!job2);
 
     cacheInterface->typeOverride = KisDabRenderingJob::Copy;
-    KisDabRenderingJobSP job3 = queue.addDab(request2, OPACITY_OPAQUE_F, OPACITY_OPAQUE_F);
+    int job3SeqNo = -1;
+    KisDabRenderingJobSP job3 = queue.addDab(request2, OPACITY_OPAQUE_F, OPACITY_OPAQUE_F, &job3SeqNo);
     QVERIFY(!job3);
+    QCOMPARE(job3SeqNo, 3);
 
     // we only added the dabs, but we haven't completed them yet
     QVERIFY(!queue.hasPreparedDabs());
@@ -144,6 +146,7 @@ void KisDabRenderingQueueTest::testCachedDabs()
         // take the prepared dabs
         renderedDabs = queue.takeReadyDabs();
         QCOMPARE(renderedDabs.size(), 1);
+        QCOMPARE(renderedDabs[0].seqNo, 0);
 
         // the list should be empty again
         QVERIFY(!queue.hasPreparedDabs());
@@ -164,6 +167,9 @@ void KisDabRenderingQueueTest::testCachedDabs()
         // take the prepared dabs
         renderedDabs = queue.takeReadyDabs();
         QCOMPARE(renderedDabs.size(), 3);
+        QCOMPARE(renderedDabs[0].seqNo, 1);
+        QCOMPARE(renderedDabs[1].seqNo, 2);
+        QCOMPARE(renderedDabs[2].seqNo, 3);
 
         // since they are copies, they should be the same
         QCOMPARE(renderedDabs[1].device, renderedDabs[0].device);
@@ -443,7 +449,7 @@ void KisDabRenderingQueueTest::testPostprocessedDabs()
 
 }
 
-#include <../KisDabRenderingQueueCache.h>
+#include <KisDabRenderingQueueCache.h>
 
 void KisDabRenderingQueueTest::testRunningJobs()
 {
@@ -498,7 +504,7 @@ void KisDabRenderingQueueTest::testRunningJobs()
     QCOMPARE(renderedDabs[1].offset, QPoint(15,15));
 }
 
-#include "../KisDabRenderingExecutor.h"
+#include "KisDabRenderingExecutor.h"
 #include "KisFakeRunnableStrokeJobsExecutor.h"
 
 void KisDabRenderingQueueTest::testExecutor()
@@ -0,0 +1,137 @@
+/*
+ *  Copyright (c) 2020 Krita Developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisParallelDabRendererTest.h"
+
+#include <QTest>
+#include <tuple>
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+
+#include <kis_paint_device.h>
+#include <kis_painter.h>
+#include <KisRunnableStrokeJobData.h>
+#include <KisRunnableStrokeJobsInterface.h>
+
+#include <KisParallelDabRenderer.h>
+
+#include "testutil.h"
+
+namespace {
+
+struct TestDab {
+    QRect rect;
+    QColor color;
+    quint8 opacity;
+};
+
+void renderTestDab(KisPaintDeviceSP dev, const TestDab &dab)
+{
+    dev->fill(dab.rect, KoColor(dab.color, dev->colorSpace()));
+}
+
+void flushRenderer(KisParallelDabRenderer *renderer, KisPainter *painter)
+{
+    bool needMoreUpdates = true;
+
+    while (needMoreUpdates) {
+        QVector<KisRunnableStrokeJobData*> jobs;
+        std::tie(std::ignore, needMoreUpdates) = renderer->doAsyncronousUpdate(jobs);
+        painter->runnableStrokeJobsInterface()->addRunnableJobs(jobs);
+    }
+}
+
+}
+
+void KisParallelDabRendererTest::testCompositionOrder()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    QVector<TestDab> dabs;
+    dabs << TestDab{QRect(10, 10, 200, 200), Qt::red, 255};
+    dabs << TestDab{QRect(100, 100, 300, 50), Qt::green, 128};
+    dabs << TestDab{QRect(150, 20, 50, 400), Qt::blue, 200};
+    dabs << TestDab{QRect(390, 130, 200, 200), Qt::yellow, 64};
+
+    KisPaintDeviceSP refDev = new KisPaintDevice(cs);
+    KisPainter refPainter(refDev);
+
+    Q_FOREACH (const TestDab &dab, dabs) {
+        KisPaintDeviceSP dev = new KisPaintDevice(cs);
+        renderTestDab(dev, dab);
+
+        const QRect rc = dev->extent();
+        refPainter.setOpacity(dab.opacity);
+        refPainter.bitBlt(rc.topLeft(), dev, rc);
+    }
+
+    KisPaintDeviceSP dstDev = new KisPaintDevice(cs);
+    KisPainter dstPainter(dstDev);
+    KisParallelDabRenderer renderer(&dstPainter);
+
+    for (int i = 0; i < dabs.size(); i++) {
+        const TestDab dab = dabs[i];
+        const qreal opacity = qreal(dab.opacity) / OPACITY_OPAQUE_U8;
+
+        // mix both kinds of dabs to check that their order is preserved
+        if (i % 2) {
+            KisPaintDeviceSP dev = renderer.createDabDevice();
+            renderTestDab(dev, dab);
+            renderer.addRenderedDab(dev, opacity);
+        } else {
+            renderer.addDab(
+                [dab] (KisPaintDeviceSP dev) {
+                    renderTestDab(dev, dab);
+                },
+                opacity);
+        }
+    }
+
+    flushRenderer(&renderer, &dstPainter);
+
+    QVERIFY(!renderer.hasPreparedDabs());
+
+    QPoint errorPoint;
+    QVERIFY(TestUtil::comparePaintDevices(errorPoint, refDev, dstDev));
+
+    QRect dirtyRect;
+    Q_FOREACH (const QRect &rc, dstPainter.takeDirtyRegion()) {
+        dirtyRect |= rc;
+    }
+    QVERIFY(dirtyRect.contains(refDev->exactBounds()));
+}
+
+void KisParallelDabRendererTest::testEmptyDabs()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    KisPaintDeviceSP dstDev = new KisPaintDevice(cs);
+    KisPainter dstPainter(dstDev);
+    KisParallelDabRenderer renderer(&dstPainter);
+
+    renderer.addDab([] (KisPaintDeviceSP) {}, 1.0);
+    renderer.addRenderedDab(renderer.createDabDevice(), 1.0);
+
+    flushRenderer(&renderer, &dstPainter);
+
+    QVERIFY(!renderer.hasPreparedDabs());
+    QVERIFY(dstDev->extent().isEmpty());
+}
+
+QTEST_MAIN(KisParallelDabRendererTest)
@@ -18,6 +18,7 @@
 
 #include "kis_sensors_test.h"
 #include <kis_dynamic_sensor.h>
+#include <kis_curve_option.h>
 
 #include <QTest>
 
@@ -39,6 +40,96 @@ void KisSensorsTest::testDrawingAngle()
     testBound(sensor);
 }
 
+namespace {
+KisCubicCurve testingCurve(qreal midValue)
+{
+    QList<QPointF> points;
+    points << QPointF(0, 0.1) << QPointF(0.4, midValue) << QPointF(1, 0.9);
+    return KisCubicCurve(points);
+}
+
+QList<KisPaintInformation> tiltedPaintInformations()
+{
+    QList<KisPaintInformation> result;
+
+    for (int i = 0; i <= 10; i++) {
+        result << KisPaintInformation(QPointF(i, i), 0.1 * i, 6 * i - 30, 0, 0);
+    }
+
+    return result;
+}
+}
+
+void KisSensorsTest::testCurveOptionProgram_data()
+{
+    QTest::addColumn<int>("curveMode");
+
+    QTest::newRow("multiply") << 0;
+    QTest::newRow("add") << 1;
+    QTest::newRow("max") << 2;
+    QTest::newRow("min") << 3;
+    QTest::newRow("difference") << 4;
+}
+
+void KisSensorsTest::testCurveOptionProgram()
+{
+    QFETCH(int, curveMode);
+
+    KisCurveOption option("testname", KisPaintOpOption::GENERAL, true);
+    option.setUseSameCurve(false);
+    option.setCurveMode(curveMode);
+
+    KisDynamicSensorSP pressure = option.sensor(PRESSURE, false);
+    KisDynamicSensorSP xTilt = option.sensor(XTILT, false);
+
+    pressure->setCurve(testingCurve(0.3));
+    xTilt->setCurve(testingCurve(0.7));
+    xTilt->setActive(true);
+
+    Q_FOREACH (const KisPaintInformation &pi, tiltedPaintInformations()) {
+        // the reference values are calculated with the curves sampled for every dab
+        const qreal a = pressure->parameter(pi, pressure->curve(), true);
+        const qreal b = xTilt->parameter(pi, xTilt->curve(), true);
+
+        qreal scaling =
+            curveMode == 1 ? a + b :
+            curveMode == 2 ? qMax(a, b) :
+            curveMode == 3 ? qMin(a, b) :
+            curveMode == 4 ? qAbs(a - b) :
+            a * b;
+
+        QCOMPARE(option.computeSizeLikeValue(pi), qBound(0.0, scaling, 1.0));
+    }
+
+    // the activity of the sensors is checked for every dab
+    option.sensor(XTILT, false)->setActive(false);
+
+    Q_FOREACH (const KisPaintInformation &pi, tiltedPaintInformations()) {
+        QCOMPARE(option.computeSizeLikeValue(pi), pressure->parameter(pi, pressure->curve(), true));
+    }
+}
+
+void KisSensorsTest::testCurveOptionCommonCurve()
+{
+    KisCurveOption option("testname", KisPaintOpOption::GENERAL, true);
+    option.setUseSameCurve(true);
+    option.setCommonCurve(testingCurve(0.3));
+
+    KisDynamicSensorSP pressure = option.sensor(PRESSURE, true);
+    QVERIFY(pressure);
+
+    Q_FOREACH (const KisPaintInformation &pi, tiltedPaintInformations()) {
+        QCOMPARE(option.computeSizeLikeValue(pi), pressure->parameter(pi, testingCurve(0.3), true));
+    }
+
+    // the new common curve should be baked again
+    option.setCommonCurve(testingCurve(0.8));
+
+    Q_FOREACH (const KisPaintInformation &pi, tiltedPaintInformations()) {
+        QCOMPARE(option.computeSizeLikeValue(pi), pressure->parameter(pi, testingCurve(0.8), true));
+    }
+}
+
 void KisSensorsTest::testBound(KisDynamicSensorSP sensor)
 {
     Q_FOREACH (const KisPaintInformation & pi, paintInformations) {
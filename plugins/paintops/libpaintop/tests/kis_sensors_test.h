@@ -32,6 +32,9 @@ public:
 private Q_SLOTS:
 
     void testDrawingAngle();
+    void testCurveOptionProgram_data();
+    void testCurveOptionProgram();
+    void testCurveOptionCommonCurve();
 private:
     void testBound(KisDynamicSensorSP sensor);
 private:
@@ -36,6 +36,7 @@
 #include <kis_paintop_plugin_utils.h>
 #include <brushengine/kis_paintop.h>
 #include <brushengine/kis_paint_information.h>
+#include <KisParallelDabRenderer.h>
 
 #include "kis_particleop_option.h"
 
@@ -62,6 +63,10 @@ KisParticlePaintOp::KisParticlePaintOp(const KisPaintOpSettingsSP settings, KisP
     m_rateOption.resetAllSensors();
 
     m_first = true;
+
+    if (settings->needsAsynchronousUpdates()) {
+        m_dabRenderer.reset(new KisParallelDabRenderer(painter));
+    }
 }
 
 KisParticlePaintOp::~KisParticlePaintOp()
@@ -81,6 +86,13 @@ KisSpacingInformation KisParticlePaintOp::updateSpacingImpl(const KisPaintInform
                                                    &m_airbrushOption, nullptr, info);
 }
 
+std::pair<int, bool> KisParticlePaintOp::doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs)
+{
+    return m_dabRenderer ?
+        m_dabRenderer->doAsyncronousUpdate(jobs) :
+        KisPaintOp::doAsyncronousUpdate(jobs);
+}
+
 KisTimingInformation KisParticlePaintOp::updateTimingImpl(const KisPaintInformation &info) const
 {
     return KisPaintOpPluginUtils::effectiveTiming(&m_airbrushOption, &m_rateOption, info);
@@ -116,6 +128,12 @@ void KisParticlePaintOp::doPaintLine(const KisPaintInformation &pi1, const KisPa
     }
 
     m_particleBrush.draw(m_dab, painter()->paintColor(), pi2.pos());
+
+    if (m_dabRenderer) {
+        m_dabRenderer->addRenderedDab(m_dab, qreal(painter()->opacity()) / OPACITY_OPAQUE_U8);
+        return;
+    }
+
     QRect rc = m_dab->extent();
 
     painter()->bitBlt(rc.x(), rc.y(), m_dab, rc.x(), rc.y(), rc.width(), rc.height());
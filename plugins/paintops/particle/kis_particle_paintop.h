@@ -27,8 +27,11 @@
 #include "kis_particle_paintop_settings.h"
 #include "particle_brush.h"
 
+#include <QScopedPointer>
+
 class KisPainter;
 class KisPaintInformation;
+class KisParallelDabRenderer;
 
 class KisParticlePaintOp : public KisPaintOp
 {
@@ -47,6 +50,8 @@ protected:
 
     KisTimingInformation updateTimingImpl(const KisPaintInformation &info) const override;
 
+    std::pair<int, bool> doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs) override;
+
 private:
     void doPaintLine(const KisPaintInformation &pi1, const KisPaintInformation &pi2);
 
@@ -57,6 +62,10 @@ private:
     KisAirbrushOptionProperties m_airbrushOption;
     KisPressureRateOption m_rateOption;
     bool m_first;
+
+    // the particles move between the dabs, so the dabs are rendered
+    // on the stroke thread and only composited in parallel
+    QScopedPointer<KisParallelDabRenderer> m_dabRenderer;
 };
 
 #endif // KIS_PARTICLE_PAINTOP_H_
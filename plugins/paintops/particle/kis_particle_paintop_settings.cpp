@@ -47,6 +47,11 @@ bool KisParticlePaintOpSettings::paintIncremental()
     return (enumPaintActionType)getInt("PaintOpAction", WASH) == BUILDUP;
 }
 
+bool KisParticlePaintOpSettings::needsAsynchronousUpdates() const
+{
+    return true;
+}
+
 
 #include <brushengine/kis_slider_based_paintop_property.h>
 #include "kis_paintop_preset.h"
@@ -33,6 +33,7 @@ public:
 
     bool lodSizeThresholdSupported() const override;
     bool paintIncremental() override;
+    bool needsAsynchronousUpdates() const override;
 
     QList<KisUniformPaintOpPropertySP> uniformProperties(KisPaintOpSettingsSP settings) override;
 
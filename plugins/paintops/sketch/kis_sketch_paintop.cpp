@@ -41,6 +41,7 @@
 #include <kis_pressure_opacity_option.h>
 #include <kis_dab_cache.h>
 #include "kis_lod_transform.h"
+#include <KisParallelDabRenderer.h>
 
 
 #include <QtGlobal>
@@ -90,6 +91,10 @@ KisSketchPaintOp::KisSketchPaintOp(const KisPaintOpSettingsSP settings, KisPaint
 
     m_painter = 0;
     m_count = 0;
+
+    if (settings->needsAsynchronousUpdates()) {
+        m_dabRenderer.reset(new KisParallelDabRenderer(painter));
+    }
 }
 
 KisSketchPaintOp::~KisSketchPaintOp()
@@ -296,11 +301,15 @@ void KisSketchPaintOp::doPaintLine(const KisPaintInformation &pi1, const KisPain
 
     m_count++;
 
-    QRect rc = m_dab->extent();
     quint8 origOpacity = m_opacityOption.apply(painter(), pi2);
 
-    painter()->bitBlt(rc.x(), rc.y(), m_dab, rc.x(), rc.y(), rc.width(), rc.height());
-    painter()->renderMirrorMask(rc, m_dab);
+    if (m_dabRenderer) {
+        m_dabRenderer->addRenderedDab(m_dab, qreal(painter()->opacity()) / OPACITY_OPAQUE_U8);
+    } else {
+        QRect rc = m_dab->extent();
+        painter()->bitBlt(rc.x(), rc.y(), m_dab, rc.x(), rc.y(), rc.width(), rc.height());
+        painter()->renderMirrorMask(rc, m_dab);
+    }
     painter()->setOpacity(origOpacity);
 }
 
@@ -312,6 +321,13 @@ KisSpacingInformation KisSketchPaintOp::paintAt(const KisPaintInformation& info)
     return updateSpacingImpl(info);
 }
 
+std::pair<int, bool> KisSketchPaintOp::doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs)
+{
+    return m_dabRenderer ?
+        m_dabRenderer->doAsyncronousUpdate(jobs) :
+        KisPaintOp::doAsyncronousUpdate(jobs);
+}
+
 KisSpacingInformation KisSketchPaintOp::updateSpacingImpl(const KisPaintInformation &info) const
 {
     return KisPaintOpPluginUtils::effectiveSpacing(0.0, 0.0, true, 0.0, false, 0.0, false, 0.0,
@@ -35,7 +35,10 @@
 #include "kis_linewidth_option.h"
 #include "kis_offset_scale_option.h"
 
+#include <QScopedPointer>
+
 class KisDabCache;
+class KisParallelDabRenderer;
 
 
 class KisSketchPaintOp : public KisPaintOp
@@ -55,6 +58,8 @@ protected:
 
     KisTimingInformation updateTimingImpl(const KisPaintInformation &info) const override;
 
+    std::pair<int, bool> doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs) override;
+
 private:
     // pixel buffer
     KisPaintDeviceSP m_dab;
@@ -85,6 +90,10 @@ private:
     KisBrushSP m_brush;
     KisDabCache *m_dabCache;
 
+    // the lines depend on the history of the stroke, so the dabs are
+    // rendered on the stroke thread and only composited in parallel
+    QScopedPointer<KisParallelDabRenderer> m_dabRenderer;
+
 private:
     void drawConnection(const QPointF &start, const QPointF &end, double lineWidth);
     void updateBrushMask(const KisPaintInformation& info, qreal scale, qreal rotation);
@@ -33,6 +33,11 @@ bool KisSketchPaintOpSettings::paintIncremental()
     return (enumPaintActionType)getInt("PaintOpAction", WASH) == BUILDUP;
 }
 
+bool KisSketchPaintOpSettings::needsAsynchronousUpdates() const
+{
+    return true;
+}
+
 QPainterPath KisSketchPaintOpSettings::brushOutline(const KisPaintInformation &info, const OutlineMode &mode)
 {
     bool isSimpleMode = getBool(SKETCH_USE_SIMPLE_MODE);
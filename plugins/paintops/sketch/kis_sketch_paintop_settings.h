@@ -37,6 +37,8 @@ public:
     QPainterPath brushOutline(const KisPaintInformation &info, const OutlineMode &mode) override;
 
     bool paintIncremental() override;
+
+    bool needsAsynchronousUpdates() const override;
 };
 
 typedef KisSharedPtr<KisSketchPaintOpSettings> KisSketchPaintOpSettingsSP;
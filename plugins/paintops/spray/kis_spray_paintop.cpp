@@ -39,12 +39,15 @@
 #include <kis_color_option.h>
 #include <kis_lod_transform.h>
 #include <kis_paintop_plugin_utils.h>
+#include <KisParallelDabRenderer.h>
+#include <brushengine/kis_random_source.h>
 
 
 KisSprayPaintOp::KisSprayPaintOp(const KisPaintOpSettingsSP settings, KisPainter *painter, KisNodeSP node, KisImageSP image)
     : KisPaintOp(painter)
     , m_isPresetValid(true)
     , m_node(node)
+    , m_dabColorSpace(painter->device()->colorSpace())
 {
     Q_ASSERT(settings);
     Q_ASSERT(painter);
@@ -81,7 +84,21 @@ KisSprayPaintOp::KisSprayPaintOp(const KisPaintOpSettingsSP settings, KisPainter
     m_sprayBrush.setProperties(&m_properties, &m_colorProperties,
                                &m_shapeProperties, &m_shapeDynamicsProperties, m_brushOption.brush());
 
-    m_sprayBrush.setFixedDab(cachedDab());
+    m_sprayBrush.setFixedDab(cachedDab(m_dabColorSpace));
+
+    /**
+     * Pipe brushes select the next brush on every call, so their
+     * dabs should be rendered in the order they come.
+     */
+    KisBrushSP brush = m_brushOption.brush();
+    m_canRenderInParallel =
+        m_shapeProperties.enabled ||
+        !brush ||
+        (brush->brushType() != PIPE_MASK && brush->brushType() != PIPE_IMAGE);
+
+    if (settings->needsAsynchronousUpdates()) {
+        m_dabRenderer.reset(new KisParallelDabRenderer(painter));
+    }
 
     // spacing
     if ((m_properties.diameter * 0.5) > 1) {
@@ -103,13 +120,6 @@ KisSpacingInformation KisSprayPaintOp::paintAt(const KisPaintInformation& info)
         return KisSpacingInformation(m_spacing);
     }
 
-    if (!m_dab) {
-        m_dab = source()->createCompositionSourceDevice();
-    }
-    else {
-        m_dab->clear();
-    }
-
     qreal rotation = m_rotationOption.apply(info);
     quint8 origOpacity = m_opacityOption.apply(painter(), info);
     // Spray Brush is capable of working with zero scale,
@@ -117,6 +127,42 @@ KisSpacingInformation KisSprayPaintOp::paintAt(const KisPaintInformation& info)
     const qreal scale = m_sizeOption.apply(info);
     const qreal lodScale = KisLodTransform::lodToScale(painter()->device());
 
+    if (m_dabRenderer && m_canRenderInParallel) {
+        const qreal opacity = qreal(painter()->opacity()) / OPACITY_OPAQUE_U8;
+        painter()->setOpacity(origOpacity);
+
+        /**
+         * The dab is rendered on a worker thread, so it gets its own
+         * random source (seeded in the order of the dabs to keep the
+         * stroke reproducible) and a fixed drawing angle
+         */
+        KisPaintInformation dabInfo(info);
+        dabInfo.setRandomSource(new KisRandomSource(info.randomSource()->generate()));
+        dabInfo.overrideDrawingAngle(info.drawingAngle());
+
+        KisPaintDeviceSP source = m_node->paintDevice();
+        const KoColor paintColor = painter()->paintColor();
+        const KoColor backgroundColor = painter()->backgroundColor();
+
+        m_dabRenderer->addDab(
+            [this, dabInfo, source, rotation, scale, lodScale, paintColor, backgroundColor] (KisPaintDeviceSP dab) {
+                QSharedPointer<SprayBrush> sprayBrush = acquireSprayBrush();
+                sprayBrush->paint(dab, source, dabInfo,
+                                  rotation, scale, lodScale,
+                                  paintColor, backgroundColor);
+                releaseSprayBrush(sprayBrush);
+            },
+            opacity);
+
+        return computeSpacing(info, lodScale);
+    }
+
+    if (!m_dab) {
+        m_dab = source()->createCompositionSourceDevice();
+    }
+    else {
+        m_dab->clear();
+    }
 
     m_sprayBrush.paint(m_dab,
                        m_node->paintDevice(),
@@ -126,9 +172,13 @@ KisSpacingInformation KisSprayPaintOp::paintAt(const KisPaintInformation& info)
                        painter()->paintColor(),
                        painter()->backgroundColor());
 
-    QRect rc = m_dab->extent();
-    painter()->bitBlt(rc.topLeft(), m_dab, rc);
-    painter()->renderMirrorMask(rc, m_dab);
+    if (m_dabRenderer) {
+        m_dabRenderer->addRenderedDab(m_dab, qreal(painter()->opacity()) / OPACITY_OPAQUE_U8);
+    } else {
+        QRect rc = m_dab->extent();
+        painter()->bitBlt(rc.topLeft(), m_dab, rc);
+        painter()->renderMirrorMask(rc, m_dab);
+    }
     painter()->setOpacity(origOpacity);
 
     return computeSpacing(info, lodScale);
@@ -139,6 +189,40 @@ KisSpacingInformation KisSprayPaintOp::updateSpacingImpl(const KisPaintInformati
     return computeSpacing(info, KisLodTransform::lodToScale(painter()->device()));
 }
 
+std::pair<int, bool> KisSprayPaintOp::doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs)
+{
+    return m_dabRenderer ?
+        m_dabRenderer->doAsyncronousUpdate(jobs) :
+        KisPaintOp::doAsyncronousUpdate(jobs);
+}
+
+QSharedPointer<SprayBrush> KisSprayPaintOp::acquireSprayBrush()
+{
+    QMutexLocker l(&m_sprayBrushesMutex);
+
+    if (!m_freeSprayBrushes.isEmpty()) {
+        return m_freeSprayBrushes.takeLast();
+    }
+
+    KisBrushSP brush = m_brushOption.brush();
+    if (brush) {
+        brush = brush->clone();
+    }
+
+    QSharedPointer<SprayBrush> sprayBrush(new SprayBrush());
+    sprayBrush->setProperties(&m_properties, &m_colorProperties,
+                              &m_shapeProperties, &m_shapeDynamicsProperties, brush);
+    sprayBrush->setFixedDab(new KisFixedPaintDevice(m_dabColorSpace));
+
+    return sprayBrush;
+}
+
+void KisSprayPaintOp::releaseSprayBrush(QSharedPointer<SprayBrush> brush)
+{
+    QMutexLocker l(&m_sprayBrushesMutex);
+    m_freeSprayBrushes.append(brush);
+}
+
 KisTimingInformation KisSprayPaintOp::updateTimingImpl(const KisPaintInformation &info) const
 {
     return KisPaintOpPluginUtils::effectiveTiming(&m_airbrushOption, &m_rateOption, info);
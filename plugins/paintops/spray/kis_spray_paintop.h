@@ -31,6 +31,12 @@
 #include <kis_pressure_size_option.h>
 #include <kis_pressure_rate_option.h>
 
+#include <QMutex>
+#include <QSharedPointer>
+#include <QScopedPointer>
+
+class KisParallelDabRenderer;
+
 class KisPainter;
 
 
@@ -50,9 +56,14 @@ protected:
 
     KisTimingInformation updateTimingImpl(const KisPaintInformation &info) const override;
 
+    std::pair<int, bool> doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs) override;
+
 private:
     KisSpacingInformation computeSpacing(const KisPaintInformation &info, qreal lodScale) const;
 
+    QSharedPointer<SprayBrush> acquireSprayBrush();
+    void releaseSprayBrush(QSharedPointer<SprayBrush> brush);
+
 private:
     KisShapeProperties m_shapeProperties;
     KisSprayOptionProperties m_properties;
@@ -70,6 +81,19 @@ private:
     KisPressureOpacityOption m_opacityOption;
     KisPressureRateOption m_rateOption;
     KisNodeSP m_node;
+
+    /// the color space of the fixed dabs, shared by all the spray brushes
+    const KoColorSpace *m_dabColorSpace;
+
+    /**
+     * The dabs are rendered on the worker threads. Every thread takes
+     * its own copy of the spray brush from the pool, because the brush
+     * keeps its intermediate rendering state.
+     */
+    QScopedPointer<KisParallelDabRenderer> m_dabRenderer;
+    bool m_canRenderInParallel;
+    QMutex m_sprayBrushesMutex;
+    QVector<QSharedPointer<SprayBrush>> m_freeSprayBrushes;
 };
 
 #endif // KIS_SPRAY_PAINTOP_H_
@@ -65,6 +65,11 @@ bool KisSprayPaintOpSettings::paintIncremental()
     return (enumPaintActionType)getInt("PaintOpAction", WASH) == BUILDUP;
 }
 
+bool KisSprayPaintOpSettings::needsAsynchronousUpdates() const
+{
+    return !getBool(COLOROP_SAMPLE_COLOR, false);
+}
+
 
 QPainterPath KisSprayPaintOpSettings::brushOutline(const KisPaintInformation &info, const OutlineMode &mode)
 {
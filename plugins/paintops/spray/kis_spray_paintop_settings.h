@@ -45,6 +45,12 @@ public:
 
     bool paintIncremental() override;
 
+    /**
+     * The dabs are rendered in parallel unless the particles
+     * sample the color of the canvas
+     */
+    bool needsAsynchronousUpdates() const override;
+
 protected:
 
     QList<KisUniformPaintOpPropertySP> uniformProperties(KisPaintOpSettingsSP settings) override;
@@ -128,6 +128,10 @@ void SprayBrush::paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,
             m_brushQImage = m_brushQImage.scaled(m_shapeProperties->width, m_shapeProperties->height);
         }
         m_imageDevice = new KisPaintDevice(dab->colorSpace());
+    } else if (m_painter->device() != dab) {
+        // the brush may be reused for rendering into different dab devices
+        m_painter->begin(dab);
+        m_painter->setFillStyle(KisPainter::FillStyleForegroundColor);
     }
 
 